@@ -0,0 +1,137 @@
+#include <chrono>
+#include <cfloat>
+#include "BallIntegrator.h"
+#include "Collision.h"
+#include "Function.h"
+#include "Heightfield.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+namespace {
+// 並列に処理するときに1つの区切りで扱うボールの数(1個あたり全形状と判定するので小さめ)
+constexpr size_t kGrainSize = 64;
+
+// 全形状の中で最初に当たるものを探す
+bool FindFirstImpact(const Sphere& sphere, const Vector3& displacement, const StaticColliders& colliders, Impact& first) {
+	bool hit = false;
+	first.time = FLT_MAX;
+	Impact impact;
+	for (const Plane& plane : colliders.planes) {
+		if (SweepSphere(sphere, displacement, plane, impact) && impact.time < first.time) {
+			first = impact;
+			hit = true;
+		}
+	}
+	for (const Triangle& triangle : colliders.triangles) {
+		if (SweepSphere(sphere, displacement, triangle, impact) && impact.time < first.time) {
+			first = impact;
+			hit = true;
+		}
+	}
+	for (const OBB& obb : colliders.obbs) {
+		if (SweepSphere(sphere, displacement, obb, impact) && impact.time < first.time) {
+			first = impact;
+			hit = true;
+		}
+	}
+	if (colliders.heightfield != nullptr && colliders.heightfield->SweepSphere(sphere, displacement, impact) && impact.time < first.time) {
+		first = impact;
+		hit = true;
+	}
+	return hit;
+}
+}
+
+void BallIntegrator::Step(std::span<Ball> balls, const StaticColliders& colliders, float deltaTime) {
+	MT4_PROFILE_ZONE("BallIntegrator::Step");
+	const auto start = std::chrono::steady_clock::now();
+	const uint32_t threadCount = pool_ != nullptr ? pool_->GetThreadCount() : 1;
+	counters_.assign(threadCount, Counter{});
+	auto range = [&](size_t begin, size_t end, uint32_t threadIndex) {
+		Counter& counter = counters_[threadIndex];
+		for (size_t i = begin; i < end; ++i) {
+			if (balls[i].mass <= 0.0f) {
+				continue;
+			}
+			if (mode_ == Mode::Discrete) {
+				counter.impactCount += StepDiscrete(balls[i], colliders, deltaTime);
+			} else {
+				bool clamped = false;
+				counter.impactCount += StepContinuous(balls[i], colliders, deltaTime, clamped);
+				counter.clampedCount += clamped ? 1 : 0;
+			}
+		}
+	};
+	if (pool_ == nullptr) {
+		range(0, balls.size(), 0u);
+	} else {
+		pool_->ParallelFor(balls.size(), kGrainSize, range);
+	}
+
+	statistics_ = {};
+	statistics_.ballCount = balls.size();
+	for (const Counter& counter : counters_) {
+		statistics_.impactCount += counter.impactCount;
+		statistics_.clampedCount += counter.clampedCount;
+	}
+	statistics_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+Vector3 BallIntegrator::Bounce(const Vector3& velocity, const Vector3& normal) const {
+	// Reflectは法線方向の速度を反転する。そこから(1 - restitution)倍を戻して弱める
+	return Reflect(velocity, normal) + normal * (Dot(velocity, normal) * (1.0f - restitution_));
+}
+
+uint32_t BallIntegrator::StepDiscrete(Ball& ball, const StaticColliders& colliders, float deltaTime) const {
+	ball.velocity += ball.acceleration * deltaTime;
+	ball.position += ball.velocity * deltaTime;
+	uint32_t impacts = 0;
+	// 重なっていれば法線方向に押し戻し、近づく向きの速度なら跳ね返す
+	auto push = [&](const Contact& contact) {
+		ball.position -= contact.normal * contact.depth;
+		if (Dot(ball.velocity, contact.normal) > 0.0f) {
+			ball.velocity = Bounce(ball.velocity, contact.normal);
+			++impacts;
+		}
+	};
+	auto resolve = [&](const auto& shape) {
+		Contact contact;
+		if (IsCollision(Sphere{ ball.position, ball.radius, ball.color }, shape, contact)) {
+			push(contact);
+		}
+	};
+	for (const Plane& plane : colliders.planes) {
+		resolve(plane);
+	}
+	for (const Triangle& triangle : colliders.triangles) {
+		resolve(triangle);
+	}
+	for (const OBB& obb : colliders.obbs) {
+		resolve(obb);
+	}
+	Contact contact;
+	if (colliders.heightfield != nullptr && colliders.heightfield->IsCollision(Sphere{ ball.position, ball.radius, ball.color }, contact)) {
+		push(contact);
+	}
+	return impacts;
+}
+
+uint32_t BallIntegrator::StepContinuous(Ball& ball, const StaticColliders& colliders, float deltaTime, bool& clamped) const {
+	ball.velocity += ball.acceleration * deltaTime;
+	// 残りの時間で進む距離を調べ、当たったらそこまで進めて跳ね返る
+	float remaining = deltaTime;
+	for (uint32_t impacts = 0; impacts < maxImpacts_; ++impacts) {
+		const Vector3 displacement = ball.velocity * remaining;
+		Impact impact;
+		if (!FindFirstImpact(Sphere{ ball.position, ball.radius, ball.color }, displacement, colliders, impact)) {
+			ball.position += displacement;
+			return impacts;
+		}
+		ball.position += displacement * impact.time;
+		ball.velocity = Bounce(ball.velocity, impact.normal);
+		remaining *= 1.0f - impact.time;
+	}
+	// 上限まで跳ね返ったら、すり抜けないよう残りの時間は進めない
+	clamped = true;
+	return maxImpacts_;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Struct.h"
+
+class Heightfield;
+class ThreadPool;
+
+// ボールが当たる動かない形状の一覧(配列は呼び出し側が持つ)
+struct StaticColliders {
+	std::span<const Plane> planes;
+	std::span<const Triangle> triangles;
+	std::span<const OBB> obbs;
+	const Heightfield* heightfield = nullptr; // 地形(無ければnullptr)
+};
+
+// Ballの配列を動かない形状と衝突させながら進める
+// 速度は velocity += acceleration * deltaTime で先に更新し、新しい速度で位置を進める(半陰的Euler)
+// 跳ね返りは反発係数をかけたReflect(法線方向の速度だけ -restitution 倍になる)。ボール同士は当たらない
+// massが0以下のボールは動かない(SpringSystemと同じ)
+class BallIntegrator {
+public:
+	enum class Mode {
+		// 位置を進めてから重なっている形状の外へ押し戻す。速いボールは薄い形状をすり抜ける
+		Discrete,
+		// 最初に当たる時刻まで進めて跳ね返り、残りの時間でさらに進める(SweepSphere)
+		// サブステップを使わずに大きな刻み幅でもすり抜けない
+		Continuous,
+	};
+
+	// 直近のStepの統計
+	struct Statistics {
+		size_t ballCount;
+		size_t impactCount;  // 跳ね返った回数の合計
+		size_t clampedCount; // 1ステップの衝突回数の上限に達して、残りの時間を進めなかったボールの数
+		double seconds;
+	};
+
+	void SetMode(Mode mode) { mode_ = mode; }
+	Mode GetMode() const { return mode_; }
+	// 反発係数(0で法線方向に止まる、1で完全に跳ね返る)
+	void SetRestitution(float restitution) { restitution_ = restitution; }
+	// 1つのボールが1ステップで跳ね返る最大回数。角に挟まったときに無限に跳ね返り続けるのを防ぐ
+	void SetMaxImpacts(uint32_t maxImpacts) { maxImpacts_ = maxImpacts; }
+	// nullptrなら呼び出したスレッドだけで処理する
+	void SetThreadPool(ThreadPool* pool) { pool_ = pool; }
+
+	// 全ボールをdeltaTimeだけ進める。ボールごとに独立しているので、結果はスレッド数によらず同じ
+	void Step(std::span<Ball> balls, const StaticColliders& colliders, float deltaTime);
+
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private:
+	// ボールを進めて、跳ね返った回数を返す。上限に達して残りの時間を捨てたらclampedを立てる
+	uint32_t StepDiscrete(Ball& ball, const StaticColliders& colliders, float deltaTime) const;
+	uint32_t StepContinuous(Ball& ball, const StaticColliders& colliders, float deltaTime, bool& clamped) const;
+	// 法線方向の速度を反発係数に合わせて跳ね返す
+	Vector3 Bounce(const Vector3& velocity, const Vector3& normal) const;
+
+	// スレッドごとの集計
+	struct Counter {
+		size_t impactCount;
+		size_t clampedCount;
+	};
+
+	Mode mode_ = Mode::Continuous;
+	float restitution_ = 1.0f;
+	uint32_t maxImpacts_ = 8;
+	ThreadPool* pool_ = nullptr;
+	std::vector<Counter> counters_;
+	Statistics statistics_ = {};
+};
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include "Benchmark.h"
+#include "Profiler.h"
+
+namespace Benchmark {
+
+#if defined(_MSC_VER) && !defined(__clang__)
+void UseCharPointer(const volatile char*) {}
+#endif
+
+namespace {
+// 計測の繰り返し回数。一番速かった回を採用して、割り込みなどの影響を減らす
+constexpr int kRepetitions = 5;
+
+double Measure(const CaseFunction& function, uint64_t iterations) {
+	auto start = std::chrono::steady_clock::now();
+	function(iterations);
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+// JSONの文字列として書けるようにエスケープする
+std::string Escape(const std::string& text) {
+	std::string result;
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			result += '\\';
+		}
+		result += c;
+	}
+	return result;
+}
+}
+
+void Runner::Add(std::string name, CaseFunction function, uint64_t opsPerIteration, bool heavy) {
+	cases_.push_back({ std::move(name), std::move(function), opsPerIteration, heavy });
+}
+
+std::vector<Result> Runner::Run() const {
+	std::vector<Result> results;
+	std::printf("%-48s %14s %16s %12s\n", "name", "ns/op", "ops/sec", "iterations");
+	for (const Case& benchmarkCase : cases_) {
+		if (!filter_.empty() && benchmarkCase.name.find(filter_) == std::string::npos) {
+			continue;
+		}
+		if (skipHeavy_ && benchmarkCase.heavy) {
+			continue;
+		}
+
+		// プロファイラにはケースごとに1フレームとして記録する(--traceで書き出す)
+		MT4_PROFILE_BEGIN_FRAME();
+		const double target = minTime_ / kRepetitions;
+		uint64_t iterations = 1;
+		double best = 0.0;
+		uint64_t total = 0;
+		{
+			MT4_PROFILE_ZONE(benchmarkCase.name.c_str());
+			// 1回分の計測時間がminTime_ / kRepetitionsを超えるまで回数を増やす
+			double elapsed = Measure(benchmarkCase.function, iterations);
+			while (elapsed < target) {
+				double scale = elapsed > 0.0 ? target / elapsed * 1.2 : 10.0;
+				scale = std::clamp(scale, 2.0, 10.0);
+				iterations = static_cast<uint64_t>(static_cast<double>(iterations) * scale);
+				elapsed = Measure(benchmarkCase.function, iterations);
+			}
+			best = elapsed;
+			total = iterations;
+			for (int repetition = 1; repetition < kRepetitions; ++repetition) {
+				best = std::min(best, Measure(benchmarkCase.function, iterations));
+				total += iterations;
+			}
+		}
+		MT4_PROFILE_END_FRAME();
+
+		Result result;
+		result.name = benchmarkCase.name;
+		result.iterations = total;
+		double ops = static_cast<double>(iterations) * static_cast<double>(benchmarkCase.opsPerIteration);
+		result.nsPerOp = best * 1e9 / ops;
+		result.opsPerSecond = ops / best;
+		std::printf("%-48s %14.3f %16.4g %12llu\n", result.name.c_str(), result.nsPerOp, result.opsPerSecond,
+			static_cast<unsigned long long>(result.iterations));
+		std::fflush(stdout);
+		results.push_back(result);
+	}
+	return results;
+}
+
+bool WriteJson(const std::string& path, const std::vector<Result>& results) {
+	std::ofstream file(path);
+	if (!file) {
+		return false;
+	}
+	file << "{\n\t\"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result& result = results[i];
+		char numbers[160];
+		std::snprintf(numbers, sizeof(numbers), "\"iterations\": %llu, \"nsPerOp\": %.6g, \"opsPerSecond\": %.6g",
+			static_cast<unsigned long long>(result.iterations), result.nsPerOp, result.opsPerSecond);
+		file << "\t\t{ \"name\": \"" << Escape(result.name) << "\", " << numbers << " }";
+		file << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	file << "\t]\n}\n";
+	return static_cast<bool>(file);
+}
+
+bool ReadJson(const std::string& path, std::vector<Result>& results) {
+	std::ifstream file(path);
+	if (!file) {
+		return false;
+	}
+	std::stringstream stream;
+	stream << file.rdbuf();
+	const std::string text = stream.str();
+
+	// WriteJsonの形式だけ読めればよいので、キーを順に探す
+	auto findNumber = [&](const char* key, size_t from, size_t to, double& value) {
+		size_t position = text.find(key, from);
+		if (position == std::string::npos || position > to) {
+			return false;
+		}
+		position = text.find(':', position);
+		if (position == std::string::npos) {
+			return false;
+		}
+		value = std::strtod(text.c_str() + position + 1, nullptr);
+		return true;
+	};
+
+	results.clear();
+	size_t position = 0;
+	for (;;) {
+		position = text.find("\"name\"", position);
+		if (position == std::string::npos) {
+			break;
+		}
+		size_t begin = text.find('"', text.find(':', position));
+		if (begin == std::string::npos) {
+			return false;
+		}
+		std::string name;
+		size_t cursor = begin + 1;
+		for (; cursor < text.size() && text[cursor] != '"'; ++cursor) {
+			if (text[cursor] == '\\' && cursor + 1 < text.size()) {
+				++cursor;
+			}
+			name += text[cursor];
+		}
+		size_t end = text.find('}', cursor);
+		if (end == std::string::npos) {
+			return false;
+		}
+		Result result = { name, 0, 0.0, 0.0 };
+		double iterations = 0.0;
+		if (!findNumber("\"nsPerOp\"", cursor, end, result.nsPerOp)) {
+			return false;
+		}
+		findNumber("\"opsPerSecond\"", cursor, end, result.opsPerSecond);
+		findNumber("\"iterations\"", cursor, end, iterations);
+		result.iterations = static_cast<uint64_t>(iterations);
+		results.push_back(result);
+		position = end;
+	}
+	return true;
+}
+
+std::vector<Comparison> Compare(const std::vector<Result>& baseline, const std::vector<Result>& results, double threshold) {
+	std::vector<Comparison> comparisons;
+	for (const Result& result : results) {
+		auto found = std::find_if(baseline.begin(), baseline.end(), [&](const Result& base) { return base.name == result.name; });
+		if (found == baseline.end() || found->nsPerOp <= 0.0) {
+			// 新しく追加したケースは比べない
+			continue;
+		}
+		Comparison comparison;
+		comparison.name = result.name;
+		comparison.baselineNsPerOp = found->nsPerOp;
+		comparison.nsPerOp = result.nsPerOp;
+		comparison.ratio = result.nsPerOp / found->nsPerOp;
+		comparison.regressed = comparison.ratio > 1.0 + threshold;
+		comparisons.push_back(comparison);
+	}
+	return comparisons;
+}
+
+} // namespace Benchmark
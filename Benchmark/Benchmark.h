@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// 計測ツール用の小さなベンチマークの仕組み
+// 各ケースは「iterations回分の処理をする関数」として登録し、Runnerが回数を調整しながら計測する
+namespace Benchmark {
+
+// 計測結果
+struct Result {
+	std::string name;
+	uint64_t iterations;  // 計測した回数(ケースの関数に渡した回数の合計)
+	double nsPerOp;       // 1操作あたりのナノ秒
+	double opsPerSecond;  // 1秒あたりの操作数
+};
+
+// 比較の結果
+struct Comparison {
+	std::string name;
+	double baselineNsPerOp;
+	double nsPerOp;
+	double ratio; // nsPerOp / baselineNsPerOp。1より大きいと遅くなっている
+	bool regressed;
+};
+
+// iterations回分の処理をする
+using CaseFunction = std::function<void(uint64_t iterations)>;
+
+class Runner {
+public:
+	// ケースを登録する
+	// opsPerIterationは1回あたりの操作数(配列をまとめて処理するケースでは要素数)。ns/opはこれで割った値になる
+	// heavyなケースは--quickでは飛ばす
+	void Add(std::string name, CaseFunction function, uint64_t opsPerIteration = 1, bool heavy = false);
+
+	// 1つのケースに使う計測時間(秒)
+	void SetMinTime(double seconds) { minTime_ = seconds; }
+	// 名前にfilterを含むケースだけ計測する
+	void SetFilter(std::string filter) { filter_ = std::move(filter); }
+	void SetSkipHeavy(bool skipHeavy) { skipHeavy_ = skipHeavy; }
+
+	// 登録されたケースを順に計測して結果を表示する
+	std::vector<Result> Run() const;
+
+private:
+	struct Case {
+		std::string name;
+		CaseFunction function;
+		uint64_t opsPerIteration;
+		bool heavy;
+	};
+	std::vector<Case> cases_;
+	double minTime_ = 0.2;
+	std::string filter_;
+	bool skipHeavy_ = false;
+};
+
+// 結果をJSONとして書き出す。失敗したらfalseを返す
+bool WriteJson(const std::string& path, const std::vector<Result>& results);
+// WriteJsonで書き出したJSONを読み込む。失敗したらfalseを返す
+bool ReadJson(const std::string& path, std::vector<Result>& results);
+// 基準の結果と比べ、thresholdより(割合で)遅くなったケースにregressedを立てる
+std::vector<Comparison> Compare(const std::vector<Result>& baseline, const std::vector<Result>& results, double threshold);
+
+// 計算結果を使ったことにして、最適化で処理ごと消されないようにする
+#if defined(_MSC_VER) && !defined(__clang__)
+void UseCharPointer(const volatile char* pointer);
+template<typename T>
+inline void DoNotOptimize(const T& value) {
+	UseCharPointer(&reinterpret_cast<const volatile char&>(value));
+	_ReadWriteBarrier();
+}
+#else
+template<typename T>
+inline void DoNotOptimize(const T& value) {
+	asm volatile("" : : "m"(value) : "memory");
+}
+#endif
+
+} // namespace Benchmark
+
+// 各ファイルのケースを登録する
+void RegisterFunctionBenchmarks(Benchmark::Runner& runner);
+void RegisterCollisionBenchmarks(Benchmark::Runner& runner);
+void RegisterPhysicsBenchmarks(Benchmark::Runner& runner);
+void RegisterRenderBenchmarks(Benchmark::Runner& runner);
+void RegisterRayCastBenchmarks(Benchmark::Runner& runner);
+void RegisterObjLoaderBenchmarks(Benchmark::Runner& runner);
+void RegisterJobSystemBenchmarks(Benchmark::Runner& runner);
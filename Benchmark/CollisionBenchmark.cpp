@@ -0,0 +1,397 @@
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "Collision.h"
+#include "DynamicAABBTree.h"
+#include "FrameArena.h"
+#include "Frustum.h"
+#include "Function.h"
+#include "SignedDistanceField.h"
+#include "SpatialHashGrid.h"
+#include "ThreadPool.h"
+
+namespace {
+constexpr size_t kDataSize = 1024;
+constexpr size_t kDataMask = kDataSize - 1;
+
+struct Shapes {
+	std::vector<Sphere> spheres;
+	std::vector<Segment> segments;
+	std::vector<Triangle> triangles;
+	std::vector<AABB> aabbs;
+	std::vector<OBB> obbs;
+	std::vector<Capsule> capsules;
+
+	Shapes() {
+		std::mt19937 random(54321);
+		std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+		std::uniform_real_distribution<float> size(0.2f, 1.5f);
+		std::uniform_real_distribution<float> angle(-3.14f, 3.14f);
+		auto point = [&]() { return Vector3{ position(random), position(random), position(random) }; };
+		for (size_t i = 0; i < kDataSize; ++i) {
+			spheres.push_back({ point(), size(random), 0 });
+			segments.push_back({ point(), point(), 0 });
+			triangles.push_back({ { point(), point(), point() }, 0 });
+			Vector3 center = point();
+			Vector3 extent = { size(random), size(random), size(random) };
+			aabbs.push_back({ center - extent, center + extent, 0 });
+			Matrix4x4 rotate = MakeRotateMatrix(angle(random), angle(random), angle(random));
+			OBB obb = {};
+			obb.center = point();
+			for (int axis = 0; axis < 3; ++axis) {
+				obb.orientations[axis] = { rotate.m[axis][0], rotate.m[axis][1], rotate.m[axis][2] };
+			}
+			obb.size = { size(random), size(random), size(random) };
+			obbs.push_back(obb);
+			capsules.push_back({ { point(), point() * 0.3f, 0 }, size(random) * 0.5f });
+		}
+	}
+};
+
+const Shapes& GetShapes() {
+	static Shapes shapes;
+	return shapes;
+}
+
+template<typename Function>
+Benchmark::CaseFunction Loop(Function function) {
+	return [function](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Benchmark::DoNotOptimize(function(static_cast<size_t>(i) & kDataMask));
+		}
+	};
+}
+
+// 半径0.5のボールを、平均して1つあたり数個と重なる密度で立方体の中にばらまく
+std::vector<Sphere> MakeBalls(size_t count, uint32_t seed) {
+	const float side = std::cbrt(static_cast<float>(count) * 8.0f);
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> position(0.0f, side);
+	std::vector<Sphere> balls(count);
+	for (Sphere& ball : balls) {
+		ball = { { position(random), position(random), position(random) }, 0.5f, 0 };
+	}
+	return balls;
+}
+
+// カメラの前後左右に広くばらまいた物体(視錐台に入るのは一部だけ)
+constexpr size_t kCullingCount = 100000;
+// フレームごとに作る接触の一覧の数と、1つの一覧の接触の数
+constexpr size_t kContactListCount = 256;
+constexpr size_t kContactsPerList = 16;
+
+std::string CountLabel(size_t count) {
+	return count >= 1000 ? std::to_string(count / 1000) + "k" : std::to_string(count);
+}
+}
+
+void RegisterCollisionBenchmarks(Benchmark::Runner& runner) {
+	static const Shapes& s = GetShapes();
+
+#pragma region 衝突判定
+	runner.Add("Collision/Sphere-Triangle", Loop([](size_t i) { return IsCollision(s.spheres[i], s.triangles[i]); }));
+	runner.Add("Collision/Sphere-OBB", Loop([](size_t i) { return IsCollision(s.spheres[i], s.obbs[i]); }));
+	runner.Add("Collision/Segment-Triangle", Loop([](size_t i) { return IsCollision(s.segments[i], s.triangles[i]); }));
+	runner.Add("Collision/Segment-OBB", Loop([](size_t i) { return IsCollision(s.segments[i], s.obbs[i]); }));
+	runner.Add("Collision/Triangle-Triangle", Loop([](size_t i) { return IsCollision(s.triangles[i], s.triangles[(i + 1) & kDataMask]); }));
+	runner.Add("Collision/Triangle-AABB", Loop([](size_t i) { return IsCollision(s.triangles[i], s.aabbs[i]); }));
+	runner.Add("Collision/AABB-AABB", Loop([](size_t i) { return IsCollision(s.aabbs[i], s.aabbs[(i + 1) & kDataMask]); }));
+	runner.Add("Collision/OBB-OBB", Loop([](size_t i) { return IsCollision(s.obbs[i], s.obbs[(i + 1) & kDataMask]); }));
+	runner.Add("Collision/OBB-Capsule", Loop([](size_t i) { return IsCollision(s.obbs[i], s.capsules[i]); }));
+	runner.Add("Collision/Capsule-Capsule", Loop([](size_t i) { return IsCollision(s.capsules[i], s.capsules[(i + 1) & kDataMask]); }));
+	runner.Add("Collision/Contact(OBB-OBB)", Loop([](size_t i) {
+		Contact contact;
+		bool hit = IsCollision(s.obbs[i], s.obbs[(i + 1) & kDataMask], contact);
+		Benchmark::DoNotOptimize(contact);
+		return hit;
+	}));
+	runner.Add("Collision/Contact(Capsule-Capsule)", Loop([](size_t i) {
+		Contact contact;
+		bool hit = IsCollision(s.capsules[i], s.capsules[(i + 1) & kDataMask], contact);
+		Benchmark::DoNotOptimize(contact);
+		return hit;
+	}));
+	// 球を線分の向きに動かしたときの衝突時刻
+	runner.Add("Collision/SweepSphere-Triangle", Loop([](size_t i) {
+		Impact impact;
+		bool hit = SweepSphere(s.spheres[i], s.segments[i].diff, s.triangles[i], impact);
+		Benchmark::DoNotOptimize(impact);
+		return hit;
+	}));
+	runner.Add("Collision/SweepSphere-OBB", Loop([](size_t i) {
+		Impact impact;
+		bool hit = SweepSphere(s.spheres[i], s.segments[i].diff, s.obbs[i], impact);
+		Benchmark::DoNotOptimize(impact);
+		return hit;
+	}));
+	auto hits = std::make_shared<std::vector<uint32_t>>(kDataSize);
+	runner.Add("Collision/Sphere-AABB(span)", [hits](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Benchmark::DoNotOptimize(IsCollision(s.spheres[i & kDataMask], s.aabbs, *hits));
+		}
+	}, kDataSize);
+	runner.Add("Collision/Sphere-OBB(span)", [hits](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Benchmark::DoNotOptimize(IsCollision(s.spheres[i & kDataMask], s.obbs, *hits));
+		}
+	}, kDataSize);
+#pragma endregion
+
+#pragma region ブロードフェーズ
+	// 1フレーム分の全組の検出(ns/opは1フレームあたり)。総当たりの100kは時間がかかるので--quickでは飛ばす
+	for (size_t count : { size_t(1000), size_t(10000), size_t(100000) }) {
+		auto balls = std::make_shared<std::vector<Sphere>>(MakeBalls(count, static_cast<uint32_t>(count)));
+		const std::string label = CountLabel(count);
+		runner.Add("BroadPhase/BruteForce(" + label + ")", [balls](uint64_t iterations) {
+			const std::vector<Sphere>& b = *balls;
+			for (uint64_t i = 0; i < iterations; ++i) {
+				size_t pairs = 0;
+				for (size_t a = 0; a < b.size(); ++a) {
+					for (size_t c = a + 1; c < b.size(); ++c) {
+						pairs += IsCollision(b[a], b[c]);
+					}
+				}
+				Benchmark::DoNotOptimize(pairs);
+			}
+		}, 1, count >= 100000);
+		auto grid = std::make_shared<SpatialHashGrid>();
+		auto pairs = std::make_shared<std::vector<SpatialHashGrid::Pair>>();
+		runner.Add("BroadPhase/SpatialHashGrid(" + label + ")", [balls, grid, pairs](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; ++i) {
+				grid->Build(*balls);
+				grid->FindPairs(*pairs);
+				Benchmark::DoNotOptimize(pairs->size());
+			}
+		});
+		runner.Add("BroadPhase/SpatialHashGrid(" + label + ",threads)", [balls, grid, pairs](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; ++i) {
+				grid->Build(*balls);
+				grid->FindPairs(*pairs, &ThreadPool::GetDefault());
+				Benchmark::DoNotOptimize(pairs->size());
+			}
+		});
+
+		// 全部を少しずつ動かして、組み替えた分のペアを求める
+		auto tree = std::make_shared<DynamicAABBTree>(0.1f);
+		auto proxies = std::make_shared<std::vector<int32_t>>();
+		for (size_t i = 0; i < count; ++i) {
+			proxies->push_back(tree->CreateProxy(MakeAABB((*balls)[i]), static_cast<uint32_t>(i)));
+		}
+		auto treePairs = std::make_shared<std::vector<DynamicAABBTree::Pair>>();
+		tree->QueryAllPairs(*treePairs);
+		runner.Add("BroadPhase/DynamicAABBTree(" + label + ",move+pairs)", [balls, tree, proxies, treePairs](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; ++i) {
+				// 毎回同じ動きにならないよう、フレームごとに向きを変えて往復させる
+				const float offset = (i & 1) ? -0.05f : 0.05f;
+				for (size_t ball = 0; ball < balls->size(); ++ball) {
+					Sphere moved = (*balls)[ball];
+					moved.center.x += (ball & 1) ? offset : -offset;
+					tree->MoveProxy((*proxies)[ball], MakeAABB(moved), { offset, 0.0f, 0.0f });
+				}
+				tree->QueryMovedPairs(*treePairs);
+				Benchmark::DoNotOptimize(treePairs->size());
+			}
+		});
+		runner.Add("BroadPhase/DynamicAABBTree(" + label + ",raycast)", [tree](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; ++i) {
+				const Shapes& shapes = GetShapes();
+				Segment ray = shapes.segments[i & kDataMask];
+				ray.diff = ray.diff * 20.0f;
+				int hitCount = 0;
+				tree->RayCast(ray, [&](int32_t, const Segment&, float maxFraction) {
+					++hitCount;
+					return maxFraction;
+				});
+				Benchmark::DoNotOptimize(hitCount);
+			}
+		});
+	}
+#pragma endregion
+
+#pragma region 視錐台カリング
+	// ns/opは物体1個あたり。カメラを毎フレーム少しずつ回すので、覚えておいた平面がほぼ当たる
+	auto cullingSpheres = std::make_shared<std::vector<Sphere>>(kCullingCount);
+	auto cullingAABBs = std::make_shared<std::vector<AABB>>(kCullingCount);
+	{
+		std::mt19937 random(2024);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> size(0.2f, 2.0f);
+		for (size_t i = 0; i < kCullingCount; ++i) {
+			Vector3 center = { position(random), position(random) * 0.2f, position(random) };
+			(*cullingSpheres)[i] = { center, size(random), 0 };
+			Vector3 extent = { size(random), size(random), size(random) };
+			(*cullingAABBs)[i] = { center - extent, center + extent, 0 };
+		}
+	}
+	const Matrix4x4 projection = MakePerspectiveFovMatrix(0.45f, 16.0f / 9.0f, 0.1f, 100.0f);
+	auto frustumOfFrame = [projection](uint64_t frame) {
+		Vector3 scale = { 1.0f, 1.0f, 1.0f };
+		Vector3 rotate = { 0.0f, static_cast<float>(frame & 63) * 0.01f, 0.0f };
+		Vector3 translate = { 0.0f, 0.0f, -10.0f };
+		return MakeFrustum(Multiply(InverseRigid(MakeAffineMatrix(scale, rotate, translate)), projection));
+	};
+	auto visible = std::make_shared<std::vector<uint32_t>>();
+	runner.Add("Culling/IsVisible(Sphere)", [cullingSpheres, frustumOfFrame](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			const Frustum frustum = frustumOfFrame(i);
+			size_t count = 0;
+			for (const Sphere& sphere : *cullingSpheres) {
+				count += IsVisible(frustum, sphere);
+			}
+			Benchmark::DoNotOptimize(count);
+		}
+	}, kCullingCount);
+	auto sphereCuller = std::make_shared<FrustumCuller>();
+	runner.Add("Culling/FrustumCuller(Sphere)", [cullingSpheres, frustumOfFrame, sphereCuller, visible](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			sphereCuller->SetFrustum(frustumOfFrame(i));
+			Benchmark::DoNotOptimize(sphereCuller->Cull(*cullingSpheres, *visible));
+		}
+	}, kCullingCount);
+	runner.Add("Culling/FrustumCuller(Sphere,no cache)", [cullingSpheres, frustumOfFrame, sphereCuller, visible](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			sphereCuller->ResetCache();
+			sphereCuller->SetFrustum(frustumOfFrame(i));
+			Benchmark::DoNotOptimize(sphereCuller->Cull(*cullingSpheres, *visible));
+		}
+	}, kCullingCount);
+	runner.Add("Culling/IsVisible(AABB)", [cullingAABBs, frustumOfFrame](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			const Frustum frustum = frustumOfFrame(i);
+			size_t count = 0;
+			for (const AABB& aabb : *cullingAABBs) {
+				count += IsVisible(frustum, aabb);
+			}
+			Benchmark::DoNotOptimize(count);
+		}
+	}, kCullingCount);
+	auto aabbCuller = std::make_shared<FrustumCuller>();
+	runner.Add("Culling/FrustumCuller(AABB)", [cullingAABBs, frustumOfFrame, aabbCuller, visible](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			aabbCuller->SetFrustum(frustumOfFrame(i));
+			Benchmark::DoNotOptimize(aabbCuller->Cull(*cullingAABBs, *visible));
+		}
+	}, kCullingCount);
+#pragma endregion
+
+#pragma region フレームアリーナ
+	// 毎フレーム作って捨てる結果の置き場所を、ヒープとFrameArenaで比べる(1回が1フレーム)
+	// カリング: ns/opは物体1個あたり。ヒープの版はフレームごとに新しい配列を作る
+	auto frameArena = std::make_shared<FrameArena>(1 << 20);
+	runner.Add("FrameArena/Cull(Sphere,heap)", [cullingSpheres, frustumOfFrame, sphereCuller](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			std::vector<uint32_t> frameVisible;
+			sphereCuller->SetFrustum(frustumOfFrame(i));
+			Benchmark::DoNotOptimize(sphereCuller->Cull(*cullingSpheres, frameVisible));
+		}
+	}, kCullingCount);
+	runner.Add("FrameArena/Cull(Sphere,arena)", [cullingSpheres, frustumOfFrame, sphereCuller, frameArena](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			std::span<uint32_t> frameVisible = frameArena->Get().AllocateArray<uint32_t>(cullingSpheres->size());
+			sphereCuller->SetFrustum(frustumOfFrame(i));
+			Benchmark::DoNotOptimize(sphereCuller->Cull(*cullingSpheres, frameVisible));
+			frameArena->EndFrame();
+		}
+	}, kCullingCount);
+	// 接触の一覧: ns/opは接触1個あたり。小さな配列をたくさん作って少しずつ積む
+	auto pushContacts = [](auto& contacts, size_t list) {
+		for (size_t j = 0; j < kContactsPerList; ++j) {
+			const float value = static_cast<float>(list + j);
+			contacts.push_back({ { value, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, value * 0.01f });
+		}
+	};
+	runner.Add("FrameArena/ContactLists(heap)", [pushContacts](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			for (size_t list = 0; list < kContactListCount; ++list) {
+				std::vector<Contact> contacts;
+				pushContacts(contacts, list);
+				Benchmark::DoNotOptimize(contacts.back());
+			}
+		}
+	}, kContactListCount * kContactsPerList);
+	runner.Add("FrameArena/ContactLists(arena)", [pushContacts, frameArena](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			for (size_t list = 0; list < kContactListCount; ++list) {
+				FrameVector<Contact> contacts{ FrameAllocator<Contact>(frameArena->Get()) };
+				pushContacts(contacts, list);
+				Benchmark::DoNotOptimize(contacts.back());
+			}
+			frameArena->EndFrame();
+		}
+	}, kContactListCount * kContactsPerList);
+#pragma endregion
+
+#pragma region 距離場
+	// 球・AABB・OBB・カプセルをkFieldShapeCount個ずつと床の平面を焼き込む
+	constexpr size_t kFieldShapeCount = 32;
+	constexpr size_t kFieldQueryCount = 4096;
+	static const Plane fieldFloor = { { 0.0f, 1.0f, 0.0f }, -4.0f, 0 };
+	const DistanceFieldShapes fieldShapes = {
+		std::span<const Sphere>(s.spheres).first(kFieldShapeCount),
+		std::span<const Plane>(&fieldFloor, 1),
+		std::span<const AABB>(s.aabbs).first(kFieldShapeCount),
+		std::span<const OBB>(s.obbs).first(kFieldShapeCount),
+		std::span<const Capsule>(s.capsules).first(kFieldShapeCount),
+	};
+	const AABB fieldBounds = { { -5.0f, -5.0f, -5.0f }, { 5.0f, 5.0f, 5.0f }, 0 };
+	constexpr float kVoxelSize = 0.05f;
+	constexpr float kNarrowBand = 0.2f;
+	for (const auto& [name, threads] : { std::make_tuple("DistanceField/Build", false), std::make_tuple("DistanceField/Build(threads)", true) }) {
+		auto field = std::make_shared<SignedDistanceField>();
+		field->SetThreadPool(threads ? &ThreadPool::GetDefault() : nullptr);
+		runner.Add(name, [field, fieldShapes, fieldBounds](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; ++i) {
+				field->Build(fieldShapes, fieldBounds, kVoxelSize, kNarrowBand);
+			}
+			Benchmark::DoNotOptimize(field->GetStatistics());
+		}, 1, true);
+	}
+
+	// ns/opは1点あたり。形状を全て調べる場合と比べる
+	auto queryPoints = std::make_shared<std::vector<Vector3>>();
+	{
+		std::mt19937 random(97531);
+		std::uniform_real_distribution<float> position(-4.5f, 4.5f);
+		for (size_t i = 0; i < kFieldQueryCount; ++i) {
+			queryPoints->push_back({ position(random), position(random), position(random) });
+		}
+	}
+	auto distances = std::make_shared<std::vector<float>>(kFieldQueryCount);
+	auto gradients = std::make_shared<std::vector<Vector3>>(kFieldQueryCount);
+	runner.Add("DistanceField/Exact", [fieldShapes, queryPoints, distances](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			for (size_t k = 0; k < queryPoints->size(); ++k) {
+				const Vector3& point = (*queryPoints)[k];
+				float distance = SignedDistance(fieldShapes.planes[0], point);
+				for (size_t j = 0; j < kFieldShapeCount; ++j) {
+					distance = std::min(distance, SignedDistance(fieldShapes.spheres[j], point));
+					distance = std::min(distance, SignedDistance(fieldShapes.aabbs[j], point));
+					distance = std::min(distance, SignedDistance(fieldShapes.obbs[j], point));
+					distance = std::min(distance, SignedDistance(fieldShapes.capsules[j], point));
+				}
+				(*distances)[k] = distance;
+			}
+		}
+		Benchmark::DoNotOptimize(distances->front());
+	}, kFieldQueryCount);
+	auto sampledField = std::make_shared<SignedDistanceField>();
+	for (const auto& [name, withGradients] : { std::make_tuple("DistanceField/Sample(distance)", false), std::make_tuple("DistanceField/Sample(distance+gradient)", true) }) {
+		const bool gradient = withGradients;
+		runner.Add(name, [sampledField, fieldShapes, fieldBounds, queryPoints, distances, gradients, gradient](uint64_t iterations) {
+			if (sampledField->GetStatistics().shapeCount == 0) {
+				sampledField->SetThreadPool(&ThreadPool::GetDefault());
+				sampledField->Build(fieldShapes, fieldBounds, kVoxelSize, kNarrowBand);
+				sampledField->SetThreadPool(nullptr);
+			}
+			std::span<Vector3> gradientSpan = gradient ? std::span<Vector3>(*gradients) : std::span<Vector3>();
+			for (uint64_t i = 0; i < iterations; ++i) {
+				sampledField->Sample(*queryPoints, *distances, gradientSpan);
+			}
+			Benchmark::DoNotOptimize(distances->front());
+		}, kFieldQueryCount);
+	}
+#pragma endregion
+}
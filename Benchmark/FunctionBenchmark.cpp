@@ -0,0 +1,330 @@
+#include <memory>
+#include <random>
+#include <vector>
+#include "Benchmark.h"
+#include "Curve.h"
+#include "Function.h"
+#include "Profiler.h"
+#include "TransformHierarchy.h"
+#include "Vector3SoA.h"
+
+namespace {
+// 入力の配列の大きさ。添字をこれで回して、毎回違う値を渡す
+constexpr size_t kDataSize = 1024;
+constexpr size_t kDataMask = kDataSize - 1;
+// 配列をまとめて処理するケースの要素数
+constexpr size_t kBatchSize = 4096;
+// 曲線1本あたりの分割数
+constexpr uint32_t kCurveSegments = 32;
+
+struct Data {
+	std::vector<Vector3> vectors;
+	std::vector<Vector3> others;
+	std::vector<float> scalars;
+	std::vector<Matrix4x4> matrices;
+	std::vector<Matrix4x4> affineMatrices;
+	std::vector<Matrix4x4> rigidMatrices;
+	std::vector<AlignedMatrix4x4> alignedMatrices;
+	std::vector<Quaternion> quaternions;
+
+	Data() {
+		std::mt19937 random(12345);
+		std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+		std::uniform_real_distribution<float> angle(-3.14f, 3.14f);
+		std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+		for (size_t i = 0; i < kDataSize; ++i) {
+			vectors.push_back({ value(random), value(random), value(random) });
+			others.push_back({ value(random), value(random), value(random) });
+			scalars.push_back(angle(random));
+			Matrix4x4 matrix;
+			for (int row = 0; row < 4; ++row) {
+				for (int column = 0; column < 4; ++column) {
+					matrix.m[row][column] = value(random);
+				}
+			}
+			matrices.push_back(matrix);
+			Vector3 translate = { value(random), value(random), value(random) };
+			affineMatrices.push_back(MakeAffineMatrix({ scale(random), scale(random), scale(random) }, { angle(random), angle(random), angle(random) }, translate));
+			rigidMatrices.push_back(MakeAffineMatrix({ 1.0f, 1.0f, 1.0f }, { angle(random), angle(random), angle(random) }, translate));
+			AlignedMatrix4x4 aligned;
+			for (int row = 0; row < 4; ++row) {
+				for (int column = 0; column < 4; ++column) {
+					aligned.m[row][column] = matrix.m[row][column];
+				}
+			}
+			alignedMatrices.push_back(aligned);
+			quaternions.push_back(MakeRotateQuaternion(angle(random), angle(random), angle(random)));
+		}
+	}
+};
+
+const Data& GetData() {
+	static Data data;
+	return data;
+}
+
+// iterations回、添字を変えながらfunctionを呼んで結果を捨てる
+template<typename Function>
+Benchmark::CaseFunction Loop(Function function) {
+	return [function](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Benchmark::DoNotOptimize(function(static_cast<size_t>(i) & kDataMask));
+		}
+	};
+}
+}
+
+void RegisterFunctionBenchmarks(Benchmark::Runner& runner) {
+	// 登録したケースは後から呼ばれるので、ここでは静的な参照にしておく
+	static const Data& d = GetData();
+
+#pragma region Vector3
+	runner.Add("Function/Add(Vector3)", Loop([&](size_t i) { return Add(d.vectors[i], d.others[i]); }));
+	runner.Add("Function/Subtract(Vector3)", Loop([&](size_t i) { return Subtract(d.vectors[i], d.others[i]); }));
+	runner.Add("Function/Multiply(float,Vector3)", Loop([&](size_t i) { return Multiply(d.scalars[i], d.vectors[i]); }));
+	runner.Add("Function/Dot", Loop([&](size_t i) { return Dot(d.vectors[i], d.others[i]); }));
+	runner.Add("Function/Normalize", Loop([&](size_t i) { return Normalize(d.vectors[i]); }));
+	runner.Add("Function/Length", Loop([&](size_t i) { return Length(d.vectors[i]); }));
+	runner.Add("Function/Cross", Loop([&](size_t i) { return Cross(d.vectors[i], d.others[i]); }));
+	runner.Add("Function/Transform", Loop([&](size_t i) { return Transform(d.matrices[i], d.vectors[i]); }));
+	runner.Add("Function/Project", Loop([&](size_t i) {
+		Vector3 other = d.others[i];
+		return Project(d.vectors[i], other);
+	}));
+	runner.Add("Function/ClosestPoint", Loop([&](size_t i) { return ClosestPoint(d.vectors[i], d.others[i], d.vectors[(i + 1) & kDataMask]); }));
+	runner.Add("Function/Perpendicular", Loop([&](size_t i) { return Perpendicular(d.vectors[i]); }));
+	runner.Add("Function/Lerp", Loop([&](size_t i) { return Lerp(d.vectors[i], d.others[i], d.scalars[i]); }));
+	runner.Add("Function/Bezier", Loop([&](size_t i) { return Bezier(d.vectors[i], d.others[i], d.vectors[(i + 1) & kDataMask], d.scalars[i]); }));
+	runner.Add("Function/Reflect", Loop([&](size_t i) { return Reflect(d.vectors[i], Normalize(d.others[i])); }));
+
+	// 配列をまとめて変換する(1要素あたりの時間)
+	auto transformInput = std::make_shared<std::vector<Vector3>>(kBatchSize);
+	auto transformOutput = std::make_shared<std::vector<Vector3>>(kBatchSize);
+	for (size_t i = 0; i < kBatchSize; ++i) {
+		(*transformInput)[i] = d.vectors[i & kDataMask];
+	}
+	runner.Add("Function/Transform(span)", [transformInput, transformOutput](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Transform(d.matrices[i & kDataMask], *transformInput, *transformOutput);
+			Benchmark::DoNotOptimize(transformOutput->front());
+		}
+	}, kBatchSize);
+	runner.Add("Function/IsAffine", Loop([&](size_t i) { return IsAffine(d.affineMatrices[i]); }));
+#pragma endregion
+
+#pragma region Matrix4x4
+	runner.Add("Function/Inverse", Loop([&](size_t i) { return Inverse(d.matrices[i]); }));
+	runner.Add("Function/TryInverse", Loop([&](size_t i) {
+		Matrix4x4 result;
+		bool invertible = TryInverse(d.matrices[i], result);
+		Benchmark::DoNotOptimize(result);
+		return invertible;
+	}));
+	runner.Add("Function/InverseAffine", Loop([&](size_t i) { return InverseAffine(d.affineMatrices[i]); }));
+	runner.Add("Function/InverseRigid", Loop([&](size_t i) { return InverseRigid(d.rigidMatrices[i]); }));
+	auto inverseOutput = std::make_shared<std::vector<Matrix4x4>>(kDataSize);
+	std::shared_ptr<bool[]> singular = std::make_shared<bool[]>(kDataSize);
+	runner.Add("Function/Inverse(span)", [inverseOutput, singular](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Benchmark::DoNotOptimize(Inverse(d.matrices, *inverseOutput, std::span<bool>(singular.get(), kDataSize)));
+		}
+	}, kDataSize);
+	runner.Add("Function/MakeTranslateMatrix", Loop([&](size_t i) { return MakeTranslateMatrix(d.vectors[i]); }));
+	runner.Add("Function/MakeScaleMatrix", Loop([&](size_t i) { return MakeScaleMatrix(d.vectors[i]); }));
+	runner.Add("Function/MakeRotateXMatrix", Loop([&](size_t i) { return MakeRotateXMatrix(d.scalars[i]); }));
+	runner.Add("Function/MakeRotateYMatrix", Loop([&](size_t i) { return MakeRotateYMatrix(d.scalars[i]); }));
+	runner.Add("Function/MakeRotateZMatrix", Loop([&](size_t i) { return MakeRotateZMatrix(d.scalars[i]); }));
+	runner.Add("Function/MakeRotateMatrix", Loop([&](size_t i) { return MakeRotateMatrix(d.scalars[i], d.scalars[(i + 1) & kDataMask], d.scalars[(i + 2) & kDataMask]); }));
+	runner.Add("Function/MakeAffineMatrix", Loop([&](size_t i) {
+		Vector3 translate = d.others[i];
+		return MakeAffineMatrix(d.vectors[i], d.vectors[(i + 1) & kDataMask], translate);
+	}));
+	runner.Add("Function/MakePerspectiveFovMatrix", Loop([&](size_t i) { return MakePerspectiveFovMatrix(0.45f + d.scalars[i] * 0.1f, 16.0f / 9.0f, 0.1f, 100.0f); }));
+	runner.Add("Function/MakeOrthographicMatrix", Loop([&](size_t i) { return MakeOrthographicMatrix(-d.scalars[i], 1.0f, d.scalars[i] + 10.0f, -1.0f, 0.1f, 100.0f); }));
+	runner.Add("Function/MakeViewportMatrix", Loop([&](size_t i) { return MakeViewportMatrix(d.scalars[i], 0.0f, 1280.0f, 720.0f, 0.0f, 1.0f); }));
+	runner.Add("Function/Add(Matrix4x4)", Loop([&](size_t i) { return Add(d.matrices[i], d.matrices[(i + 1) & kDataMask]); }));
+	runner.Add("Function/Subtract(Matrix4x4)", Loop([&](size_t i) { return Subtract(d.matrices[i], d.matrices[(i + 1) & kDataMask]); }));
+	runner.Add("Function/Multiply(Matrix4x4)", Loop([&](size_t i) { return Multiply(d.matrices[i], d.matrices[(i + 1) & kDataMask]); }));
+	runner.Add("Function/Multiply(AlignedMatrix4x4)", Loop([&](size_t i) { return Multiply(d.alignedMatrices[i], d.alignedMatrices[(i + 1) & kDataMask]); }));
+	runner.Add("Function/MultiplyChain(4)", Loop([&](size_t i) {
+		return MultiplyChain({ &d.matrices[i], &d.matrices[(i + 1) & kDataMask], &d.matrices[(i + 2) & kDataMask], &d.matrices[(i + 3) & kDataMask] });
+	}));
+	auto multiplyOutput = std::make_shared<std::vector<Matrix4x4>>(kDataSize);
+	runner.Add("Function/Multiply(span)", [multiplyOutput](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Multiply(d.matrices, d.matrices[i & kDataMask], *multiplyOutput);
+			Benchmark::DoNotOptimize(multiplyOutput->front());
+		}
+	}, kDataSize);
+	runner.Add("Function/Transpose", Loop([&](size_t i) { return Transpose(d.matrices[i]); }));
+	runner.Add("Function/MakeIdentity", Loop([&](size_t) { return MakeIdentity(); }));
+	runner.Add("Function/MakeRotateAxisAngle", Loop([&](size_t i) { return MakeRotateAxisAngle(Normalize(d.vectors[i]), d.scalars[i]); }));
+#pragma endregion
+
+#pragma region Quaternion
+	runner.Add("Quaternion/Multiply", Loop([&](size_t i) { return Multiply(d.quaternions[i], d.quaternions[(i + 1) & kDataMask]); }));
+	runner.Add("Quaternion/Normalize", Loop([&](size_t i) { return Normalize(d.quaternions[i]); }));
+	runner.Add("Quaternion/Inverse", Loop([&](size_t i) { return Inverse(d.quaternions[i]); }));
+	runner.Add("Quaternion/MakeRotateAxisAngleQuaternion", Loop([&](size_t i) { return MakeRotateAxisAngleQuaternion(Normalize(d.vectors[i]), d.scalars[i]); }));
+	runner.Add("Quaternion/MakeRotateQuaternion", Loop([&](size_t i) {
+		return MakeRotateQuaternion(d.scalars[i], d.scalars[(i + 1) & kDataMask], d.scalars[(i + 2) & kDataMask]);
+	}));
+	runner.Add("Quaternion/RotateVector", Loop([&](size_t i) { return RotateVector(d.vectors[i], d.quaternions[i]); }));
+	runner.Add("Quaternion/MakeRotateMatrix", Loop([&](size_t i) { return MakeRotateMatrix(d.quaternions[i]); }));
+	runner.Add("Quaternion/Slerp", Loop([&](size_t i) { return Slerp(d.quaternions[i], d.quaternions[(i + 1) & kDataMask], 0.3f); }));
+	runner.Add("Quaternion/Nlerp", Loop([&](size_t i) { return Nlerp(d.quaternions[i], d.quaternions[(i + 1) & kDataMask], 0.3f); }));
+	auto quaternionOutput = std::make_shared<std::vector<Quaternion>>(kDataSize);
+	auto rotatedVectors = std::make_shared<std::vector<Vector3>>(kDataSize);
+	auto rotateMatrices = std::make_shared<std::vector<Matrix4x4>>(kDataSize);
+	runner.Add("Quaternion/Multiply(span)", [quaternionOutput](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Multiply(d.quaternions, *quaternionOutput, *quaternionOutput);
+			Benchmark::DoNotOptimize(quaternionOutput->front());
+		}
+	}, kDataSize);
+	runner.Add("Quaternion/RotateVector(span)", [rotatedVectors](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			RotateVector(d.vectors, d.quaternions, *rotatedVectors);
+			Benchmark::DoNotOptimize(rotatedVectors->front());
+		}
+	}, kDataSize);
+	runner.Add("Quaternion/RotateVector(span,shared)", [rotatedVectors](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			RotateVector(d.vectors, d.quaternions[i & kDataMask], *rotatedVectors);
+			Benchmark::DoNotOptimize(rotatedVectors->front());
+		}
+	}, kDataSize);
+	runner.Add("Quaternion/MakeRotateMatrix(span)", [rotateMatrices](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			MakeRotateMatrix(d.quaternions, *rotateMatrices);
+			Benchmark::DoNotOptimize(rotateMatrices->front());
+		}
+	}, kDataSize);
+	runner.Add("Quaternion/Slerp(span)", [quaternionOutput](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Slerp(std::span<const Quaternion>(d.quaternions).first(kDataSize - 1), std::span<const Quaternion>(d.quaternions).subspan(1), 0.3f, *quaternionOutput);
+			Benchmark::DoNotOptimize(quaternionOutput->front());
+		}
+	}, kDataSize - 1);
+	runner.Add("Quaternion/Nlerp(span)", [quaternionOutput](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Nlerp(std::span<const Quaternion>(d.quaternions).first(kDataSize - 1), std::span<const Quaternion>(d.quaternions).subspan(1), 0.3f, *quaternionOutput);
+			Benchmark::DoNotOptimize(quaternionOutput->front());
+		}
+	}, kDataSize - 1);
+#pragma endregion
+
+#pragma region 曲線
+	// ns/opは曲線1本(kCurveSegments + 1点)あたり
+	auto curvePoints = std::make_shared<std::vector<Vector3>>(kMaxAdaptivePoints * 4);
+	runner.Add("Curve/Bezier(per point)", [curvePoints](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			size_t k = i & kDataMask;
+			for (uint32_t j = 0; j <= kCurveSegments; ++j) {
+				float t = static_cast<float>(j) / static_cast<float>(kCurveSegments);
+				(*curvePoints)[j] = Bezier(d.vectors[k], d.others[k], d.vectors[(k + 1) & kDataMask], 1.0f - t);
+			}
+			Benchmark::DoNotOptimize(curvePoints->front());
+		}
+	});
+	runner.Add("Curve/Tessellate(QuadraticBezier)", [curvePoints](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			size_t k = i & kDataMask;
+			QuadraticBezier curve = { { d.vectors[k], d.others[k], d.vectors[(k + 1) & kDataMask] } };
+			Benchmark::DoNotOptimize(Tessellate(curve, kCurveSegments, *curvePoints));
+		}
+	});
+	runner.Add("Curve/Tessellate(CubicBezier)", [curvePoints](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			size_t k = i & kDataMask;
+			CubicBezier curve = { { d.vectors[k], d.others[k], d.vectors[(k + 1) & kDataMask], d.others[(k + 1) & kDataMask] } };
+			Benchmark::DoNotOptimize(Tessellate(curve, kCurveSegments, *curvePoints));
+		}
+	});
+	runner.Add("Curve/TessellateCatmullRom(4 spans)", [curvePoints](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			size_t k = static_cast<size_t>(i % (kDataSize - 4));
+			std::span<const Vector3> points(d.vectors.data() + k, 5);
+			Benchmark::DoNotOptimize(TessellateCatmullRom(points, kCurveSegments / 4, *curvePoints));
+		}
+	});
+	// 画面の手前にある曲線を許容誤差1ピクセルで分割する
+	Vector3 curveCameraScale = { 1.0f, 1.0f, 1.0f };
+	Vector3 curveCameraRotate = { 0.0f, 0.0f, 0.0f };
+	Vector3 curveCameraTranslate = { 0.0f, 0.0f, -40.0f };
+	const Matrix4x4 toScreen = Multiply(Multiply(InverseRigid(MakeAffineMatrix(curveCameraScale, curveCameraRotate, curveCameraTranslate)),
+		MakePerspectiveFovMatrix(0.45f, static_cast<float>(kWindowWidth) / kWindowHeight, 0.1f, 100.0f)),
+		MakeViewportMatrix(0.0f, 0.0f, static_cast<float>(kWindowWidth), static_cast<float>(kWindowHeight), 0.0f, 1.0f));
+	runner.Add("Curve/TessellateAdaptive(CubicBezier,1px)", [curvePoints, toScreen](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			size_t k = i & kDataMask;
+			CubicBezier curve = { { d.vectors[k], d.others[k], d.vectors[(k + 1) & kDataMask], d.others[(k + 1) & kDataMask] } };
+			Benchmark::DoNotOptimize(TessellateAdaptive(curve, toScreen, 1.0f, *curvePoints));
+		}
+	});
+#pragma endregion
+
+#pragma region Vector3SoA
+	auto soaA = std::make_shared<Vector3SoA>(std::span<const Vector3>(d.vectors));
+	auto soaB = std::make_shared<Vector3SoA>(std::span<const Vector3>(d.others));
+	auto soaOut = std::make_shared<Vector3SoA>(kDataSize);
+	auto soaScalars = std::make_shared<std::vector<float>>(kDataSize);
+	runner.Add("Vector3SoA/Add", [soaA, soaB, soaOut](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Add(*soaA, *soaB, *soaOut);
+			Benchmark::DoNotOptimize(soaOut->X()[0]);
+		}
+	}, kDataSize);
+	runner.Add("Vector3SoA/Dot", [soaA, soaB, soaScalars](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Dot(*soaA, *soaB, *soaScalars);
+			Benchmark::DoNotOptimize(soaScalars->front());
+		}
+	}, kDataSize);
+	runner.Add("Vector3SoA/Normalize", [soaA, soaOut](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Normalize(*soaA, *soaOut);
+			Benchmark::DoNotOptimize(soaOut->X()[0]);
+		}
+	}, kDataSize);
+	runner.Add("Vector3SoA/Cross", [soaA, soaB, soaOut](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			Cross(*soaA, *soaB, *soaOut);
+			Benchmark::DoNotOptimize(soaOut->X()[0]);
+		}
+	}, kDataSize);
+#pragma endregion
+
+#pragma region TransformHierarchy
+	// 1000ノード(10本の深さ100の鎖)のうち、根を1つ動かしてUpdateする
+	auto hierarchy = std::make_shared<TransformHierarchy>();
+	for (int chain = 0; chain < 10; ++chain) {
+		uint32_t parent = TransformHierarchy::kNoParent;
+		for (int depth = 0; depth < 100; ++depth) {
+			parent = hierarchy->Create(parent, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.01f, 0.0f }, { 0.0f, 0.0f, 1.0f });
+		}
+	}
+	hierarchy->Update();
+	runner.Add("TransformHierarchy/Update(1 of 10 chains dirty)", [hierarchy](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			hierarchy->SetTranslate(900, d.vectors[i & kDataMask]);
+			hierarchy->Update();
+			Benchmark::DoNotOptimize(hierarchy->GetWorldMatrix(999));
+		}
+	});
+#pragma endregion
+
+#pragma region Profiler
+	// 計測区間1つあたりの負担(リングバッファが溢れないよう、一定数ごとにEndFrameで回収する)
+	runner.Add("Profiler/ScopedZone", [](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			{
+				Profiler::ScopedZone zone("Profiler/ScopedZone");
+			}
+			if ((i & (Profiler::kRingCapacity / 2 - 1)) == 0) {
+				Profiler::EndFrame();
+			}
+		}
+	});
+#pragma endregion
+}
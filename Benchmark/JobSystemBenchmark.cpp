@@ -0,0 +1,108 @@
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "JobSystem.h"
+
+namespace {
+// ParallelForで処理する要素の数
+constexpr size_t kElementCount = 1 << 16;
+// タスクグラフのジョブの数
+constexpr uint32_t kJobCount = 256;
+
+// 1要素ぶんの軽い計算
+inline float Work(float value) {
+	return std::sqrt(value * value + 1.0f) * 0.5f;
+}
+}
+
+void RegisterJobSystemBenchmarks(Benchmark::Runner& runner) {
+#pragma region ParallelFor
+	// ops/secは1秒あたりに処理できる要素の数。区切りを細かくすると分配の手間が目立つ
+	auto values = std::make_shared<std::vector<float>>(kElementCount, 1.0f);
+	runner.Add("ParallelFor/Serial", [values](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			for (float& value : *values) {
+				value = Work(value);
+			}
+			Benchmark::DoNotOptimize((*values)[0]);
+		}
+	}, kElementCount);
+	for (size_t grain : { size_t(256), size_t(4096), size_t(0) }) {
+		const std::string name = grain == 0 ? "ParallelFor/grain=auto" : "ParallelFor/grain=" + std::to_string(grain);
+		runner.Add(name, [values, grain](uint64_t iterations) {
+			JobSystem& jobSystem = JobSystem::GetDefault();
+			for (uint64_t i = 0; i < iterations; ++i) {
+				jobSystem.ParallelFor(values->size(), grain, [&](size_t begin, size_t end, uint32_t) {
+					for (size_t index = begin; index < end; ++index) {
+						(*values)[index] = Work((*values)[index]);
+					}
+				});
+				Benchmark::DoNotOptimize((*values)[0]);
+			}
+		}, kElementCount);
+	}
+	// 入れ子のParallelFor(外側の区切りの中でさらに分ける)
+	runner.Add("ParallelFor/Nested", [values](uint64_t iterations) {
+		JobSystem& jobSystem = JobSystem::GetDefault();
+		constexpr size_t kOuterCount = 16;
+		const size_t innerCount = values->size() / kOuterCount;
+		for (uint64_t i = 0; i < iterations; ++i) {
+			jobSystem.ParallelFor(kOuterCount, 1, [&](size_t outerBegin, size_t outerEnd, uint32_t) {
+				for (size_t outer = outerBegin; outer < outerEnd; ++outer) {
+					float* base = values->data() + outer * innerCount;
+					jobSystem.ParallelFor(innerCount, 0, [&](size_t begin, size_t end, uint32_t) {
+						for (size_t index = begin; index < end; ++index) {
+							base[index] = Work(base[index]);
+						}
+					});
+				}
+			});
+			Benchmark::DoNotOptimize((*values)[0]);
+		}
+	}, kElementCount);
+#pragma endregion
+
+#pragma region タスクグラフ
+	// ops/secは1秒あたりに作って実行して待てるジョブの数
+	// 広がり: 1つのジョブの後に残り全てが並列に動く
+	runner.Add("TaskGraph/FanOut", [](uint64_t iterations) {
+		JobSystem& jobSystem = JobSystem::GetDefault();
+		std::atomic<uint32_t> sum{ 0 };
+		for (uint64_t i = 0; i < iterations; ++i) {
+			JobSystem::Counter counter;
+			JobSystem::Job* root = jobSystem.CreateJob([&](uint32_t) { sum.fetch_add(1, std::memory_order_relaxed); }, &counter);
+			for (uint32_t j = 1; j < kJobCount; ++j) {
+				JobSystem::Job* job = jobSystem.CreateJob([&](uint32_t) { sum.fetch_add(1, std::memory_order_relaxed); }, &counter);
+				jobSystem.AddDependency(root, job);
+				jobSystem.Submit(job);
+			}
+			jobSystem.Submit(root);
+			jobSystem.Wait(counter);
+		}
+		Benchmark::DoNotOptimize(sum);
+	}, kJobCount);
+	// 鎖: 前のジョブが終わってから次が動く(並列にならないので、ジョブ1つあたりの受け渡しの手間が分かる)
+	runner.Add("TaskGraph/Chain", [](uint64_t iterations) {
+		JobSystem& jobSystem = JobSystem::GetDefault();
+		uint32_t sum = 0;
+		std::vector<JobSystem::Job*> jobs(kJobCount);
+		for (uint64_t i = 0; i < iterations; ++i) {
+			JobSystem::Counter counter;
+			for (uint32_t j = 0; j < kJobCount; ++j) {
+				jobs[j] = jobSystem.CreateJob([&sum](uint32_t) { ++sum; }, &counter);
+				if (j > 0) {
+					jobSystem.AddDependency(jobs[j - 1], jobs[j]);
+				}
+			}
+			for (JobSystem::Job* job : jobs) {
+				jobSystem.Submit(job);
+			}
+			jobSystem.Wait(counter);
+		}
+		Benchmark::DoNotOptimize(sum);
+	}, kJobCount);
+#pragma endregion
+}
@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "Benchmark.h"
+#include "Profiler.h"
+
+// 使い方
+//   MT4Benchmark [--filter 名前の一部] [--min-time 秒] [--quick]
+//                [--json 出力先.json] [--baseline 基準.json] [--threshold 0.1]
+//                [--trace 出力先.json]
+// --baselineを渡すと、基準よりthreshold(割合)以上遅くなったケースがあれば終了コード1を返す
+// --traceを渡すと、プロファイラの計測区間をChromeのトレース形式(chrome://tracing, Perfetto)で書き出す
+namespace {
+void PrintUsage() {
+	std::printf("usage: MT4Benchmark [--filter text] [--min-time seconds] [--quick]\n"
+		"                    [--json output.json] [--baseline baseline.json] [--threshold ratio]\n"
+		"                    [--trace trace.json]\n");
+}
+}
+
+int main(int argc, char** argv) {
+	Benchmark::Runner runner;
+	std::string jsonPath;
+	std::string baselinePath;
+	std::string tracePath;
+	double threshold = 0.1;
+
+	for (int i = 1; i < argc; ++i) {
+		const char* argument = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (std::strcmp(argument, "--filter") == 0 && hasValue) {
+			runner.SetFilter(argv[++i]);
+		} else if (std::strcmp(argument, "--min-time") == 0 && hasValue) {
+			runner.SetMinTime(std::strtod(argv[++i], nullptr));
+		} else if (std::strcmp(argument, "--quick") == 0) {
+			// 動作確認用。計測時間を短くし、重いケースは飛ばす
+			runner.SetMinTime(0.005);
+			runner.SetSkipHeavy(true);
+		} else if (std::strcmp(argument, "--json") == 0 && hasValue) {
+			jsonPath = argv[++i];
+		} else if (std::strcmp(argument, "--baseline") == 0 && hasValue) {
+			baselinePath = argv[++i];
+		} else if (std::strcmp(argument, "--trace") == 0 && hasValue) {
+			tracePath = argv[++i];
+		} else if (std::strcmp(argument, "--threshold") == 0 && hasValue) {
+			threshold = std::strtod(argv[++i], nullptr);
+		} else {
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	RegisterFunctionBenchmarks(runner);
+	RegisterCollisionBenchmarks(runner);
+	RegisterPhysicsBenchmarks(runner);
+	RegisterRenderBenchmarks(runner);
+	RegisterRayCastBenchmarks(runner);
+	RegisterObjLoaderBenchmarks(runner);
+	RegisterJobSystemBenchmarks(runner);
+
+	if (!tracePath.empty()) {
+		Profiler::SetThreadName("Main");
+		Profiler::BeginCapture();
+	}
+	std::vector<Benchmark::Result> results = runner.Run();
+	if (!tracePath.empty()) {
+		Profiler::EndCapture();
+		if (!Profiler::WriteChromeTrace(tracePath)) {
+			std::fprintf(stderr, "failed to write %s\n", tracePath.c_str());
+			return 2;
+		}
+	}
+
+	if (!jsonPath.empty() && !Benchmark::WriteJson(jsonPath, results)) {
+		std::fprintf(stderr, "failed to write %s\n", jsonPath.c_str());
+		return 2;
+	}
+
+	if (baselinePath.empty()) {
+		return 0;
+	}
+	std::vector<Benchmark::Result> baseline;
+	if (!Benchmark::ReadJson(baselinePath, baseline)) {
+		std::fprintf(stderr, "failed to read %s\n", baselinePath.c_str());
+		return 2;
+	}
+	int regressions = 0;
+	std::printf("\ncomparison with %s (threshold +%.1f%%)\n", baselinePath.c_str(), threshold * 100.0);
+	for (const Benchmark::Comparison& comparison : Benchmark::Compare(baseline, results, threshold)) {
+		std::printf("%-48s %12.3f -> %12.3f ns/op (%+7.1f%%)%s\n", comparison.name.c_str(), comparison.baselineNsPerOp,
+			comparison.nsPerOp, (comparison.ratio - 1.0) * 100.0, comparison.regressed ? "  REGRESSION" : "");
+		regressions += comparison.regressed;
+	}
+	if (regressions > 0) {
+		std::printf("%d regression(s)\n", regressions);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,78 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "Benchmark.h"
+#include "ObjLoader.h"
+#include "ThreadPool.h"
+
+namespace {
+// 格子の一辺の四角形の数(約16万頂点・32万三角形、約13MB)
+constexpr int kGridSize = 400;
+
+// 法線付きの四角形の格子のOBJ
+std::string MakeObjText() {
+	std::string text = "# benchmark grid\no Grid\n";
+	char line[128];
+	for (int y = 0; y <= kGridSize; ++y) {
+		for (int x = 0; x <= kGridSize; ++x) {
+			std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", x * 0.05f, 0.01f * static_cast<float>((x * 7 + y * 13) % 17), y * 0.05f);
+			text += line;
+		}
+	}
+	text += "vn 0.000000 1.000000 0.000000\n";
+	for (int y = 0; y < kGridSize; ++y) {
+		for (int x = 0; x < kGridSize; ++x) {
+			int i = y * (kGridSize + 1) + x + 1;
+			std::snprintf(line, sizeof(line), "f %d//1 %d//1 %d//1 %d//1\n", i, i + kGridSize + 1, i + kGridSize + 2, i + 1);
+			text += line;
+		}
+	}
+	return text;
+}
+
+// 最初に計測されたときに文字列(とファイル)を作る
+struct ObjSource {
+	std::string text;
+	std::string path;
+
+	void Prepare(bool writeFile) {
+		if (text.empty()) {
+			text = MakeObjText();
+		}
+		if (writeFile && path.empty()) {
+			path = (std::filesystem::temp_directory_path() / "MT4Benchmark.obj").string();
+			std::ofstream file(path, std::ios::binary);
+			file.write(text.data(), static_cast<std::streamsize>(text.size()));
+		}
+	}
+};
+}
+
+void RegisterObjLoaderBenchmarks(Benchmark::Runner& runner) {
+#pragma region OBJの読み込み
+	// opsは1回あたりの文字数なので、ops/secは1秒あたりのバイト数(MB/s = ops/sec / 10^6)
+	auto source = std::make_shared<ObjSource>();
+	source->Prepare(false);
+	const uint64_t bytes = source->text.size();
+	for (bool threads : { false, true }) {
+		auto loader = std::make_shared<ObjLoader>();
+		auto mesh = std::make_shared<ObjMesh>();
+		loader->SetThreadPool(threads ? &ThreadPool::GetDefault() : nullptr);
+		runner.Add(threads ? "ObjLoader/Parse(threads)" : "ObjLoader/Parse", [source, loader, mesh](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; ++i) {
+				loader->Parse(source->text, *mesh);
+			}
+			Benchmark::DoNotOptimize(mesh->indices.back());
+		}, bytes);
+		runner.Add(threads ? "ObjLoader/Load(mmap,threads)" : "ObjLoader/Load(mmap)", [source, loader, mesh](uint64_t iterations) {
+			source->Prepare(true);
+			for (uint64_t i = 0; i < iterations; ++i) {
+				loader->Load(source->path, *mesh);
+			}
+			Benchmark::DoNotOptimize(mesh->indices.back());
+		}, bytes);
+	}
+#pragma endregion
+}
@@ -0,0 +1,258 @@
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+#include "BallIntegrator.h"
+#include "Benchmark.h"
+#include "PendulumEnsemble.h"
+#include "RigidBodyWorld.h"
+#include "SpringSystem.h"
+#include "ThreadPool.h"
+
+namespace {
+// 振り子の数とサブステップ数
+constexpr size_t kPendulumCount = 100000;
+constexpr uint32_t kSubSteps = 4;
+// 布の一辺のボール数(ばねは約2 * kClothSize^2本)
+constexpr uint32_t kClothSize = 256;
+
+std::vector<Pendulum> MakePendulums() {
+	std::vector<Pendulum> pendulums(kPendulumCount);
+	for (size_t i = 0; i < kPendulumCount; ++i) {
+		float t = static_cast<float>(i) / static_cast<float>(kPendulumCount);
+		pendulums[i] = { { 0.0f, 1.0f, 0.0f }, 0.5f + t, -1.5f + 3.0f * t, 0.0f, 0.0f };
+	}
+	return pendulums;
+}
+
+std::shared_ptr<SpringSystem> MakeCloth(SpringSystem::Mode mode, ThreadPool* pool) {
+	auto system = std::make_shared<SpringSystem>();
+	const float spacing = 0.05f;
+	for (uint32_t y = 0; y < kClothSize; ++y) {
+		for (uint32_t x = 0; x < kClothSize; ++x) {
+			Ball ball = {};
+			ball.position = { x * spacing, 0.0f, y * spacing };
+			// 一番上の列は固定する
+			ball.mass = y == 0 ? 0.0f : 0.01f;
+			ball.radius = 0.01f;
+			system->AddBall(ball);
+		}
+	}
+	for (uint32_t y = 0; y < kClothSize; ++y) {
+		for (uint32_t x = 0; x < kClothSize; ++x) {
+			uint32_t index = y * kClothSize + x;
+			if (x + 1 < kClothSize) {
+				system->AddSpring(index, index + 1, spacing, 100.0f, 0.01f);
+			}
+			if (y + 1 < kClothSize) {
+				system->AddSpring(index, index + kClothSize, spacing, 100.0f, 0.01f);
+			}
+		}
+	}
+	system->SetTimeStep(1.0f / 240.0f);
+	system->SetMode(mode);
+	system->SetThreadPool(pool);
+	return system;
+}
+
+// 速いボールが飛び回る部屋。床は平面、壁は薄いOBB、中に三角形の坂を置く
+constexpr size_t kBouncingBallCount = 4096;
+
+struct BallRoom {
+	std::vector<Ball> balls;
+	std::vector<Plane> planes;
+	std::vector<Triangle> triangles;
+	std::vector<OBB> obbs;
+	BallIntegrator integrator;
+
+	BallRoom(BallIntegrator::Mode mode, ThreadPool* pool) {
+		const float half = 20.0f;
+		planes.push_back({ { 0.0f, 1.0f, 0.0f }, 0.0f, 0 });
+		for (int i = 0; i < 4; ++i) {
+			// 厚さ0.02の壁。x = ±half, z = ±half
+			OBB wall = {};
+			wall.orientations[0] = { 1.0f, 0.0f, 0.0f };
+			wall.orientations[1] = { 0.0f, 1.0f, 0.0f };
+			wall.orientations[2] = { 0.0f, 0.0f, 1.0f };
+			float sign = (i & 1) ? 1.0f : -1.0f;
+			wall.center = (i < 2) ? Vector3{ sign * half, half, 0.0f } : Vector3{ 0.0f, half, sign * half };
+			wall.size = (i < 2) ? Vector3{ 0.01f, half, half } : Vector3{ half, half, 0.01f };
+			obbs.push_back(wall);
+		}
+		for (int i = 0; i < 8; ++i) {
+			float x = -15.0f + 4.0f * static_cast<float>(i);
+			triangles.push_back({ { { x, 0.0f, -5.0f }, { x + 3.0f, 0.0f, -5.0f }, { x, 3.0f, 5.0f } }, 0 });
+		}
+		std::mt19937 random(2468);
+		std::uniform_real_distribution<float> position(-half * 0.8f, half * 0.8f);
+		std::uniform_real_distribution<float> speed(-200.0f, 200.0f);
+		balls.resize(kBouncingBallCount);
+		for (Ball& ball : balls) {
+			ball = { { position(random), half + position(random), position(random) }, { speed(random), speed(random), speed(random) }, { 0.0f, -9.8f, 0.0f }, 1.0f, 0.2f, 0 };
+		}
+		integrator.SetMode(mode);
+		integrator.SetRestitution(0.9f);
+		integrator.SetThreadPool(pool);
+	}
+
+	StaticColliders GetColliders() const { return { planes, triangles, obbs }; }
+};
+
+// 箱を積んだ塔を格子状に並べる(kTowerGrid^2本 * kTowerHeight段)
+constexpr uint32_t kTowerGrid = 8;
+constexpr uint32_t kTowerHeight = 8;
+constexpr uint32_t kTowerBoxCount = kTowerGrid * kTowerGrid * kTowerHeight;
+
+std::shared_ptr<RigidBodyWorld> MakeTowers(bool sleep, ThreadPool* pool) {
+	auto world = std::make_shared<RigidBodyWorld>();
+	world->AddPlane({ { 0.0f, 1.0f, 0.0f }, 0.0f, 0 });
+	for (uint32_t x = 0; x < kTowerGrid; ++x) {
+		for (uint32_t z = 0; z < kTowerGrid; ++z) {
+			for (uint32_t y = 0; y < kTowerHeight; ++y) {
+				OBB box = {};
+				box.center = { static_cast<float>(x) * 1.5f, 0.5f + static_cast<float>(y), static_cast<float>(z) * 1.5f };
+				box.orientations[0] = { 1.0f, 0.0f, 0.0f };
+				box.orientations[1] = { 0.0f, 1.0f, 0.0f };
+				box.orientations[2] = { 0.0f, 0.0f, 1.0f };
+				box.size = { 0.5f, 0.5f, 0.5f };
+				world->AddBox(box, 1.0f);
+			}
+		}
+	}
+	world->SetSleepEnabled(sleep);
+	world->SetThreadPool(pool);
+	// 落ち着くまで進めておく(眠れる場合は全て眠る)
+	for (int i = 0; i < 120; ++i) {
+		world->Step();
+	}
+	return world;
+}
+}
+
+void RegisterPhysicsBenchmarks(Benchmark::Runner& runner) {
+#pragma region 振り子
+	// ops/secは1秒あたりに進められる振り子のステップ数
+	const uint64_t pendulumSteps = kPendulumCount * kSubSteps;
+	auto scalarPendulums = std::make_shared<std::vector<Pendulum>>(MakePendulums());
+	runner.Add("Pendulum/Scalar", [scalarPendulums](uint64_t iterations) {
+		const float h = 1.0f / 60.0f / kSubSteps;
+		for (uint64_t i = 0; i < iterations; ++i) {
+			for (Pendulum& pendulum : *scalarPendulums) {
+				for (uint32_t step = 0; step < kSubSteps; ++step) {
+					pendulum.angularAcceleration = -(9.8f / pendulum.length) * std::sin(pendulum.angle);
+					pendulum.angularVelocity += pendulum.angularAcceleration * h;
+					pendulum.angle += pendulum.angularVelocity * h;
+				}
+			}
+			Benchmark::DoNotOptimize(scalarPendulums->front());
+		}
+	}, pendulumSteps);
+	auto ensemble = std::make_shared<PendulumEnsemble>();
+	for (const Pendulum& pendulum : MakePendulums()) {
+		ensemble->Add(pendulum);
+	}
+	runner.Add("Pendulum/Ensemble(SIMD)", [ensemble](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			ensemble->Update(1.0f / 60.0f, kSubSteps);
+		}
+		Benchmark::DoNotOptimize(ensemble->Get(0));
+	}, pendulumSteps);
+	runner.Add("Pendulum/Ensemble(SIMD,threads)", [ensemble](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			ensemble->Update(1.0f / 60.0f, kSubSteps, &ThreadPool::GetDefault());
+		}
+		Benchmark::DoNotOptimize(ensemble->Get(0));
+	}, pendulumSteps);
+	auto bobs = std::make_shared<std::vector<Vector3>>(kPendulumCount);
+	runner.Add("Pendulum/ComputeBobPositions", [ensemble, bobs](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			ensemble->ComputeBobPositions(*bobs);
+			Benchmark::DoNotOptimize(bobs->front());
+		}
+	}, kPendulumCount);
+	auto conical = std::make_shared<ConicalPendulumEnsemble>();
+	for (size_t i = 0; i < kPendulumCount; ++i) {
+		float t = static_cast<float>(i) / static_cast<float>(kPendulumCount);
+		conical->Add({ { 0.0f, 1.0f, 0.0f }, 0.5f + t, 0.1f + t, 0.0f, 0.0f });
+	}
+	runner.Add("ConicalPendulum/Ensemble(SIMD)", [conical](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			conical->Update(1.0f / 60.0f);
+		}
+		Benchmark::DoNotOptimize(conical->Get(0));
+	}, kPendulumCount);
+#pragma endregion
+
+#pragma region ばね
+	// ns/opは1ステップあたり
+	struct ClothCase {
+		const char* name;
+		SpringSystem::Mode mode;
+		bool threads;
+	};
+	for (const ClothCase& clothCase : {
+		ClothCase{ "SpringSystem/Cloth(deterministic)", SpringSystem::Mode::Deterministic, false },
+		ClothCase{ "SpringSystem/Cloth(deterministic,threads)", SpringSystem::Mode::Deterministic, true },
+		ClothCase{ "SpringSystem/Cloth(fast,threads)", SpringSystem::Mode::Fast, true },
+		}) {
+		auto cloth = MakeCloth(clothCase.mode, clothCase.threads ? &ThreadPool::GetDefault() : nullptr);
+		runner.Add(clothCase.name, [cloth](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; ++i) {
+				cloth->Step();
+			}
+			Benchmark::DoNotOptimize(cloth->GetPosition(0));
+		});
+	}
+#pragma endregion
+
+#pragma region 動く球の連続的な衝突
+	// ops/secは1秒あたりに1フレーム(1/60秒)進められるボールの数
+	// 離散的な方法ですり抜けを減らすには、1フレームを細かく分けて進める必要がある
+	struct BallCase {
+		const char* name;
+		BallIntegrator::Mode mode;
+		uint32_t subSteps;
+		bool threads;
+	};
+	for (const BallCase& ballCase : {
+		BallCase{ "BallIntegrator/Discrete(1 step)", BallIntegrator::Mode::Discrete, 1, false },
+		BallCase{ "BallIntegrator/Discrete(8 substeps)", BallIntegrator::Mode::Discrete, 8, false },
+		BallCase{ "BallIntegrator/Continuous", BallIntegrator::Mode::Continuous, 1, false },
+		BallCase{ "BallIntegrator/Continuous(threads)", BallIntegrator::Mode::Continuous, 1, true },
+		}) {
+		auto room = std::make_shared<BallRoom>(ballCase.mode, ballCase.threads ? &ThreadPool::GetDefault() : nullptr);
+		const uint32_t subSteps = ballCase.subSteps;
+		runner.Add(ballCase.name, [room, subSteps](uint64_t iterations) {
+			const StaticColliders colliders = room->GetColliders();
+			for (uint64_t i = 0; i < iterations; ++i) {
+				for (uint32_t step = 0; step < subSteps; ++step) {
+					room->integrator.Step(room->balls, colliders, 1.0f / 60.0f / static_cast<float>(subSteps));
+				}
+			}
+			Benchmark::DoNotOptimize(room->balls.front());
+		}, kBouncingBallCount);
+	}
+#pragma endregion
+
+#pragma region 剛体
+	// ns/opは1ステップあたり。眠っている塔はブロードフェーズからも外れるので、ほとんど時間がかからない
+	struct TowerCase {
+		const char* name;
+		bool sleep;
+		bool threads;
+	};
+	for (const TowerCase& towerCase : {
+		TowerCase{ "RigidBodyWorld/Towers512(sleeping)", true, false },
+		TowerCase{ "RigidBodyWorld/Towers512(awake)", false, false },
+		TowerCase{ "RigidBodyWorld/Towers512(awake,threads)", false, true },
+		}) {
+		auto world = MakeTowers(towerCase.sleep, towerCase.threads ? &ThreadPool::GetDefault() : nullptr);
+		runner.Add(towerCase.name, [world](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; ++i) {
+				world->Step();
+			}
+			Benchmark::DoNotOptimize(world->GetPosition(0));
+		});
+	}
+#pragma endregion
+}
@@ -0,0 +1,275 @@
+#include <cmath>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "Benchmark.h"
+#include "Function.h"
+#include "Heightfield.h"
+#include "ThreadPool.h"
+#include "TriangleBVH.h"
+
+namespace {
+// 地形の一辺の頂点数。三角形は 2 * (頂点数 - 1)^2 個
+constexpr uint32_t kSmallTerrainSize = 128;  // 約3.2万個
+constexpr uint32_t kLargeTerrainSize = 708;  // 約100万個
+// 1回に飛ばす線分の数(kRayGridSize^2本)
+constexpr uint32_t kRayGridSize = 64;
+
+// 地形の高さ
+float TerrainHeight(float x, float z) {
+	return std::sin(x * 0.7f) * std::cos(z * 0.5f) + 0.1f * std::sin(x * 5.0f + z * 3.0f);
+}
+
+// 起伏のある地形(一辺20の正方形)の三角形
+std::vector<Triangle> MakeTerrain(uint32_t size) {
+	auto point = [size](uint32_t x, uint32_t z) {
+		float px = static_cast<float>(x) / static_cast<float>(size - 1) * 20.0f - 10.0f;
+		float pz = static_cast<float>(z) / static_cast<float>(size - 1) * 20.0f - 10.0f;
+		return Vector3{ px, TerrainHeight(px, pz), pz };
+	};
+	std::vector<Triangle> triangles;
+	triangles.reserve(2 * static_cast<size_t>(size - 1) * (size - 1));
+	for (uint32_t z = 0; z + 1 < size; ++z) {
+		for (uint32_t x = 0; x + 1 < size; ++x) {
+			triangles.push_back({ { point(x, z), point(x, z + 1), point(x + 1, z + 1) }, 0 });
+			triangles.push_back({ { point(x, z), point(x + 1, z + 1), point(x + 1, z) }, 0 });
+		}
+	}
+	return triangles;
+}
+
+// MakeTerrainと同じ地形の高さの格子
+void MakeHeightfield(uint32_t size, Heightfield& heightfield) {
+	const float cellSize = 20.0f / static_cast<float>(size - 1);
+	std::vector<float> heights(static_cast<size_t>(size) * size);
+	for (uint32_t z = 0; z < size; ++z) {
+		for (uint32_t x = 0; x < size; ++x) {
+			heights[static_cast<size_t>(z) * size + x] = TerrainHeight(static_cast<float>(x) * cellSize - 10.0f, static_cast<float>(z) * cellSize - 10.0f);
+		}
+	}
+	heightfield.Build(heights, size, size, { -10.0f, 0.0f, -10.0f }, cellSize);
+}
+
+// 斜め上のカメラから地形の格子状の点へ向かう線分(ピックのように隣り合う線分はほぼ同じ向き)
+std::vector<Segment> MakeRays() {
+	std::vector<Segment> segments;
+	const Vector3 camera = { 0.0f, 8.0f, -15.0f };
+	for (uint32_t y = 0; y < kRayGridSize; ++y) {
+		for (uint32_t x = 0; x < kRayGridSize; ++x) {
+			Vector3 target = { static_cast<float>(x) / kRayGridSize * 16.0f - 8.0f, -2.0f, static_cast<float>(y) / kRayGridSize * 16.0f - 8.0f };
+			segments.push_back({ camera, (target - camera) * 2.0f, 0 });
+		}
+	}
+	return segments;
+}
+
+// 重いケース用に、最初に計測されたときに地形と木を作る
+struct Scene {
+	uint32_t terrainSize;
+	std::vector<Triangle> triangles;
+	TriangleBVH bvh;
+	Heightfield heightfield;
+
+	void Prepare() {
+		if (triangles.empty()) {
+			triangles = MakeTerrain(terrainSize);
+			bvh.Build(triangles);
+			MakeHeightfield(terrainSize, heightfield);
+		}
+	}
+};
+}
+
+void RegisterRayCastBenchmarks(Benchmark::Runner& runner) {
+#pragma region BVHの作成
+	// ns/opは1回作るのにかかる時間
+	struct BuildCase {
+		const char* name;
+		uint32_t terrainSize;
+		bool threads;
+		bool heavy;
+	};
+	for (const BuildCase& buildCase : {
+		BuildCase{ "TriangleBVH/Build(32k)", kSmallTerrainSize, false, false },
+		BuildCase{ "TriangleBVH/Build(32k,threads)", kSmallTerrainSize, true, false },
+		BuildCase{ "TriangleBVH/Build(1M)", kLargeTerrainSize, false, true },
+		BuildCase{ "TriangleBVH/Build(1M,threads)", kLargeTerrainSize, true, true },
+		}) {
+		auto triangles = std::make_shared<std::vector<Triangle>>();
+		auto bvh = std::make_shared<TriangleBVH>();
+		bvh->SetThreadPool(buildCase.threads ? &ThreadPool::GetDefault() : nullptr);
+		const uint32_t terrainSize = buildCase.terrainSize;
+		runner.Add(buildCase.name, [triangles, bvh, terrainSize](uint64_t iterations) {
+			if (triangles->empty()) {
+				*triangles = MakeTerrain(terrainSize);
+			}
+			for (uint64_t i = 0; i < iterations; ++i) {
+				bvh->Build(*triangles);
+			}
+			Benchmark::DoNotOptimize(bvh->GetStatistics());
+		}, 1, buildCase.heavy);
+	}
+#pragma endregion
+
+#pragma region レイキャスト
+	// ops/secは1秒あたりに判定できる線分の数(Mrays/sec = ops/sec / 10^6)
+	auto segments = std::make_shared<std::vector<Segment>>(MakeRays());
+	auto hits = std::make_shared<std::vector<RayHit>>(segments->size());
+	const uint64_t rayCount = segments->size();
+	auto small = std::make_shared<Scene>();
+	small->terrainSize = kSmallTerrainSize;
+	auto large = std::make_shared<Scene>();
+	large->terrainSize = kLargeTerrainSize;
+	for (const auto& [scene, label, heavy] : { std::make_tuple(small, "32k", false), std::make_tuple(large, "1M", true) }) {
+		runner.Add(std::string("TriangleBVH/RayCast(") + label + ")", [scene, segments, hits](uint64_t iterations) {
+			scene->Prepare();
+			for (uint64_t i = 0; i < iterations; ++i) {
+				for (size_t k = 0; k < segments->size(); ++k) {
+					scene->bvh.RayCast((*segments)[k], (*hits)[k]);
+				}
+			}
+			Benchmark::DoNotOptimize(hits->front());
+		}, rayCount, heavy);
+		runner.Add(std::string("TriangleBVH/RayCast(") + label + ",packet)", [scene, segments, hits](uint64_t iterations) {
+			scene->Prepare();
+			scene->bvh.SetThreadPool(nullptr);
+			for (uint64_t i = 0; i < iterations; ++i) {
+				scene->bvh.RayCast(*segments, *hits);
+			}
+			Benchmark::DoNotOptimize(hits->front());
+		}, rayCount, heavy);
+		runner.Add(std::string("TriangleBVH/RayCast(") + label + ",packet,threads)", [scene, segments, hits](uint64_t iterations) {
+			scene->Prepare();
+			scene->bvh.SetThreadPool(&ThreadPool::GetDefault());
+			for (uint64_t i = 0; i < iterations; ++i) {
+				scene->bvh.RayCast(*segments, *hits);
+			}
+			Benchmark::DoNotOptimize(hits->front());
+		}, rayCount, heavy);
+	}
+
+	// 大きさが桁違いに並ぶ三角形(1つの頂点が原点、中心が軸ごとに2^i)。SAHの分割が1つずつ切り離す形に偏る
+	// 木の深さが探索用スタックに収まるように抑えられていることの確かめも兼ねる
+	constexpr uint32_t kSkewedTriangleCount = 723;
+	auto skewed = std::make_shared<TriangleBVH>();
+	{
+		std::vector<Triangle> triangles;
+		for (uint32_t i = 0; i < kSkewedTriangleCount; ++i) {
+			const float size = std::ldexp(1.0f, static_cast<int>(i / 3) - 120);
+			Vector3 edge = {};
+			Vector3 offset = {};
+			(i % 3 == 0 ? edge.x : (i % 3 == 1 ? edge.y : edge.z)) = 2.0f * size;
+			(i % 3 == 0 ? offset.y : (i % 3 == 1 ? offset.z : offset.x)) = size;
+			triangles.push_back({ { { 0.0f, 0.0f, 0.0f }, edge, edge + offset }, 0 });
+		}
+		skewed->Build(triangles);
+	}
+	auto skewedSegments = std::make_shared<std::vector<Segment>>();
+	for (int i = 0; i < 64; ++i) {
+		skewedSegments->push_back({ { 0.0f, 0.0f, 0.0f }, { std::ldexp(1.0f, i - 40), std::ldexp(1.0f, i - 50), std::ldexp(1.0f, i - 60) }, 0 });
+	}
+	auto skewedHits = std::make_shared<std::vector<RayHit>>(skewedSegments->size());
+	runner.Add("TriangleBVH/RayCast(skewed,packet)", [skewed, skewedSegments, skewedHits](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			skewed->RayCast(*skewedSegments, *skewedHits);
+		}
+		Benchmark::DoNotOptimize(skewedHits->front());
+	}, skewedSegments->size());
+#pragma endregion
+
+#pragma region 地形(Heightfield)
+	// 同じ地形と線分でTriangleBVHと比べる
+	for (const auto& [scene, label, heavy] : { std::make_tuple(small, "32k", false), std::make_tuple(large, "1M", true) }) {
+		auto terrainHits = std::make_shared<std::vector<Heightfield::Hit>>(segments->size());
+		runner.Add(std::string("Heightfield/RayCast(") + label + ")", [scene, segments, terrainHits](uint64_t iterations) {
+			scene->Prepare();
+			scene->heightfield.SetThreadPool(nullptr);
+			for (uint64_t i = 0; i < iterations; ++i) {
+				scene->heightfield.RayCast(*segments, *terrainHits);
+			}
+			Benchmark::DoNotOptimize(terrainHits->front());
+		}, rayCount, heavy);
+		runner.Add(std::string("Heightfield/RayCast(") + label + ",threads)", [scene, segments, terrainHits](uint64_t iterations) {
+			scene->Prepare();
+			scene->heightfield.SetThreadPool(&ThreadPool::GetDefault());
+			for (uint64_t i = 0; i < iterations; ++i) {
+				scene->heightfield.RayCast(*segments, *terrainHits);
+			}
+			Benchmark::DoNotOptimize(terrainHits->front());
+		}, rayCount, heavy);
+	}
+
+	// 格子座標が2048を超える細長い地形を端から端まで横切る線分(浮動小数点の精度で格子をたどれなくなる所を通る)
+	// ns/opは線分1本あたり。たどり方が戻らずに進むことの確かめも兼ねる(終わらなければスモークテストが時間切れになる)
+	constexpr uint32_t kWideTerrainWidth = 8193;
+	constexpr uint32_t kWideTerrainDepth = 4;
+	auto wide = std::make_shared<Heightfield>();
+	{
+		std::vector<float> heights(static_cast<size_t>(kWideTerrainWidth) * kWideTerrainDepth);
+		for (size_t i = 0; i < heights.size(); ++i) {
+			// 緩い坂に細かい起伏を乗せる(線分は坂に沿って少し上を通り、全てのセルを調べる)
+			const float x = static_cast<float>(i % kWideTerrainWidth);
+			heights[i] = x * 0.001f + std::sin(x * 0.37f) * 0.5f;
+		}
+		wide->Build(heights, kWideTerrainWidth, kWideTerrainDepth, { 0.0f, 0.0f, 0.0f }, 1.0f);
+	}
+	auto wideSegments = std::make_shared<std::vector<Segment>>();
+	wideSegments->push_back({ { 0x1.4363f6p-1f, 5.0f, 0x1.4663bp-1f }, { 0x1.001p+12f, -0x1.2a8b74p+2f, 0x1.391224p-3f }, 0 });
+	for (uint32_t i = 0; i < 63; ++i) {
+		const float z = static_cast<float>(i) / 63.0f * 3.0f;
+		const float sign = i % 2 == 0 ? 1.0f : -1.0f;
+		const float start = sign > 0.0f ? 0.25f : static_cast<float>(kWideTerrainWidth) - 1.25f;
+		const float length = sign * static_cast<float>(kWideTerrainWidth);
+		wideSegments->push_back({ { start, start * 0.001f + 0.55f, z }, { length, length * 0.001f, 3.0f - 2.0f * z }, 0 });
+	}
+	auto wideHits = std::make_shared<std::vector<Heightfield::Hit>>(wideSegments->size());
+	runner.Add("Heightfield/RayCast(wide)", [wide, wideSegments, wideHits](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			wide->RayCast(*wideSegments, *wideHits);
+		}
+		Benchmark::DoNotOptimize(wideHits->front());
+	}, wideSegments->size());
+
+	// ns/opは1点あたり
+	constexpr size_t kSampleCount = 16384;
+	auto samplePoints = std::make_shared<std::vector<Vector3>>();
+	for (size_t i = 0; i < kSampleCount; ++i) {
+		const float angle = static_cast<float>(i) * 0.618f;
+		const float radius = 9.5f * std::sqrt(static_cast<float>(i) / kSampleCount);
+		samplePoints->push_back({ std::cos(angle) * radius, 0.0f, std::sin(angle) * radius });
+	}
+	auto sampleHeights = std::make_shared<std::vector<float>>(kSampleCount);
+	auto sampleNormals = std::make_shared<std::vector<Vector3>>(kSampleCount);
+	for (const auto& [name, normals] : { std::make_tuple("Heightfield/Sample(height)", false), std::make_tuple("Heightfield/Sample(height+normal)", true) }) {
+		const bool withNormals = normals;
+		runner.Add(name, [small, samplePoints, sampleHeights, sampleNormals, withNormals](uint64_t iterations) {
+			small->Prepare();
+			small->heightfield.SetThreadPool(nullptr);
+			std::span<Vector3> normalSpan = withNormals ? std::span<Vector3>(*sampleNormals) : std::span<Vector3>();
+			for (uint64_t i = 0; i < iterations; ++i) {
+				small->heightfield.Sample(*samplePoints, *sampleHeights, normalSpan);
+			}
+			Benchmark::DoNotOptimize(sampleHeights->front());
+		}, kSampleCount);
+	}
+
+	// 地形の少し上にある球(半分くらいが接している)
+	auto spheres = std::make_shared<std::vector<Sphere>>();
+	for (const Vector3& point : *samplePoints) {
+		const float offset = (spheres->size() % 2 == 0) ? 0.1f : 0.5f;
+		spheres->push_back({ { point.x, TerrainHeight(point.x, point.z) + offset, point.z }, 0.3f, 0 });
+	}
+	runner.Add("Heightfield/IsCollision(Sphere)", [small, spheres](uint64_t iterations) {
+		small->Prepare();
+		size_t contactCount = 0;
+		for (uint64_t i = 0; i < iterations; ++i) {
+			for (const Sphere& sphere : *spheres) {
+				Contact contact;
+				contactCount += small->heightfield.IsCollision(sphere, contact) ? 1 : 0;
+			}
+		}
+		Benchmark::DoNotOptimize(contactCount);
+	}, kSampleCount);
+#pragma endregion
+}
@@ -0,0 +1,53 @@
+#include <memory>
+#include <random>
+#include <vector>
+#include "Benchmark.h"
+#include "Function.h"
+#include "Rasterizer.h"
+#include "ThreadPool.h"
+
+namespace {
+// 1回の描画で渡す三角形の数
+constexpr size_t kRenderTriangleCount = 20000;
+
+// カメラの前に小さな三角形を散らばらせる。一部は近い面や画面の端をまたぐので切り取られる
+std::vector<Triangle> MakeScene() {
+	std::mt19937 random(24680);
+	std::uniform_real_distribution<float> position(-6.0f, 6.0f);
+	std::uniform_real_distribution<float> depth(0.0f, 20.0f);
+	std::uniform_real_distribution<float> offset(-0.4f, 0.4f);
+	std::uniform_int_distribution<unsigned int> color(0, 0xFFFFFF);
+	std::vector<Triangle> triangles(kRenderTriangleCount);
+	for (Triangle& triangle : triangles) {
+		Vector3 center = { position(random), position(random), depth(random) };
+		for (Vector3& vertex : triangle.vertex) {
+			vertex = center + Vector3{ offset(random), offset(random), offset(random) };
+		}
+		triangle.color = (color(random) << 8) | 0xFF;
+	}
+	return triangles;
+}
+}
+
+void RegisterRenderBenchmarks(Benchmark::Runner& runner) {
+#pragma region ラスタライザ
+	// ops/secは1秒あたりに描ける三角形の数(画面のクリアも含む)
+	auto triangles = std::make_shared<std::vector<Triangle>>(MakeScene());
+	Vector3 scale = { 1.0f, 1.0f, 1.0f };
+	Vector3 rotate = { 0.0f, 0.0f, 0.0f };
+	Vector3 translate = { 0.0f, 0.0f, -10.0f };
+	const Matrix4x4 viewProjection = Multiply(InverseRigid(MakeAffineMatrix(scale, rotate, translate)),
+		MakePerspectiveFovMatrix(0.45f, static_cast<float>(kWindowWidth) / kWindowHeight, 0.1f, 100.0f));
+	for (bool threads : { false, true }) {
+		auto rasterizer = std::make_shared<Rasterizer>();
+		rasterizer->SetThreadPool(threads ? &ThreadPool::GetDefault() : nullptr);
+		runner.Add(threads ? "Rasterizer/Draw(threads)" : "Rasterizer/Draw", [rasterizer, triangles, viewProjection](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; ++i) {
+				rasterizer->Clear();
+				rasterizer->Draw(*triangles, viewProjection);
+				Benchmark::DoNotOptimize(rasterizer->GetPixel(0, 0));
+			}
+		}, kRenderTriangleCount);
+	}
+#pragma endregion
+}
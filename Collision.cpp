@@ -0,0 +1,1308 @@
+#include <algorithm>
+#include <assert.h>
+#include <cfloat>
+#include <cmath>
+#include "Collision.h"
+#include "Function.h"
+
+// 平行判定などに使う許容誤差
+static constexpr float kEpsilon = 1.0e-6f;
+
+#pragma region 内部で使う関数
+// Vector3の成分を添字で取り出す
+static float Component(const Vector3& v, int axis) {
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+// 符号(0は正とみなす)
+static float Sign(float value) {
+	return value < 0.0f ? -1.0f : 1.0f;
+}
+
+static float Clamp01(float value) {
+	return std::clamp(value, 0.0f, 1.0f);
+}
+
+// 長さの2乗
+static float LengthSquared(const Vector3& v) {
+	return Dot(v, v);
+}
+
+// ワールド座標の点をOBBのローカル座標にする
+static Vector3 ToOBBLocal(const OBB& obb, const Vector3& point) {
+	Vector3 d = point - obb.center;
+	return { Dot(d, obb.orientations[0]), Dot(d, obb.orientations[1]), Dot(d, obb.orientations[2]) };
+}
+
+// ワールド座標の方向をOBBのローカル座標にする
+static Vector3 ToOBBLocalDirection(const OBB& obb, const Vector3& direction) {
+	return { Dot(direction, obb.orientations[0]), Dot(direction, obb.orientations[1]), Dot(direction, obb.orientations[2]) };
+}
+
+// OBBのローカル座標の点をワールド座標にする
+static Vector3 FromOBBLocal(const OBB& obb, const Vector3& local) {
+	return obb.center + obb.orientations[0] * local.x + obb.orientations[1] * local.y + obb.orientations[2] * local.z;
+}
+
+// 原点中心で半径extentの箱の中に点を収める
+static Vector3 ClampToExtent(const Vector3& point, const Vector3& extent) {
+	return {
+		std::clamp(point.x, -extent.x, extent.x),
+		std::clamp(point.y, -extent.y, extent.y),
+		std::clamp(point.z, -extent.z, extent.z),
+	};
+}
+
+// 線分(origin + t * diff)を箱[min, max]で切り取る。箱と重なるtの範囲を返す
+static bool ClipSegment(const Vector3& origin, const Vector3& diff, const Vector3& min, const Vector3& max, float& tMin, float& tMax) {
+	tMin = 0.0f;
+	tMax = 1.0f;
+	for (int axis = 0; axis < 3; ++axis) {
+		float o = Component(origin, axis);
+		float d = Component(diff, axis);
+		float lo = Component(min, axis);
+		float hi = Component(max, axis);
+		if (std::fabs(d) < kEpsilon) {
+			// 軸に平行なので、範囲外なら当たらない
+			if (o < lo || o > hi) {
+				return false;
+			}
+			continue;
+		}
+		float inverse = 1.0f / d;
+		float t1 = (lo - o) * inverse;
+		float t2 = (hi - o) * inverse;
+		if (t1 > t2) {
+			std::swap(t1, t2);
+		}
+		tMin = std::max(tMin, t1);
+		tMax = std::min(tMax, t2);
+		if (tMin > tMax) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// 線分と三角形の交差判定(Möller–Trumbore)。交点の線分上の位置tを返す
+static bool IntersectSegmentTriangle(const Segment& segment, const Triangle& triangle, float& t) {
+	Vector3 edge1 = triangle.vertex[1] - triangle.vertex[0];
+	Vector3 edge2 = triangle.vertex[2] - triangle.vertex[0];
+	Vector3 p = Cross(segment.diff, edge2);
+	float det = Dot(edge1, p);
+	// detは辺2本と線分の長さの積に比例するので、その積に対する割合(線分と面のなす角の正弦)で平行かどうかを決める
+	// 絶対値で比べると、小さな三角形や短い線分が平行でなくても外れてしまう
+	if (std::fabs(det) <= kEpsilon * Length(edge1) * Length(edge2) * Length(segment.diff)) {
+		// 三角形の面と平行(または三角形・線分が潰れている)
+		return false;
+	}
+	float inverseDet = 1.0f / det;
+	Vector3 toOrigin = segment.origin - triangle.vertex[0];
+	float u = Dot(toOrigin, p) * inverseDet;
+	if (u < 0.0f || u > 1.0f) {
+		return false;
+	}
+	Vector3 q = Cross(toOrigin, edge1);
+	float v = Dot(segment.diff, q) * inverseDet;
+	if (v < 0.0f || u + v > 1.0f) {
+		return false;
+	}
+	t = Dot(edge2, q) * inverseDet;
+	return t >= 0.0f && t <= 1.0f;
+}
+
+// 三角形を軸に投影した範囲
+static void ProjectTriangle(const Vector3 vertices[3], const Vector3& axis, float& min, float& max) {
+	float d0 = Dot(vertices[0], axis);
+	float d1 = Dot(vertices[1], axis);
+	float d2 = Dot(vertices[2], axis);
+	min = std::min({ d0, d1, d2 });
+	max = std::max({ d0, d1, d2 });
+}
+
+// 原点中心で半径extentの箱と、(箱のローカル座標の)三角形の分離軸判定
+static bool IsCollisionTriangleBox(const Vector3 vertices[3], const Vector3& extent) {
+	const Vector3 edges[3] = { vertices[1] - vertices[0], vertices[2] - vertices[1], vertices[0] - vertices[2] };
+	const Vector3 boxAxes[3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+
+	// 軸ごとに投影した範囲が重なっているか
+	auto overlaps = [&](const Vector3& axis) {
+		float min, max;
+		ProjectTriangle(vertices, axis, min, max);
+		float radius = extent.x * std::fabs(axis.x) + extent.y * std::fabs(axis.y) + extent.z * std::fabs(axis.z);
+		return !(min > radius || max < -radius);
+	};
+
+	// 箱の面の法線(ローカル座標なのでxyz軸)
+	for (int i = 0; i < 3; ++i) {
+		float min, max;
+		ProjectTriangle(vertices, boxAxes[i], min, max);
+		if (min > Component(extent, i) || max < -Component(extent, i)) {
+			return false;
+		}
+	}
+	// 三角形の法線
+	if (!overlaps(Cross(edges[0], edges[1]))) {
+		return false;
+	}
+	// 辺同士のクロス積(平行な辺の組み合わせは軸にならないので飛ばす)
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			Vector3 axis = Cross(boxAxes[i], edges[j]);
+			if (LengthSquared(axis) > kEpsilon && !overlaps(axis)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// 点が箱の中にある場合の接触情報。一番近い面から押し出す
+// localはOBBのローカル座標。normalは点から箱へ向かう向きで返す
+static void ContactInsideBox(const OBB& obb, const Vector3& local, float radius, Contact& contact) {
+	int bestAxis = 0;
+	float bestSign = 1.0f;
+	float bestDistance = FLT_MAX;
+	for (int axis = 0; axis < 3; ++axis) {
+		float extent = Component(obb.size, axis);
+		float p = Component(local, axis);
+		if (extent - p < bestDistance) {
+			bestDistance = extent - p;
+			bestAxis = axis;
+			bestSign = 1.0f;
+		}
+		if (extent + p < bestDistance) {
+			bestDistance = extent + p;
+			bestAxis = axis;
+			bestSign = -1.0f;
+		}
+	}
+	Vector3 outward = obb.orientations[bestAxis] * bestSign;
+	Vector3 world = FromOBBLocal(obb, local);
+	contact.normal = -outward;
+	contact.depth = radius + bestDistance;
+	contact.point = world + outward * ((bestDistance - radius) * 0.5f);
+}
+
+// 中心centerで半径radiusの球と、形状上の最近接点closestから接触情報を作る
+static bool ContactSpherePoint(const Vector3& center, float radius, const Vector3& closest, Contact& contact) {
+	Vector3 d = closest - center;
+	float distanceSquared = LengthSquared(d);
+	if (distanceSquared > radius * radius) {
+		return false;
+	}
+	float distance = std::sqrt(distanceSquared);
+	contact.normal = distance > kEpsilon ? d / distance : Vector3{ 0.0f, 1.0f, 0.0f };
+	contact.depth = radius - distance;
+	contact.point = closest + contact.normal * (contact.depth * 0.5f);
+	return true;
+}
+
+// 2つの球の接触情報
+static bool ContactSpheres(const Vector3& center1, float radius1, const Vector3& center2, float radius2, Contact& contact) {
+	Vector3 d = center2 - center1;
+	float radius = radius1 + radius2;
+	float distanceSquared = LengthSquared(d);
+	if (distanceSquared > radius * radius) {
+		return false;
+	}
+	float distance = std::sqrt(distanceSquared);
+	contact.normal = distance > kEpsilon ? d / distance : Vector3{ 0.0f, 1.0f, 0.0f };
+	contact.depth = radius - distance;
+	contact.point = center1 + contact.normal * (radius1 - contact.depth * 0.5f);
+	return true;
+}
+
+// 半径radiusの球(中心center)とOBBの接触情報
+static bool ContactSphereOBB(const Vector3& center, float radius, const OBB& obb, Contact& contact) {
+	Vector3 local = ToOBBLocal(obb, center);
+	Vector3 clamped = ClampToExtent(local, obb.size);
+	if (clamped.x == local.x && clamped.y == local.y && clamped.z == local.z) {
+		// 中心が箱の中にある
+		ContactInsideBox(obb, local, radius, contact);
+		return true;
+	}
+	return ContactSpherePoint(center, radius, FromOBBLocal(obb, clamped), contact);
+}
+
+// 線分の端点
+static Vector3 EndPoint(const Segment& segment) {
+	return segment.origin + segment.diff;
+}
+
+// 箱を平面の法線に投影した半径
+static float ProjectedRadius(const OBB& obb, const Vector3& normal) {
+	return obb.size.x * std::fabs(Dot(normal, obb.orientations[0])) +
+		obb.size.y * std::fabs(Dot(normal, obb.orientations[1])) +
+		obb.size.z * std::fabs(Dot(normal, obb.orientations[2]));
+}
+#pragma endregion
+
+#pragma region 最近接点
+// 線分上の最近接点(長さ0の線分にも対応)
+Vector3 ClosestPoint(const Segment& segment, const Vector3& point) {
+	float lengthSquared = LengthSquared(segment.diff);
+	if (lengthSquared == 0.0f) {
+		return segment.origin;
+	}
+	float t = Clamp01(Dot(point - segment.origin, segment.diff) / lengthSquared);
+	return segment.origin + segment.diff * t;
+}
+
+// 平面上の最近接点
+Vector3 ClosestPoint(const Plane& plane, const Vector3& point) {
+	return point - plane.normal * SignedDistance(plane, point);
+}
+
+// 三角形上の最近接点(頂点・辺・面のどの領域にあるかで場合分けする)
+Vector3 ClosestPoint(const Triangle& triangle, const Vector3& point) {
+	const Vector3& a = triangle.vertex[0];
+	const Vector3& b = triangle.vertex[1];
+	const Vector3& c = triangle.vertex[2];
+	Vector3 ab = b - a;
+	Vector3 ac = c - a;
+	Vector3 ap = point - a;
+	float d1 = Dot(ab, ap);
+	float d2 = Dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) {
+		return a;
+	}
+	Vector3 bp = point - b;
+	float d3 = Dot(ab, bp);
+	float d4 = Dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) {
+		return b;
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		return a + ab * (d1 / (d1 - d3));
+	}
+	Vector3 cp = point - c;
+	float d5 = Dot(ab, cp);
+	float d6 = Dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) {
+		return c;
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		return a + ac * (d2 / (d2 - d6));
+	}
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+	float denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// AABB上(内部を含む)の最近接点
+Vector3 ClosestPoint(const AABB& aabb, const Vector3& point) {
+	return {
+		std::clamp(point.x, aabb.min.x, aabb.max.x),
+		std::clamp(point.y, aabb.min.y, aabb.max.y),
+		std::clamp(point.z, aabb.min.z, aabb.max.z),
+	};
+}
+
+// OBB上(内部を含む)の最近接点
+Vector3 ClosestPoint(const OBB& obb, const Vector3& point) {
+	return FromOBBLocal(obb, ClampToExtent(ToOBBLocal(obb, point), obb.size));
+}
+
+// 2本の線分の最近接点を求め、その距離の2乗を返す
+float ClosestPoints(const Segment& segment1, const Segment& segment2, Vector3& point1, Vector3& point2) {
+	const Vector3& d1 = segment1.diff;
+	const Vector3& d2 = segment2.diff;
+	Vector3 r = segment1.origin - segment2.origin;
+	float a = Dot(d1, d1);
+	float e = Dot(d2, d2);
+	float f = Dot(d2, r);
+	float s = 0.0f;
+	float t = 0.0f;
+	if (a <= kEpsilon && e <= kEpsilon) {
+		// 両方とも点
+	} else if (a <= kEpsilon) {
+		t = Clamp01(f / e);
+	} else {
+		float c = Dot(d1, r);
+		if (e <= kEpsilon) {
+			s = Clamp01(-c / a);
+		} else {
+			float b = Dot(d1, d2);
+			float denom = a * e - b * b;
+			// 平行な場合は1本目の始点から求める
+			s = denom != 0.0f ? Clamp01((b * f - c * e) / denom) : 0.0f;
+			t = (b * s + f) / e;
+			if (t < 0.0f) {
+				t = 0.0f;
+				s = Clamp01(-c / a);
+			} else if (t > 1.0f) {
+				t = 1.0f;
+				s = Clamp01((b - c) / a);
+			}
+		}
+	}
+	point1 = segment1.origin + d1 * s;
+	point2 = segment2.origin + d2 * t;
+	return LengthSquared(point1 - point2);
+}
+
+// 線分と三角形の最近接点を求め、その距離の2乗を返す
+float ClosestPoints(const Segment& segment, const Triangle& triangle, Vector3& onSegment, Vector3& onTriangle) {
+	float t;
+	if (IntersectSegmentTriangle(segment, triangle, t)) {
+		onSegment = segment.origin + segment.diff * t;
+		onTriangle = onSegment;
+		return 0.0f;
+	}
+	// 交差しなければ、端点と三角形、線分と各辺のどれかが最近接になる
+	onSegment = segment.origin;
+	onTriangle = ClosestPoint(triangle, segment.origin);
+	float best = LengthSquared(onSegment - onTriangle);
+
+	Vector3 end = EndPoint(segment);
+	Vector3 candidate = ClosestPoint(triangle, end);
+	float distanceSquared = LengthSquared(end - candidate);
+	if (distanceSquared < best) {
+		best = distanceSquared;
+		onSegment = end;
+		onTriangle = candidate;
+	}
+	for (int i = 0; i < 3; ++i) {
+		const Vector3& start = triangle.vertex[i];
+		Segment edge = { start, triangle.vertex[(i + 1) % 3] - start, 0 };
+		Vector3 p1, p2;
+		distanceSquared = ClosestPoints(segment, edge, p1, p2);
+		if (distanceSquared < best) {
+			best = distanceSquared;
+			onSegment = p1;
+			onTriangle = p2;
+		}
+	}
+	return best;
+}
+
+// 線分とOBBの最近接点を求め、その距離の2乗を返す(線分がOBBを貫く場合は0)
+float ClosestPoints(const Segment& segment, const OBB& obb, Vector3& onSegment, Vector3& onOBB) {
+	Vector3 origin = ToOBBLocal(obb, segment.origin);
+	Vector3 diff = ToOBBLocalDirection(obb, segment.diff);
+	float tMin, tMax;
+	if (ClipSegment(origin, diff, -obb.size, obb.size, tMin, tMax)) {
+		// 箱の中を通る区間の中点を接触点にする
+		onSegment = segment.origin + segment.diff * ((tMin + tMax) * 0.5f);
+		onOBB = onSegment;
+		return 0.0f;
+	}
+
+	// 交差しなければ、端点と箱、線分と箱の12本の辺のどれかが最近接になる
+	Vector3 bestSegment = origin;
+	Vector3 bestBox = ClampToExtent(origin, obb.size);
+	float best = LengthSquared(bestSegment - bestBox);
+
+	Vector3 end = origin + diff;
+	Vector3 clamped = ClampToExtent(end, obb.size);
+	float distanceSquared = LengthSquared(end - clamped);
+	if (distanceSquared < best) {
+		best = distanceSquared;
+		bestSegment = end;
+		bestBox = clamped;
+	}
+
+	Segment local = { origin, diff, 0 };
+	for (int axis = 0; axis < 3; ++axis) {
+		int axis1 = (axis + 1) % 3;
+		int axis2 = (axis + 2) % 3;
+		for (int corner = 0; corner < 4; ++corner) {
+			float start[3];
+			float edgeDiff[3] = { 0.0f, 0.0f, 0.0f };
+			start[axis] = -Component(obb.size, axis);
+			start[axis1] = (corner & 1) ? Component(obb.size, axis1) : -Component(obb.size, axis1);
+			start[axis2] = (corner & 2) ? Component(obb.size, axis2) : -Component(obb.size, axis2);
+			edgeDiff[axis] = Component(obb.size, axis) * 2.0f;
+			Segment edge = { { start[0], start[1], start[2] }, { edgeDiff[0], edgeDiff[1], edgeDiff[2] }, 0 };
+			Vector3 p1, p2;
+			distanceSquared = ClosestPoints(local, edge, p1, p2);
+			if (distanceSquared < best) {
+				best = distanceSquared;
+				bestSegment = p1;
+				bestBox = p2;
+			}
+		}
+	}
+	onSegment = FromOBBLocal(obb, bestSegment);
+	onOBB = FromOBBLocal(obb, bestBox);
+	return best;
+}
+#pragma endregion
+
+#pragma region 補助
+// AABBを同じ範囲のOBBにする
+OBB MakeOBB(const AABB& aabb) {
+	OBB obb = {};
+	obb.center = (aabb.min + aabb.max) * 0.5f;
+	obb.orientations[0] = { 1.0f, 0.0f, 0.0f };
+	obb.orientations[1] = { 0.0f, 1.0f, 0.0f };
+	obb.orientations[2] = { 0.0f, 0.0f, 1.0f };
+	obb.size = (aabb.max - aabb.min) * 0.5f;
+	obb.color = aabb.color;
+	return obb;
+}
+
+// 点までの符号付き距離。形状の外側が正、内側が負(平面は法線の向きが正)
+float SignedDistance(const Sphere& sphere, const Vector3& point) {
+	return Length(point - sphere.center) - sphere.radius;
+}
+
+float SignedDistance(const Plane& plane, const Vector3& point) {
+	return Dot(plane.normal, point) - plane.distance;
+}
+
+float SignedDistance(const AABB& aabb, const Vector3& point) {
+	return SignedDistance(MakeOBB(aabb), point);
+}
+
+float SignedDistance(const OBB& obb, const Vector3& point) {
+	// 各軸で面からはみ出した量。外側は全軸のはみ出しの長さ、内側は一番近い面までの距離(負)
+	const Vector3 local = ToOBBLocal(obb, point);
+	const Vector3 q = { std::abs(local.x) - obb.size.x, std::abs(local.y) - obb.size.y, std::abs(local.z) - obb.size.z };
+	const Vector3 outside = { std::max(q.x, 0.0f), std::max(q.y, 0.0f), std::max(q.z, 0.0f) };
+	return Length(outside) + std::min(std::max(q.x, std::max(q.y, q.z)), 0.0f);
+}
+
+float SignedDistance(const Capsule& capsule, const Vector3& point) {
+	return Length(point - ClosestPoint(capsule.segment, point)) - capsule.radius;
+}
+
+// 各形状を囲むAABB
+AABB MakeAABB(const Sphere& sphere) {
+	Vector3 radius = { sphere.radius, sphere.radius, sphere.radius };
+	return { sphere.center - radius, sphere.center + radius, sphere.color };
+}
+
+AABB MakeAABB(const Segment& segment) {
+	Vector3 end = EndPoint(segment);
+	return {
+		{ std::min(segment.origin.x, end.x), std::min(segment.origin.y, end.y), std::min(segment.origin.z, end.z) },
+		{ std::max(segment.origin.x, end.x), std::max(segment.origin.y, end.y), std::max(segment.origin.z, end.z) },
+		segment.color,
+	};
+}
+
+AABB MakeAABB(const Triangle& triangle) {
+	const Vector3& a = triangle.vertex[0];
+	const Vector3& b = triangle.vertex[1];
+	const Vector3& c = triangle.vertex[2];
+	return {
+		{ std::min({ a.x, b.x, c.x }), std::min({ a.y, b.y, c.y }), std::min({ a.z, b.z, c.z }) },
+		{ std::max({ a.x, b.x, c.x }), std::max({ a.y, b.y, c.y }), std::max({ a.z, b.z, c.z }) },
+		triangle.color,
+	};
+}
+
+AABB MakeAABB(const OBB& obb) {
+	// 各軸の半径は、OBBの軸をワールドの軸に投影した長さの和
+	Vector3 extent = {};
+	for (int axis = 0; axis < 3; ++axis) {
+		const Vector3& orientation = obb.orientations[axis];
+		float size = Component(obb.size, axis);
+		extent.x += std::fabs(orientation.x) * size;
+		extent.y += std::fabs(orientation.y) * size;
+		extent.z += std::fabs(orientation.z) * size;
+	}
+	return { obb.center - extent, obb.center + extent, obb.color };
+}
+
+AABB MakeAABB(const Capsule& capsule) {
+	AABB aabb = MakeAABB(capsule.segment);
+	Vector3 radius = { capsule.radius, capsule.radius, capsule.radius };
+	aabb.min -= radius;
+	aabb.max += radius;
+	return aabb;
+}
+#pragma endregion
+
+#pragma region 衝突判定
+bool IsCollision(const Sphere& sphere1, const Sphere& sphere2) {
+	float radius = sphere1.radius + sphere2.radius;
+	return LengthSquared(sphere2.center - sphere1.center) <= radius * radius;
+}
+
+bool IsCollision(const Sphere& sphere, const Plane& plane) {
+	return SignedDistance(plane, sphere.center) <= sphere.radius;
+}
+
+bool IsCollision(const Sphere& sphere, const Segment& segment) {
+	return LengthSquared(ClosestPoint(segment, sphere.center) - sphere.center) <= sphere.radius * sphere.radius;
+}
+
+bool IsCollision(const Sphere& sphere, const Triangle& triangle) {
+	return LengthSquared(ClosestPoint(triangle, sphere.center) - sphere.center) <= sphere.radius * sphere.radius;
+}
+
+bool IsCollision(const Sphere& sphere, const AABB& aabb) {
+	return LengthSquared(ClosestPoint(aabb, sphere.center) - sphere.center) <= sphere.radius * sphere.radius;
+}
+
+bool IsCollision(const Sphere& sphere, const OBB& obb) {
+	Vector3 local = ToOBBLocal(obb, sphere.center);
+	return LengthSquared(ClampToExtent(local, obb.size) - local) <= sphere.radius * sphere.radius;
+}
+
+bool IsCollision(const Sphere& sphere, const Capsule& capsule) {
+	float radius = sphere.radius + capsule.radius;
+	return LengthSquared(ClosestPoint(capsule.segment, sphere.center) - sphere.center) <= radius * radius;
+}
+
+bool IsCollision(const Plane& plane1, const Plane& plane2) {
+	if (LengthSquared(Cross(plane1.normal, plane2.normal)) > kEpsilon) {
+		// 平行でなければ必ず交わる
+		return true;
+	}
+	// 同じ向きなら片方がもう片方を含む。逆向きなら裏側どうしが離れていなければ重なる
+	if (Dot(plane1.normal, plane2.normal) > 0.0f) {
+		return true;
+	}
+	return plane1.distance + plane2.distance >= -kEpsilon;
+}
+
+bool IsCollision(const Plane& plane, const Segment& segment) {
+	float d0 = SignedDistance(plane, segment.origin);
+	float d1 = SignedDistance(plane, EndPoint(segment));
+	return std::min(d0, d1) <= 0.0f;
+}
+
+bool IsCollision(const Plane& plane, const Triangle& triangle) {
+	float d0 = SignedDistance(plane, triangle.vertex[0]);
+	float d1 = SignedDistance(plane, triangle.vertex[1]);
+	float d2 = SignedDistance(plane, triangle.vertex[2]);
+	return std::min({ d0, d1, d2 }) <= 0.0f;
+}
+
+bool IsCollision(const Plane& plane, const AABB& aabb) {
+	Vector3 center = (aabb.min + aabb.max) * 0.5f;
+	Vector3 extent = aabb.max - center;
+	float radius = extent.x * std::fabs(plane.normal.x) + extent.y * std::fabs(plane.normal.y) + extent.z * std::fabs(plane.normal.z);
+	return SignedDistance(plane, center) <= radius;
+}
+
+bool IsCollision(const Plane& plane, const OBB& obb) {
+	return SignedDistance(plane, obb.center) <= ProjectedRadius(obb, plane.normal);
+}
+
+bool IsCollision(const Plane& plane, const Capsule& capsule) {
+	float d0 = SignedDistance(plane, capsule.segment.origin);
+	float d1 = SignedDistance(plane, EndPoint(capsule.segment));
+	return std::min(d0, d1) <= capsule.radius;
+}
+
+bool IsCollision(const Segment& segment1, const Segment& segment2) {
+	Vector3 p1, p2;
+	return ClosestPoints(segment1, segment2, p1, p2) <= kEpsilon * kEpsilon;
+}
+
+bool IsCollision(const Segment& segment, const Triangle& triangle) {
+	float t;
+	return IntersectSegmentTriangle(segment, triangle, t);
+}
+
+bool IsCollision(const Segment& segment, const AABB& aabb) {
+	float tMin, tMax;
+	return ClipSegment(segment.origin, segment.diff, aabb.min, aabb.max, tMin, tMax);
+}
+
+bool IsCollision(const Segment& segment, const OBB& obb) {
+	float tMin, tMax;
+	return ClipSegment(ToOBBLocal(obb, segment.origin), ToOBBLocalDirection(obb, segment.diff), -obb.size, obb.size, tMin, tMax);
+}
+
+bool IsCollision(const Segment& segment, const Capsule& capsule) {
+	Vector3 p1, p2;
+	return ClosestPoints(segment, capsule.segment, p1, p2) <= capsule.radius * capsule.radius;
+}
+
+// 分離軸判定。両方の法線、辺同士のクロス積、同一平面のとき用に面内の辺の法線を調べる
+bool IsCollision(const Triangle& triangle1, const Triangle& triangle2) {
+	const Vector3 edges1[3] = { triangle1.vertex[1] - triangle1.vertex[0], triangle1.vertex[2] - triangle1.vertex[1], triangle1.vertex[0] - triangle1.vertex[2] };
+	const Vector3 edges2[3] = { triangle2.vertex[1] - triangle2.vertex[0], triangle2.vertex[2] - triangle2.vertex[1], triangle2.vertex[0] - triangle2.vertex[2] };
+	Vector3 normal1 = Cross(edges1[0], edges1[1]);
+	Vector3 normal2 = Cross(edges2[0], edges2[1]);
+
+	auto separated = [&](const Vector3& axis) {
+		if (LengthSquared(axis) <= kEpsilon * kEpsilon) {
+			return false;
+		}
+		float min1, max1, min2, max2;
+		ProjectTriangle(triangle1.vertex, axis, min1, max1);
+		ProjectTriangle(triangle2.vertex, axis, min2, max2);
+		return min1 > max2 || min2 > max1;
+	};
+
+	if (separated(normal1) || separated(normal2)) {
+		return false;
+	}
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			if (separated(Cross(edges1[i], edges2[j]))) {
+				return false;
+			}
+		}
+	}
+	for (int i = 0; i < 3; ++i) {
+		if (separated(Cross(normal1, edges1[i])) || separated(Cross(normal2, edges2[i]))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IsCollision(const Triangle& triangle, const AABB& aabb) {
+	Vector3 center = (aabb.min + aabb.max) * 0.5f;
+	const Vector3 vertices[3] = { triangle.vertex[0] - center, triangle.vertex[1] - center, triangle.vertex[2] - center };
+	return IsCollisionTriangleBox(vertices, aabb.max - center);
+}
+
+bool IsCollision(const Triangle& triangle, const OBB& obb) {
+	const Vector3 vertices[3] = { ToOBBLocal(obb, triangle.vertex[0]), ToOBBLocal(obb, triangle.vertex[1]), ToOBBLocal(obb, triangle.vertex[2]) };
+	return IsCollisionTriangleBox(vertices, obb.size);
+}
+
+bool IsCollision(const Triangle& triangle, const Capsule& capsule) {
+	Vector3 onSegment, onTriangle;
+	return ClosestPoints(capsule.segment, triangle, onSegment, onTriangle) <= capsule.radius * capsule.radius;
+}
+
+bool IsCollision(const AABB& aabb1, const AABB& aabb2) {
+	return (aabb1.min.x <= aabb2.max.x && aabb1.max.x >= aabb2.min.x) &&
+		(aabb1.min.y <= aabb2.max.y && aabb1.max.y >= aabb2.min.y) &&
+		(aabb1.min.z <= aabb2.max.z && aabb1.max.z >= aabb2.min.z);
+}
+
+bool IsCollision(const AABB& aabb, const OBB& obb) {
+	return IsCollision(MakeOBB(aabb), obb);
+}
+
+bool IsCollision(const AABB& aabb, const Capsule& capsule) {
+	return IsCollision(MakeOBB(aabb), capsule);
+}
+
+// 分離軸判定(15軸)
+// 2つのOBBの軸同士の内積Rとその絶対値を最初に求めておき、全ての軸の判定で使い回す
+bool IsCollision(const OBB& obb1, const OBB& obb2) {
+	float r[3][3];
+	float absR[3][3];
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			r[i][j] = Dot(obb1.orientations[i], obb2.orientations[j]);
+			// 辺が平行なときにクロス積が0になって誤判定しないよう誤差を足す
+			absR[i][j] = std::fabs(r[i][j]) + kEpsilon;
+		}
+	}
+	Vector3 d = obb2.center - obb1.center;
+	const float t[3] = { Dot(d, obb1.orientations[0]), Dot(d, obb1.orientations[1]), Dot(d, obb1.orientations[2]) };
+	const float e1[3] = { obb1.size.x, obb1.size.y, obb1.size.z };
+	const float e2[3] = { obb2.size.x, obb2.size.y, obb2.size.z };
+
+	// obb1の軸
+	for (int i = 0; i < 3; ++i) {
+		float radius1 = e1[i];
+		float radius2 = e2[0] * absR[i][0] + e2[1] * absR[i][1] + e2[2] * absR[i][2];
+		if (std::fabs(t[i]) > radius1 + radius2) {
+			return false;
+		}
+	}
+	// obb2の軸
+	for (int j = 0; j < 3; ++j) {
+		float radius1 = e1[0] * absR[0][j] + e1[1] * absR[1][j] + e1[2] * absR[2][j];
+		float radius2 = e2[j];
+		if (std::fabs(t[0] * r[0][j] + t[1] * r[1][j] + t[2] * r[2][j]) > radius1 + radius2) {
+			return false;
+		}
+	}
+	// 軸同士のクロス積
+	for (int i = 0; i < 3; ++i) {
+		int i1 = (i + 1) % 3;
+		int i2 = (i + 2) % 3;
+		for (int j = 0; j < 3; ++j) {
+			int j1 = (j + 1) % 3;
+			int j2 = (j + 2) % 3;
+			float radius1 = e1[i1] * absR[i2][j] + e1[i2] * absR[i1][j];
+			float radius2 = e2[j1] * absR[i][j2] + e2[j2] * absR[i][j1];
+			if (std::fabs(t[i2] * r[i1][j] - t[i1] * r[i2][j]) > radius1 + radius2) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool IsCollision(const OBB& obb, const Capsule& capsule) {
+	Vector3 onSegment, onOBB;
+	return ClosestPoints(capsule.segment, obb, onSegment, onOBB) <= capsule.radius * capsule.radius;
+}
+
+bool IsCollision(const Capsule& capsule1, const Capsule& capsule2) {
+	Vector3 p1, p2;
+	float radius = capsule1.radius + capsule2.radius;
+	return ClosestPoints(capsule1.segment, capsule2.segment, p1, p2) <= radius * radius;
+}
+#pragma endregion
+
+#pragma region 接触情報の生成
+bool IsCollision(const Sphere& sphere1, const Sphere& sphere2, Contact& contact) {
+	return ContactSpheres(sphere1.center, sphere1.radius, sphere2.center, sphere2.radius, contact);
+}
+
+bool IsCollision(const Sphere& sphere, const Plane& plane, Contact& contact) {
+	float distance = SignedDistance(plane, sphere.center);
+	if (distance > sphere.radius) {
+		return false;
+	}
+	contact.normal = -plane.normal;
+	contact.depth = sphere.radius - distance;
+	contact.point = sphere.center - plane.normal * (distance + contact.depth * 0.5f);
+	return true;
+}
+
+bool IsCollision(const Sphere& sphere, const Triangle& triangle, Contact& contact) {
+	Vector3 closest = ClosestPoint(triangle, sphere.center);
+	if (!ContactSpherePoint(sphere.center, sphere.radius, closest, contact)) {
+		return false;
+	}
+	if (contact.depth >= sphere.radius - kEpsilon) {
+		// 中心が三角形上にあるときは、法線は三角形の面の向きにする
+		Vector3 normal = Normalize(Cross(triangle.vertex[1] - triangle.vertex[0], triangle.vertex[2] - triangle.vertex[0]));
+		contact.normal = -normal;
+	}
+	return true;
+}
+
+bool IsCollision(const Sphere& sphere, const AABB& aabb, Contact& contact) {
+	return ContactSphereOBB(sphere.center, sphere.radius, MakeOBB(aabb), contact);
+}
+
+bool IsCollision(const Sphere& sphere, const OBB& obb, Contact& contact) {
+	return ContactSphereOBB(sphere.center, sphere.radius, obb, contact);
+}
+
+bool IsCollision(const Sphere& sphere, const Capsule& capsule, Contact& contact) {
+	return ContactSpheres(sphere.center, sphere.radius, ClosestPoint(capsule.segment, sphere.center), capsule.radius, contact);
+}
+
+bool IsCollision(const Plane& plane, const AABB& aabb, Contact& contact) {
+	return IsCollision(plane, MakeOBB(aabb), contact);
+}
+
+bool IsCollision(const Plane& plane, const OBB& obb, Contact& contact) {
+	// 一番深い頂点(法線と逆向きの頂点)
+	Vector3 deepest = obb.center;
+	for (int axis = 0; axis < 3; ++axis) {
+		float sign = -Sign(Dot(plane.normal, obb.orientations[axis]));
+		deepest += obb.orientations[axis] * (Component(obb.size, axis) * sign);
+	}
+	float distance = SignedDistance(plane, deepest);
+	if (distance > 0.0f) {
+		return false;
+	}
+	contact.normal = plane.normal;
+	contact.depth = -distance;
+	contact.point = deepest + plane.normal * (contact.depth * 0.5f);
+	return true;
+}
+
+bool IsCollision(const Plane& plane, const Capsule& capsule, Contact& contact) {
+	Vector3 end = EndPoint(capsule.segment);
+	float d0 = SignedDistance(plane, capsule.segment.origin);
+	float d1 = SignedDistance(plane, end);
+	const Vector3& deepest = d0 <= d1 ? capsule.segment.origin : end;
+	float distance = std::min(d0, d1);
+	if (distance > capsule.radius) {
+		return false;
+	}
+	contact.normal = plane.normal;
+	contact.depth = capsule.radius - distance;
+	contact.point = deepest - plane.normal * (distance + contact.depth * 0.5f);
+	return true;
+}
+
+bool IsCollision(const AABB& aabb1, const AABB& aabb2, Contact& contact) {
+	if (!IsCollision(aabb1, aabb2)) {
+		return false;
+	}
+	// 重なりが一番小さい軸で押し出す
+	Vector3 overlapMin = { std::max(aabb1.min.x, aabb2.min.x), std::max(aabb1.min.y, aabb2.min.y), std::max(aabb1.min.z, aabb2.min.z) };
+	Vector3 overlapMax = { std::min(aabb1.max.x, aabb2.max.x), std::min(aabb1.max.y, aabb2.max.y), std::min(aabb1.max.z, aabb2.max.z) };
+	Vector3 overlap = overlapMax - overlapMin;
+	Vector3 d = (aabb2.min + aabb2.max) - (aabb1.min + aabb1.max);
+	int axis = 0;
+	if (overlap.y < Component(overlap, axis)) {
+		axis = 1;
+	}
+	if (overlap.z < Component(overlap, axis)) {
+		axis = 2;
+	}
+	float normal[3] = { 0.0f, 0.0f, 0.0f };
+	normal[axis] = Sign(Component(d, axis));
+	contact.normal = { normal[0], normal[1], normal[2] };
+	contact.depth = Component(overlap, axis);
+	contact.point = (overlapMin + overlapMax) * 0.5f;
+	return true;
+}
+
+// 分離軸判定で一番めり込みの浅い軸を法線にする
+// 面の軸は辺同士の軸よりも安定するので、ほぼ同じ深さなら面の軸を優先する
+bool IsCollision(const OBB& obb1, const OBB& obb2, Contact& contact) {
+	float r[3][3];
+	float absR[3][3];
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			r[i][j] = Dot(obb1.orientations[i], obb2.orientations[j]);
+			absR[i][j] = std::fabs(r[i][j]) + kEpsilon;
+		}
+	}
+	Vector3 d = obb2.center - obb1.center;
+	const float t[3] = { Dot(d, obb1.orientations[0]), Dot(d, obb1.orientations[1]), Dot(d, obb1.orientations[2]) };
+	const float e1[3] = { obb1.size.x, obb1.size.y, obb1.size.z };
+	const float e2[3] = { obb2.size.x, obb2.size.y, obb2.size.z };
+
+	// 0～2:obb1の面、3～5:obb2の面、6～14:辺同士
+	int bestAxis = -1;
+	float bestDepth = FLT_MAX;
+	Vector3 bestNormal = {};
+
+	for (int i = 0; i < 3; ++i) {
+		float radius2 = e2[0] * absR[i][0] + e2[1] * absR[i][1] + e2[2] * absR[i][2];
+		float depth = e1[i] + radius2 - std::fabs(t[i]);
+		if (depth < 0.0f) {
+			return false;
+		}
+		if (depth < bestDepth) {
+			bestDepth = depth;
+			bestAxis = i;
+			bestNormal = obb1.orientations[i] * Sign(t[i]);
+		}
+	}
+	for (int j = 0; j < 3; ++j) {
+		float radius1 = e1[0] * absR[0][j] + e1[1] * absR[1][j] + e1[2] * absR[2][j];
+		float distance = t[0] * r[0][j] + t[1] * r[1][j] + t[2] * r[2][j];
+		float depth = radius1 + e2[j] - std::fabs(distance);
+		if (depth < 0.0f) {
+			return false;
+		}
+		if (depth < bestDepth) {
+			bestDepth = depth;
+			bestAxis = 3 + j;
+			bestNormal = obb2.orientations[j] * Sign(distance);
+		}
+	}
+	const float faceDepth = bestDepth;
+	for (int i = 0; i < 3; ++i) {
+		int i1 = (i + 1) % 3;
+		int i2 = (i + 2) % 3;
+		for (int j = 0; j < 3; ++j) {
+			int j1 = (j + 1) % 3;
+			int j2 = (j + 2) % 3;
+			float radius1 = e1[i1] * absR[i2][j] + e1[i2] * absR[i1][j];
+			float radius2 = e2[j1] * absR[i][j2] + e2[j2] * absR[i][j1];
+			float distance = t[i2] * r[i1][j] - t[i1] * r[i2][j];
+			float depth = radius1 + radius2 - std::fabs(distance);
+			if (depth < 0.0f) {
+				return false;
+			}
+			// 軸の長さ(平行な辺同士は軸にならない)
+			float length = std::sqrt(std::max(0.0f, 1.0f - r[i][j] * r[i][j]));
+			if (length < 1.0e-3f) {
+				continue;
+			}
+			depth /= length;
+			if (depth < bestDepth && depth < faceDepth * 0.95f) {
+				bestDepth = depth;
+				bestAxis = 6 + i * 3 + j;
+				bestNormal = Cross(obb1.orientations[i], obb2.orientations[j]) * (Sign(distance) / length);
+			}
+		}
+	}
+
+	contact.normal = bestNormal;
+	contact.depth = bestDepth;
+	if (bestAxis < 3) {
+		// obb1の面にobb2の一番深い頂点が当たっている
+		Vector3 vertex = obb2.center;
+		for (int k = 0; k < 3; ++k) {
+			vertex -= obb2.orientations[k] * (e2[k] * Sign(Dot(bestNormal, obb2.orientations[k])));
+		}
+		contact.point = vertex + bestNormal * (bestDepth * 0.5f);
+	} else if (bestAxis < 6) {
+		// obb2の面にobb1の一番深い頂点が当たっている
+		Vector3 vertex = obb1.center;
+		for (int k = 0; k < 3; ++k) {
+			vertex += obb1.orientations[k] * (e1[k] * Sign(Dot(bestNormal, obb1.orientations[k])));
+		}
+		contact.point = vertex - bestNormal * (bestDepth * 0.5f);
+	} else {
+		// 辺同士。それぞれ法線方向に一番出っ張った辺の最近接点の中点
+		int i = (bestAxis - 6) / 3;
+		int j = (bestAxis - 6) % 3;
+		Vector3 center1 = obb1.center;
+		Vector3 center2 = obb2.center;
+		for (int k = 0; k < 3; ++k) {
+			if (k != i) {
+				center1 += obb1.orientations[k] * (e1[k] * Sign(Dot(bestNormal, obb1.orientations[k])));
+			}
+			if (k != j) {
+				center2 -= obb2.orientations[k] * (e2[k] * Sign(Dot(bestNormal, obb2.orientations[k])));
+			}
+		}
+		Segment edge1 = { center1 - obb1.orientations[i] * e1[i], obb1.orientations[i] * (e1[i] * 2.0f), 0 };
+		Segment edge2 = { center2 - obb2.orientations[j] * e2[j], obb2.orientations[j] * (e2[j] * 2.0f), 0 };
+		Vector3 p1, p2;
+		ClosestPoints(edge1, edge2, p1, p2);
+		contact.point = (p1 + p2) * 0.5f;
+	}
+	return true;
+}
+
+bool IsCollision(const OBB& obb, const Capsule& capsule, Contact& contact) {
+	Vector3 onSegment, onOBB;
+	float distanceSquared = ClosestPoints(capsule.segment, obb, onSegment, onOBB);
+	if (distanceSquared > capsule.radius * capsule.radius) {
+		return false;
+	}
+	if (distanceSquared > 0.0f) {
+		// カプセルから見た接触なので、向きを反転してobb→カプセルにする
+		if (!ContactSpherePoint(onSegment, capsule.radius, onOBB, contact)) {
+			return false;
+		}
+		contact.normal = -contact.normal;
+		return true;
+	}
+	// 芯の線分が箱を貫いているときは、線分全体が面の外に出るまでの距離が一番短い面から押し出す
+	const Vector3 local[2] = { ToOBBLocal(obb, capsule.segment.origin), ToOBBLocal(obb, EndPoint(capsule.segment)) };
+	float bestDepth = FLT_MAX;
+	for (int axis = 0; axis < 3; ++axis) {
+		float extent = Component(obb.size, axis);
+		float p0 = Component(local[0], axis);
+		float p1 = Component(local[1], axis);
+		for (float sign : { 1.0f, -1.0f }) {
+			// 面の外向きに見て一番奥にある端点
+			int deepest = p0 * sign <= p1 * sign ? 0 : 1;
+			float depth = extent - Component(local[deepest], axis) * sign + capsule.radius;
+			if (depth < bestDepth) {
+				bestDepth = depth;
+				contact.normal = obb.orientations[axis] * sign;
+				contact.depth = depth;
+				Vector3 endPoint = FromOBBLocal(obb, local[deepest]);
+				contact.point = endPoint + contact.normal * ((depth - capsule.radius * 2.0f) * 0.5f);
+			}
+		}
+	}
+	return true;
+}
+
+bool IsCollision(const Capsule& capsule1, const Capsule& capsule2, Contact& contact) {
+	Vector3 p1, p2;
+	ClosestPoints(capsule1.segment, capsule2.segment, p1, p2);
+	return ContactSpheres(p1, capsule1.radius, p2, capsule2.radius, contact);
+}
+#pragma endregion
+
+#pragma region 動く球の衝突時刻
+// 点がorigin + t * diffと動くとき、球の中に入る最初のt(0 <= t <= 1)
+static bool SweepPointSphere(const Vector3& origin, const Vector3& diff, const Vector3& center, float radius, float& t) {
+	Vector3 m = origin - center;
+	float a = LengthSquared(diff);
+	float b = Dot(m, diff);
+	if (a == 0.0f || b >= 0.0f) {
+		// 止まっているか、離れていく
+		return false;
+	}
+	float c = LengthSquared(m) - radius * radius;
+	float discriminant = b * b - a * c;
+	if (discriminant < 0.0f) {
+		return false;
+	}
+	t = std::max((-b - std::sqrt(discriminant)) / a, 0.0f);
+	return t <= 1.0f;
+}
+
+// 点がorigin + t * diffと動くとき、線分(start, end)を軸とする半径radiusの円柱の側面に入る最初のt
+// 線分の両端より外側で入る場合は当たらない扱いにする(端は球で調べる)
+static bool SweepPointCylinder(const Vector3& origin, const Vector3& diff, const Vector3& start, const Vector3& end, float radius, float& t) {
+	Vector3 axis = end - start;
+	Vector3 m = origin - start;
+	float axisSquared = LengthSquared(axis);
+	float diffSquared = LengthSquared(diff);
+	float mAxis = Dot(m, axis);
+	float diffAxis = Dot(diff, axis);
+	// 軸に垂直な成分だけで二次方程式を作る(各係数はaxisSquared倍してある)
+	float a = axisSquared * diffSquared - diffAxis * diffAxis;
+	if (a <= kEpsilon * axisSquared * diffSquared) {
+		// 軸に平行に動いている
+		return false;
+	}
+	float b = axisSquared * Dot(m, diff) - mAxis * diffAxis;
+	if (b >= 0.0f) {
+		return false;
+	}
+	float c = axisSquared * (LengthSquared(m) - radius * radius) - mAxis * mAxis;
+	float discriminant = b * b - a * c;
+	if (discriminant < 0.0f) {
+		return false;
+	}
+	t = std::max((-b - std::sqrt(discriminant)) / a, 0.0f);
+	if (t > 1.0f) {
+		return false;
+	}
+	float s = mAxis + diffAxis * t;
+	return s >= 0.0f && s <= axisSquared;
+}
+
+// 点がorigin + t * diffと動くとき、線分(start, end)から半径radiusのカプセルに入る最初のtで、tを小さくする
+static bool SweepPointCapsule(const Vector3& origin, const Vector3& diff, const Vector3& start, const Vector3& end, float radius, float& t) {
+	bool hit = false;
+	float candidate;
+	if (SweepPointCylinder(origin, diff, start, end, radius, candidate) && candidate < t) {
+		t = candidate;
+		hit = true;
+	}
+	if (SweepPointSphere(origin, diff, start, radius, candidate) && candidate < t) {
+		t = candidate;
+		hit = true;
+	}
+	if (SweepPointSphere(origin, diff, end, radius, candidate) && candidate < t) {
+		t = candidate;
+		hit = true;
+	}
+	return hit;
+}
+
+// 動かす前から重なっている場合の結果。近づく向きに動くときだけ当たった扱いにする
+static bool OverlapImpact(const Contact& contact, const Vector3& displacement, const Vector3& closest, Impact& impact) {
+	if (Dot(displacement, contact.normal) <= 0.0f) {
+		return false;
+	}
+	impact.time = 0.0f;
+	impact.point = closest;
+	impact.normal = contact.normal;
+	return true;
+}
+
+// 時刻tの球の中心から最近接点へ向かう向きを法線にする
+static void MakeImpact(const Vector3& center, const Vector3& displacement, float t, const Vector3& closest, Impact& impact) {
+	impact.time = t;
+	impact.point = closest;
+	impact.normal = Normalize(closest - (center + displacement * t));
+	if (LengthSquared(impact.normal) == 0.0f) {
+		// 半径0の球は接触点と中心が一致するので、動く向きを法線にする
+		impact.normal = Normalize(displacement);
+	}
+}
+
+bool SweepSphere(const Sphere& sphere, const Vector3& displacement, const Plane& plane, Impact& impact) {
+	float approach = Dot(plane.normal, displacement);
+	if (approach >= 0.0f) {
+		// 裏側に向かって動いていない
+		return false;
+	}
+	// 中心と平面の距離が半径になる時刻。最初から重なっていれば負になるので0にする
+	float distance = SignedDistance(plane, sphere.center);
+	float t = (distance - sphere.radius) / -approach;
+	if (t > 1.0f) {
+		return false;
+	}
+	t = std::max(t, 0.0f);
+	impact.time = t;
+	impact.point = ClosestPoint(plane, sphere.center + displacement * t);
+	impact.normal = -plane.normal;
+	return true;
+}
+
+bool SweepSphere(const Sphere& sphere, const Vector3& displacement, const Triangle& triangle, Impact& impact) {
+	const Vector3& a = triangle.vertex[0];
+	const Vector3& b = triangle.vertex[1];
+	const Vector3& c = triangle.vertex[2];
+	Vector3 normal = Cross(b - a, c - a);
+	float normalLength = Length(normal);
+	float distance = 0.0f;
+	float approach = 0.0f;
+	if (normalLength > 0.0f) {
+		normal = normal * (1.0f / normalLength);
+		distance = Dot(normal, sphere.center - a);
+		approach = Dot(normal, displacement);
+		// 動く前も後も面の同じ側で半径より離れていれば当たらない(大半の三角形はここで除ける)
+		float end = distance + approach;
+		if ((distance > sphere.radius && end > sphere.radius) || (distance < -sphere.radius && end < -sphere.radius)) {
+			return false;
+		}
+	}
+	Contact contact;
+	if (IsCollision(sphere, triangle, contact)) {
+		return OverlapImpact(contact, displacement, ClosestPoint(triangle, sphere.center), impact);
+	}
+	if (normalLength > 0.0f) {
+		// 面: 球が近づく側の面から半径だけ離した平面に中心が届く時刻の接触点が三角形の中なら、それが最初の接触
+		if (distance * approach < 0.0f) {
+			float side = Sign(distance);
+			float t = (std::fabs(distance) - sphere.radius) / std::fabs(approach);
+			if (t >= 0.0f && t <= 1.0f) {
+				Vector3 point = sphere.center + displacement * t - normal * (side * sphere.radius);
+				if (Dot(Cross(b - a, point - a), normal) >= 0.0f &&
+					Dot(Cross(c - b, point - b), normal) >= 0.0f &&
+					Dot(Cross(a - c, point - c), normal) >= 0.0f) {
+					impact.time = t;
+					impact.point = point;
+					impact.normal = normal * -side;
+					return true;
+				}
+			}
+		}
+	}
+	// 辺と頂点: 中心が各辺のカプセルに入る最初の時刻
+	float t = FLT_MAX;
+	bool hit = false;
+	for (int i = 0; i < 3; ++i) {
+		hit |= SweepPointCapsule(sphere.center, displacement, triangle.vertex[i], triangle.vertex[(i + 1) % 3], sphere.radius, t);
+	}
+	if (!hit) {
+		return false;
+	}
+	MakeImpact(sphere.center, displacement, t, ClosestPoint(triangle, sphere.center + displacement * t), impact);
+	return true;
+}
+
+bool SweepSphere(const Sphere& sphere, const Vector3& displacement, const OBB& obb, Impact& impact) {
+	// 動く範囲を囲む球と、箱を囲む球が離れていれば当たらない
+	Vector3 middle = sphere.center + displacement * 0.5f;
+	float reach = sphere.radius + Length(displacement) * 0.5f + Length(obb.size);
+	if (LengthSquared(middle - obb.center) > reach * reach) {
+		return false;
+	}
+	Contact contact;
+	if (IsCollision(sphere, obb, contact)) {
+		return OverlapImpact(contact, displacement, ClosestPoint(obb, sphere.center), impact);
+	}
+	// ローカル座標で、箱を半径だけ広げた箱と線分の交差を求める
+	Vector3 origin = ToOBBLocal(obb, sphere.center);
+	Vector3 diff = ToOBBLocalDirection(obb, displacement);
+	const Vector3& extent = obb.size;
+	Vector3 expanded = extent + Vector3{ sphere.radius, sphere.radius, sphere.radius };
+	float tMin, tMax;
+	if (!ClipSegment(origin, diff, -expanded, expanded, tMin, tMax)) {
+		return false;
+	}
+	// 広げた箱に入った点が、元の箱の外側にはみ出している軸を調べる
+	Vector3 enter = origin + diff * tMin;
+	float signs[3];
+	int outsideCount = 0;
+	int insideAxis = 0;
+	for (int axis = 0; axis < 3; ++axis) {
+		float p = Component(enter, axis);
+		float e = Component(extent, axis);
+		signs[axis] = Sign(p);
+		if (p < -e || p > e) {
+			++outsideCount;
+		} else {
+			insideAxis = axis;
+		}
+	}
+	float t = tMin;
+	if (outsideCount >= 2) {
+		// 広げた箱の角の部分に入ったので、実際には辺のカプセルに当たるかどうかで決まる
+		Vector3 corner = { signs[0] * extent.x, signs[1] * extent.y, signs[2] * extent.z };
+		t = FLT_MAX;
+		bool hit = false;
+		for (int axis = 0; axis < 3; ++axis) {
+			if (outsideCount == 2 && axis != insideAxis) {
+				// 辺の部分は、はみ出していない軸に沿った辺だけ調べればよい
+				continue;
+			}
+			Vector3 other = corner;
+			if (axis == 0) {
+				other.x = -other.x;
+			} else if (axis == 1) {
+				other.y = -other.y;
+			} else {
+				other.z = -other.z;
+			}
+			hit |= SweepPointCapsule(origin, diff, corner, other, sphere.radius, t);
+		}
+		if (!hit) {
+			return false;
+		}
+	}
+	MakeImpact(sphere.center, displacement, t, ClosestPoint(obb, sphere.center + displacement * t), impact);
+	return true;
+}
+#pragma endregion
+
+#pragma region 一括判定
+// 配列の各要素をtestで判定して、当たった添字を詰めて書き込む
+template<typename Other, typename Test>
+static size_t CollectHits(std::span<const Other> others, std::span<uint32_t> hitIndices, Test test) {
+	assert(hitIndices.size() >= others.size());
+	size_t hitCount = 0;
+	for (size_t i = 0; i < others.size(); ++i) {
+		// 分岐を減らすため、常に書き込んでから当たった時だけ進める
+		hitIndices[hitCount] = static_cast<uint32_t>(i);
+		hitCount += test(others[i]) ? 1 : 0;
+	}
+	return hitCount;
+}
+
+size_t IsCollision(const Sphere& sphere, std::span<const Sphere> spheres, std::span<uint32_t> hitIndices) {
+	return CollectHits(spheres, hitIndices, [&](const Sphere& other) { return IsCollision(sphere, other); });
+}
+
+size_t IsCollision(const Sphere& sphere, std::span<const Triangle> triangles, std::span<uint32_t> hitIndices) {
+	const float radiusSquared = sphere.radius * sphere.radius;
+	return CollectHits(triangles, hitIndices, [&](const Triangle& triangle) {
+		return LengthSquared(ClosestPoint(triangle, sphere.center) - sphere.center) <= radiusSquared;
+	});
+}
+
+size_t IsCollision(const Sphere& sphere, std::span<const AABB> aabbs, std::span<uint32_t> hitIndices) {
+	const float radiusSquared = sphere.radius * sphere.radius;
+	return CollectHits(aabbs, hitIndices, [&](const AABB& aabb) {
+		return LengthSquared(ClosestPoint(aabb, sphere.center) - sphere.center) <= radiusSquared;
+	});
+}
+
+size_t IsCollision(const Sphere& sphere, std::span<const OBB> obbs, std::span<uint32_t> hitIndices) {
+	return CollectHits(obbs, hitIndices, [&](const OBB& obb) { return IsCollision(sphere, obb); });
+}
+
+size_t IsCollision(const Sphere& sphere, std::span<const Capsule> capsules, std::span<uint32_t> hitIndices) {
+	return CollectHits(capsules, hitIndices, [&](const Capsule& capsule) { return IsCollision(sphere, capsule); });
+}
+
+size_t IsCollision(const Segment& segment, std::span<const Triangle> triangles, std::span<uint32_t> hitIndices) {
+	return CollectHits(triangles, hitIndices, [&](const Triangle& triangle) { return IsCollision(segment, triangle); });
+}
+
+size_t IsCollision(const Segment& segment, std::span<const AABB> aabbs, std::span<uint32_t> hitIndices) {
+	return CollectHits(aabbs, hitIndices, [&](const AABB& aabb) { return IsCollision(segment, aabb); });
+}
+
+size_t IsCollision(const Segment& segment, std::span<const OBB> obbs, std::span<uint32_t> hitIndices) {
+	return CollectHits(obbs, hitIndices, [&](const OBB& obb) { return IsCollision(segment, obb); });
+}
+
+size_t IsCollision(const AABB& aabb, std::span<const AABB> aabbs, std::span<uint32_t> hitIndices) {
+	return CollectHits(aabbs, hitIndices, [&](const AABB& other) { return IsCollision(aabb, other); });
+}
+
+size_t IsCollision(const OBB& obb, std::span<const OBB> obbs, std::span<uint32_t> hitIndices) {
+	// 外接球で先にふるい落とす
+	const float radius = Length(obb.size);
+	return CollectHits(obbs, hitIndices, [&](const OBB& other) {
+		float sum = radius + Length(other.size);
+		if (LengthSquared(other.center - obb.center) > sum * sum) {
+			return false;
+		}
+		return IsCollision(obb, other);
+	});
+}
+
+size_t IsCollision(const Capsule& capsule, std::span<const Capsule> capsules, std::span<uint32_t> hitIndices) {
+	return CollectHits(capsules, hitIndices, [&](const Capsule& other) { return IsCollision(capsule, other); });
+}
+#pragma endregion
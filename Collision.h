@@ -0,0 +1,142 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include "Struct.h"
+
+// 衝突判定
+// 引数の形状の順番は Sphere, Plane, Segment, Triangle, AABB, OBB, Capsule の順に揃えてある
+// Planeは dot(normal, p) = distance を境界とし、裏側(dot(normal, p) <= distance)を中身の詰まった半空間として扱う(地面のように)
+// 判定・接触情報・動く球の衝突時刻のどれも同じ扱いで、裏側に丸ごと入った形状も当たっている。normalは正規化済みであること
+
+// 接触情報
+struct Contact {
+	Vector3 point;  //!< 接触点(2つの形状の最近接点の中点)
+	Vector3 normal; //!< 法線(1つ目の形状から2つ目の形状へ向かう向き)
+	float depth;    //!< めり込み量
+};
+
+// 動く球が最初に接したときの情報
+struct Impact {
+	float time;     //!< 接した時刻(移動量に対する割合。0以上1以下)
+	Vector3 point;  //!< 接触点(相手の形状上の点)
+	Vector3 normal; //!< 法線(球から相手の形状へ向かう向き)
+};
+
+#pragma region 最近接点
+// 線分上の最近接点(長さ0の線分にも対応)
+Vector3 ClosestPoint(const Segment& segment, const Vector3& point);
+// 平面上の最近接点
+Vector3 ClosestPoint(const Plane& plane, const Vector3& point);
+// 三角形上の最近接点
+Vector3 ClosestPoint(const Triangle& triangle, const Vector3& point);
+// AABB上(内部を含む)の最近接点
+Vector3 ClosestPoint(const AABB& aabb, const Vector3& point);
+// OBB上(内部を含む)の最近接点
+Vector3 ClosestPoint(const OBB& obb, const Vector3& point);
+// 2本の線分の最近接点を求め、その距離の2乗を返す
+float ClosestPoints(const Segment& segment1, const Segment& segment2, Vector3& point1, Vector3& point2);
+// 線分と三角形の最近接点を求め、その距離の2乗を返す
+float ClosestPoints(const Segment& segment, const Triangle& triangle, Vector3& onSegment, Vector3& onTriangle);
+// 線分とOBBの最近接点を求め、その距離の2乗を返す(線分がOBBを貫く場合は0)
+float ClosestPoints(const Segment& segment, const OBB& obb, Vector3& onSegment, Vector3& onOBB);
+#pragma endregion
+
+#pragma region 補助
+// AABBを同じ範囲のOBBにする
+OBB MakeOBB(const AABB& aabb);
+// 点までの符号付き距離。形状の外側が正、内側が負(平面は法線の向きが正)
+float SignedDistance(const Sphere& sphere, const Vector3& point);
+float SignedDistance(const Plane& plane, const Vector3& point);
+float SignedDistance(const AABB& aabb, const Vector3& point);
+float SignedDistance(const OBB& obb, const Vector3& point);
+float SignedDistance(const Capsule& capsule, const Vector3& point);
+// 各形状を囲むAABB
+AABB MakeAABB(const Sphere& sphere);
+AABB MakeAABB(const Segment& segment);
+AABB MakeAABB(const Triangle& triangle);
+AABB MakeAABB(const OBB& obb);
+AABB MakeAABB(const Capsule& capsule);
+#pragma endregion
+
+#pragma region 衝突判定
+bool IsCollision(const Sphere& sphere1, const Sphere& sphere2);
+bool IsCollision(const Sphere& sphere, const Plane& plane);
+bool IsCollision(const Sphere& sphere, const Segment& segment);
+bool IsCollision(const Sphere& sphere, const Triangle& triangle);
+bool IsCollision(const Sphere& sphere, const AABB& aabb);
+bool IsCollision(const Sphere& sphere, const OBB& obb);
+bool IsCollision(const Sphere& sphere, const Capsule& capsule);
+
+bool IsCollision(const Plane& plane1, const Plane& plane2);
+bool IsCollision(const Plane& plane, const Segment& segment);
+bool IsCollision(const Plane& plane, const Triangle& triangle);
+bool IsCollision(const Plane& plane, const AABB& aabb);
+bool IsCollision(const Plane& plane, const OBB& obb);
+bool IsCollision(const Plane& plane, const Capsule& capsule);
+
+bool IsCollision(const Segment& segment1, const Segment& segment2);
+bool IsCollision(const Segment& segment, const Triangle& triangle);
+bool IsCollision(const Segment& segment, const AABB& aabb);
+bool IsCollision(const Segment& segment, const OBB& obb);
+bool IsCollision(const Segment& segment, const Capsule& capsule);
+
+bool IsCollision(const Triangle& triangle1, const Triangle& triangle2);
+bool IsCollision(const Triangle& triangle, const AABB& aabb);
+bool IsCollision(const Triangle& triangle, const OBB& obb);
+bool IsCollision(const Triangle& triangle, const Capsule& capsule);
+
+bool IsCollision(const AABB& aabb1, const AABB& aabb2);
+bool IsCollision(const AABB& aabb, const OBB& obb);
+bool IsCollision(const AABB& aabb, const Capsule& capsule);
+
+bool IsCollision(const OBB& obb1, const OBB& obb2);
+bool IsCollision(const OBB& obb, const Capsule& capsule);
+
+bool IsCollision(const Capsule& capsule1, const Capsule& capsule2);
+#pragma endregion
+
+#pragma region 接触情報の生成
+// 当たっていればcontactに接触情報を書き込んでtrueを返す
+bool IsCollision(const Sphere& sphere1, const Sphere& sphere2, Contact& contact);
+bool IsCollision(const Sphere& sphere, const Plane& plane, Contact& contact);
+bool IsCollision(const Sphere& sphere, const Triangle& triangle, Contact& contact);
+bool IsCollision(const Sphere& sphere, const AABB& aabb, Contact& contact);
+bool IsCollision(const Sphere& sphere, const OBB& obb, Contact& contact);
+bool IsCollision(const Sphere& sphere, const Capsule& capsule, Contact& contact);
+
+bool IsCollision(const Plane& plane, const AABB& aabb, Contact& contact);
+bool IsCollision(const Plane& plane, const OBB& obb, Contact& contact);
+bool IsCollision(const Plane& plane, const Capsule& capsule, Contact& contact);
+
+bool IsCollision(const AABB& aabb1, const AABB& aabb2, Contact& contact);
+bool IsCollision(const OBB& obb1, const OBB& obb2, Contact& contact);
+bool IsCollision(const OBB& obb, const Capsule& capsule, Contact& contact);
+
+bool IsCollision(const Capsule& capsule1, const Capsule& capsule2, Contact& contact);
+#pragma endregion
+
+#pragma region 動く球の衝突時刻
+// 球の中心をdisplacementだけまっすぐ動かしたとき、最初に相手の形状に接する時刻を求める(連続的な衝突判定)
+// 薄い形状や速い球でも、途中ですり抜けることがない
+// 動かす前から重なっている場合は、近づく向きに動くならtimeが0、離れる向きなら当たらない扱いにする(跳ね返った直後に同じ形状で止まらないように)
+// Planeは裏側を中身の詰まった半空間として扱う(IsCollisionと同じ)。Triangleは両面
+bool SweepSphere(const Sphere& sphere, const Vector3& displacement, const Plane& plane, Impact& impact);
+bool SweepSphere(const Sphere& sphere, const Vector3& displacement, const Triangle& triangle, Impact& impact);
+bool SweepSphere(const Sphere& sphere, const Vector3& displacement, const OBB& obb, Impact& impact);
+#pragma endregion
+
+#pragma region 一括判定
+// 1つの形状と形状の配列をまとめて判定する
+// 当たった要素の添字をhitIndicesに書き込み、その数を返す(hitIndices.size() >= 配列の要素数)
+size_t IsCollision(const Sphere& sphere, std::span<const Sphere> spheres, std::span<uint32_t> hitIndices);
+size_t IsCollision(const Sphere& sphere, std::span<const Triangle> triangles, std::span<uint32_t> hitIndices);
+size_t IsCollision(const Sphere& sphere, std::span<const AABB> aabbs, std::span<uint32_t> hitIndices);
+size_t IsCollision(const Sphere& sphere, std::span<const OBB> obbs, std::span<uint32_t> hitIndices);
+size_t IsCollision(const Sphere& sphere, std::span<const Capsule> capsules, std::span<uint32_t> hitIndices);
+size_t IsCollision(const Segment& segment, std::span<const Triangle> triangles, std::span<uint32_t> hitIndices);
+size_t IsCollision(const Segment& segment, std::span<const AABB> aabbs, std::span<uint32_t> hitIndices);
+size_t IsCollision(const Segment& segment, std::span<const OBB> obbs, std::span<uint32_t> hitIndices);
+size_t IsCollision(const AABB& aabb, std::span<const AABB> aabbs, std::span<uint32_t> hitIndices);
+size_t IsCollision(const OBB& obb, std::span<const OBB> obbs, std::span<uint32_t> hitIndices);
+size_t IsCollision(const Capsule& capsule, std::span<const Capsule> capsules, std::span<uint32_t> hitIndices);
+#pragma endregion
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include "Curve.h"
+#include "Function.h"
+
+namespace {
+// f(t) = a t^3 + b t^2 + c t + d (0 <= t <= 1) をsegments等分した点を前進差分で書き込む
+// 差分 d1 = f(t + h) - f(t), d2 = d1の差分, d3 = d2の差分(一定) を足していくだけで次の点が求まる
+size_t ForwardDifference(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d, const Vector3& end, uint32_t segments, std::span<Vector3> output) {
+	if (output.empty()) {
+		return 0;
+	}
+	segments = std::max(segments, 1u);
+	const size_t count = std::min(static_cast<size_t>(segments) + 1, output.size());
+	const float h = 1.0f / static_cast<float>(segments);
+	const float h2 = h * h;
+	const float h3 = h2 * h;
+	Vector3 point = d;
+	Vector3 d1 = a * h3 + b * h2 + c * h;
+	Vector3 d2 = a * (6.0f * h3) + b * (2.0f * h2);
+	const Vector3 d3 = a * (6.0f * h3);
+	output[0] = point;
+	for (size_t i = 1; i < count; ++i) {
+		point += d1;
+		d1 += d2;
+		d2 += d3;
+		output[i] = point;
+	}
+	if (count == static_cast<size_t>(segments) + 1) {
+		output[segments] = end;
+	}
+	return count;
+}
+
+// Catmull-Romの区間(p1からp2まで)の多項式の係数
+void CatmullRomCoefficients(const Vector3& p0, const Vector3& p1, const Vector3& p2, const Vector3& p3, Vector3& a, Vector3& b, Vector3& c) {
+	a = (p0 * -1.0f + p1 * 3.0f - p2 * 3.0f + p3) * 0.5f;
+	b = (p0 * 2.0f - p1 * 5.0f + p2 * 4.0f - p3) * 0.5f;
+	c = (p2 - p0) * 0.5f;
+}
+
+// i番目の区間の4点(両端は端の点を複製する)
+void CatmullRomSpan(std::span<const Vector3> points, size_t i, Vector3 (&span)[4]) {
+	span[0] = points[i > 0 ? i - 1 : 0];
+	span[1] = points[i];
+	span[2] = points[i + 1];
+	span[3] = points[std::min(i + 2, points.size() - 1)];
+}
+
+// スクリーン座標(x, y)。カメラの後ろ(w <= 0)ならvalidがfalse
+struct ScreenPoint {
+	float x;
+	float y;
+	bool valid;
+};
+
+ScreenPoint Project(const Matrix4x4& m, const Vector3& p) {
+	float w = p.x * m.m[0][3] + p.y * m.m[1][3] + p.z * m.m[2][3] + m.m[3][3];
+	if (!(w > 0.0f)) {
+		return { 0.0f, 0.0f, false };
+	}
+	float x = p.x * m.m[0][0] + p.y * m.m[1][0] + p.z * m.m[2][0] + m.m[3][0];
+	float y = p.x * m.m[0][1] + p.y * m.m[1][1] + p.z * m.m[2][1] + m.m[3][1];
+	return { x / w, y / w, true };
+}
+
+// 点から線分までの距離の2乗
+float DistanceSquared(const ScreenPoint& p, const ScreenPoint& a, const ScreenPoint& b) {
+	float abX = b.x - a.x;
+	float abY = b.y - a.y;
+	float apX = p.x - a.x;
+	float apY = p.y - a.y;
+	float lengthSquared = abX * abX + abY * abY;
+	float t = lengthSquared > 0.0f ? std::clamp((apX * abX + apY * abY) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+	float dx = apX - abX * t;
+	float dy = apY - abY * t;
+	return dx * dx + dy * dy;
+}
+
+// 画面に投影した制御点が全て端点を結ぶ線分からtolerance以内なら、曲線も線分からtolerance以内にある(凸包性)
+// カメラの後ろに制御点があるときは判断できないので平らでない扱いにする
+bool IsFlat(const Vector3 (&control)[4], const Matrix4x4& toScreen, float toleranceSquared) {
+	ScreenPoint screen[4];
+	for (int i = 0; i < 4; ++i) {
+		screen[i] = Project(toScreen, control[i]);
+		if (!screen[i].valid) {
+			return false;
+		}
+	}
+	return DistanceSquared(screen[1], screen[0], screen[3]) <= toleranceSquared &&
+		DistanceSquared(screen[2], screen[0], screen[3]) <= toleranceSquared;
+}
+
+// 3次ベジエ曲線を平らになるまで半分に分け、各部分の終点を書き込む。writeStartなら始点も書き込む
+size_t TessellateCubicAdaptive(const Vector3 (&control)[4], const Matrix4x4& toScreen, float tolerance, std::span<Vector3> output, bool writeStart) {
+	struct Part {
+		Vector3 control[4];
+		uint32_t depth;
+	};
+	size_t count = 0;
+	if (writeStart) {
+		if (output.empty()) {
+			return 0;
+		}
+		output[count++] = control[0];
+	}
+	const float toleranceSquared = tolerance * tolerance;
+	// 左の部分から順に処理する。積むのは1段につき右の部分1つなので、深さ+1あれば足りる
+	Part stack[kMaxAdaptiveDepth + 1];
+	uint32_t stackCount = 0;
+	stack[stackCount++] = { { control[0], control[1], control[2], control[3] }, 0 };
+	while (stackCount > 0) {
+		const Part part = stack[--stackCount];
+		if (part.depth == kMaxAdaptiveDepth || IsFlat(part.control, toScreen, toleranceSquared)) {
+			if (count == output.size()) {
+				return count;
+			}
+			output[count++] = part.control[3];
+			continue;
+		}
+		// de Casteljauの方法でt = 0.5で分ける
+		const Vector3* p = part.control;
+		Vector3 p01 = (p[0] + p[1]) * 0.5f;
+		Vector3 p12 = (p[1] + p[2]) * 0.5f;
+		Vector3 p23 = (p[2] + p[3]) * 0.5f;
+		Vector3 p012 = (p01 + p12) * 0.5f;
+		Vector3 p123 = (p12 + p23) * 0.5f;
+		Vector3 middle = (p012 + p123) * 0.5f;
+		stack[stackCount++] = { { middle, p123, p23, p[3] }, part.depth + 1 };
+		stack[stackCount++] = { { p[0], p01, p012, middle }, part.depth + 1 };
+	}
+	return count;
+}
+}
+
+#pragma region 一様な分割
+size_t Tessellate(const QuadraticBezier& curve, uint32_t segments, std::span<Vector3> output) {
+	const Vector3* p = curve.points;
+	const Vector3 b = p[0] - p[1] * 2.0f + p[2];
+	const Vector3 c = (p[1] - p[0]) * 2.0f;
+	return ForwardDifference(Vector3{}, b, c, p[0], p[2], segments, output);
+}
+
+size_t Tessellate(const CubicBezier& curve, uint32_t segments, std::span<Vector3> output) {
+	const Vector3* p = curve.points;
+	const Vector3 a = p[0] * -1.0f + p[1] * 3.0f - p[2] * 3.0f + p[3];
+	const Vector3 b = p[0] * 3.0f - p[1] * 6.0f + p[2] * 3.0f;
+	const Vector3 c = (p[1] - p[0]) * 3.0f;
+	return ForwardDifference(a, b, c, p[0], p[3], segments, output);
+}
+
+size_t TessellateCatmullRom(std::span<const Vector3> points, uint32_t segmentsPerSpan, std::span<Vector3> output) {
+	if (points.empty() || output.empty()) {
+		return 0;
+	}
+	output[0] = points[0];
+	segmentsPerSpan = std::max(segmentsPerSpan, 1u);
+	size_t count = 1;
+	for (size_t i = 0; i + 1 < points.size(); ++i) {
+		// 区間の始点は前の区間の終点と同じ位置に書き込む
+		const size_t offset = i * segmentsPerSpan;
+		if (offset >= output.size()) {
+			break;
+		}
+		Vector3 span[4];
+		CatmullRomSpan(points, i, span);
+		Vector3 a, b, c;
+		CatmullRomCoefficients(span[0], span[1], span[2], span[3], a, b, c);
+		count = offset + ForwardDifference(a, b, c, span[1], span[2], segmentsPerSpan, output.subspan(offset));
+	}
+	return count;
+}
+#pragma endregion
+
+#pragma region 画面上の誤差に合わせた分割
+size_t TessellateAdaptive(const QuadraticBezier& curve, const Matrix4x4& toScreen, float tolerance, std::span<Vector3> output) {
+	// 同じ曲線を表す3次ベジエ曲線に変換する(次数上げ)
+	const Vector3* p = curve.points;
+	const Vector3 control[4] = { p[0], p[0] + (p[1] - p[0]) * (2.0f / 3.0f), p[2] + (p[1] - p[2]) * (2.0f / 3.0f), p[2] };
+	return TessellateCubicAdaptive(control, toScreen, tolerance, output, true);
+}
+
+size_t TessellateAdaptive(const CubicBezier& curve, const Matrix4x4& toScreen, float tolerance, std::span<Vector3> output) {
+	const Vector3 control[4] = { curve.points[0], curve.points[1], curve.points[2], curve.points[3] };
+	return TessellateCubicAdaptive(control, toScreen, tolerance, output, true);
+}
+
+size_t TessellateCatmullRomAdaptive(std::span<const Vector3> points, const Matrix4x4& toScreen, float tolerance, std::span<Vector3> output) {
+	if (points.empty() || output.empty()) {
+		return 0;
+	}
+	if (points.size() == 1) {
+		output[0] = points[0];
+		return 1;
+	}
+	size_t count = 0;
+	for (size_t i = 0; i + 1 < points.size() && count < output.size(); ++i) {
+		// 区間を同じ曲線を表す3次ベジエ曲線に変換する
+		Vector3 span[4];
+		CatmullRomSpan(points, i, span);
+		const Vector3 control[4] = { span[1], span[1] + (span[2] - span[0]) * (1.0f / 6.0f), span[2] - (span[3] - span[1]) * (1.0f / 6.0f), span[2] };
+		count += TessellateCubicAdaptive(control, toScreen, tolerance, output.subspan(count), i == 0);
+	}
+	return count;
+}
+#pragma endregion
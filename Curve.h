@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include "Struct.h"
+
+// 曲線を折れ線の点列にまとめて変換する(描画や当たり判定用)
+// 点はpoints[0]から順に並ぶ。MathCore.hのBezier(p0, p1, p2, t)はtが0のときp2なので、
+// Bezier(p0, p1, p2, t)は、ここで分割した点列のうち割合(1 - t)の位置の点と同じになる
+// 結果は呼び出し側が用意した配列に書き込み、書き込んだ点の数を返す。配列が足りなければ書き込める所までで打ち切る
+
+// 2次ベジエ曲線の制御点
+struct QuadraticBezier {
+	Vector3 points[3];
+};
+
+// 3次ベジエ曲線の制御点
+struct CubicBezier {
+	Vector3 points[4];
+};
+
+#pragma region 一様な分割
+// 曲線のパラメータをsegments等分した(segments + 1)個の点を求める
+// 前進差分で、1点あたり加算だけで次の点を求める(終点は誤差が溜まらないよう制御点をそのまま書き込む)
+size_t Tessellate(const QuadraticBezier& curve, uint32_t segments, std::span<Vector3> output);
+size_t Tessellate(const CubicBezier& curve, uint32_t segments, std::span<Vector3> output);
+// 全ての点を通るCatmull-Romスプライン。隣り合う点の間をsegmentsPerSpan等分する
+// 両端は端の点を複製して延長したものとして扱う。点の数は (points.size() - 1) * segmentsPerSpan + 1
+size_t TessellateCatmullRom(std::span<const Vector3> points, uint32_t segmentsPerSpan, std::span<Vector3> output);
+#pragma endregion
+
+#pragma region 画面上の誤差に合わせた分割
+// 画面上で折れ線と曲線のずれがtolerance(ピクセル)以下になるまで、曲がっている所だけを細かく分ける
+// toScreenはワールド座標からスクリーン座標への行列(ビュープロジェクション * ビューポート)
+// 書き込む点はワールド座標。曲線1本(Catmull-Romは1区間)あたり最大kMaxAdaptivePoints個
+constexpr uint32_t kMaxAdaptiveDepth = 10;
+constexpr size_t kMaxAdaptivePoints = (size_t(1) << kMaxAdaptiveDepth) + 1;
+size_t TessellateAdaptive(const QuadraticBezier& curve, const Matrix4x4& toScreen, float tolerance, std::span<Vector3> output);
+size_t TessellateAdaptive(const CubicBezier& curve, const Matrix4x4& toScreen, float tolerance, std::span<Vector3> output);
+size_t TessellateCatmullRomAdaptive(std::span<const Vector3> points, const Matrix4x4& toScreen, float tolerance, std::span<Vector3> output);
+#pragma endregion
@@ -0,0 +1,432 @@
+#include <algorithm>
+#include <assert.h>
+#include <cstdlib>
+#include "DynamicAABBTree.h"
+
+namespace {
+// 移動量の何倍だけ先回りして太らせるか
+constexpr float kDisplacementMultiplier = 4.0f;
+
+AABB Union(const AABB& a, const AABB& b) {
+	return {
+		{ std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z) },
+		{ std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z) },
+		a.color,
+	};
+}
+
+// 表面積(の半分)。挿入先を選ぶコストに使う
+float Area(const AABB& aabb) {
+	float x = aabb.max.x - aabb.min.x;
+	float y = aabb.max.y - aabb.min.y;
+	float z = aabb.max.z - aabb.min.z;
+	return x * y + y * z + z * x;
+}
+
+bool Contains(const AABB& outer, const AABB& inner) {
+	return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+		inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+}
+
+AABB Fatten(const AABB& aabb, float margin) {
+	return {
+		{ aabb.min.x - margin, aabb.min.y - margin, aabb.min.z - margin },
+		{ aabb.max.x + margin, aabb.max.y + margin, aabb.max.z + margin },
+		aabb.color,
+	};
+}
+
+// 移動方向にだけAABBを伸ばす
+void Extend(float& min, float& max, float displacement) {
+	if (displacement < 0.0f) {
+		min += displacement;
+	} else {
+		max += displacement;
+	}
+}
+}
+
+DynamicAABBTree::DynamicAABBTree(float margin)
+	: margin_(margin) {
+	assert(margin >= 0.0f);
+}
+
+bool DynamicAABBTree::Overlaps(const AABB& a, const AABB& b) {
+	return a.min.x <= b.max.x && b.min.x <= a.max.x &&
+		a.min.y <= b.max.y && b.min.y <= a.max.y &&
+		a.min.z <= b.max.z && b.min.z <= a.max.z;
+}
+
+#pragma region ノードの確保
+int32_t DynamicAABBTree::AllocateNode() {
+	if (freeList_ == kNullNode) {
+		// 空きが無ければプールを広げる。広げた分は空きリストにつないでおく
+		int32_t oldCapacity = static_cast<int32_t>(nodes_.size());
+		int32_t newCapacity = std::max(oldCapacity * 2, 16);
+		nodes_.resize(newCapacity);
+		for (int32_t i = oldCapacity; i < newCapacity; ++i) {
+			nodes_[i].parent = i + 1 < newCapacity ? i + 1 : kNullNode;
+			nodes_[i].height = -1;
+		}
+		freeList_ = oldCapacity;
+	}
+	int32_t node = freeList_;
+	freeList_ = nodes_[node].parent;
+	nodes_[node].parent = kNullNode;
+	nodes_[node].child1 = kNullNode;
+	nodes_[node].child2 = kNullNode;
+	nodes_[node].height = 0;
+	nodes_[node].userData = 0;
+	nodes_[node].moved = false;
+	return node;
+}
+
+void DynamicAABBTree::FreeNode(int32_t node) {
+	assert(0 <= node && node < static_cast<int32_t>(nodes_.size()));
+	nodes_[node].parent = freeList_;
+	nodes_[node].height = -1;
+	freeList_ = node;
+}
+#pragma endregion
+
+#pragma region プロキシ
+int32_t DynamicAABBTree::CreateProxy(const AABB& aabb, uint32_t userData) {
+	int32_t proxy = AllocateNode();
+	nodes_[proxy].aabb = Fatten(aabb, margin_);
+	nodes_[proxy].userData = userData;
+	nodes_[proxy].moved = true;
+	InsertLeaf(proxy);
+	moveBuffer_.push_back(proxy);
+	++proxyCount_;
+	return proxy;
+}
+
+void DynamicAABBTree::DestroyProxy(int32_t proxy) {
+	assert(0 <= proxy && proxy < static_cast<int32_t>(nodes_.size()));
+	assert(nodes_[proxy].IsLeaf() && nodes_[proxy].height == 0);
+	if (nodes_[proxy].moved) {
+		// 組み替え待ちからも外す
+		std::replace(moveBuffer_.begin(), moveBuffer_.end(), proxy, kNullNode);
+	}
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	--proxyCount_;
+}
+
+bool DynamicAABBTree::MoveProxy(int32_t proxy, const AABB& aabb, const Vector3& displacement) {
+	assert(0 <= proxy && proxy < static_cast<int32_t>(nodes_.size()));
+	assert(nodes_[proxy].IsLeaf() && nodes_[proxy].height == 0);
+	if (Contains(nodes_[proxy].aabb, aabb)) {
+		// 太らせた範囲に収まっていれば何もしない
+		return false;
+	}
+
+	AABB fat = Fatten(aabb, margin_);
+	Extend(fat.min.x, fat.max.x, displacement.x * kDisplacementMultiplier);
+	Extend(fat.min.y, fat.max.y, displacement.y * kDisplacementMultiplier);
+	Extend(fat.min.z, fat.max.z, displacement.z * kDisplacementMultiplier);
+
+	RemoveLeaf(proxy);
+	nodes_[proxy].aabb = fat;
+	InsertLeaf(proxy);
+	if (!nodes_[proxy].moved) {
+		nodes_[proxy].moved = true;
+		moveBuffer_.push_back(proxy);
+	}
+	return true;
+}
+#pragma endregion
+
+#pragma region 木の操作
+void DynamicAABBTree::InsertLeaf(int32_t leaf) {
+	if (root_ == kNullNode) {
+		root_ = leaf;
+		nodes_[root_].parent = kNullNode;
+		return;
+	}
+
+	// 表面積の増え方が一番小さくなる兄弟を探す
+	const AABB leafAABB = nodes_[leaf].aabb;
+	int32_t index = root_;
+	while (!nodes_[index].IsLeaf()) {
+		const Node& node = nodes_[index];
+		float area = Area(node.aabb);
+		float combinedArea = Area(Union(node.aabb, leafAABB));
+		// ここに新しい親を作って兄弟にする場合のコスト
+		float cost = 2.0f * combinedArea;
+		// さらに下に降りる場合に、このノードより上で増える分
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCost[2];
+		const int32_t children[2] = { node.child1, node.child2 };
+		for (int i = 0; i < 2; ++i) {
+			const Node& child = nodes_[children[i]];
+			float unionArea = Area(Union(child.aabb, leafAABB));
+			if (child.IsLeaf()) {
+				childCost[i] = unionArea + inheritanceCost;
+			} else {
+				childCost[i] = unionArea - Area(child.aabb) + inheritanceCost;
+			}
+		}
+
+		if (cost < childCost[0] && cost < childCost[1]) {
+			break;
+		}
+		index = childCost[0] < childCost[1] ? node.child1 : node.child2;
+	}
+	int32_t sibling = index;
+
+	// 兄弟と新しい葉をまとめる親を作る
+	int32_t oldParent = nodes_[sibling].parent;
+	int32_t newParent = AllocateNode();
+	nodes_[newParent].parent = oldParent;
+	nodes_[newParent].aabb = Union(leafAABB, nodes_[sibling].aabb);
+	nodes_[newParent].height = nodes_[sibling].height + 1;
+	nodes_[newParent].child1 = sibling;
+	nodes_[newParent].child2 = leaf;
+	nodes_[sibling].parent = newParent;
+	nodes_[leaf].parent = newParent;
+
+	if (oldParent == kNullNode) {
+		root_ = newParent;
+	} else if (nodes_[oldParent].child1 == sibling) {
+		nodes_[oldParent].child1 = newParent;
+	} else {
+		nodes_[oldParent].child2 = newParent;
+	}
+
+	Refit(nodes_[leaf].parent);
+}
+
+void DynamicAABBTree::RemoveLeaf(int32_t leaf) {
+	if (leaf == root_) {
+		root_ = kNullNode;
+		return;
+	}
+
+	// 親を消して、兄弟を祖父につなぎ直す
+	int32_t parent = nodes_[leaf].parent;
+	int32_t grandParent = nodes_[parent].parent;
+	int32_t sibling = nodes_[parent].child1 == leaf ? nodes_[parent].child2 : nodes_[parent].child1;
+
+	if (grandParent == kNullNode) {
+		root_ = sibling;
+		nodes_[sibling].parent = kNullNode;
+		FreeNode(parent);
+		return;
+	}
+
+	if (nodes_[grandParent].child1 == parent) {
+		nodes_[grandParent].child1 = sibling;
+	} else {
+		nodes_[grandParent].child2 = sibling;
+	}
+	nodes_[sibling].parent = grandParent;
+	FreeNode(parent);
+
+	Refit(grandParent);
+}
+
+void DynamicAABBTree::Refit(int32_t index) {
+	while (index != kNullNode) {
+		index = Balance(index);
+
+		Node& node = nodes_[index];
+		const Node& child1 = nodes_[node.child1];
+		const Node& child2 = nodes_[node.child2];
+		node.height = 1 + std::max(child1.height, child2.height);
+		node.aabb = Union(child1.aabb, child2.aabb);
+
+		index = node.parent;
+	}
+}
+
+int32_t DynamicAABBTree::Balance(int32_t iA) {
+	// Aを根とする部分木で、BとCのどちらかが2以上高ければ高い方を持ち上げる
+	// A の子が B, C で、C の子が F, G (B の子は D, E)
+	Node& A = nodes_[iA];
+	if (A.IsLeaf() || A.height < 2) {
+		return iA;
+	}
+
+	int32_t iB = A.child1;
+	int32_t iC = A.child2;
+	Node& B = nodes_[iB];
+	Node& C = nodes_[iC];
+	int32_t balance = C.height - B.height;
+
+	// Cを持ち上げる
+	if (balance > 1) {
+		int32_t iF = C.child1;
+		int32_t iG = C.child2;
+		Node& F = nodes_[iF];
+		Node& G = nodes_[iG];
+
+		C.child1 = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+		if (C.parent == kNullNode) {
+			root_ = iC;
+		} else if (nodes_[C.parent].child1 == iA) {
+			nodes_[C.parent].child1 = iC;
+		} else {
+			nodes_[C.parent].child2 = iC;
+		}
+
+		// FとGのうち高い方をCの下に残し、低い方をAに渡す
+		if (F.height > G.height) {
+			C.child2 = iF;
+			A.child2 = iG;
+			G.parent = iA;
+			A.aabb = Union(B.aabb, G.aabb);
+			C.aabb = Union(A.aabb, F.aabb);
+			A.height = 1 + std::max(B.height, G.height);
+			C.height = 1 + std::max(A.height, F.height);
+		} else {
+			C.child2 = iG;
+			A.child2 = iF;
+			F.parent = iA;
+			A.aabb = Union(B.aabb, F.aabb);
+			C.aabb = Union(A.aabb, G.aabb);
+			A.height = 1 + std::max(B.height, F.height);
+			C.height = 1 + std::max(A.height, G.height);
+		}
+		return iC;
+	}
+
+	// Bを持ち上げる
+	if (balance < -1) {
+		int32_t iD = B.child1;
+		int32_t iE = B.child2;
+		Node& D = nodes_[iD];
+		Node& E = nodes_[iE];
+
+		B.child1 = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+		if (B.parent == kNullNode) {
+			root_ = iB;
+		} else if (nodes_[B.parent].child1 == iA) {
+			nodes_[B.parent].child1 = iB;
+		} else {
+			nodes_[B.parent].child2 = iB;
+		}
+
+		if (D.height > E.height) {
+			B.child2 = iD;
+			A.child1 = iE;
+			E.parent = iA;
+			A.aabb = Union(C.aabb, E.aabb);
+			B.aabb = Union(A.aabb, D.aabb);
+			A.height = 1 + std::max(C.height, E.height);
+			B.height = 1 + std::max(A.height, D.height);
+		} else {
+			B.child2 = iE;
+			A.child1 = iD;
+			D.parent = iA;
+			A.aabb = Union(C.aabb, D.aabb);
+			B.aabb = Union(A.aabb, E.aabb);
+			A.height = 1 + std::max(C.height, D.height);
+			B.height = 1 + std::max(A.height, E.height);
+		}
+		return iB;
+	}
+
+	return iA;
+}
+#pragma endregion
+
+#pragma region ペア検出
+void DynamicAABBTree::QueryAllPairs(std::vector<Pair>& pairs) {
+	pairs.clear();
+	for (int32_t proxy = 0; proxy < static_cast<int32_t>(nodes_.size()); ++proxy) {
+		const Node& node = nodes_[proxy];
+		if (node.height != 0) {
+			continue;
+		}
+		// 同じ組を2回数えないよう、番号の大きい相手とだけ組にする
+		Query(node.aabb, [&](int32_t other) {
+			if (other > proxy) {
+				pairs.push_back({ node.userData, nodes_[other].userData });
+			}
+			return true;
+		});
+	}
+	// 組み替え待ちはすべて処理したことになる
+	for (int32_t proxy : moveBuffer_) {
+		if (proxy != kNullNode) {
+			nodes_[proxy].moved = false;
+		}
+	}
+	moveBuffer_.clear();
+	pairCount_ = pairs.size();
+}
+
+void DynamicAABBTree::QueryMovedPairs(std::vector<Pair>& pairs) {
+	pairs.clear();
+	for (int32_t proxy : moveBuffer_) {
+		if (proxy == kNullNode) {
+			continue;
+		}
+		const Node& node = nodes_[proxy];
+		Query(node.aabb, [&](int32_t other) {
+			if (other == proxy) {
+				return true;
+			}
+			// 両方とも組み替えられていれば、番号の小さい方からだけ組にする
+			if (nodes_[other].moved && other < proxy) {
+				return true;
+			}
+			pairs.push_back({ node.userData, nodes_[other].userData });
+			return true;
+		});
+	}
+	for (int32_t proxy : moveBuffer_) {
+		if (proxy != kNullNode) {
+			nodes_[proxy].moved = false;
+		}
+	}
+	moveBuffer_.clear();
+	pairCount_ = pairs.size();
+}
+#pragma endregion
+
+DynamicAABBTree::Statistics DynamicAABBTree::GetStatistics() const {
+	Statistics statistics = {};
+	statistics.proxyCount = proxyCount_;
+	statistics.pairCount = pairCount_;
+	if (root_ == kNullNode) {
+		return statistics;
+	}
+	statistics.height = nodes_[root_].height;
+
+	// 深さ付きで全ノードをたどる
+	struct Entry {
+		int32_t node;
+		int32_t depth;
+	};
+	Entry stack[kStackSize];
+	int32_t count = 0;
+	stack[count++] = { root_, 0 };
+	float internalArea = 0.0f;
+	int64_t leafDepthSum = 0;
+	while (count > 0) {
+		Entry entry = stack[--count];
+		const Node& node = nodes_[entry.node];
+		++statistics.nodeCount;
+		if (node.IsLeaf()) {
+			leafDepthSum += entry.depth;
+			continue;
+		}
+		internalArea += Area(node.aabb);
+		int32_t balance = std::abs(nodes_[node.child2].height - nodes_[node.child1].height);
+		statistics.maxBalance = std::max(statistics.maxBalance, balance);
+		assert(count + 2 <= kStackSize);
+		stack[count++] = { node.child1, entry.depth + 1 };
+		stack[count++] = { node.child2, entry.depth + 1 };
+	}
+	float rootArea = Area(nodes_[root_].aabb);
+	statistics.areaRatio = rootArea > 0.0f ? internalArea / rootArea : 0.0f;
+	statistics.averageLeafDepth = static_cast<float>(leafDepthSum) / static_cast<float>(proxyCount_);
+	return statistics;
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <assert.h>
+#include <cstdint>
+#include <vector>
+#include "Struct.h"
+
+// 動的AABB木によるブロードフェーズ
+// 葉には少し太らせた(余白を足した)AABBを登録するので、小さな移動では木を組み替えずに済む
+// ノードは配列でプールして使い回すので、容量が足りている間はメモリ確保をしない
+class DynamicAABBTree {
+public:
+	// 無効なノード番号
+	static constexpr int32_t kNullNode = -1;
+	// 探索用スタックの大きさ。回転で高さを抑えているので十分足りる
+	static constexpr int32_t kStackSize = 256;
+
+	// 重なっているプロキシの組(登録時のuserData)
+	struct Pair {
+		uint32_t userData1;
+		uint32_t userData2;
+	};
+
+	// 木の統計
+	struct Statistics {
+		int32_t proxyCount;     // 登録されているプロキシの数
+		int32_t nodeCount;      // 使用中のノードの数
+		int32_t height;         // 木の高さ
+		float averageLeafDepth; // 葉の深さの平均
+		int32_t maxBalance;     // 子の高さの差の最大値
+		float areaRatio;        // 内部ノードの表面積の合計 / 根の表面積
+		size_t pairCount;       // 直近のペア検出で見つかった組の数
+	};
+
+	// marginはAABBを太らせる量
+	explicit DynamicAABBTree(float margin = 0.1f);
+
+	// プロキシを登録して番号を返す
+	int32_t CreateProxy(const AABB& aabb, uint32_t userData);
+	void DestroyProxy(int32_t proxy);
+	// プロキシのAABBを更新する。displacementはこのフレームの移動量で、その向きに余分に太らせる
+	// 太らせたAABBからはみ出して木を組み替えた場合はtrueを返す
+	bool MoveProxy(int32_t proxy, const AABB& aabb, const Vector3& displacement = {});
+
+	uint32_t GetUserData(int32_t proxy) const { return nodes_[proxy].userData; }
+	const AABB& GetFatAABB(int32_t proxy) const { return nodes_[proxy].aabb; }
+
+	// aabbと重なるプロキシごとにcallback(proxy)を呼ぶ。callbackがfalseを返すと打ち切る
+	template<typename Callback>
+	void Query(const AABB& aabb, Callback&& callback) const;
+
+	// 線分と交わるプロキシごとにcallback(proxy, segment, maxFraction)を呼ぶ
+	// callbackは新しいmaxFraction(線分上の割合0～1)を返す。0を返すと打ち切り、maxFractionを返すとそのまま続ける
+	template<typename Callback>
+	void RayCast(const Segment& segment, Callback&& callback) const;
+
+	// 重なっている全ての組を求める
+	void QueryAllPairs(std::vector<Pair>& pairs);
+	// 前回呼んでから組み替えられた(MoveProxyがtrueを返した)プロキシが関わる組だけを求める
+	void QueryMovedPairs(std::vector<Pair>& pairs);
+
+	// 木を走査して統計を求める
+	Statistics GetStatistics() const;
+
+private:
+	struct Node {
+		AABB aabb;         // 葉は太らせたAABB、内部ノードは子を囲むAABB
+		uint32_t userData; // 葉のみ
+		int32_t parent;    // 空きノードの場合は次の空きノード
+		int32_t child1;    // 葉ならkNullNode
+		int32_t child2;
+		int32_t height;    // 葉は0、空きノードは-1
+		bool moved;        // 組み替えられてまだペア検出していない
+
+		bool IsLeaf() const { return child1 == kNullNode; }
+	};
+
+	int32_t AllocateNode();
+	void FreeNode(int32_t node);
+	void InsertLeaf(int32_t leaf);
+	void RemoveLeaf(int32_t leaf);
+	// nodeの子の高さが2以上違えば回転して、新しく部分木の根になったノードを返す
+	int32_t Balance(int32_t node);
+	// nodeから根までAABBと高さを更新する(途中で回転もする)
+	void Refit(int32_t node);
+
+	static bool Overlaps(const AABB& a, const AABB& b);
+
+	std::vector<Node> nodes_;
+	int32_t root_ = kNullNode;
+	int32_t freeList_ = kNullNode;
+	int32_t proxyCount_ = 0;
+	float margin_;
+	// 組み替えられたプロキシ
+	std::vector<int32_t> moveBuffer_;
+	size_t pairCount_ = 0;
+};
+
+template<typename Callback>
+void DynamicAABBTree::Query(const AABB& aabb, Callback&& callback) const {
+	int32_t stack[kStackSize];
+	int32_t count = 0;
+	stack[count++] = root_;
+	while (count > 0) {
+		int32_t index = stack[--count];
+		if (index == kNullNode) {
+			continue;
+		}
+		const Node& node = nodes_[index];
+		if (!Overlaps(node.aabb, aabb)) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			if (!callback(index)) {
+				return;
+			}
+		} else {
+			assert(count + 2 <= kStackSize);
+			stack[count++] = node.child1;
+			stack[count++] = node.child2;
+		}
+	}
+}
+
+template<typename Callback>
+void DynamicAABBTree::RayCast(const Segment& segment, Callback&& callback) const {
+	float maxFraction = 1.0f;
+	// 各軸の傾きの逆数(0除算はinfになり、下の比較で正しく扱われる)
+	const float inverse[3] = { 1.0f / segment.diff.x, 1.0f / segment.diff.y, 1.0f / segment.diff.z };
+	const float origin[3] = { segment.origin.x, segment.origin.y, segment.origin.z };
+
+	int32_t stack[kStackSize];
+	int32_t count = 0;
+	stack[count++] = root_;
+	while (count > 0) {
+		int32_t index = stack[--count];
+		if (index == kNullNode) {
+			continue;
+		}
+		const Node& node = nodes_[index];
+		// スラブ法で[0, maxFraction]の範囲で交わるか調べる
+		const float min[3] = { node.aabb.min.x, node.aabb.min.y, node.aabb.min.z };
+		const float max[3] = { node.aabb.max.x, node.aabb.max.y, node.aabb.max.z };
+		float tMin = 0.0f;
+		float tMax = maxFraction;
+		bool hit = true;
+		for (int axis = 0; axis < 3 && hit; ++axis) {
+			float t1 = (min[axis] - origin[axis]) * inverse[axis];
+			float t2 = (max[axis] - origin[axis]) * inverse[axis];
+			if (t1 != t1 || t2 != t2) {
+				// 軸に平行でちょうど面上にある(0 * inf)
+				continue;
+			}
+			if (t1 > t2) {
+				float tmp = t1;
+				t1 = t2;
+				t2 = tmp;
+			}
+			tMin = t1 > tMin ? t1 : tMin;
+			tMax = t2 < tMax ? t2 : tMax;
+			hit = tMin <= tMax;
+		}
+		if (!hit) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			float value = callback(index, segment, maxFraction);
+			if (value == 0.0f) {
+				return;
+			}
+			if (value > 0.0f && value < maxFraction) {
+				maxFraction = value;
+			}
+		} else {
+			assert(count + 2 <= kStackSize);
+			stack[count++] = node.child1;
+			stack[count++] = node.child2;
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <assert.h>
+#include "FrameArena.h"
+
+namespace {
+// 容量を超えたフレームの後に広げるときの単位
+constexpr size_t kGrowGranularity = 4096;
+
+// blockのused以降からalignmentの倍数の位置にsizeバイトを切り出す。入りきらなければnullptr
+void* Bump(std::byte* block, size_t capacity, size_t& used, size_t size, size_t alignment) {
+	if (block == nullptr) {
+		return nullptr;
+	}
+	const uintptr_t base = reinterpret_cast<uintptr_t>(block);
+	const uintptr_t aligned = (base + used + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+	const size_t offset = static_cast<size_t>(aligned - base);
+	if (offset > capacity || size > capacity - offset) {
+		return nullptr;
+	}
+	used = offset + size;
+	return block + offset;
+}
+}
+
+#pragma region スレッドごとの領域
+void* FrameArena::ThreadArena::Allocate(size_t size, size_t alignment) {
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && "alignmentは2のべき乗にすること");
+	++allocationCount_;
+	if (void* pointer = Bump(buffer_.get(), capacity_, used_, size, alignment)) {
+		return pointer;
+	}
+
+	// 容量を超えた分はヒープのブロックから切り出す
+	std::byte* block = overflowBlocks_.empty() ? nullptr : overflowBlocks_.back().get();
+	size_t before = overflowUsed_;
+	void* pointer = Bump(block, overflowCapacity_, overflowUsed_, size, alignment);
+	if (pointer == nullptr) {
+		overflowCapacity_ = std::max(capacity_, size + alignment);
+		overflowBlocks_.emplace_back(new std::byte[overflowCapacity_]);
+		overflowUsed_ = 0;
+		before = 0;
+		pointer = Bump(overflowBlocks_.back().get(), overflowCapacity_, overflowUsed_, size, alignment);
+	}
+	overflowBytes_ += overflowUsed_ - before;
+	return pointer;
+}
+
+bool FrameArena::ThreadArena::Reset() {
+	const bool grow = overflowBytes_ > 0;
+	if (grow) {
+		// 次に同じだけ使ってもヒープから取らずに済むよう、このフレームで使った大きさまで広げる
+		capacity_ = (GetUsedBytes() + kGrowGranularity - 1) / kGrowGranularity * kGrowGranularity;
+		buffer_.reset(new std::byte[capacity_]);
+		overflowBlocks_.clear();
+		overflowUsed_ = 0;
+		overflowCapacity_ = 0;
+		overflowBytes_ = 0;
+	}
+	used_ = 0;
+	allocationCount_ = 0;
+	return grow;
+}
+#pragma endregion
+
+#pragma region フレーム
+FrameArena::FrameArena(size_t capacityPerThread, uint32_t threadCount)
+	: threadCount_(std::max(threadCount, 1u)) {
+	for (std::unique_ptr<ThreadArena[]>& frame : frames_) {
+		frame.reset(new ThreadArena[threadCount_]);
+		for (uint32_t i = 0; i < threadCount_; ++i) {
+			frame[i].capacity_ = capacityPerThread;
+			frame[i].buffer_.reset(capacityPerThread > 0 ? new std::byte[capacityPerThread] : nullptr);
+		}
+	}
+	statistics_.capacityBytes = capacityPerThread * threadCount_;
+}
+
+void FrameArena::EndFrame() {
+	// 締めるフレームの統計を取る
+	Statistics& statistics = statistics_;
+	statistics.usedBytes = 0;
+	statistics.allocationCount = 0;
+	statistics.overflowBytes = 0;
+	for (uint32_t i = 0; i < threadCount_; ++i) {
+		const ThreadArena& arena = frames_[current_][i];
+		statistics.usedBytes += arena.GetUsedBytes();
+		statistics.allocationCount += arena.allocationCount_;
+		statistics.overflowBytes += arena.overflowBytes_;
+		statistics.highWaterBytes = std::max(statistics.highWaterBytes, arena.GetUsedBytes());
+	}
+	++statistics.frameCount;
+
+	// 2つ前のフレームの領域を捨てて、次のフレームに使う
+	current_ ^= 1;
+	statistics.capacityBytes = 0;
+	for (uint32_t i = 0; i < threadCount_; ++i) {
+		ThreadArena& arena = frames_[current_][i];
+		statistics.growCount += arena.Reset();
+		statistics.capacityBytes += arena.capacity_;
+	}
+}
+#pragma endregion
@@ -0,0 +1,118 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// 1フレームの間だけ使う一時的なメモリ(当たり判定の結果、カリングで見えた物体の添字、デバッグ表示の線分など)の割り当て
+// 先頭から順に切り出すだけで、個別には解放しない。EndFrameでまとめて捨てる
+// 2フレーム分を交互に使うので、EndFrameの後も直前のフレームで割り当てたものは次のEndFrameまで読める
+// スレッドごとに別の領域(Get(threadIndex))を持つので、ParallelForの区切りの中からロックなしで割り当てられる
+// 容量を超えた分はヒープから取り、そのフレームの領域を捨てるときに、使った大きさまで領域を広げる(数フレームでヒープを使わなくなる)
+class FrameArena {
+public:
+	// 直近のEndFrameで締めたフレームの統計
+	struct Statistics {
+		uint64_t frameCount;     // EndFrameを呼んだ回数
+		size_t usedBytes;        // 全スレッドで割り当てた大きさ(位置合わせの隙間を含む)
+		size_t allocationCount;  // 割り当てた回数
+		size_t overflowBytes;    // 容量を超えてヒープから取った大きさ
+		size_t capacityBytes;    // 全スレッドの容量の合計(1フレーム分)
+		size_t highWaterBytes;   // これまでで一番多く使ったフレームの、1スレッドあたりの最大。容量を決める目安
+		uint64_t growCount;      // 容量を超えて領域を広げた回数(これまでの合計)
+	};
+
+#ifdef _MSC_VER
+	// キャッシュラインを分けるための詰め物はわざとなので、C4324(alignasで詰め物が入った)は出さない
+#pragma warning(push)
+#pragma warning(disable: 4324)
+#endif
+	// 1スレッド・1フレーム分の領域(スレッドごとに別のキャッシュラインに置く)
+	class alignas(64) ThreadArena {
+	public:
+		// sizeバイトをalignmentの倍数の位置に割り当てる。alignmentは2のべき乗
+		void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+		// count個のTを割り当てる。中身は初期化しない。デストラクタは呼ばれないので、破棄しなくてよい型だけにすること
+		template<typename T>
+		std::span<T> AllocateArray(size_t count) {
+			static_assert(std::is_trivially_destructible_v<T>, "FrameArenaはデストラクタを呼ばない");
+			return { static_cast<T*>(Allocate(count * sizeof(T), alignof(T))), count };
+		}
+
+		// このフレームで割り当てた大きさ
+		size_t GetUsedBytes() const { return used_ + overflowBytes_; }
+		size_t GetCapacity() const { return capacity_; }
+
+	private:
+		friend class FrameArena;
+
+		// 割り当てたものを全て捨てる。容量を超えていたら使った大きさまで広げてtrueを返す
+		bool Reset();
+
+		std::unique_ptr<std::byte[]> buffer_;
+		size_t capacity_ = 0;
+		size_t used_ = 0;
+		size_t allocationCount_ = 0;
+		// 容量を超えた分を切り出すヒープのブロック(最後のものから切り出す)
+		std::vector<std::unique_ptr<std::byte[]>> overflowBlocks_;
+		size_t overflowUsed_ = 0;
+		size_t overflowCapacity_ = 0;
+		size_t overflowBytes_ = 0;
+	};
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+	// capacityPerThreadは1スレッド・1フレーム分の容量。threadCountはGet(threadIndex)で使うスレッドの数
+	FrameArena(size_t capacityPerThread, uint32_t threadCount = 1);
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	uint32_t GetThreadCount() const { return threadCount_; }
+	// 今のフレームのスレッドの領域。1つの領域を複数のスレッドから同時に使わないこと
+	ThreadArena& Get(uint32_t threadIndex = 0) { return frames_[current_][threadIndex]; }
+
+	// フレームを締める。今のフレームで割り当てたものは次のEndFrameまで残り、その前のフレームの分を捨てる
+	// 割り当てているスレッドが無いときに呼ぶこと
+	void EndFrame();
+
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private:
+	uint32_t threadCount_;
+	uint32_t current_ = 0;
+	// 2フレーム分のスレッドごとの領域。current_が今のフレーム
+	std::unique_ptr<ThreadArena[]> frames_[2];
+	Statistics statistics_ = {};
+};
+
+// FrameArenaから割り当てるSTLのアロケータ。deallocateは何もしない(フレームの終わりにまとめて捨てる)
+// 伸ばすたびに前の領域はそのフレームの間残るので、要素数の見当がつくならreserveしておくとよい
+template<typename T>
+class FrameAllocator {
+public:
+	using value_type = T;
+
+	explicit FrameAllocator(FrameArena::ThreadArena& arena) : arena_(&arena) {}
+	template<typename U>
+	FrameAllocator(const FrameAllocator<U>& other) : arena_(other.arena_) {}
+
+	T* allocate(size_t count) { return static_cast<T*>(arena_->Allocate(count * sizeof(T), alignof(T))); }
+	void deallocate(T*, size_t) {}
+
+	template<typename U>
+	bool operator==(const FrameAllocator<U>& other) const { return arena_ == other.arena_; }
+
+private:
+	template<typename U>
+	friend class FrameAllocator;
+
+	FrameArena::ThreadArena* arena_;
+};
+
+// フレームの間だけ使う可変長配列
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <assert.h>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include "Frustum.h"
+#include "Function.h"
+#include "Simd.h"
+
+#pragma region 視錐台
+// 行ベクトルなのでクリップ座標のi成分は p * (行列のi列目)。z∈[0,1]のクリップ空間では
+// 左: w+x>=0, 右: w-x>=0, 下: w+y>=0, 上: w-y>=0, 近: z>=0, 遠: w-z>=0 が見える範囲になる
+Frustum MakeFrustum(const Matrix4x4& viewProjection) {
+	const Matrix4x4& m = viewProjection;
+	auto column = [&](int j, float sign) {
+		return Vector3{ sign * m.m[0][j], sign * m.m[1][j], sign * m.m[2][j] };
+	};
+	const Vector3 columnW = { m.m[0][3], m.m[1][3], m.m[2][3] };
+	// (平面の係数a,b,c, 定数d) で a*x + b*y + c*z + d >= 0 が見える側
+	struct Coefficients {
+		Vector3 abc;
+		float d;
+	};
+	const Coefficients coefficients[6] = {
+		{ columnW + column(0, 1.0f), m.m[3][3] + m.m[3][0] },
+		{ columnW + column(0, -1.0f), m.m[3][3] - m.m[3][0] },
+		{ columnW + column(1, 1.0f), m.m[3][3] + m.m[3][1] },
+		{ columnW + column(1, -1.0f), m.m[3][3] - m.m[3][1] },
+		{ column(2, 1.0f), m.m[3][2] },
+		{ columnW + column(2, -1.0f), m.m[3][3] - m.m[3][2] },
+	};
+
+	Frustum frustum = {};
+	for (int i = 0; i < 6; ++i) {
+		float length = Length(coefficients[i].abc);
+		float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+		frustum.planes[i].normal = coefficients[i].abc * inverseLength;
+		frustum.planes[i].distance = -coefficients[i].d * inverseLength;
+	}
+	return frustum;
+}
+
+// 中心から平面までの符号付き距離が -半径 より小さい平面が1枚でもあれば見えない
+bool IsVisible(const Frustum& frustum, const Sphere& sphere) {
+	for (const Plane& plane : frustum.planes) {
+		if (Dot(plane.normal, sphere.center) - plane.distance < -sphere.radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// 平面の法線方向に一番遠い頂点(中心 + 各軸の半分の長さ * |法線の成分|)まで平面の裏側なら見えない
+bool IsVisible(const Frustum& frustum, const AABB& aabb) {
+	const Vector3 center = (aabb.min + aabb.max) * 0.5f;
+	const Vector3 extent = (aabb.max - aabb.min) * 0.5f;
+	for (const Plane& plane : frustum.planes) {
+		float radius = extent.x * std::fabs(plane.normal.x) + extent.y * std::fabs(plane.normal.y) + extent.z * std::fabs(plane.normal.z);
+		if (Dot(plane.normal, center) - plane.distance < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
+#pragma endregion
+
+#pragma region まとめてカリング
+FrustumCuller::FrustumCuller(const Frustum& frustum) {
+	SetFrustum(frustum);
+}
+
+void FrustumCuller::SetFrustum(const Frustum& frustum) {
+	frustum_ = frustum;
+	for (size_t i = 0; i < kPlaneCount; ++i) {
+		const Plane& plane = frustum.planes[i];
+		planes_[i][0] = plane.normal.x;
+		planes_[i][1] = plane.normal.y;
+		planes_[i][2] = plane.normal.z;
+		planes_[i][3] = plane.distance;
+		absNormals_[i][0] = std::fabs(plane.normal.x);
+		absNormals_[i][1] = std::fabs(plane.normal.y);
+		absNormals_[i][2] = std::fabs(plane.normal.z);
+		absNormals_[i][3] = 0.0f;
+	}
+	// 覚えている平面が無いレーン用。法線が0で距離が-FLT_MAXなので、符号付き距離は常にFLT_MAXになり外に出さない
+	planes_[kNoPlane][0] = planes_[kNoPlane][1] = planes_[kNoPlane][2] = 0.0f;
+	planes_[kNoPlane][3] = -FLT_MAX;
+	absNormals_[kNoPlane][0] = absNormals_[kNoPlane][1] = absNormals_[kNoPlane][2] = absNormals_[kNoPlane][3] = 0.0f;
+}
+
+void FrustumCuller::PrepareCache(size_t count) {
+	if (lastPlane_.size() != count) {
+		lastPlane_.assign(count, kNoPlane);
+	}
+	statistics_ = {};
+	statistics_.objectCount = count;
+}
+
+namespace {
+// p[0]～p[3]から4要素ずつ読み、要素ごとに4つずつ並べ替える(p[i]の要素がレーンiに入る)
+inline void Transpose4(const float* const* p, __m128 (&out)[4]) {
+	out[0] = _mm_loadu_ps(p[0]);
+	out[1] = _mm_loadu_ps(p[1]);
+	out[2] = _mm_loadu_ps(p[2]);
+	out[3] = _mm_loadu_ps(p[3]);
+	_MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+}
+
+// p[0]～p[kWidth-1]から4要素ずつ読み、要素ごとにSimd::kWidth個ずつ並べ替える
+inline void TransposeLanes(const float* const* p, Simd::Float (&out)[4]) {
+#if defined(__AVX__)
+	__m128 low[4];
+	__m128 high[4];
+	Transpose4(p, low);
+	Transpose4(p + 4, high);
+	for (int i = 0; i < 4; ++i) {
+		out[i] = _mm256_insertf128_ps(_mm256_castps128_ps256(low[i]), high[i], 1);
+	}
+#else
+	Transpose4(p, out);
+#endif
+}
+
+// レーンごとにrows[index[レーン]]の4要素を集め、要素ごとに並べ替える
+inline void GatherRows(const float (*rows)[4], const uint8_t* index, Simd::Float (&out)[4]) {
+	const float* lanes[Simd::kWidth];
+	for (size_t lane = 0; lane < Simd::kWidth; ++lane) {
+		lanes[lane] = rows[index[lane]];
+	}
+	TransposeLanes(lanes, out);
+}
+
+// レーンごとのvalues[レーン]をfloatにする
+inline Simd::Float ToFloat(const uint8_t* values) {
+#if defined(__AVX__)
+	return _mm256_setr_ps(values[0], values[1], values[2], values[3], values[4], values[5], values[6], values[7]);
+#else
+	return _mm_setr_ps(values[0], values[1], values[2], values[3]);
+#endif
+}
+
+// 物体Simd::kWidth個分の、平面までの符号付き距離
+inline Simd::Float PlaneDistance(Simd::Float nx, Simd::Float ny, Simd::Float nz, Simd::Float d, Simd::Float x, Simd::Float y, Simd::Float z) {
+	return Simd::Sub(Simd::Add(Simd::Add(Simd::Mul(nx, x), Simd::Mul(ny, y)), Simd::Mul(nz, z)), d);
+}
+
+// last[0]～last[laneCount-1]をcachedに読み、空きレーンはnoPlaneで埋める。覚えている平面が1つでもあればtrue
+inline bool LoadLastPlanes(uint8_t (&cached)[Simd::kWidth], const uint8_t* last, size_t laneCount, uint8_t noPlane) {
+	// 全レーン分をまとめて1つの整数として比べる
+	using Lanes = std::conditional_t<Simd::kWidth == 8, uint64_t, uint32_t>;
+	static_assert(sizeof(Lanes) == Simd::kWidth);
+	Lanes none;
+	std::memset(&none, noPlane, sizeof(none));
+	std::memcpy(cached, &none, sizeof(cached));
+	if (laneCount == Simd::kWidth) {
+		std::memcpy(cached, last, Simd::kWidth);
+	} else {
+		std::memcpy(cached, last, laneCount);
+	}
+	Lanes lanes;
+	std::memcpy(&lanes, cached, sizeof(lanes));
+	return lanes != none;
+}
+
+// maskの立っているレーンの数(popcnt命令はSSE2に無いので表を引く)
+inline size_t CountLanes(int mask) {
+	static constexpr uint8_t kBitCount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+	return kBitCount[mask & 15] + kBitCount[(mask >> 4) & 15];
+}
+
+// レーンごとの平面の番号(floatで持っている)をlast[0]～last[laneCount-1]に書き込む
+inline void StoreLastPlanes(uint8_t* last, size_t laneCount, Simd::Float planes) {
+#if defined(__AVX__)
+	const __m256i planes32 = _mm256_cvttps_epi32(planes);
+	const __m128i planes16 = _mm_packs_epi32(_mm256_castsi256_si128(planes32), _mm256_extractf128_si256(planes32, 1));
+#else
+	const __m128i planes32 = _mm_cvttps_epi32(planes);
+	const __m128i planes16 = _mm_packs_epi32(planes32, planes32);
+#endif
+	uint8_t values[16];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(values), _mm_packus_epi16(planes16, planes16));
+	if (laneCount == Simd::kWidth) {
+		std::memcpy(last, values, Simd::kWidth);
+	} else {
+		std::memcpy(last, values, laneCount);
+	}
+}
+
+// maskの立っているレーンの番号を小さい順にfunction(lane)に渡す
+template<typename Function>
+inline void ForEachLane(int mask, Function&& function) {
+	for (unsigned int bits = static_cast<unsigned int>(mask); bits != 0; bits &= bits - 1) {
+		function(static_cast<size_t>(std::countr_zero(bits)));
+	}
+}
+}
+
+// 各関数は、Simd::kWidth個の物体ごとに 覚えている平面(レーンごとに集める) → 6枚の平面を1枚ずつ の順に判定する
+// 物体はSIMDの並べ替えでSoAにする。物体の数が足りない最後のまとまりは最後の物体の複製で埋める(空きレーンの結果は使わない)
+// レーンごとに結果が違っても分岐しないよう、6枚は全て調べる。外に出した平面は後ろから選び直していき、一番番号の小さい平面を覚える
+// 覚えている平面で外に出たレーンは、その平面を覚えたままにする。まとまり全てがそれで外に出たら、6枚は調べない
+template<typename Output>
+size_t FrustumCuller::CullSpheres(std::span<const Sphere> spheres, Output&& output) {
+	size_t visibleCount = 0;
+	PrepareCache(spheres.size());
+	Simd::Float planeX[kPlaneCount];
+	Simd::Float planeY[kPlaneCount];
+	Simd::Float planeZ[kPlaneCount];
+	Simd::Float planeDistance[kPlaneCount];
+	Simd::Float planeIndex[kPlaneCount];
+	for (size_t plane = 0; plane < kPlaneCount; ++plane) {
+		planeX[plane] = Simd::Set1(planes_[plane][0]);
+		planeY[plane] = Simd::Set1(planes_[plane][1]);
+		planeZ[plane] = Simd::Set1(planes_[plane][2]);
+		planeDistance[plane] = Simd::Set1(planes_[plane][3]);
+		planeIndex[plane] = Simd::Set1(static_cast<float>(plane));
+	}
+	for (size_t base = 0; base < spheres.size(); base += Simd::kWidth) {
+		const size_t laneCount = std::min(Simd::kWidth, spheres.size() - base);
+		uint8_t* last = lastPlane_.data() + base;
+		// 各レーンの中心と半径の先頭
+		const float* lanes[Simd::kWidth];
+		for (size_t lane = 0; lane < Simd::kWidth; ++lane) {
+			lanes[lane] = &spheres[base + std::min(lane, laneCount - 1)].center.x;
+		}
+		uint8_t cached[Simd::kWidth];
+		const bool anyCached = LoadLastPlanes(cached, last, laneCount, kNoPlane);
+		Simd::Float soa[4];
+		TransposeLanes(lanes, soa);
+		const Simd::Float& x = soa[0];
+		const Simd::Float& y = soa[1];
+		const Simd::Float& z = soa[2];
+		const Simd::Float negativeRadius = Simd::Sub(Simd::Zero(), soa[3]);
+
+		const int laneMask = (1 << laneCount) - 1;
+		Simd::Float hit = Simd::Zero();
+		if (anyCached) {
+			Simd::Float plane[4];
+			GatherRows(planes_, cached, plane);
+			const Simd::Float distance = PlaneDistance(plane[0], plane[1], plane[2], plane[3], x, y, z);
+			hit = Simd::CmpLt(distance, negativeRadius);
+			const int hitMask = Simd::MoveMask(hit) & laneMask;
+			statistics_.cacheHitCount += CountLanes(hitMask);
+			if (hitMask == laneMask) {
+				continue;
+			}
+		}
+		Simd::Float outside = hit;
+		Simd::Float culledBy = Simd::Set1(static_cast<float>(kNoPlane));
+		for (int plane = kPlaneCount - 1; plane >= 0; --plane) {
+			const Simd::Float distance = PlaneDistance(planeX[plane], planeY[plane], planeZ[plane], planeDistance[plane], x, y, z);
+			const Simd::Float culled = Simd::CmpLt(distance, negativeRadius);
+			culledBy = Simd::Select(culled, planeIndex[plane], culledBy);
+			outside = Simd::Or(outside, culled);
+		}
+		StoreLastPlanes(last, laneCount, anyCached ? Simd::Select(hit, ToFloat(cached), culledBy) : culledBy);
+
+		ForEachLane(~Simd::MoveMask(outside) & laneMask, [&](size_t lane) {
+			output(static_cast<uint32_t>(base + lane));
+			++visibleCount;
+		});
+	}
+	statistics_.visibleCount = visibleCount;
+	return visibleCount;
+}
+
+template<typename Output>
+size_t FrustumCuller::CullAABBs(std::span<const AABB> aabbs, Output&& output) {
+	size_t visibleCount = 0;
+	PrepareCache(aabbs.size());
+	Simd::Float planeX[kPlaneCount];
+	Simd::Float planeY[kPlaneCount];
+	Simd::Float planeZ[kPlaneCount];
+	Simd::Float planeDistance[kPlaneCount];
+	Simd::Float planeAbsX[kPlaneCount];
+	Simd::Float planeAbsY[kPlaneCount];
+	Simd::Float planeAbsZ[kPlaneCount];
+	Simd::Float planeIndex[kPlaneCount];
+	for (size_t plane = 0; plane < kPlaneCount; ++plane) {
+		planeX[plane] = Simd::Set1(planes_[plane][0]);
+		planeY[plane] = Simd::Set1(planes_[plane][1]);
+		planeZ[plane] = Simd::Set1(planes_[plane][2]);
+		planeDistance[plane] = Simd::Set1(planes_[plane][3]);
+		planeAbsX[plane] = Simd::Set1(absNormals_[plane][0]);
+		planeAbsY[plane] = Simd::Set1(absNormals_[plane][1]);
+		planeAbsZ[plane] = Simd::Set1(absNormals_[plane][2]);
+		planeIndex[plane] = Simd::Set1(static_cast<float>(plane));
+	}
+	const Simd::Float half = Simd::Set1(0.5f);
+	for (size_t base = 0; base < aabbs.size(); base += Simd::kWidth) {
+		const size_t laneCount = std::min(Simd::kWidth, aabbs.size() - base);
+		uint8_t* last = lastPlane_.data() + base;
+		// 各レーンの最小点と最大点の先頭
+		const float* minLanes[Simd::kWidth];
+		const float* maxLanes[Simd::kWidth];
+		for (size_t lane = 0; lane < Simd::kWidth; ++lane) {
+			const AABB& aabb = aabbs[base + std::min(lane, laneCount - 1)];
+			minLanes[lane] = &aabb.min.x;
+			maxLanes[lane] = &aabb.max.x;
+		}
+		uint8_t cached[Simd::kWidth];
+		const bool anyCached = LoadLastPlanes(cached, last, laneCount, kNoPlane);
+		Simd::Float min[4];
+		Simd::Float max[4];
+		TransposeLanes(minLanes, min);
+		TransposeLanes(maxLanes, max);
+		Simd::Float center[3];
+		Simd::Float extent[3];
+		for (int axis = 0; axis < 3; ++axis) {
+			center[axis] = Simd::Mul(Simd::Add(min[axis], max[axis]), half);
+			extent[axis] = Simd::Mul(Simd::Sub(max[axis], min[axis]), half);
+		}
+		// 法線方向に一番遠い頂点まで平面の裏側なら外
+		auto isOutside = [&](Simd::Float nx, Simd::Float ny, Simd::Float nz, Simd::Float d, Simd::Float ax, Simd::Float ay, Simd::Float az) {
+			const Simd::Float distance = PlaneDistance(nx, ny, nz, d, center[0], center[1], center[2]);
+			const Simd::Float radius = Simd::Add(Simd::Add(Simd::Mul(extent[0], ax), Simd::Mul(extent[1], ay)), Simd::Mul(extent[2], az));
+			return Simd::CmpLt(distance, Simd::Sub(Simd::Zero(), radius));
+		};
+
+		const int laneMask = (1 << laneCount) - 1;
+		Simd::Float hit = Simd::Zero();
+		if (anyCached) {
+			Simd::Float plane[4];
+			Simd::Float absNormal[4];
+			GatherRows(planes_, cached, plane);
+			GatherRows(absNormals_, cached, absNormal);
+			hit = isOutside(plane[0], plane[1], plane[2], plane[3], absNormal[0], absNormal[1], absNormal[2]);
+			const int hitMask = Simd::MoveMask(hit) & laneMask;
+			statistics_.cacheHitCount += CountLanes(hitMask);
+			if (hitMask == laneMask) {
+				continue;
+			}
+		}
+		Simd::Float outside = hit;
+		Simd::Float culledBy = Simd::Set1(static_cast<float>(kNoPlane));
+		for (int plane = kPlaneCount - 1; plane >= 0; --plane) {
+			const Simd::Float culled = isOutside(planeX[plane], planeY[plane], planeZ[plane], planeDistance[plane], planeAbsX[plane], planeAbsY[plane], planeAbsZ[plane]);
+			culledBy = Simd::Select(culled, planeIndex[plane], culledBy);
+			outside = Simd::Or(outside, culled);
+		}
+		StoreLastPlanes(last, laneCount, anyCached ? Simd::Select(hit, ToFloat(cached), culledBy) : culledBy);
+
+		ForEachLane(~Simd::MoveMask(outside) & laneMask, [&](size_t lane) {
+			output(static_cast<uint32_t>(base + lane));
+			++visibleCount;
+		});
+	}
+	statistics_.visibleCount = visibleCount;
+	return visibleCount;
+}
+
+// 配列の版は見えた物体を後ろに積む。spanの版は先頭から書き込む(ヒープを使わない)
+size_t FrustumCuller::Cull(std::span<const Sphere> spheres, std::vector<uint32_t>& visible) {
+	visible.clear();
+	return CullSpheres(spheres, [&](uint32_t index) { visible.push_back(index); });
+}
+
+size_t FrustumCuller::Cull(std::span<const Sphere> spheres, std::span<uint32_t> visible) {
+	assert(visible.size() >= spheres.size());
+	size_t count = 0;
+	return CullSpheres(spheres, [&](uint32_t index) { visible[count++] = index; });
+}
+
+size_t FrustumCuller::Cull(std::span<const AABB> aabbs, std::vector<uint32_t>& visible) {
+	visible.clear();
+	return CullAABBs(aabbs, [&](uint32_t index) { visible.push_back(index); });
+}
+
+size_t FrustumCuller::Cull(std::span<const AABB> aabbs, std::span<uint32_t> visible) {
+	assert(visible.size() >= aabbs.size());
+	size_t count = 0;
+	return CullAABBs(aabbs, [&](uint32_t index) { visible[count++] = index; });
+}
+#pragma endregion
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Struct.h"
+
+// 視錐台カリング
+// MakePerspectiveFovMatrix・MakeOrthographicMatrixで作ったビュープロジェクション行列から視錐台を取り出し、
+// 画面に映らない物体を描画(頂点の座標変換)の前に取り除く
+
+#pragma region 視錐台
+// ビュープロジェクション行列(行ベクトル、クリップ空間のzは0～1)から視錐台を取り出す(Gribb-Hartmannの方法)
+// ワールド行列まで掛けた行列を渡すと、ローカル座標の視錐台になる
+Frustum MakeFrustum(const Matrix4x4& viewProjection);
+// 視錐台と(一部でも)重なっているか。境界付近では見えない物体をtrueにすることがある(取りこぼしはしない)
+bool IsVisible(const Frustum& frustum, const Sphere& sphere);
+bool IsVisible(const Frustum& frustum, const AABB& aabb);
+#pragma endregion
+
+#pragma region まとめてカリング
+// 配列をまとめて視錐台と判定し、見える物体の添字を返す
+// 物体をSimd::kWidth個ずつSoAに並べ替え、平面を1枚ずつ全てのレーンとSIMDで判定する(全てのレーンが外と決まったらそこで打ち切る)
+// 前のフレームで物体を外に出した平面を覚えておき、次のフレームは各レーンの覚えている平面を集めて最初に1回だけ調べる
+// (カメラが少し動いただけなら、ほとんどの物体はそれで判定が終わる)
+// 覚えている平面は配列の添字ごとなので、毎フレーム同じ並びの配列を渡すこと。並びが変わっても結果は正しい(速さだけが変わる)
+class FrustumCuller {
+public:
+	// 直近のCullの統計
+	struct Statistics {
+		size_t objectCount;   // 判定した物体の数
+		size_t visibleCount;  // 見えると判定した物体の数
+		size_t cacheHitCount; // 覚えていた平面だけで外と判定できた物体の数
+	};
+
+	FrustumCuller() = default;
+	explicit FrustumCuller(const Frustum& frustum);
+
+	// 判定に使う視錐台を設定する(毎フレーム呼ぶ)
+	void SetFrustum(const Frustum& frustum);
+	const Frustum& GetFrustum() const { return frustum_; }
+
+	// 見える物体の添字をvisibleに書き込み(前の中身は消す)、その数を返す
+	size_t Cull(std::span<const Sphere> spheres, std::vector<uint32_t>& visible);
+	size_t Cull(std::span<const AABB> aabbs, std::vector<uint32_t>& visible);
+	// 見える物体の添字をvisibleの先頭から書き込み、その数を返す。visibleには物体の数以上の大きさが必要
+	// FrameArenaから物体の数だけ割り当てて渡せば、ヒープを使わずに済む
+	size_t Cull(std::span<const Sphere> spheres, std::span<uint32_t> visible);
+	size_t Cull(std::span<const AABB> aabbs, std::span<uint32_t> visible);
+
+	// 覚えている平面を捨てる(物体の配列を作り直したときなど)
+	void ResetCache() { lastPlane_.clear(); }
+
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private:
+	static constexpr uint8_t kPlaneCount = 6;
+	// 物体を外に出した平面を覚えていない(平面の係数の配列の末尾を指す)
+	static constexpr uint8_t kNoPlane = kPlaneCount;
+
+	void PrepareCache(size_t count);
+	// 見える物体の添字をoutput(添字)に順に渡し、その数を返す
+	template<typename Output>
+	size_t CullSpheres(std::span<const Sphere> spheres, Output&& output);
+	template<typename Output>
+	size_t CullAABBs(std::span<const AABB> aabbs, Output&& output);
+
+	Frustum frustum_ = {};
+	// 平面ごとに(法線のx, y, z, 距離)。レーンごとに覚えている平面を集めるとき、1平面を1回で読めるよう4つずつ並べる
+	// 末尾の1つは覚えている平面が無いレーン用で、どんな物体も外に出さない
+	float planes_[kPlaneCount + 1][4] = {};
+	// AABBの判定用に(法線の各成分の絶対値, 0)
+	float absNormals_[kPlaneCount + 1][4] = {};
+	std::vector<uint8_t> lastPlane_;
+	Statistics statistics_ = {};
+};
+#pragma endregion
@@ -1,60 +1,77 @@
 #include <cmath>
 #include <assert.h>
 #include "Function.h"
+#include "Simd.h"
 
 #pragma region Vector3
-// ベクトルの加算を計算する関数
-Vector3 Add(const Vector3& v1, const Vector3& v2) {
-	return { v1.x + v2.x, v1.y + v2.y, v1.z + v2.z };
-}
-
-// ベクトルの引き算を計算する関数
-Vector3 Subtract(const Vector3& v1, const Vector3& v2) {
-	return { v1.x - v2.x, v1.y - v2.y, v1.z - v2.z };
-}
-
-// ベクトルをスカラー倍する関数
-Vector3 Multiply(float scalar, const Vector3& v) {
-	return { scalar * v.x, scalar * v.y, scalar * v.z };
-}
-
-// 内積を計算する関数
-float Dot(const Vector3& v1, const Vector3& v2) {
-	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
-}
-
-// ベクトルの長さを計算する関数
-float Length(const Vector3& v) {
-	return sqrtf(Dot(v, v));
-}
+// 座標変換(配列をまとめて変換。inputとoutputは同じ配列でもよい)
+// 4個(AVXでは8個)ずつSoAに並べ替えて変換する。乗算と加算の順番は1個ずつのTransformと同じなので結果はビット単位で一致する
+void Transform(const Matrix4x4& matrix, std::span<const Vector3> input, std::span<Vector3> output) {
+	assert(output.size() >= input.size());
+	const size_t count = input.size();
+	const float* src = reinterpret_cast<const float*>(input.data());
+	float* dst = reinterpret_cast<float*>(output.data());
+	// 4列目が(0,0,0,1)ならw=1なので除算を省略できる
+	const bool affine = IsAffine(matrix);
+	size_t i = 0;
+
+#if defined(__AVX__)
+	{
+		__m256 m[4][4];
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				m[row][column] = _mm256_set1_ps(matrix.m[row][column]);
+			}
+		}
+		for (; i + 8 <= count; i += 8) {
+			__m256 x, y, z;
+			Simd::LoadVector3x8(src + i * 3, x, y, z);
+			__m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[0][0], x), _mm256_mul_ps(m[1][0], y)), _mm256_mul_ps(m[2][0], z)), m[3][0]);
+			__m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[0][1], x), _mm256_mul_ps(m[1][1], y)), _mm256_mul_ps(m[2][1], z)), m[3][1]);
+			__m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[0][2], x), _mm256_mul_ps(m[1][2], y)), _mm256_mul_ps(m[2][2], z)), m[3][2]);
+			if (!affine) {
+				__m256 w = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[0][3], x), _mm256_mul_ps(m[1][3], y)), _mm256_mul_ps(m[2][3], z)), m[3][3]);
+				assert(_mm256_movemask_ps(_mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_EQ_OQ)) == 0);
+				rx = _mm256_div_ps(rx, w);
+				ry = _mm256_div_ps(ry, w);
+				rz = _mm256_div_ps(rz, w);
+			}
+			Simd::StoreVector3x8(dst + i * 3, rx, ry, rz);
+		}
+	}
+#endif
 
-// ベクトルを正規化する関数
-Vector3 Normalize(const Vector3& v) {
-	float length = Length(v);
-	if (length == 0) {
-		return { 0, 0, 0 };
+	__m128 m[4][4];
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 4; ++column) {
+			m[row][column] = _mm_set1_ps(matrix.m[row][column]);
+		}
+	}
+	for (; i + 4 <= count; i += 4) {
+		__m128 x, y, z;
+		Simd::LoadVector3x4(src + i * 3, x, y, z);
+		__m128 rx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][0], x), _mm_mul_ps(m[1][0], y)), _mm_mul_ps(m[2][0], z)), m[3][0]);
+		__m128 ry = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][1], x), _mm_mul_ps(m[1][1], y)), _mm_mul_ps(m[2][1], z)), m[3][1]);
+		__m128 rz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][2], x), _mm_mul_ps(m[1][2], y)), _mm_mul_ps(m[2][2], z)), m[3][2]);
+		if (!affine) {
+			__m128 w = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][3], x), _mm_mul_ps(m[1][3], y)), _mm_mul_ps(m[2][3], z)), m[3][3]);
+			assert(_mm_movemask_ps(_mm_cmpeq_ps(w, _mm_setzero_ps())) == 0);
+			rx = _mm_div_ps(rx, w);
+			ry = _mm_div_ps(ry, w);
+			rz = _mm_div_ps(rz, w);
+		}
+		Simd::StoreVector3x4(dst + i * 3, rx, ry, rz);
 	}
-	return Multiply(1.0f / length, v);
-}
 
-//クロス積
-Vector3 Cross(const Vector3& v1, const Vector3& v2) {
-	Vector3 result = { v1.y * v2.z - v1.z * v2.y,v1.z * v2.x - v1.x * v2.z,v1.x * v2.y - v1.y * v2.x };
-	return result;
+	// 端数はスカラーで変換
+	for (; i < count; ++i) {
+		output[i] = Transform(matrix, input[i]);
+	}
 }
 
-// 座標変換(Matrix4x4からVector3へ)
-Vector3 Transform(const Matrix4x4& matrix, const Vector3& vector) {
-	Vector3 result = {};
-	result.x = matrix.m[0][0] * vector.x + matrix.m[1][0] * vector.y + matrix.m[2][0] * vector.z + matrix.m[3][0];
-	result.y = matrix.m[0][1] * vector.x + matrix.m[1][1] * vector.y + matrix.m[2][1] * vector.z + matrix.m[3][1];
-	result.z = matrix.m[0][2] * vector.x + matrix.m[1][2] * vector.y + matrix.m[2][2] * vector.z + matrix.m[3][2];
-	float w = matrix.m[0][3] * vector.x + matrix.m[1][3] * vector.y + matrix.m[2][3] * vector.z + matrix.m[3][3];
-	assert(w != 0.0f);
-	result.x /= w;
-	result.y /= w;
-	result.z /= w;
-	return result;
+// 座標変換(配列をその場で変換)
+void Transform(const Matrix4x4& matrix, std::span<Vector3> vectors) {
+	Transform(matrix, std::span<const Vector3>(vectors), vectors);
 }
 
 // 正射影ベクトルを求める関数
@@ -92,268 +109,245 @@ Vector3 Perpendicular(const Vector3& vector) {
 	}
 	return { 0.0f, -vector.z, vector.y };
 }
-
-// 線形補間
-Vector3 Lerp(const Vector3& v1, const Vector3& v2, const float& t) {
-	return Add(Multiply(t, v1), Multiply(1.0f - t, v2));
-}
-
-// ベジエ
-Vector3 Bezier(const Vector3& p0, const Vector3& p1, const Vector3& p2, const float& t) {
-	Vector3 p0p1 = Lerp(p0, p1, t);
-	Vector3 p1p2 = Lerp(p1, p2, t);
-	return Lerp(p0p1, p1p2, t);
-}
-
-// 反発ベクトルを求める
-Vector3 Reflect(const Vector3& input, const Vector3& normal) {
-	return input - 2.0f * (Dot(input, normal) * normal);
-}
 #pragma endregion
 
 #pragma region Matrix4x4
 // 逆行列(Matrix4x4)
+// 行列式が0の場合、逆行列は存在しないのでゼロ行列を返す。判定が必要な場合はTryInverseを使う
 Matrix4x4 Inverse(const Matrix4x4& m) {
 	Matrix4x4 result = { 0 };
-	Matrix4x4 num = { 0 };
-	float det =
-		m.m[0][0] * m.m[1][1] * m.m[2][2] * m.m[3][3]//1
-		+ m.m[0][0] * m.m[1][2] * m.m[2][3] * m.m[3][1]//2
-		+ m.m[0][0] * m.m[1][3] * m.m[2][1] * m.m[3][2]//3
-		- m.m[0][0] * m.m[1][3] * m.m[2][2] * m.m[3][1]//4
-		- m.m[0][0] * m.m[1][2] * m.m[2][1] * m.m[3][3]//5
-		- m.m[0][0] * m.m[1][1] * m.m[2][3] * m.m[3][2]//6
-		- m.m[0][1] * m.m[1][0] * m.m[2][2] * m.m[3][3]//7
-		- m.m[0][2] * m.m[1][0] * m.m[2][3] * m.m[3][1]//8
-		- m.m[0][3] * m.m[1][0] * m.m[2][1] * m.m[3][2]//9
-		+ m.m[0][3] * m.m[1][0] * m.m[2][2] * m.m[3][1]//10
-		+ m.m[0][2] * m.m[1][0] * m.m[2][1] * m.m[3][3]//11
-		+ m.m[0][1] * m.m[1][0] * m.m[2][3] * m.m[3][2]//12
-		+ m.m[0][1] * m.m[1][2] * m.m[2][0] * m.m[3][3]//13
-		+ m.m[0][2] * m.m[1][3] * m.m[2][0] * m.m[3][1]//14
-		+ m.m[0][3] * m.m[1][1] * m.m[2][0] * m.m[3][2]//15
-		- m.m[0][3] * m.m[1][2] * m.m[2][0] * m.m[3][1]//16
-		- m.m[0][2] * m.m[1][1] * m.m[2][0] * m.m[3][3]//17
-		- m.m[0][1] * m.m[1][3] * m.m[2][0] * m.m[3][2]//18
-		- m.m[0][1] * m.m[1][2] * m.m[2][3] * m.m[3][0]//19
-		- m.m[0][2] * m.m[1][3] * m.m[2][1] * m.m[3][0]//20
-		- m.m[0][3] * m.m[1][1] * m.m[2][2] * m.m[3][0]//21
-		+ m.m[0][3] * m.m[1][2] * m.m[2][1] * m.m[3][0]//22
-		+ m.m[0][2] * m.m[1][1] * m.m[2][3] * m.m[3][0]//23
-		+ m.m[0][1] * m.m[1][3] * m.m[2][2] * m.m[3][0];//24
+	TryInverse(m, result);
+	return result;
+}
+
+// 2x2行列(行優先で4要素に格納)の積 A*B
+static __m128 Mat2Mul(__m128 a, __m128 b) {
+	return _mm_add_ps(_mm_mul_ps(a, Simd::Swizzle<0, 3, 0, 3>(b)), _mm_mul_ps(Simd::Swizzle<1, 0, 3, 2>(a), Simd::Swizzle<2, 1, 2, 1>(b)));
+}
+
+// 2x2行列の余因子行列との積 adj(A)*B
+static __m128 Mat2AdjMul(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(Simd::Swizzle<3, 3, 0, 0>(a), b), _mm_mul_ps(Simd::Swizzle<1, 1, 2, 2>(a), Simd::Swizzle<2, 3, 0, 1>(b)));
+}
+
+// 2x2行列と余因子行列の積 A*adj(B)
+static __m128 Mat2MulAdj(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(a, Simd::Swizzle<3, 0, 3, 0>(b)), _mm_mul_ps(Simd::Swizzle<1, 0, 3, 2>(a), Simd::Swizzle<2, 1, 2, 1>(b)));
+}
+
+// 逆行列(行列式が0ならfalseを返し、resultは変更しない)
+// 4x4行列を2x2のブロックA,B,C,Dに分け、ブロックの行列式と余因子行列の積を使い回して計算する
+bool TryInverse(const Matrix4x4& m, Matrix4x4& result) {
+	__m128 row0 = _mm_loadu_ps(m.m[0]);
+	__m128 row1 = _mm_loadu_ps(m.m[1]);
+	__m128 row2 = _mm_loadu_ps(m.m[2]);
+	__m128 row3 = _mm_loadu_ps(m.m[3]);
+	// | A B |
+	// | C D |
+	__m128 a = _mm_movelh_ps(row0, row1);
+	__m128 b = _mm_movehl_ps(row1, row0);
+	__m128 c = _mm_movelh_ps(row2, row3);
+	__m128 d = _mm_movehl_ps(row3, row2);
+
+	// 各ブロックの行列式 (|A| |B| |C| |D|)
+	__m128 detSub = _mm_sub_ps(
+		_mm_mul_ps(_mm_shuffle_ps(row0, row2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(row1, row3, _MM_SHUFFLE(3, 1, 3, 1))),
+		_mm_mul_ps(_mm_shuffle_ps(row0, row2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(row1, row3, _MM_SHUFFLE(2, 0, 2, 0))));
+	__m128 detA = Simd::Swizzle<0, 0, 0, 0>(detSub);
+	__m128 detB = Simd::Swizzle<1, 1, 1, 1>(detSub);
+	__m128 detC = Simd::Swizzle<2, 2, 2, 2>(detSub);
+	__m128 detD = Simd::Swizzle<3, 3, 3, 3>(detSub);
+
+	// 使い回す積 adj(D)*C と adj(A)*B
+	__m128 dc = Mat2AdjMul(d, c);
+	__m128 ab = Mat2AdjMul(a, b);
+
+	// 結果の各ブロック(余因子行列の形)
+	__m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), Mat2Mul(b, dc));
+	__m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), Mat2Mul(c, ab));
+	__m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), Mat2MulAdj(d, ab));
+	__m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), Mat2MulAdj(a, dc));
+
+	// |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+	__m128 trace = _mm_mul_ps(ab, Simd::Swizzle<0, 2, 1, 3>(dc));
+	trace = _mm_add_ps(trace, Simd::Swizzle<1, 0, 3, 2>(trace));
+	trace = _mm_add_ps(trace, Simd::Swizzle<2, 3, 0, 1>(trace));
+	__m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), trace);
+	float detScalar = _mm_cvtss_f32(det);
 	// 行列式が0の場合、逆行列は存在しない
-	// 適切なエラーハンドリングを行う
-	if (det == 0) {
-		return result; // ここでは単純にゼロ行列を返す
+	if (detScalar == 0.0f || !std::isfinite(1.0f / detScalar)) {
+		return false;
 	}
 
-	// 逆行列の計算
-	num.m[0][0] =
-		m.m[1][1] * m.m[2][2] * m.m[3][3]//1
-		+ m.m[1][2] * m.m[2][3] * m.m[3][1]//2
-		+ m.m[1][3] * m.m[2][1] * m.m[3][2]//3
-		- m.m[1][3] * m.m[2][2] * m.m[3][1]//4
-		- m.m[1][2] * m.m[2][1] * m.m[3][3]//5
-		- m.m[1][1] * m.m[2][3] * m.m[3][2];//6
-	num.m[0][1] =
-		-m.m[0][1] * m.m[2][2] * m.m[3][3]//1
-		- m.m[0][2] * m.m[2][3] * m.m[3][1]//2
-		- m.m[0][3] * m.m[2][1] * m.m[3][2]//3
-		+ m.m[0][3] * m.m[2][2] * m.m[3][1]//4
-		+ m.m[0][2] * m.m[2][1] * m.m[3][3]//5
-		+ m.m[0][1] * m.m[2][3] * m.m[3][2];//6
-	num.m[0][2] =
-		m.m[0][1] * m.m[1][2] * m.m[3][3]//1
-		+ m.m[0][2] * m.m[1][3] * m.m[3][1]//2
-		+ m.m[0][3] * m.m[1][1] * m.m[3][2]//3
-		- m.m[0][3] * m.m[1][2] * m.m[3][1]//4
-		- m.m[0][2] * m.m[1][1] * m.m[3][3]//5
-		- m.m[0][1] * m.m[1][3] * m.m[3][2];//6
-	num.m[0][3] =
-		-m.m[0][1] * m.m[1][2] * m.m[2][3]//1
-		- m.m[0][2] * m.m[1][3] * m.m[2][1]//2
-		- m.m[0][3] * m.m[1][1] * m.m[2][2]//3
-		+ m.m[0][3] * m.m[1][2] * m.m[2][1]//4
-		+ m.m[0][2] * m.m[1][1] * m.m[2][3]//5
-		+ m.m[0][1] * m.m[1][3] * m.m[2][2];//6
-
-	num.m[1][0] =
-		-m.m[1][0] * m.m[2][2] * m.m[3][3]//1
-		- m.m[1][2] * m.m[2][3] * m.m[3][0]//2
-		- m.m[1][3] * m.m[2][0] * m.m[3][2]//3
-		+ m.m[1][3] * m.m[2][2] * m.m[3][0]//4
-		+ m.m[1][2] * m.m[2][0] * m.m[3][3]//5
-		+ m.m[1][0] * m.m[2][3] * m.m[3][2];//6
-	num.m[1][1] =
-		m.m[0][0] * m.m[2][2] * m.m[3][3]//1
-		+ m.m[0][2] * m.m[2][3] * m.m[3][0]//2
-		+ m.m[0][3] * m.m[2][0] * m.m[3][2]//3
-		- m.m[0][3] * m.m[2][2] * m.m[3][0]//4
-		- m.m[0][2] * m.m[2][0] * m.m[3][3]//5
-		- m.m[0][0] * m.m[2][3] * m.m[3][2];//6
-	num.m[1][2] =
-		-m.m[0][0] * m.m[1][2] * m.m[3][3]//1
-		- m.m[0][2] * m.m[1][3] * m.m[3][0]//2
-		- m.m[0][3] * m.m[1][0] * m.m[3][2]//3
-		+ m.m[0][3] * m.m[1][2] * m.m[3][0]//4
-		+ m.m[0][2] * m.m[1][0] * m.m[3][3]//5
-		+ m.m[0][0] * m.m[1][3] * m.m[3][2];//6
-	num.m[1][3] =
-		m.m[0][0] * m.m[1][2] * m.m[2][3]//1
-		+ m.m[0][2] * m.m[1][3] * m.m[2][0]//2
-		+ m.m[0][3] * m.m[1][0] * m.m[2][2]//3
-		- m.m[0][3] * m.m[1][2] * m.m[2][0]//4
-		- m.m[0][2] * m.m[1][0] * m.m[2][3]//5
-		- m.m[0][0] * m.m[1][3] * m.m[2][2];//6
-
-	num.m[2][0] =
-		m.m[1][0] * m.m[2][1] * m.m[3][3]//1
-		+ m.m[1][1] * m.m[2][3] * m.m[3][0]//2
-		+ m.m[1][3] * m.m[2][0] * m.m[3][1]//3
-		- m.m[1][3] * m.m[2][1] * m.m[3][0]//4
-		- m.m[1][1] * m.m[2][0] * m.m[3][3]//5
-		- m.m[1][0] * m.m[2][3] * m.m[3][1];//6
-	num.m[2][1] =
-		-m.m[0][0] * m.m[2][1] * m.m[3][3]//1
-		- m.m[0][1] * m.m[2][3] * m.m[3][0]//2
-		- m.m[0][3] * m.m[2][0] * m.m[3][1]//3
-		+ m.m[0][3] * m.m[2][1] * m.m[3][0]//4
-		+ m.m[0][1] * m.m[2][0] * m.m[3][3]//5
-		+ m.m[0][0] * m.m[2][3] * m.m[3][1];//6
-	num.m[2][2] =
-		m.m[0][0] * m.m[1][1] * m.m[3][3]//1
-		+ m.m[0][1] * m.m[1][3] * m.m[3][0]//2
-		+ m.m[0][3] * m.m[1][0] * m.m[3][1]//3
-		- m.m[0][3] * m.m[1][1] * m.m[3][0]//4
-		- m.m[0][1] * m.m[1][0] * m.m[3][3]//5
-		- m.m[0][0] * m.m[1][3] * m.m[3][1];//6
-	num.m[2][3] =
-		-m.m[0][0] * m.m[1][1] * m.m[2][3]//1
-		- m.m[0][1] * m.m[1][3] * m.m[2][0]//2
-		- m.m[0][3] * m.m[1][0] * m.m[2][1]//3
-		+ m.m[0][3] * m.m[1][1] * m.m[2][0]//4
-		+ m.m[0][1] * m.m[1][0] * m.m[2][3]//5
-		+ m.m[0][0] * m.m[1][3] * m.m[2][1];//6
-
-	num.m[3][0] =
-		-m.m[1][0] * m.m[2][1] * m.m[3][2]//1
-		- m.m[1][1] * m.m[2][2] * m.m[3][0]//2
-		- m.m[1][2] * m.m[2][0] * m.m[3][1]//3
-		+ m.m[1][2] * m.m[2][1] * m.m[3][0]//4
-		+ m.m[1][1] * m.m[2][0] * m.m[3][2]//5
-		+ m.m[1][0] * m.m[2][2] * m.m[3][1];//6
-	num.m[3][1] =
-		m.m[0][0] * m.m[2][1] * m.m[3][2]//1
-		+ m.m[0][1] * m.m[2][2] * m.m[3][0]//2
-		+ m.m[0][2] * m.m[2][0] * m.m[3][1]//3
-		- m.m[0][2] * m.m[2][1] * m.m[3][0]//4
-		- m.m[0][1] * m.m[2][0] * m.m[3][2]//5
-		- m.m[0][0] * m.m[2][2] * m.m[3][1];//6
-	num.m[3][2] =
-		-m.m[0][0] * m.m[1][1] * m.m[3][2]//1
-		- m.m[0][1] * m.m[1][2] * m.m[3][0]//2
-		- m.m[0][2] * m.m[1][0] * m.m[3][1]//3
-		+ m.m[0][2] * m.m[1][1] * m.m[3][0]//4
-		+ m.m[0][1] * m.m[1][0] * m.m[3][2]//5
-		+ m.m[0][0] * m.m[1][2] * m.m[3][1];//6
-	num.m[3][3] =
-		m.m[0][0] * m.m[1][1] * m.m[2][2]//1
-		+ m.m[0][1] * m.m[1][2] * m.m[2][0]//2
-		+ m.m[0][2] * m.m[1][0] * m.m[2][1]//3
-		- m.m[0][2] * m.m[1][1] * m.m[2][0]//4
-		- m.m[0][1] * m.m[1][0] * m.m[2][2]//5
-		- m.m[0][0] * m.m[1][2] * m.m[2][1];//6
-	// 行列式で割る
-	for (int i = 0; i < 4; ++i) {
-		for (int j = 0; j < 4; ++j) {
-			result.m[i][j] = num.m[i][j] / det;
-		}
-	}
+	__m128 inverseDet = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+	x = _mm_mul_ps(x, inverseDet);
+	y = _mm_mul_ps(y, inverseDet);
+	z = _mm_mul_ps(z, inverseDet);
+	w = _mm_mul_ps(w, inverseDet);
+	// 余因子行列への並べ替えと行への並べ直しをまとめて行う
+	_mm_storeu_ps(result.m[0], _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(result.m[1], _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+	_mm_storeu_ps(result.m[2], _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(result.m[3], _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+	return true;
+}
+
+// 逆行列(拡大縮小・回転・平行移動だけのアフィン変換行列用。4列目が(0,0,0,1)であること)
+// 左上3x3を行ベクトルのクロス積で逆行列にし、平行移動はその逆行列で戻す
+Matrix4x4 InverseAffine(const Matrix4x4& m) {
+	assert(IsAffine(m));
+	Vector3 row0 = { m.m[0][0], m.m[0][1], m.m[0][2] };
+	Vector3 row1 = { m.m[1][0], m.m[1][1], m.m[1][2] };
+	Vector3 row2 = { m.m[2][0], m.m[2][1], m.m[2][2] };
+	Vector3 translate = { m.m[3][0], m.m[3][1], m.m[3][2] };
+	Vector3 column0 = Cross(row1, row2);
+	Vector3 column1 = Cross(row2, row0);
+	Vector3 column2 = Cross(row0, row1);
+	float det = Dot(row0, column0);
+	assert(det != 0.0f);
+	float inverseDet = 1.0f / det;
+	column0 *= inverseDet;
+	column1 *= inverseDet;
+	column2 *= inverseDet;
+
+	Matrix4x4 result = {};
+	result.m[0][0] = column0.x;
+	result.m[0][1] = column1.x;
+	result.m[0][2] = column2.x;
+	result.m[1][0] = column0.y;
+	result.m[1][1] = column1.y;
+	result.m[1][2] = column2.y;
+	result.m[2][0] = column0.z;
+	result.m[2][1] = column1.z;
+	result.m[2][2] = column2.z;
+	result.m[3][0] = -Dot(translate, column0);
+	result.m[3][1] = -Dot(translate, column1);
+	result.m[3][2] = -Dot(translate, column2);
+	result.m[3][3] = 1.0f;
 	return result;
 }
 
-// 平行移動行列(Matrix4x4)
-Matrix4x4 MakeTranslateMatrix(const Vector3& translate) {
-	Matrix4x4 matrix = {};
-	matrix.m[0][0] = 1.0f;
-	matrix.m[1][1] = 1.0f;
-	matrix.m[2][2] = 1.0f;
-	matrix.m[3][3] = 1.0f;
-	matrix.m[3][0] = translate.x;
-	matrix.m[3][1] = translate.y;
-	matrix.m[3][2] = translate.z;
-	return matrix;
+// 逆行列(回転と平行移動だけの行列用。左上3x3が正規直交であること)
+// 回転部分は転置するだけでよい
+Matrix4x4 InverseRigid(const Matrix4x4& m) {
+	assert(IsAffine(m));
+	Matrix4x4 result = {};
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			result.m[i][j] = m.m[j][i];
+		}
+	}
+	for (int j = 0; j < 3; ++j) {
+		result.m[3][j] = -(m.m[3][0] * m.m[j][0] + m.m[3][1] * m.m[j][1] + m.m[3][2] * m.m[j][2]);
+	}
+	result.m[3][3] = 1.0f;
+	return result;
 }
 
-// 拡大縮小行列(Matrix4x4)
-Matrix4x4 MakeScaleMatrix(const Vector3& scale) {
-	Matrix4x4 matrix = {};
-	matrix.m[0][0] = scale.x;
-	matrix.m[1][1] = scale.y;
-	matrix.m[2][2] = scale.z;
-	matrix.m[3][3] = 1.0f;
-	return matrix;
+// 逆行列をまとめて計算する
+// 逆行列が存在しなかった行列はsingularをtrueにしてゼロ行列を書き込み、その個数を返す
+size_t Inverse(std::span<const Matrix4x4> input, std::span<Matrix4x4> output, std::span<bool> singular) {
+	assert(output.size() >= input.size());
+	assert(singular.size() >= input.size());
+	size_t singularCount = 0;
+	for (size_t i = 0; i < input.size(); ++i) {
+		Matrix4x4 result = { 0 };
+		singular[i] = !TryInverse(input[i], result);
+		output[i] = result;
+		if (singular[i]) {
+			++singularCount;
+		}
+	}
+	return singularCount;
 }
 
 // 回転行列(Matrix4x4)
 // X軸回転行列
 Matrix4x4  MakeRotateXMatrix(float radian) {
+	const float s = std::sin(radian);
+	const float c = std::cos(radian);
 	Matrix4x4 matrix = {};
 	matrix.m[0][0] = 1;
-	matrix.m[1][1] = std::cosf(radian);
-	matrix.m[1][2] = std::sinf(radian);
-	matrix.m[2][1] = -std::sinf(radian);
-	matrix.m[2][2] = std::cosf(radian);
+	matrix.m[1][1] = c;
+	matrix.m[1][2] = s;
+	matrix.m[2][1] = -s;
+	matrix.m[2][2] = c;
 	matrix.m[3][3] = 1;
 	return matrix;
 }
 
 // Y軸回転行列
 Matrix4x4  MakeRotateYMatrix(float radian) {
+	const float s = std::sin(radian);
+	const float c = std::cos(radian);
 	Matrix4x4 matrix = {};
-	matrix.m[0][0] = std::cosf(radian);
-	matrix.m[0][2] = -std::sinf(radian);
+	matrix.m[0][0] = c;
+	matrix.m[0][2] = -s;
 	matrix.m[1][1] = 1;
-	matrix.m[2][0] = std::sinf(radian);
-	matrix.m[2][2] = std::cosf(radian);
+	matrix.m[2][0] = s;
+	matrix.m[2][2] = c;
 	matrix.m[3][3] = 1;
 	return matrix;
 }
 
 // Z軸回転行列
 Matrix4x4  MakeRotateZMatrix(float radian) {
+	const float s = std::sin(radian);
+	const float c = std::cos(radian);
 	Matrix4x4 matrix = {};
-	matrix.m[0][0] = std::cosf(radian);
-	matrix.m[0][1] = std::sinf(radian);
-	matrix.m[1][0] = -std::sinf(radian);
-	matrix.m[1][1] = std::cosf(radian);
+	matrix.m[0][0] = c;
+	matrix.m[0][1] = s;
+	matrix.m[1][0] = -s;
+	matrix.m[1][1] = c;
 	matrix.m[2][2] = 1;
 	matrix.m[3][3] = 1;
 	return matrix;
 }
 
 // 回転行列
+// X軸回転行列 * Y軸回転行列 * Z軸回転行列を展開した形で、sin・cosは各軸1回ずつだけ計算する
 Matrix4x4 MakeRotateMatrix(float roll, float pitch, float yaw) {
-	Matrix4x4 rotateX = MakeRotateXMatrix(roll);
-	Matrix4x4 rotateY = MakeRotateYMatrix(pitch);
-	Matrix4x4 rotateZ = MakeRotateZMatrix(yaw);
-	return Multiply(Multiply(rotateX, rotateY), rotateZ);
+	const float sx = std::sin(roll);
+	const float cx = std::cos(roll);
+	const float sy = std::sin(pitch);
+	const float cy = std::cos(pitch);
+	const float sz = std::sin(yaw);
+	const float cz = std::cos(yaw);
+	Matrix4x4 matrix = {};
+	matrix.m[0][0] = cy * cz;
+	matrix.m[0][1] = cy * sz;
+	matrix.m[0][2] = -sy;
+	matrix.m[1][0] = sx * sy * cz - cx * sz;
+	matrix.m[1][1] = sx * sy * sz + cx * cz;
+	matrix.m[1][2] = sx * cy;
+	matrix.m[2][0] = cx * sy * cz + sx * sz;
+	matrix.m[2][1] = cx * sy * sz - sx * cz;
+	matrix.m[2][2] = cx * cy;
+	matrix.m[3][3] = 1.0f;
+	return matrix;
 }
 
 //　アフィン変換行列(Matrix4x4)
+// 拡大縮小、回転、平行移動の順で行列を乗算(W=SRT:[W:WorldMatrix][S=ScaleMatrix][R=RotateMatrix][T=TranslateMatrix])
+// Sは対角、Tは4行目だけなので、回転行列の各行を拡大縮小して4行目に平行移動を置けばよい
 Matrix4x4 MakeAffineMatrix(const Vector3& scale, const Vector3& rotate, Vector3& translate) {
-	// 拡大縮小行列、回転行列、平行移動行列を作成
-	Matrix4x4 scaleMatrix = MakeScaleMatrix(scale);
-	Matrix4x4 rotateMatrix = MakeRotateMatrix(rotate.x, rotate.y, rotate.z);
-	Matrix4x4 translateMatrix = MakeTranslateMatrix(translate);
-	// 拡大縮小、回転、平行移動の順で行列を乗算(W=SRT:[W:WorldMatrix][S=ScaleMatrix][R=RotateMatrix][T=TranslateMatrix])
-	return Multiply(Multiply(scaleMatrix, rotateMatrix), translateMatrix);
+	Matrix4x4 matrix = MakeRotateMatrix(rotate.x, rotate.y, rotate.z);
+	const float scales[3] = { scale.x, scale.y, scale.z };
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			matrix.m[i][j] *= scales[i];
+		}
+	}
+	matrix.m[3][0] = translate.x;
+	matrix.m[3][1] = translate.y;
+	matrix.m[3][2] = translate.z;
+	return matrix;
 }
 
 // 透視投影行列
 Matrix4x4 MakePerspectiveFovMatrix(float fovY, float aspectRatio, float nearClip, float farClip) {
 	Matrix4x4 result = {};
-	float f = 1.0f / std::tanf(fovY / 2.0f);
+	float f = 1.0f / std::tan(fovY / 2.0f);
 	result.m[0][0] = f / aspectRatio;
 	result.m[1][1] = f;
 	result.m[2][2] = farClip / (farClip - nearClip);
@@ -388,132 +382,395 @@ Matrix4x4 MakeViewportMatrix(float left, float top, float width, float height, f
 	return result;
 }
 
-// 行列の加算
-Matrix4x4 Add(const Matrix4x4& m1, const Matrix4x4& m2) {
-	Matrix4x4 result;
-	for (int i = 0; i < 4; ++i) {
-		for (int j = 0; j < 4; ++j) {
-			result.m[i][j] = m1.m[i][j] + m2.m[i][j];
-		}
-	}
-	return result;
+// 行列の乗算の1行分。aの行の各要素をブロードキャストしてbの各行に掛け合わせる
+// 加算の順番はスカラーの a0*b0 + a1*b1 + a2*b2 + a3*b3 と同じ
+static __m128 MultiplyRow(__m128 aRow, const __m128 b[4]) {
+	__m128 row = _mm_mul_ps(Simd::Swizzle<0, 0, 0, 0>(aRow), b[0]);
+	row = _mm_add_ps(row, _mm_mul_ps(Simd::Swizzle<1, 1, 1, 1>(aRow), b[1]));
+	row = _mm_add_ps(row, _mm_mul_ps(Simd::Swizzle<2, 2, 2, 2>(aRow), b[2]));
+	row = _mm_add_ps(row, _mm_mul_ps(Simd::Swizzle<3, 3, 3, 3>(aRow), b[3]));
+	return row;
 }
 
-// 行列の減算
-Matrix4x4 Subtract(const Matrix4x4& m1, const Matrix4x4& m2) {
+// 行列の乗算
+Matrix4x4 Multiply(const Matrix4x4& a, const Matrix4x4& b) {
+	const __m128 bRows[4] = { _mm_loadu_ps(b.m[0]), _mm_loadu_ps(b.m[1]), _mm_loadu_ps(b.m[2]), _mm_loadu_ps(b.m[3]) };
 	Matrix4x4 result;
 	for (int i = 0; i < 4; ++i) {
-		for (int j = 0; j < 4; ++j) {
-			result.m[i][j] = m1.m[i][j] - m2.m[i][j];
-		}
+		_mm_storeu_ps(result.m[i], MultiplyRow(_mm_loadu_ps(a.m[i]), bRows));
 	}
 	return result;
 }
 
-// 行列の乗算
-Matrix4x4 Multiply(const Matrix4x4& a, const Matrix4x4& b) {
-	Matrix4x4 result = {};
+// 行列の乗算(16バイト境界版)
+AlignedMatrix4x4 Multiply(const AlignedMatrix4x4& a, const AlignedMatrix4x4& b) {
+	const __m128 bRows[4] = { _mm_load_ps(b.m[0]), _mm_load_ps(b.m[1]), _mm_load_ps(b.m[2]), _mm_load_ps(b.m[3]) };
+	AlignedMatrix4x4 result;
 	for (int i = 0; i < 4; ++i) {
-		for (int j = 0; j < 4; ++j) {
-			result.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] +
-				a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
-		}
+		_mm_store_ps(result.m[i], MultiplyRow(_mm_load_ps(a.m[i]), bRows));
 	}
 	return result;
 }
 
-// 行列の転置
-Matrix4x4 Transpose(const Matrix4x4& m) {
-	Matrix4x4 result = { 0 };
-	for (int i = 0; i < 4; ++i) {
-		for (int j = 0; j < 4; ++j) {
-			result.m[i][j] = m.m[j][i];
+// 行列を左から順に掛け合わせる
+// 途中の積はレジスタに置いたままにして、一時的なMatrix4x4を作らない
+Matrix4x4 MultiplyChain(std::initializer_list<const Matrix4x4*> matrices) {
+	assert(matrices.size() > 0);
+	auto it = matrices.begin();
+	__m128 rows[4] = { _mm_loadu_ps((*it)->m[0]), _mm_loadu_ps((*it)->m[1]), _mm_loadu_ps((*it)->m[2]), _mm_loadu_ps((*it)->m[3]) };
+	for (++it; it != matrices.end(); ++it) {
+		const __m128 bRows[4] = { _mm_loadu_ps((*it)->m[0]), _mm_loadu_ps((*it)->m[1]), _mm_loadu_ps((*it)->m[2]), _mm_loadu_ps((*it)->m[3]) };
+		for (int i = 0; i < 4; ++i) {
+			rows[i] = MultiplyRow(rows[i], bRows);
 		}
 	}
+	Matrix4x4 result;
+	for (int i = 0; i < 4; ++i) {
+		_mm_storeu_ps(result.m[i], rows[i]);
+	}
 	return result;
 }
 
-// 単位行列の作成
-Matrix4x4 MakeIdentity() {
-	Matrix4x4 identity = { 0 };
-	for (int i = 0; i < 4; ++i) {
-		identity.m[i][i] = 1.0f;
+// 行列をまとめて乗算する(output[i] = matrices[i] * shared)
+// 多数のワールド行列に共通のビュープロジェクション行列を掛ける用途。sharedの行は1回だけ読み込む
+void Multiply(std::span<const Matrix4x4> matrices, const Matrix4x4& shared, std::span<Matrix4x4> output) {
+	assert(output.size() >= matrices.size());
+	size_t index = 0;
+#if defined(__AVX__)
+	{
+		// 上位・下位128bitに同じsharedの行を置き、1命令で2行分を計算する
+		__m256 bRows[4];
+		for (int k = 0; k < 4; ++k) {
+			bRows[k] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(shared.m[k]));
+		}
+		for (; index < matrices.size(); ++index) {
+			const Matrix4x4& a = matrices[index];
+			for (int i = 0; i < 4; i += 2) {
+				__m256 row = _mm256_mul_ps(_mm256_setr_m128(_mm_set1_ps(a.m[i][0]), _mm_set1_ps(a.m[i + 1][0])), bRows[0]);
+				for (int k = 1; k < 4; ++k) {
+					row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_setr_m128(_mm_set1_ps(a.m[i][k]), _mm_set1_ps(a.m[i + 1][k])), bRows[k]));
+				}
+				_mm256_storeu_ps(output[index].m[i], row);
+			}
+		}
+	}
+#endif
+	const __m128 bRows[4] = { _mm_loadu_ps(shared.m[0]), _mm_loadu_ps(shared.m[1]), _mm_loadu_ps(shared.m[2]), _mm_loadu_ps(shared.m[3]) };
+	for (; index < matrices.size(); ++index) {
+		for (int i = 0; i < 4; ++i) {
+			_mm_storeu_ps(output[index].m[i], MultiplyRow(_mm_loadu_ps(matrices[index].m[i]), bRows));
+		}
 	}
-	return identity;
 }
+
+// 任意軸回転行列
 Matrix4x4 MakeRotateAxisAngle(const Vector3& axis, float angle) {
+	const float s = std::sin(angle);
+	const float c = std::cos(angle);
+	const float oneMinusC = 1 - c;
 	Matrix4x4 result{};
-	result.m[0][0] = axis.x * axis.x * (1 - std::cosf(angle)) + std::cosf(angle);
-	result.m[0][1] = axis.x * axis.y * (1 - std::cosf(angle)) + axis.z * std::sinf(angle);
-	result.m[0][2] = axis.x * axis.z * (1 - std::cosf(angle)) - axis.y * std::sinf(angle);
-	result.m[1][0] = axis.x * axis.y * (1 - std::cosf(angle)) - axis.z * std::sinf(angle);
-	result.m[1][1] = axis.y * axis.y * (1 - std::cosf(angle)) + std::cosf(angle);
-	result.m[1][2] = axis.y * axis.z * (1 - std::cosf(angle)) + axis.x * std::sinf(angle);
-	result.m[2][0] = axis.x * axis.z * (1 - std::cosf(angle)) + axis.y * std::sinf(angle);
-	result.m[2][1] = axis.y * axis.z * (1 - std::cosf(angle)) - axis.x * std::sinf(angle);
-	result.m[2][2] = axis.z * axis.z * (1 - std::cosf(angle)) + std::cosf(angle);
+	result.m[0][0] = axis.x * axis.x * oneMinusC + c;
+	result.m[0][1] = axis.x * axis.y * oneMinusC + axis.z * s;
+	result.m[0][2] = axis.x * axis.z * oneMinusC - axis.y * s;
+	result.m[1][0] = axis.x * axis.y * oneMinusC - axis.z * s;
+	result.m[1][1] = axis.y * axis.y * oneMinusC + c;
+	result.m[1][2] = axis.y * axis.z * oneMinusC + axis.x * s;
+	result.m[2][0] = axis.x * axis.z * oneMinusC + axis.y * s;
+	result.m[2][1] = axis.y * axis.z * oneMinusC - axis.x * s;
+	result.m[2][2] = axis.z * axis.z * oneMinusC + c;
 	result.m[3][3] = 1.0f;
 
 	return result;
 }
 #pragma endregion
 
-#pragma region 演算子オーバーロード
-// 二公演算子
-Vector3 operator+(const Vector3& v1, const Vector3& v2) {
-	return Add(v1, v2);
+#pragma region Quaternion
+// クォータニオンの積(q1 * q2)
+Quaternion Multiply(const Quaternion& q1, const Quaternion& q2) {
+	Quaternion result;
+	result.x = q1.y * q2.z - q1.z * q2.y + q2.w * q1.x + q1.w * q2.x;
+	result.y = q1.z * q2.x - q1.x * q2.z + q2.w * q1.y + q1.w * q2.y;
+	result.z = q1.x * q2.y - q1.y * q2.x + q2.w * q1.z + q1.w * q2.z;
+	result.w = q1.w * q2.w - q1.x * q2.x - q1.y * q2.y - q1.z * q2.z;
+	return result;
 }
-Vector3 operator-(const Vector3& v1, const Vector3& v2) {
-	return Subtract(v1, v2);
+
+// 単位クォータニオン
+Quaternion IdentityQuaternion() {
+	return { 0.0f, 0.0f, 0.0f, 1.0f };
 }
-Vector3 operator*(float s, const Vector3& v) {
-	return Multiply(s, v);
+
+// 共役クォータニオン
+Quaternion Conjugate(const Quaternion& quaternion) {
+	return { -quaternion.x, -quaternion.y, -quaternion.z, quaternion.w };
 }
-Vector3 operator*(const Vector3& v, float s) {
-	return s * v;
+
+// クォータニオンの内積
+float Dot(const Quaternion& q1, const Quaternion& q2) {
+	return q1.x * q2.x + q1.y * q2.y + q1.z * q2.z + q1.w * q2.w;
 }
-Vector3 operator/(const Vector3& v, float s) {
-	return Multiply(1.0f / s, v);
+
+// クォータニオンのノルム
+float Norm(const Quaternion& quaternion) {
+	return std::sqrt(Dot(quaternion, quaternion));
 }
-Matrix4x4 operator+(const Matrix4x4& m1, const Matrix4x4& m2) {
-	return Add(m1, m2);
+
+// クォータニオンの正規化(ノルムが0の場合は単位クォータニオンを返す)
+Quaternion Normalize(const Quaternion& quaternion) {
+	float norm = Norm(quaternion);
+	if (norm == 0.0f) {
+		return IdentityQuaternion();
+	}
+	float inverseNorm = 1.0f / norm;
+	return { quaternion.x * inverseNorm, quaternion.y * inverseNorm, quaternion.z * inverseNorm, quaternion.w * inverseNorm };
+}
+
+// 逆クォータニオン
+Quaternion Inverse(const Quaternion& quaternion) {
+	float normSq = Dot(quaternion, quaternion);
+	assert(normSq != 0.0f);
+	float inverseNormSq = 1.0f / normSq;
+	return { -quaternion.x * inverseNormSq, -quaternion.y * inverseNormSq, -quaternion.z * inverseNormSq, quaternion.w * inverseNormSq };
+}
+
+// 任意軸回転を表すクォータニオン
+Quaternion MakeRotateAxisAngleQuaternion(const Vector3& axis, float angle) {
+	const float s = std::sin(angle * 0.5f);
+	const float c = std::cos(angle * 0.5f);
+	return { axis.x * s, axis.y * s, axis.z * s, c };
+}
+
+// オイラー角から回転を表すクォータニオン
+// X軸、Y軸、Z軸の順に回転するので qz * qy * qx を展開した形。sin・cosは各軸1回ずつだけ計算する
+Quaternion MakeRotateQuaternion(float roll, float pitch, float yaw) {
+	const float sx = std::sin(roll * 0.5f);
+	const float cx = std::cos(roll * 0.5f);
+	const float sy = std::sin(pitch * 0.5f);
+	const float cy = std::cos(pitch * 0.5f);
+	const float sz = std::sin(yaw * 0.5f);
+	const float cz = std::cos(yaw * 0.5f);
+	Quaternion result;
+	result.x = sx * cy * cz - cx * sy * sz;
+	result.y = cx * sy * cz + sx * cy * sz;
+	result.z = cx * cy * sz - sx * sy * cz;
+	result.w = cx * cy * cz + sx * sy * sz;
+	return result;
 }
-Matrix4x4 operator-(const Matrix4x4& m1, const Matrix4x4& m2) {
-	return Subtract(m1, m2);
+
+// ベクトルをクォータニオンで回転する
+// q * v * q^-1 を展開し、t = 2 * (qv × v) として v + w * t + qv × t で求める
+Vector3 RotateVector(const Vector3& vector, const Quaternion& quaternion) {
+	const Quaternion& q = quaternion;
+	const float tx = (q.y * vector.z - q.z * vector.y) * 2.0f;
+	const float ty = (q.z * vector.x - q.x * vector.z) * 2.0f;
+	const float tz = (q.x * vector.y - q.y * vector.x) * 2.0f;
+	Vector3 result;
+	result.x = vector.x + q.w * tx + (q.y * tz - q.z * ty);
+	result.y = vector.y + q.w * ty + (q.z * tx - q.x * tz);
+	result.z = vector.z + q.w * tz + (q.x * ty - q.y * tx);
+	return result;
 }
+
+// クォータニオンから回転行列
+// 軸と角度が同じならMakeRotateAxisAngleと同じ行列になる
+Matrix4x4 MakeRotateMatrix(const Quaternion& quaternion) {
+	const Quaternion& q = quaternion;
+	const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z, ww = q.w * q.w;
+	const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+	Matrix4x4 result = {};
+	result.m[0][0] = ww + xx - yy - zz;
+	result.m[0][1] = (xy + wz) * 2.0f;
+	result.m[0][2] = (xz - wy) * 2.0f;
+	result.m[1][0] = (xy - wz) * 2.0f;
+	result.m[1][1] = ww - xx + yy - zz;
+	result.m[1][2] = (yz + wx) * 2.0f;
+	result.m[2][0] = (xz + wy) * 2.0f;
+	result.m[2][1] = (yz - wx) * 2.0f;
+	result.m[2][2] = ww - xx - yy + zz;
+	result.m[3][3] = 1.0f;
+	return result;
+}
+
+// 球面線形補間
+// qと-qは同じ回転なので、内積が負ならq1を反転して近い方を通る
+Quaternion Slerp(const Quaternion& q0, const Quaternion& q1, float t) {
+	float dot = Dot(q0, q1);
+	float sign = 1.0f;
+	if (dot < 0.0f) {
+		dot = -dot;
+		sign = -1.0f;
+	}
+	// ほぼ同じ向きのときはsinθが0に近く割り算が不安定になるので、線形補間で代用する
+	if (dot >= 0.9995f) {
+		return Nlerp(q0, q1, t);
+	}
+	const float theta = std::acos(dot);
+	const float inverseSinTheta = 1.0f / std::sin(theta);
+	const float scale0 = std::sin((1.0f - t) * theta) * inverseSinTheta;
+	const float scale1 = std::sin(t * theta) * inverseSinTheta * sign;
+	return {
+		scale0 * q0.x + scale1 * q1.x,
+		scale0 * q0.y + scale1 * q1.y,
+		scale0 * q0.z + scale1 * q1.z,
+		scale0 * q0.w + scale1 * q1.w,
+	};
+}
+
+// 線形補間して正規化する
+Quaternion Nlerp(const Quaternion& q0, const Quaternion& q1, float t) {
+	const float scale0 = 1.0f - t;
+	const float scale1 = Dot(q0, q1) < 0.0f ? -t : t;
+	return Normalize(Quaternion{
+		scale0 * q0.x + scale1 * q1.x,
+		scale0 * q0.y + scale1 * q1.y,
+		scale0 * q0.z + scale1 * q1.z,
+		scale0 * q0.w + scale1 * q1.w,
+		});
+}
+
+// クォータニオンの積をまとめて計算する
+// 以下のまとめて計算する関数は、4個ずつSoAに並べ替えて1個ずつの関数と同じ順番で計算するので、結果はビット単位で一致する
+void Multiply(std::span<const Quaternion> q1, std::span<const Quaternion> q2, std::span<Quaternion> output) {
+	assert(q2.size() >= q1.size());
+	assert(output.size() >= q1.size());
+	const size_t count = q1.size();
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 ax, ay, az, aw, bx, by, bz, bw;
+		Simd::LoadVector4x4(reinterpret_cast<const float*>(q1.data() + i), ax, ay, az, aw);
+		Simd::LoadVector4x4(reinterpret_cast<const float*>(q2.data() + i), bx, by, bz, bw);
+		__m128 x = _mm_add_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by)), _mm_mul_ps(bw, ax)), _mm_mul_ps(aw, bx));
+		__m128 y = _mm_add_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz)), _mm_mul_ps(bw, ay)), _mm_mul_ps(aw, by));
+		__m128 z = _mm_add_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx)), _mm_mul_ps(bw, az)), _mm_mul_ps(aw, bz));
+		__m128 w = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(aw, bw), _mm_mul_ps(ax, bx)), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+		Simd::StoreVector4x4(reinterpret_cast<float*>(output.data() + i), x, y, z, w);
+	}
+	for (; i < count; ++i) {
+		output[i] = Multiply(q1[i], q2[i]);
+	}
+}
+
+// ベクトルをまとめて回転する
+void RotateVector(std::span<const Vector3> vectors, std::span<const Quaternion> rotations, std::span<Vector3> output) {
+	assert(rotations.size() >= vectors.size());
+	assert(output.size() >= vectors.size());
+	const size_t count = vectors.size();
+	const __m128 two = _mm_set1_ps(2.0f);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 vx, vy, vz, qx, qy, qz, qw;
+		Simd::LoadVector3x4(reinterpret_cast<const float*>(vectors.data() + i), vx, vy, vz);
+		Simd::LoadVector4x4(reinterpret_cast<const float*>(rotations.data() + i), qx, qy, qz, qw);
+		__m128 tx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(qy, vz), _mm_mul_ps(qz, vy)), two);
+		__m128 ty = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(qz, vx), _mm_mul_ps(qx, vz)), two);
+		__m128 tz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(qx, vy), _mm_mul_ps(qy, vx)), two);
+		__m128 rx = _mm_add_ps(_mm_add_ps(vx, _mm_mul_ps(qw, tx)), _mm_sub_ps(_mm_mul_ps(qy, tz), _mm_mul_ps(qz, ty)));
+		__m128 ry = _mm_add_ps(_mm_add_ps(vy, _mm_mul_ps(qw, ty)), _mm_sub_ps(_mm_mul_ps(qz, tx), _mm_mul_ps(qx, tz)));
+		__m128 rz = _mm_add_ps(_mm_add_ps(vz, _mm_mul_ps(qw, tz)), _mm_sub_ps(_mm_mul_ps(qx, ty), _mm_mul_ps(qy, tx)));
+		Simd::StoreVector3x4(reinterpret_cast<float*>(output.data() + i), rx, ry, rz);
+	}
+	for (; i < count; ++i) {
+		output[i] = RotateVector(vectors[i], rotations[i]);
+	}
+}
+
+// ベクトルをまとめて同じクォータニオンで回転する
+// 回転行列を1回作ってTransformでまとめて変換する(1個ずつのRotateVectorとは丸め誤差の分だけ異なる)
+void RotateVector(std::span<const Vector3> vectors, const Quaternion& rotation, std::span<Vector3> output) {
+	Transform(MakeRotateMatrix(rotation), vectors, output);
+}
+
+// クォータニオンからまとめて回転行列を作る
+void MakeRotateMatrix(std::span<const Quaternion> quaternions, std::span<Matrix4x4> output) {
+	assert(output.size() >= quaternions.size());
+	const size_t count = quaternions.size();
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 lastRow = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 x, y, z, w;
+		Simd::LoadVector4x4(reinterpret_cast<const float*>(quaternions.data() + i), x, y, z, w);
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z), ww = _mm_mul_ps(w, w);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+		// 行ごとに4個分の要素を並べ、転置すると各行列の1行になる
+		__m128 rows[3][4] = {
+			{ _mm_sub_ps(_mm_sub_ps(_mm_add_ps(ww, xx), yy), zz), _mm_mul_ps(_mm_add_ps(xy, wz), two), _mm_mul_ps(_mm_sub_ps(xz, wy), two), zero },
+			{ _mm_mul_ps(_mm_sub_ps(xy, wz), two), _mm_sub_ps(_mm_add_ps(_mm_sub_ps(ww, xx), yy), zz), _mm_mul_ps(_mm_add_ps(yz, wx), two), zero },
+			{ _mm_mul_ps(_mm_add_ps(xz, wy), two), _mm_mul_ps(_mm_sub_ps(yz, wx), two), _mm_add_ps(_mm_sub_ps(_mm_sub_ps(ww, xx), yy), zz), zero },
+		};
+		for (int row = 0; row < 3; ++row) {
+			_MM_TRANSPOSE4_PS(rows[row][0], rows[row][1], rows[row][2], rows[row][3]);
+			for (int k = 0; k < 4; ++k) {
+				_mm_storeu_ps(output[i + k].m[row], rows[row][k]);
+			}
+		}
+		for (int k = 0; k < 4; ++k) {
+			_mm_storeu_ps(output[i + k].m[3], lastRow);
+		}
+	}
+	for (; i < count; ++i) {
+		output[i] = MakeRotateMatrix(quaternions[i]);
+	}
+}
+
+// 球面線形補間をまとめて計算する
+void Slerp(std::span<const Quaternion> q0, std::span<const Quaternion> q1, float t, std::span<Quaternion> output) {
+	assert(q1.size() >= q0.size());
+	assert(output.size() >= q0.size());
+	for (size_t i = 0; i < q0.size(); ++i) {
+		output[i] = Slerp(q0[i], q1[i], t);
+	}
+}
+
+// 線形補間して正規化する処理をまとめて計算する
+void Nlerp(std::span<const Quaternion> q0, std::span<const Quaternion> q1, float t, std::span<Quaternion> output) {
+	assert(q1.size() >= q0.size());
+	assert(output.size() >= q0.size());
+	const size_t count = q0.size();
+	const __m128 scale0 = _mm_set1_ps(1.0f - t);
+	const __m128 positiveT = _mm_set1_ps(t);
+	const __m128 negativeT = _mm_set1_ps(-t);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 ax, ay, az, aw, bx, by, bz, bw;
+		Simd::LoadVector4x4(reinterpret_cast<const float*>(q0.data() + i), ax, ay, az, aw);
+		Simd::LoadVector4x4(reinterpret_cast<const float*>(q1.data() + i), bx, by, bz, bw);
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz)), _mm_mul_ps(aw, bw));
+		__m128 negative = _mm_cmplt_ps(dot, zero);
+		__m128 scale1 = _mm_or_ps(_mm_and_ps(negative, negativeT), _mm_andnot_ps(negative, positiveT));
+		__m128 x = _mm_add_ps(_mm_mul_ps(scale0, ax), _mm_mul_ps(scale1, bx));
+		__m128 y = _mm_add_ps(_mm_mul_ps(scale0, ay), _mm_mul_ps(scale1, by));
+		__m128 z = _mm_add_ps(_mm_mul_ps(scale0, az), _mm_mul_ps(scale1, bz));
+		__m128 w = _mm_add_ps(_mm_mul_ps(scale0, aw), _mm_mul_ps(scale1, bw));
+		__m128 norm = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w)));
+		// ノルムが0なら単位クォータニオンにする
+		__m128 degenerate = _mm_cmpeq_ps(norm, zero);
+		__m128 inverseNorm = _mm_div_ps(one, _mm_or_ps(norm, _mm_and_ps(degenerate, one)));
+		x = _mm_andnot_ps(degenerate, _mm_mul_ps(x, inverseNorm));
+		y = _mm_andnot_ps(degenerate, _mm_mul_ps(y, inverseNorm));
+		z = _mm_andnot_ps(degenerate, _mm_mul_ps(z, inverseNorm));
+		w = _mm_or_ps(_mm_andnot_ps(degenerate, _mm_mul_ps(w, inverseNorm)), _mm_and_ps(degenerate, one));
+		Simd::StoreVector4x4(reinterpret_cast<float*>(output.data() + i), x, y, z, w);
+	}
+	for (; i < count; ++i) {
+		output[i] = Nlerp(q0[i], q1[i], t);
+	}
+}
+#pragma endregion
+
+#pragma region 演算子オーバーロード
 Matrix4x4 operator*(const Matrix4x4& m1, const Matrix4x4& m2) {
 	return Multiply(m1, m2);
 }
-// 単項演算子
-Vector3 operator-(const Vector3& v) {
-	return { -v.x,-v.y,-v.z };
-}
-Vector3 operator+(const Vector3& v) {
-	return v;
-}
-// 複合代入演算子
-Vector3& operator*=(Vector3& v, float s) {
-	v.x *= s;
-	v.y *= s;
-	v.z *= s;
-	return v;
-}
-Vector3& operator-=(Vector3& v1, const Vector3& v2) {
-	v1.x -= v2.x;
-	v1.y -= v2.y;
-	v1.z -= v2.z;
-	return v1;
-}
-Vector3& operator+=(Vector3& v1, const Vector3& v2) {
-	v1.x += v2.x;
-	v1.y += v2.y;
-	v1.z += v2.z;
-	return v1;
-}
-Vector3& operator/=(Vector3& v, float s) {
-	v.x /= s;
-	v.y /= s;
-	v.z /= s;
-	return v;
-}
-#pragma endregion
\ No newline at end of file
+#pragma endregion
+#pragma region 定数式で使えることの確認
+static_assert(Dot(Vector3{ 1.0f, 2.0f, 3.0f }, Vector3{ 4.0f, 5.0f, 6.0f }) == 32.0f);
+static_assert(Length(Vector3{ 3.0f, 4.0f, 0.0f }) == 5.0f);
+static_assert(Cross(Vector3{ 1.0f, 0.0f, 0.0f }, Vector3{ 0.0f, 1.0f, 0.0f }).z == 1.0f);
+static_assert(Transform(MakeTranslateMatrix(TVector3<double>{ 1.0, 2.0, 3.0 }), TVector3<double>{ 1.0, 1.0, 1.0 }).z == 4.0);
+#pragma endregion
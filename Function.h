@@ -1,44 +1,35 @@
 #pragma once
+#include <initializer_list>
+#include <span>
+#include "MathCore.h"
 #include "Struct.h"
 
 #pragma region Vector3
-// ベクトルの加算を計算する関数
-Vector3 Add(const Vector3& v1, const Vector3& v2);
-// ベクトルの引き算を計算する関数
-Vector3 Subtract(const Vector3& v1, const Vector3& v2);
-// ベクトルをスカラー倍する関数
-Vector3 Multiply(float scalar, const Vector3& v);
-// 内積を計算する関数
-float Dot(const Vector3& v1, const Vector3& v2);
-// ベクトルを正規化する関数
-Vector3 Normalize(const Vector3& v);
-// ベクトルの長さを計算する関数
-float Length(const Vector3& v);
-// クロス積
-Vector3 Cross(const Vector3& v1, const Vector3& v2);
-// 座標変換(Matrix4x4からVector3へ)
-Vector3 Transform(const Matrix4x4& matrix, const Vector3& vector);
+// 加算・減算・スカラー倍・内積・長さ・正規化・クロス積・座標変換(1個)・線形補間・ベジエ・反発ベクトルはMathCore.h
+// 座標変換(配列をまとめて変換。inputとoutputは同じ配列でもよい)
+void Transform(const Matrix4x4& matrix, std::span<const Vector3> input, std::span<Vector3> output);
+// 座標変換(配列をその場で変換)
+void Transform(const Matrix4x4& matrix, std::span<Vector3> vectors);
 // 正射影ベクトルを求める関数
 Vector3 Project(const Vector3& v1, Vector3& v2);
 // 最近接点を求める関数
 Vector3 ClosestPoint(const Vector3& lineStart, const Vector3& lineEnd, const Vector3& point);
 // ベクトルの長さを求める関数
 Vector3 Perpendicular(const Vector3& vector);
-// 線形補間
-Vector3 Lerp(const Vector3& v1, const Vector3& v2, const float& t);
-// ベジエ
-Vector3 Bezier(const Vector3& p0, const Vector3& p1, const Vector3& p2, const float& t);
-// 反発ベクトルを求める
-Vector3 Reflect(const Vector3& input, const Vector3& normal);
 #pragma endregion
 
 #pragma region Matrix4x4
+// 平行移動・拡大縮小行列、加算・減算、転置、単位行列、IsAffineはMathCore.h
 // 逆行列(Matrix4x4)
 Matrix4x4 Inverse(const Matrix4x4& m);
-// 平行移動行列(Matrix4x4)
-Matrix4x4 MakeTranslateMatrix(const Vector3& translate);
-// 拡大縮小行列(Matrix4x4)
-Matrix4x4 MakeScaleMatrix(const Vector3& scale);
+// 逆行列(行列式が0ならfalseを返し、resultは変更しない)
+bool TryInverse(const Matrix4x4& m, Matrix4x4& result);
+// 逆行列(拡大縮小・回転・平行移動だけのアフィン変換行列用)
+Matrix4x4 InverseAffine(const Matrix4x4& m);
+// 逆行列(回転と平行移動だけの行列用)
+Matrix4x4 InverseRigid(const Matrix4x4& m);
+// 逆行列をまとめて計算する。逆行列が存在しなかった個数を返す
+size_t Inverse(std::span<const Matrix4x4> input, std::span<Matrix4x4> output, std::span<bool> singular);
 // 回転行列(Matrix4x4)
 // X軸回転行列
 Matrix4x4 MakeRotateXMatrix(float radian);
@@ -56,37 +47,61 @@ Matrix4x4 MakePerspectiveFovMatrix(float fovY, float aspectRatio, float nearClip
 Matrix4x4 MakeOrthographicMatrix(float left, float top, float right, float bottom, float nearClip, float farClip);
 // ビューポート変換行列
 Matrix4x4 MakeViewportMatrix(float left, float top, float width, float height, float minDepth, float maxDepth);
-// 行列の加算
-Matrix4x4 Add(const Matrix4x4& m1, const Matrix4x4& m2);
-// 行列の減算
-Matrix4x4 Subtract(const Matrix4x4& m1, const Matrix4x4& m2);
-// 行列の乗算
+// 行列の乗算(MathCore.hのテンプレートより優先されるSIMD版)
 Matrix4x4 Multiply(const Matrix4x4& a, const Matrix4x4& b);
-// 行列の転置
-Matrix4x4 Transpose(const Matrix4x4& m);
-// 単位ベクトルの作成
-Matrix4x4 MakeIdentity();
+// 行列の乗算(16バイト境界版)
+AlignedMatrix4x4 Multiply(const AlignedMatrix4x4& a, const AlignedMatrix4x4& b);
+// 行列を左から順に掛け合わせる(例: MultiplyChain({ &world, &view, &projection, &viewport }))
+Matrix4x4 MultiplyChain(std::initializer_list<const Matrix4x4*> matrices);
+// 行列をまとめて乗算する(output[i] = matrices[i] * shared)
+void Multiply(std::span<const Matrix4x4> matrices, const Matrix4x4& shared, std::span<Matrix4x4> output);
 // 任意軸回転行列
 Matrix4x4 MakeRotateAxisAngle(const Vector3& axis, float angle);
 
 #pragma endregion
 
+#pragma region Quaternion
+// クォータニオンの積(q1 * q2。q2の回転のあとにq1の回転を行う)
+Quaternion Multiply(const Quaternion& q1, const Quaternion& q2);
+// 単位クォータニオン
+Quaternion IdentityQuaternion();
+// 共役クォータニオン
+Quaternion Conjugate(const Quaternion& quaternion);
+// クォータニオンの内積
+float Dot(const Quaternion& q1, const Quaternion& q2);
+// クォータニオンのノルム
+float Norm(const Quaternion& quaternion);
+// クォータニオンの正規化
+Quaternion Normalize(const Quaternion& quaternion);
+// 逆クォータニオン
+Quaternion Inverse(const Quaternion& quaternion);
+// 任意軸回転を表すクォータニオン(axisは正規化済みであること)
+Quaternion MakeRotateAxisAngleQuaternion(const Vector3& axis, float angle);
+// オイラー角から回転を表すクォータニオン(MakeRotateMatrix(roll, pitch, yaw)と同じ回転)
+Quaternion MakeRotateQuaternion(float roll, float pitch, float yaw);
+// ベクトルをクォータニオンで回転する(quaternionは正規化済みであること)
+Vector3 RotateVector(const Vector3& vector, const Quaternion& quaternion);
+// クォータニオンから回転行列(quaternionは正規化済みであること)
+Matrix4x4 MakeRotateMatrix(const Quaternion& quaternion);
+// 球面線形補間(t=0でq0、t=1でq1。遠回りしない向きで補間する)
+Quaternion Slerp(const Quaternion& q0, const Quaternion& q1, float t);
+// 線形補間して正規化する(Slerpより速いが角速度は一定にならない)
+Quaternion Nlerp(const Quaternion& q0, const Quaternion& q1, float t);
+// クォータニオンの積をまとめて計算する(output[i] = q1[i] * q2[i])
+void Multiply(std::span<const Quaternion> q1, std::span<const Quaternion> q2, std::span<Quaternion> output);
+// ベクトルをまとめて回転する(output[i] = vectors[i]をrotations[i]で回転)
+void RotateVector(std::span<const Vector3> vectors, std::span<const Quaternion> rotations, std::span<Vector3> output);
+// ベクトルをまとめて同じクォータニオンで回転する
+void RotateVector(std::span<const Vector3> vectors, const Quaternion& rotation, std::span<Vector3> output);
+// クォータニオンからまとめて回転行列を作る
+void MakeRotateMatrix(std::span<const Quaternion> quaternions, std::span<Matrix4x4> output);
+// 球面線形補間をまとめて計算する
+void Slerp(std::span<const Quaternion> q0, std::span<const Quaternion> q1, float t, std::span<Quaternion> output);
+// 線形補間して正規化する処理をまとめて計算する
+void Nlerp(std::span<const Quaternion> q0, std::span<const Quaternion> q1, float t, std::span<Quaternion> output);
+#pragma endregion
+
 #pragma region 演算子オーバーロード
-// 二項演算子
-Vector3 operator+(const Vector3& v1, const Vector3& v2);
-Vector3 operator-(const Vector3& v1, const Vector3& v2);
-Vector3 operator*(float s, const Vector3& v);
-Vector3 operator*(const Vector3& v, float s);
-Vector3 operator/(const Vector3& v, float s);
-Matrix4x4 operator+(const Matrix4x4& m1, const Matrix4x4& m2);
-Matrix4x4 operator-(const Matrix4x4& m1, const Matrix4x4& m2);
+// Vector3の演算子と行列の+ -はMathCore.h。行列の*だけはSIMD版のMultiplyを使う
 Matrix4x4 operator*(const Matrix4x4& m1, const Matrix4x4& m2);
-// 単項演算子
-Vector3 operator-(const Vector3& v);
-Vector3 operator+(const Vector3& v);
-// 複合代入演算子
-Vector3& operator*=(Vector3& v, float s);
-Vector3& operator-=(Vector3& v1, const Vector3& v2);
-Vector3& operator+=(Vector3& v1, const Vector3& v2);
-Vector3& operator/=(Vector3& v, float s);
 #pragma endregion
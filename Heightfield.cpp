@@ -0,0 +1,518 @@
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "Heightfield.h"
+#include "Function.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+namespace {
+// 最小・最大の段を作るときに1スレッドがまとめて処理する行の数
+constexpr size_t kRowGrain = 64;
+// まとめて処理する線分と点を1スレッドが処理する数
+constexpr size_t kRayGrain = 256;
+constexpr size_t kSampleGrain = 4096;
+// ForEachCellの探索用スタックの大きさ(最初に積む4つ + 1段ごとに増える3つ * 最大の段数)
+constexpr uint32_t kCellStackSize = 4 + 3 * 32;
+
+// poolがあれば[0, count)をgrain個ずつ並列に処理する
+template<typename Function>
+void ForEachRange(ThreadPool* pool, size_t count, size_t grain, Function&& function) {
+	if (pool != nullptr) {
+		pool->ParallelFor(count, grain, [&](size_t begin, size_t end, uint32_t) {
+			function(begin, end);
+		});
+		return;
+	}
+	function(size_t(0), count);
+}
+
+// 線分と三角形の交差判定(Möller-Trumbore)。tが[0, best)の範囲で交われば書き換える
+bool IntersectTriangle(const Segment& segment, const Triangle& triangle, float& best) {
+	const Vector3 edge1 = triangle.vertex[1] - triangle.vertex[0];
+	const Vector3 edge2 = triangle.vertex[2] - triangle.vertex[0];
+	const Vector3 p = Cross(segment.diff, edge2);
+	const float det = Dot(edge1, p);
+	if (det == 0.0f) {
+		return false;
+	}
+	const float inverseDet = 1.0f / det;
+	const Vector3 toOrigin = segment.origin - triangle.vertex[0];
+	const float u = Dot(toOrigin, p) * inverseDet;
+	const Vector3 q = Cross(toOrigin, edge1);
+	const float v = Dot(segment.diff, q) * inverseDet;
+	const float t = Dot(edge2, q) * inverseDet;
+	if (u >= 0.0f && u <= 1.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t < best) {
+		best = t;
+		return true;
+	}
+	return false;
+}
+
+Vector3 FaceNormal(const Triangle& triangle) {
+	return Normalize(Cross(triangle.vertex[1] - triangle.vertex[0], triangle.vertex[2] - triangle.vertex[0]));
+}
+}
+
+#pragma region 作成
+void Heightfield::Build(std::span<const float> heights, uint32_t width, uint32_t depth, const Vector3& origin, float cellSize) {
+	MT4_PROFILE_ZONE("Heightfield::Build");
+	const auto start = std::chrono::steady_clock::now();
+	assert(width >= 2 && depth >= 2);
+	assert(heights.size() == static_cast<size_t>(width) * depth);
+	assert(cellSize > 0.0f);
+	heights_.assign(heights.begin(), heights.end());
+	width_ = width;
+	depth_ = depth;
+	origin_ = origin;
+	cellSize_ = cellSize;
+	inverseCellSize_ = 1.0f / cellSize;
+
+	// 一番下の段はセルの4つの頂点の高さの範囲
+	levels_.clear();
+	Level base;
+	base.width = width - 1;
+	base.depth = depth - 1;
+	base.bounds.resize(static_cast<size_t>(base.width) * base.depth);
+	ForEachRange(pool_, base.depth, kRowGrain, [&](size_t begin, size_t end) {
+		for (size_t z = begin; z < end; ++z) {
+			const float* row0 = heights_.data() + z * width_;
+			const float* row1 = row0 + width_;
+			Bounds* bounds = base.bounds.data() + z * base.width;
+			for (size_t x = 0; x < base.width; ++x) {
+				bounds[x].min = std::min(std::min(row0[x], row0[x + 1]), std::min(row1[x], row1[x + 1]));
+				bounds[x].max = std::max(std::max(row0[x], row0[x + 1]), std::max(row1[x], row1[x + 1]));
+			}
+		}
+	});
+	levels_.push_back(std::move(base));
+
+	// 上の段は下の段の2x2個(端では1個か2個)をまとめる。地形全体が1つのセルになるまで積む
+	while (levels_.back().width > 1 || levels_.back().depth > 1) {
+		const Level& lower = levels_.back();
+		Level upper;
+		upper.width = (lower.width + 1) / 2;
+		upper.depth = (lower.depth + 1) / 2;
+		upper.bounds.resize(static_cast<size_t>(upper.width) * upper.depth);
+		ForEachRange(pool_, upper.depth, kRowGrain, [&](size_t begin, size_t end) {
+			for (size_t z = begin; z < end; ++z) {
+				for (size_t x = 0; x < upper.width; ++x) {
+					Bounds bounds = lower.bounds[(z * 2) * lower.width + x * 2];
+					for (size_t childZ = z * 2; childZ < std::min<size_t>(z * 2 + 2, lower.depth); ++childZ) {
+						for (size_t childX = x * 2; childX < std::min<size_t>(x * 2 + 2, lower.width); ++childX) {
+							const Bounds& child = lower.bounds[childZ * lower.width + childX];
+							bounds.min = std::min(bounds.min, child.min);
+							bounds.max = std::max(bounds.max, child.max);
+						}
+					}
+					upper.bounds[z * upper.width + x] = bounds;
+				}
+			}
+		});
+		levels_.push_back(std::move(upper));
+	}
+
+	statistics_ = {};
+	statistics_.width = width;
+	statistics_.depth = depth;
+	statistics_.levelCount = static_cast<uint32_t>(levels_.size());
+	statistics_.minHeight = levels_.back().bounds[0].min;
+	statistics_.maxHeight = levels_.back().bounds[0].max;
+	statistics_.buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Heightfield::GetCellTriangles(uint32_t x, uint32_t z, Triangle (&triangles)[2]) const {
+	auto vertex = [this](uint32_t vx, uint32_t vz) {
+		return Vector3{ origin_.x + static_cast<float>(vx) * cellSize_, origin_.y + GetVertexHeight(vx, vz), origin_.z + static_cast<float>(vz) * cellSize_ };
+	};
+	const Vector3 v00 = vertex(x, z);
+	const Vector3 v10 = vertex(x + 1, z);
+	const Vector3 v01 = vertex(x, z + 1);
+	const Vector3 v11 = vertex(x + 1, z + 1);
+	// どちらも上から見て面の法線が上を向く順番
+	triangles[0] = { { v00, v01, v11 }, 0 };
+	triangles[1] = { { v00, v11, v10 }, 0 };
+}
+#pragma endregion
+
+#pragma region 高さと法線
+void Heightfield::Locate(float gridX, float gridZ, uint32_t& cellX, uint32_t& cellZ, float& fractionX, float& fractionZ) const {
+	const float maxX = static_cast<float>(width_ - 1);
+	const float maxZ = static_cast<float>(depth_ - 1);
+	gridX = std::clamp(gridX, 0.0f, maxX);
+	gridZ = std::clamp(gridZ, 0.0f, maxZ);
+	cellX = std::min(static_cast<uint32_t>(gridX), width_ - 2);
+	cellZ = std::min(static_cast<uint32_t>(gridZ), depth_ - 2);
+	fractionX = gridX - static_cast<float>(cellX);
+	fractionZ = gridZ - static_cast<float>(cellZ);
+}
+
+float Heightfield::Interpolate(uint32_t cellX, uint32_t cellZ, float fractionX, float fractionZ, Vector3* normal) const {
+	const float* row0 = heights_.data() + static_cast<size_t>(cellZ) * width_ + cellX;
+	const float* row1 = row0 + width_;
+	const float h00 = row0[0];
+	const float h10 = row0[1];
+	const float h01 = row1[0];
+	const float h11 = row1[1];
+	// 対角線より右下(x >= z)は三角形(00, 11, 10)、左上は三角形(00, 01, 11)
+	float slopeX;
+	float slopeZ;
+	if (fractionX >= fractionZ) {
+		slopeX = h10 - h00;
+		slopeZ = h11 - h10;
+	} else {
+		slopeX = h11 - h01;
+		slopeZ = h01 - h00;
+	}
+	if (normal != nullptr) {
+		*normal = Normalize(Vector3{ -slopeX, cellSize_, -slopeZ });
+	}
+	return origin_.y + h00 + slopeX * fractionX + slopeZ * fractionZ;
+}
+
+float Heightfield::GetHeight(float x, float z) const {
+	uint32_t cellX, cellZ;
+	float fractionX, fractionZ;
+	Locate(ToGridX(x), ToGridZ(z), cellX, cellZ, fractionX, fractionZ);
+	return Interpolate(cellX, cellZ, fractionX, fractionZ, nullptr);
+}
+
+Vector3 Heightfield::GetNormal(float x, float z) const {
+	Vector3 normal;
+	Sample(x, z, normal);
+	return normal;
+}
+
+float Heightfield::Sample(float x, float z, Vector3& normal) const {
+	uint32_t cellX, cellZ;
+	float fractionX, fractionZ;
+	Locate(ToGridX(x), ToGridZ(z), cellX, cellZ, fractionX, fractionZ);
+	return Interpolate(cellX, cellZ, fractionX, fractionZ, &normal);
+}
+
+void Heightfield::Sample(std::span<const Vector3> points, std::span<float> heights, std::span<Vector3> normals) const {
+	MT4_PROFILE_ZONE("Heightfield::Sample");
+	assert(heights.size() >= points.size());
+	assert(normals.empty() || normals.size() >= points.size());
+	const bool withNormals = !normals.empty();
+	ForEachRange(pool_, points.size(), kSampleGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			uint32_t cellX, cellZ;
+			float fractionX, fractionZ;
+			Locate(ToGridX(points[i].x), ToGridZ(points[i].z), cellX, cellZ, fractionX, fractionZ);
+			heights[i] = Interpolate(cellX, cellZ, fractionX, fractionZ, withNormals ? &normals[i] : nullptr);
+		}
+	});
+}
+#pragma endregion
+
+#pragma region レイキャスト
+bool Heightfield::IntersectCell(uint32_t cellX, uint32_t cellZ, const Segment& segment, float& t, Vector3& normal) const {
+	Triangle triangles[2];
+	GetCellTriangles(cellX, cellZ, triangles);
+	bool hit = false;
+	for (const Triangle& triangle : triangles) {
+		if (IntersectTriangle(segment, triangle, t)) {
+			normal = FaceNormal(triangle);
+			hit = true;
+		}
+	}
+	return hit;
+}
+
+bool Heightfield::RayCast(const Segment& segment, Hit& hit) const {
+	hit = { 1.0f, {}, kNoHit, kNoHit };
+	if (levels_.empty()) {
+		return false;
+	}
+	// 格子座標での線分(yはそのまま)
+	const float originX = ToGridX(segment.origin.x);
+	const float originZ = ToGridZ(segment.origin.z);
+	const float directionX = segment.diff.x * inverseCellSize_;
+	const float directionZ = segment.diff.z * inverseCellSize_;
+	const float originY = segment.origin.y;
+	const float directionY = segment.diff.y;
+
+	// 地形全体を囲む箱で線分を切り詰める
+	float tMin = 0.0f;
+	float tMax = 1.0f;
+	auto clip = [&](float origin, float direction, float min, float max) {
+		if (direction == 0.0f) {
+			return origin >= min && origin <= max;
+		}
+		float t0 = (min - origin) / direction;
+		float t1 = (max - origin) / direction;
+		if (t0 > t1) {
+			std::swap(t0, t1);
+		}
+		tMin = std::max(tMin, t0);
+		tMax = std::min(tMax, t1);
+		return tMin <= tMax;
+	};
+	const uint32_t topLevel = static_cast<uint32_t>(levels_.size() - 1);
+	const Bounds& root = levels_[topLevel].bounds[0];
+	if (!clip(originX, directionX, 0.0f, static_cast<float>(width_ - 1)) ||
+		!clip(originZ, directionZ, 0.0f, static_cast<float>(depth_ - 1)) ||
+		!clip(originY, directionY, origin_.y + root.min, origin_.y + root.max)) {
+		return false;
+	}
+
+	// 格子は整数のセル番号でたどる(Amanatides-Wooの方法)。段levelのセルは一番下のセル番号をlevelだけシフトしたもの
+	// tから位置を求め直してセルを決めると、格子座標が大きい所では境目を越えられずに同じセルを繰り返すことがある
+	const uint32_t cellCountX = width_ - 1;
+	const uint32_t cellCountZ = depth_ - 1;
+	const int32_t stepX = directionX > 0.0f ? 1 : (directionX < 0.0f ? -1 : 0);
+	const int32_t stepZ = directionZ > 0.0f ? 1 : (directionZ < 0.0f ? -1 : 0);
+	auto cellOf = [](float coordinate, uint32_t cellCount) {
+		return static_cast<uint32_t>(std::clamp(std::floor(coordinate), 0.0f, static_cast<float>(cellCount - 1)));
+	};
+	// 段levelのセルを進む向きの境目(整数の格子座標)で出るt
+	auto exitT = [](uint32_t cell, int32_t step, float origin, float direction, uint32_t level) {
+		if (step == 0) {
+			return std::numeric_limits<float>::infinity();
+		}
+		const uint32_t coarse = cell >> level;
+		const uint32_t boundary = (step > 0 ? coarse + 1 : coarse) << level;
+		return (static_cast<float>(boundary) - origin) / direction;
+	};
+	// 境目を越えなかった方の軸の、tの位置の一番下のセル。段levelの今のセルの中で、戻らない向きに限る
+	auto follow = [](uint32_t cell, int32_t step, float coordinate, uint32_t level, uint32_t cellCount) {
+		if (step == 0) {
+			return cell;
+		}
+		const uint32_t first = (cell >> level) << level;
+		const uint32_t last = std::min(first + (1u << level), cellCount) - 1;
+		const uint32_t low = step > 0 ? cell : first;
+		const uint32_t high = step > 0 ? last : cell;
+		return static_cast<uint32_t>(std::clamp(std::floor(coordinate), static_cast<float>(low), static_cast<float>(high)));
+	};
+
+	// 今いる段のセルが線分の高さの範囲と重なれば1つ下の段へ降り、重ならなければ先に境目に着く軸のセルを1つ進める
+	// 進んだ先が親のセルの外なら、新しいセルを粗い段から調べ直すため段を上がる
+	// 進む軸のセル番号は必ず1つ以上進み、もう一方の軸も戻らないので、線分が長くても必ず終わる
+	uint32_t level = topLevel;
+	float t = tMin;
+	uint32_t cellX = cellOf(originX + directionX * t, cellCountX);
+	uint32_t cellZ = cellOf(originZ + directionZ * t, cellCountZ);
+	for (;;) {
+		const Level& current = levels_[level];
+		const uint32_t x = cellX >> level;
+		const uint32_t z = cellZ >> level;
+		const float tExitX = exitT(cellX, stepX, originX, directionX, level);
+		const float tExitZ = exitT(cellZ, stepZ, originZ, directionZ, level);
+		const float tExit = std::min({ tMax, tExitX, tExitZ });
+		const float y0 = originY + directionY * t;
+		const float y1 = originY + directionY * tExit;
+		const Bounds& bounds = current.bounds[static_cast<size_t>(z) * current.width + x];
+		if (std::max(y0, y1) >= origin_.y + bounds.min && std::min(y0, y1) <= origin_.y + bounds.max) {
+			if (level > 0) {
+				--level;
+				continue;
+			}
+			// このセルの三角形はセルの中にしかないので、交われば一番近い交点になる
+			if (IntersectCell(cellX, cellZ, segment, hit.t, hit.normal)) {
+				hit.cellX = cellX;
+				hit.cellZ = cellZ;
+				return true;
+			}
+		}
+		if (tExit >= tMax) {
+			break;
+		}
+		uint32_t nextX = cellX;
+		uint32_t nextZ = cellZ;
+		if (tExitX <= tExitZ) {
+			if (stepX > 0 ? ((x + 1) << level) >= cellCountX : x == 0) {
+				break;
+			}
+			nextX = stepX > 0 ? (x + 1) << level : (x << level) - 1;
+			nextZ = follow(cellZ, stepZ, originZ + directionZ * tExit, level, cellCountZ);
+		} else {
+			if (stepZ > 0 ? ((z + 1) << level) >= cellCountZ : z == 0) {
+				break;
+			}
+			nextZ = stepZ > 0 ? (z + 1) << level : (z << level) - 1;
+			nextX = follow(cellX, stepX, originX + directionX * tExit, level, cellCountX);
+		}
+		t = std::max(t, tExit);
+		while (level < topLevel && ((nextX >> (level + 1)) != (cellX >> (level + 1)) || (nextZ >> (level + 1)) != (cellZ >> (level + 1)))) {
+			++level;
+		}
+		cellX = nextX;
+		cellZ = nextZ;
+	}
+	return false;
+}
+
+void Heightfield::RayCast(std::span<const Segment> segments, std::span<Hit> hits) const {
+	MT4_PROFILE_ZONE("Heightfield::RayCast");
+	assert(hits.size() >= segments.size());
+	ForEachRange(pool_, segments.size(), kRayGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			RayCast(segments[i], hits[i]);
+		}
+	});
+}
+#pragma endregion
+
+#pragma region 球との判定
+template<typename Function>
+void Heightfield::ForEachCell(const AABB& bounds, Function&& function) const {
+	if (levels_.empty()) {
+		return;
+	}
+	const float minX = ToGridX(bounds.min.x);
+	const float maxX = ToGridX(bounds.max.x);
+	const float minZ = ToGridZ(bounds.min.z);
+	const float maxZ = ToGridZ(bounds.max.z);
+	if (maxX < 0.0f || maxZ < 0.0f || minX > static_cast<float>(width_ - 1) || minZ > static_cast<float>(depth_ - 1)) {
+		return;
+	}
+	const uint32_t x0 = static_cast<uint32_t>(std::clamp(minX, 0.0f, static_cast<float>(width_ - 2)));
+	const uint32_t x1 = static_cast<uint32_t>(std::clamp(maxX, 0.0f, static_cast<float>(width_ - 2)));
+	const uint32_t z0 = static_cast<uint32_t>(std::clamp(minZ, 0.0f, static_cast<float>(depth_ - 2)));
+	const uint32_t z1 = static_cast<uint32_t>(std::clamp(maxZ, 0.0f, static_cast<float>(depth_ - 2)));
+	const float minY = bounds.min.y - origin_.y;
+	const float maxY = bounds.max.y - origin_.y;
+
+	// 範囲が縦横2セル以内に収まる段から始めて、高さが重なるセルだけ下の段へ降りる
+	const uint32_t topLevel = static_cast<uint32_t>(levels_.size() - 1);
+	uint32_t startLevel = 0;
+	while (startLevel < topLevel && ((x1 >> startLevel) - (x0 >> startLevel) > 1 || (z1 >> startLevel) - (z0 >> startLevel) > 1)) {
+		++startLevel;
+	}
+	struct Entry {
+		uint32_t level;
+		uint32_t x;
+		uint32_t z;
+	};
+	Entry stack[kCellStackSize];
+	uint32_t count = 0;
+	for (uint32_t z = z0 >> startLevel; z <= (z1 >> startLevel); ++z) {
+		for (uint32_t x = x0 >> startLevel; x <= (x1 >> startLevel); ++x) {
+			stack[count++] = { startLevel, x, z };
+		}
+	}
+	while (count > 0) {
+		const Entry entry = stack[--count];
+		const Level& level = levels_[entry.level];
+		const Bounds& cell = level.bounds[static_cast<size_t>(entry.z) * level.width + entry.x];
+		if (cell.max < minY || cell.min > maxY) {
+			continue;
+		}
+		if (entry.level == 0) {
+			function(entry.x, entry.z);
+			continue;
+		}
+		const uint32_t childLevel = entry.level - 1;
+		const Level& child = levels_[childLevel];
+		for (uint32_t z = entry.z * 2; z < std::min(entry.z * 2 + 2, child.depth); ++z) {
+			for (uint32_t x = entry.x * 2; x < std::min(entry.x * 2 + 2, child.width); ++x) {
+				if (x >= (x0 >> childLevel) && x <= (x1 >> childLevel) && z >= (z0 >> childLevel) && z <= (z1 >> childLevel)) {
+					assert(count < kCellStackSize);
+					stack[count++] = { childLevel, x, z };
+				}
+			}
+		}
+	}
+}
+
+bool Heightfield::IsCollision(const Sphere& sphere, Contact& contact) const {
+	if (levels_.empty()) {
+		return false;
+	}
+	// 中心が地形の下にあれば、中心の真上の面の法線の向きに押し出す
+	const float gridX = ToGridX(sphere.center.x);
+	const float gridZ = ToGridZ(sphere.center.z);
+	const bool inside = gridX >= 0.0f && gridX <= static_cast<float>(width_ - 1) && gridZ >= 0.0f && gridZ <= static_cast<float>(depth_ - 1);
+	uint32_t centerX = kNoHit;
+	uint32_t centerZ = kNoHit;
+	if (inside) {
+		float fractionX, fractionZ;
+		Locate(gridX, gridZ, centerX, centerZ, fractionX, fractionZ);
+		Vector3 normal;
+		const float height = Interpolate(centerX, centerZ, fractionX, fractionZ, &normal);
+		if (sphere.center.y < height) {
+			// 面までの距離
+			const float distance = (height - sphere.center.y) * normal.y;
+			contact.normal = -normal;
+			contact.depth = sphere.radius + distance;
+			contact.point = sphere.center + normal * ((distance - sphere.radius) * 0.5f);
+			return true;
+		}
+	}
+
+	// 球に重なるセルの三角形の中で一番近い点
+	float bestDistanceSquared = sphere.radius * sphere.radius;
+	Vector3 bestPoint = {};
+	Vector3 bestNormal = {};
+	bool found = false;
+	auto testCell = [&](uint32_t x, uint32_t z) {
+		Triangle triangles[2];
+		GetCellTriangles(x, z, triangles);
+		for (const Triangle& triangle : triangles) {
+			// 三角形を含む平面から今の一番近い距離より離れていれば、三角形の最近接点を求めるまでもない
+			const Vector3 normal = Cross(triangle.vertex[1] - triangle.vertex[0], triangle.vertex[2] - triangle.vertex[0]);
+			const float planeDistance = Dot(sphere.center - triangle.vertex[0], normal);
+			if (planeDistance * planeDistance >= bestDistanceSquared * Dot(normal, normal)) {
+				continue;
+			}
+			const Vector3 closest = ClosestPoint(triangle, sphere.center);
+			const Vector3 offset = closest - sphere.center;
+			const float distanceSquared = Dot(offset, offset);
+			if (distanceSquared < bestDistanceSquared) {
+				bestDistanceSquared = distanceSquared;
+				bestPoint = closest;
+				bestNormal = Normalize(normal);
+				found = true;
+			}
+		}
+	};
+	// 中心の真下のセルを先に調べ、残りはその距離の範囲だけ探す(半径がセルより大きいと調べるセルがかなり減る)
+	if (inside) {
+		testCell(centerX, centerZ);
+	}
+	const float reach = std::sqrt(bestDistanceSquared);
+	const Vector3 extent = { reach, reach, reach };
+	ForEachCell(AABB{ sphere.center - extent, sphere.center + extent, 0 }, [&](uint32_t x, uint32_t z) {
+		if (x != centerX || z != centerZ) {
+			testCell(x, z);
+		}
+	});
+	if (!found) {
+		return false;
+	}
+	const float distance = std::sqrt(bestDistanceSquared);
+	// 中心が面の上にあるときは面の向きを使う
+	contact.normal = distance > 1.0e-6f ? (bestPoint - sphere.center) * (1.0f / distance) : -bestNormal;
+	contact.depth = sphere.radius - distance;
+	contact.point = (bestPoint + sphere.center + contact.normal * sphere.radius) * 0.5f;
+	return true;
+}
+
+bool Heightfield::SweepSphere(const Sphere& sphere, const Vector3& displacement, Impact& impact) const {
+	const Vector3 extent = { sphere.radius, sphere.radius, sphere.radius };
+	const Vector3 end = sphere.center + displacement;
+	const AABB bounds = {
+		Vector3{ std::min(sphere.center.x, end.x), std::min(sphere.center.y, end.y), std::min(sphere.center.z, end.z) } - extent,
+		Vector3{ std::max(sphere.center.x, end.x), std::max(sphere.center.y, end.y), std::max(sphere.center.z, end.z) } + extent,
+		0,
+	};
+	bool hit = false;
+	impact.time = 1.0f;
+	ForEachCell(bounds, [&](uint32_t x, uint32_t z) {
+		Triangle triangles[2];
+		GetCellTriangles(x, z, triangles);
+		for (const Triangle& triangle : triangles) {
+			Impact candidate;
+			if (::SweepSphere(sphere, displacement, triangle, candidate) && (!hit || candidate.time < impact.time)) {
+				impact = candidate;
+				hit = true;
+			}
+		}
+	});
+	return hit;
+}
+#pragma endregion
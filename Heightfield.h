@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Collision.h"
+#include "Struct.h"
+
+class ThreadPool;
+
+// 一様な格子の高さで表した地形(TerrainVS.hlslで描く地形のCPU側)
+// 頂点(x, z)の位置は origin + (x * cellSize, heights[z * width + x], z * cellSize)
+// セルは頂点(x, z)から(x + 1, z + 1)への対角線で2つの三角形に分ける(地形のメッシュと同じ分け方なので、当たり判定と見た目がずれない)
+// セルごとの高さの最小・最大を、2x2ずつまとめた段(ミップ)に積み上げておき、
+//   レイキャストは粗い段から格子をたどり(階層的なDDA)、線分の高さの範囲と重ならない段のセルは中を調べずに飛ばす
+//   球との判定は球の範囲に重なるセルだけを、高さの範囲で絞り込んでから三角形と判定する
+// 地形より下は中身の詰まった空間として扱う(中心が地形の下にある球は上へ押し出す)
+class Heightfield {
+public:
+	static constexpr uint32_t kNoHit = 0xFFFFFFFF;
+
+	// 線分と地形の一番近い交点
+	struct Hit {
+		float t;        // 線分上の割合(0～1)。交点 = origin + diff * t
+		Vector3 normal; // 交わった三角形の面の法線(上向き)
+		uint32_t cellX; // 交わったセル。交わらなければkNoHit
+		uint32_t cellZ;
+	};
+
+	// 直近のBuildの統計
+	struct Statistics {
+		uint32_t width;      // 頂点の数
+		uint32_t depth;
+		uint32_t levelCount; // 最小・最大の段の数(一番下はセルごと、一番上は地形全体)
+		float minHeight;
+		float maxHeight;
+		double buildSeconds;
+	};
+
+	// nullptrなら呼び出したスレッドだけで処理する
+	void SetThreadPool(ThreadPool* pool) { pool_ = pool; }
+
+	// 高さの配列(width * depth個、x方向が先に並ぶ)から作り直す。width, depthは2以上
+	void Build(std::span<const float> heights, uint32_t width, uint32_t depth, const Vector3& origin, float cellSize);
+
+	uint32_t GetWidth() const { return width_; }
+	uint32_t GetDepth() const { return depth_; }
+	const Vector3& GetOrigin() const { return origin_; }
+	float GetCellSize() const { return cellSize_; }
+	float GetVertexHeight(uint32_t x, uint32_t z) const { return heights_[static_cast<size_t>(z) * width_ + x]; }
+	// セル(x, z)の2つの三角形(TriangleBVHに渡すメッシュや描画用)
+	void GetCellTriangles(uint32_t x, uint32_t z, Triangle (&triangles)[2]) const;
+
+	// 点(x, z)の地形の高さと法線(三角形の面の法線)。地形の外は一番近い端の値にする
+	float GetHeight(float x, float z) const;
+	Vector3 GetNormal(float x, float z) const;
+	float Sample(float x, float z, Vector3& normal) const;
+	// 点のx, zでの高さと法線をまとめて求める。normalsが空なら高さだけ求める
+	void Sample(std::span<const Vector3> points, std::span<float> heights, std::span<Vector3> normals) const;
+
+	// 線分と一番近くで交わる点を求める。交わらなければfalseを返し、hit.cellXはkNoHitになる
+	// 三角形は両面。線分の終点ちょうど(t == 1)で交わる場合は交わらない扱いになる(TriangleBVHと同じ)
+	bool RayCast(const Segment& segment, Hit& hit) const;
+	void RayCast(std::span<const Segment> segments, std::span<Hit> hits) const;
+
+	// 球と地形の一番深い接触。法線は球から地形へ向かう向き(Collision.hのIsCollisionと同じ)
+	bool IsCollision(const Sphere& sphere, Contact& contact) const;
+	// 動く球が地形に最初に接する時刻を求める(Collision.hのSweepSphereと同じ)
+	bool SweepSphere(const Sphere& sphere, const Vector3& displacement, Impact& impact) const;
+
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private:
+	// セル(またはまとめたセル)の高さの範囲
+	struct Bounds {
+		float min;
+		float max;
+	};
+
+	// 1つの段。段levelのセル(x, z)は、一番下のセル(x << level, z << level)から2^level個ずつをまとめたもの
+	struct Level {
+		uint32_t width;
+		uint32_t depth;
+		std::vector<Bounds> bounds;
+	};
+
+	// 格子座標(頂点の番号を単位にした座標)
+	float ToGridX(float x) const { return (x - origin_.x) * inverseCellSize_; }
+	float ToGridZ(float z) const { return (z - origin_.z) * inverseCellSize_; }
+	// 格子座標の点のセルとセル内の位置(0～1)。地形の外は端のセルに寄せる
+	void Locate(float gridX, float gridZ, uint32_t& cellX, uint32_t& cellZ, float& fractionX, float& fractionZ) const;
+	// セルの中の点の高さと法線
+	float Interpolate(uint32_t cellX, uint32_t cellZ, float fractionX, float fractionZ, Vector3* normal) const;
+	// 線分とセルの2つの三角形の一番近い交点。交わればtとnormalを書き換える
+	bool IntersectCell(uint32_t cellX, uint32_t cellZ, const Segment& segment, float& t, Vector3& normal) const;
+
+	// boundsに重なり、高さの範囲がboundsのyと重なる一番下のセルを全てfunction(x, z)に渡す
+	template<typename Function>
+	void ForEachCell(const AABB& bounds, Function&& function) const;
+
+	std::vector<float> heights_;
+	std::vector<Level> levels_;
+	uint32_t width_ = 0;
+	uint32_t depth_ = 0;
+	Vector3 origin_ = {};
+	float cellSize_ = 1.0f;
+	float inverseCellSize_ = 1.0f;
+	ThreadPool* pool_ = nullptr;
+	Statistics statistics_ = {};
+};
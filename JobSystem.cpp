@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <assert.h>
+#include <string>
+#include "JobSystem.h"
+#include "Profiler.h"
+
+namespace {
+// スレッドごとのキューに入る仕事の数(2のべき乗)。溢れた分は積んだスレッドがその場で実行する
+constexpr int64_t kQueueCapacity = 4096;
+// 眠る前に仕事を探し直す回数
+constexpr uint32_t kSpinCount = 64;
+// grainを自動で決めるときの、1スレッドあたりの区切りの数(区切りごとの重さのばらつきを盗み合いでならす)
+constexpr size_t kAutoChunksPerThread = 4;
+
+static_assert((kQueueCapacity & (kQueueCapacity - 1)) == 0, "kQueueCapacityは2のべき乗にすること");
+
+// 呼び出したスレッドがどのジョブシステムの何番のワーカーか
+thread_local const JobSystem* currentSystem = nullptr;
+thread_local uint32_t currentThreadIndex = 0;
+
+// 呼び出したスレッドのスタック上で、区切りを処理しているか手伝いを待っているParallelFor(内側から外側へ辿る)
+struct ActiveParallelFor {
+	const void* state;
+	const ActiveParallelFor* outer;
+};
+thread_local const ActiveParallelFor* activeParallelFor = nullptr;
+
+// スコープの間、stateをこのスレッドで処理中のParallelForとして登録する
+class ActiveParallelForScope {
+public:
+	explicit ActiveParallelForScope(const void* state) : node_{ state, activeParallelFor } { activeParallelFor = &node_; }
+	~ActiveParallelForScope() { activeParallelFor = node_.outer; }
+
+	ActiveParallelForScope(const ActiveParallelForScope&) = delete;
+	ActiveParallelForScope& operator=(const ActiveParallelForScope&) = delete;
+
+private:
+	ActiveParallelFor node_;
+};
+
+bool IsActiveParallelFor(const void* state) {
+	for (const ActiveParallelFor* active = activeParallelFor; active != nullptr; active = active->outer) {
+		if (active->state == state) {
+			return true;
+		}
+	}
+	return false;
+}
+}
+
+#pragma region 仕事とキュー
+struct JobSystem::Work {
+	virtual ~Work() = default;
+	virtual void Run(JobSystem& system, uint32_t threadIndex) = 0;
+	// ParallelForの手伝いなら、そのParallelForの状態(自分の手伝いを見分けるのに使う)
+	const ParallelForState* owner = nullptr;
+};
+
+struct JobSystem::Job : JobSystem::Work {
+	JobFunction function;
+	Counter* counter = nullptr;
+	std::vector<Job*> successors;
+	// 終わっていない前提のジョブの数(Submitされるまでは1多い)
+	std::atomic<uint32_t> pending{ 1 };
+	bool submitted = false;
+
+	void Run(JobSystem& system, uint32_t threadIndex) override {
+		{
+			MT4_PROFILE_ZONE("JobSystem::Job");
+			function(threadIndex);
+		}
+		system.Finish(this, threadIndex);
+	}
+};
+
+struct JobSystem::ParallelForState {
+	const RangeFunction* function;
+	size_t count;
+	size_t grain;
+	std::atomic<size_t> next{ 0 };
+	// 終わった(または取り戻した)手伝いの数
+	std::atomic<uint32_t> finished{ 0 };
+
+	// 区切りを取れるだけ取って処理する
+	void RunChunks(uint32_t threadIndex) {
+		MT4_PROFILE_ZONE("JobSystem::ParallelFor");
+		for (;;) {
+			size_t begin = next.fetch_add(grain, std::memory_order_relaxed);
+			if (begin >= count) {
+				return;
+			}
+			(*function)(begin, std::min(begin + grain, count), threadIndex);
+		}
+	}
+};
+
+struct JobSystem::RangeWork : JobSystem::Work {
+	void Run(JobSystem&, uint32_t threadIndex) override {
+		ParallelForState* state = const_cast<ParallelForState*>(owner);
+		{
+			ActiveParallelForScope active(state);
+			state->RunChunks(threadIndex);
+		}
+		state->finished.fetch_add(1, std::memory_order_release);
+	}
+};
+
+#ifdef _MSC_VER
+// キャッシュラインを分けるための詰め物はわざとなので、C4324(alignasで詰め物が入った)は出さない
+#pragma warning(push)
+#pragma warning(disable: 4324)
+#endif
+// Chase-Levの両端キュー(Lê, Pop, Cohen, Zappa Nardelli "Correct and Efficient Work-Stealing for Weak Memory Models"の配列の大きさを固定した版)
+// Push・Popは持ち主のスレッドだけが、Stealはどのスレッドからでも呼べる
+class JobSystem::WorkQueue {
+public:
+	// 一杯ならfalseを返す
+	bool Push(Work* work) {
+		const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+		const int64_t top = top_.load(std::memory_order_acquire);
+		if (bottom - top >= kQueueCapacity) {
+			return false;
+		}
+		buffer_[bottom & (kQueueCapacity - 1)].store(work, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// 一番最近積んだものを取る。空ならnullptr
+	Work* Pop() {
+		const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+		bottom_.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = top_.load(std::memory_order_relaxed);
+		Work* work = nullptr;
+		if (top <= bottom) {
+			work = buffer_[bottom & (kQueueCapacity - 1)].load(std::memory_order_relaxed);
+			if (top == bottom) {
+				// 最後の1つはStealと取り合うので、topを進められた方が取る
+				if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					work = nullptr;
+				}
+				bottom_.store(bottom + 1, std::memory_order_relaxed);
+			}
+		} else {
+			bottom_.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return work;
+	}
+
+	// 一番古いものを盗む。空か、他のスレッドと取り合って負けたらnullptr
+	Work* Steal() {
+		int64_t top = top_.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t bottom = bottom_.load(std::memory_order_acquire);
+		if (top >= bottom) {
+			return nullptr;
+		}
+		Work* work = buffer_[top & (kQueueCapacity - 1)].load(std::memory_order_relaxed);
+		if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return nullptr;
+		}
+		return work;
+	}
+
+private:
+	// topは盗むスレッドが、bottomは持ち主が書くので、キャッシュラインを分けておく
+	alignas(64) std::atomic<int64_t> top_{ 0 };
+	alignas(64) std::atomic<int64_t> bottom_{ 0 };
+	std::atomic<Work*> buffer_[kQueueCapacity];
+};
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+#pragma endregion
+
+#pragma region 起動と終了
+JobSystem::JobSystem(uint32_t threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	queues_.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		queues_.push_back(std::make_unique<WorkQueue>());
+	}
+	// 呼び出し側も作業するので、起動するのは1つ少ない数
+	workers_.reserve(threadCount - 1);
+	for (uint32_t i = 1; i < threadCount; ++i) {
+		workers_.emplace_back(&JobSystem::WorkerMain, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_.store(true, std::memory_order_seq_cst);
+	}
+	wakeCondition_.notify_all();
+	for (std::thread& worker : workers_) {
+		worker.join();
+	}
+}
+
+JobSystem& JobSystem::GetDefault() {
+	static JobSystem jobSystem;
+	return jobSystem;
+}
+
+uint32_t JobSystem::GetCurrentThreadIndex() const {
+	return currentSystem == this ? currentThreadIndex : 0;
+}
+
+void JobSystem::WorkerMain(uint32_t threadIndex) {
+	currentSystem = this;
+	currentThreadIndex = threadIndex;
+	MT4_PROFILE_THREAD_NAME("JobSystem " + std::to_string(threadIndex));
+	uint32_t idle = 0;
+	while (!quit_.load(std::memory_order_acquire)) {
+		if (Work* work = FindWork(threadIndex)) {
+			Execute(work, threadIndex);
+			idle = 0;
+			continue;
+		}
+		if (++idle < kSpinCount) {
+			std::this_thread::yield();
+			continue;
+		}
+		// 眠る直前にもう一度数を確かめる。Push側はsleepingCount_を見てから起こすので、取りこぼさない
+		idle = 0;
+		std::unique_lock<std::mutex> lock(mutex_);
+		sleepingCount_.fetch_add(1, std::memory_order_seq_cst);
+		wakeCondition_.wait(lock, [this] {
+			return quit_.load(std::memory_order_seq_cst) || queuedCount_.load(std::memory_order_seq_cst) > 0;
+		});
+		sleepingCount_.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+#pragma endregion
+
+#pragma region 仕事の受け渡し
+void JobSystem::Push(uint32_t threadIndex, Work* work) {
+	if (!queues_[threadIndex]->Push(work)) {
+		Execute(work, threadIndex);
+		return;
+	}
+	queuedCount_.fetch_add(1, std::memory_order_seq_cst);
+	if (sleepingCount_.load(std::memory_order_seq_cst) > 0) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		wakeCondition_.notify_one();
+	}
+}
+
+JobSystem::Work* JobSystem::FindWork(uint32_t threadIndex) {
+	Work* work = queues_[threadIndex]->Pop();
+	const uint32_t queueCount = static_cast<uint32_t>(queues_.size());
+	for (uint32_t i = 1; work == nullptr && i < queueCount; ++i) {
+		work = queues_[(threadIndex + i) % queueCount]->Steal();
+	}
+	if (work != nullptr) {
+		queuedCount_.fetch_sub(1, std::memory_order_relaxed);
+	}
+	return work;
+}
+
+void JobSystem::Execute(Work* work, uint32_t threadIndex) {
+	work->Run(*this, threadIndex);
+}
+
+bool JobSystem::HelpWhileWaiting(uint32_t threadIndex) {
+	Work* work = FindWork(threadIndex);
+	if (work == nullptr) {
+		return false;
+	}
+	if (work->owner != nullptr && IsActiveParallelFor(work->owner)) {
+		// このスレッドで処理中のParallelForの手伝いは実行せずに終わったことにする
+		// 残りの区切りはスタック上のRunChunksが取り切るので取りこぼさず、同じParallelForの区切りが入れ子に動くことも無い
+		const_cast<ParallelForState*>(work->owner)->finished.fetch_add(1, std::memory_order_release);
+		return true;
+	}
+	Execute(work, threadIndex);
+	return true;
+}
+#pragma endregion
+
+#pragma region 依存関係つきのジョブ
+JobSystem::Job* JobSystem::CreateJob(JobFunction function, Counter* counter) {
+	Job* job = new Job;
+	job->function = std::move(function);
+	job->counter = counter;
+	if (counter != nullptr) {
+		counter->value_.fetch_add(1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+void JobSystem::AddDependency(Job* prerequisite, Job* dependent) {
+	assert(!prerequisite->submitted && !dependent->submitted && "依存関係はSubmitする前につけること");
+	prerequisite->successors.push_back(dependent);
+	dependent->pending.fetch_add(1, std::memory_order_relaxed);
+}
+
+void JobSystem::Submit(Job* job) {
+	assert(!job->submitted);
+	job->submitted = true;
+	if (job->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		Push(GetCurrentThreadIndex(), job);
+	}
+}
+
+void JobSystem::Finish(Job* job, uint32_t threadIndex) {
+	for (Job* successor : job->successors) {
+		if (successor->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			Push(threadIndex, successor);
+		}
+	}
+	// 依存しているジョブを積んでからカウンタを減らす(同じカウンタで待っていても途中で抜けない)
+	Counter* counter = job->counter;
+	delete job;
+	if (counter != nullptr) {
+		counter->value_.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+void JobSystem::Wait(const Counter& counter) {
+	const uint32_t threadIndex = GetCurrentThreadIndex();
+	while (!counter.IsDone()) {
+		if (!HelpWhileWaiting(threadIndex)) {
+			std::this_thread::yield();
+		}
+	}
+}
+#pragma endregion
+
+#pragma region ParallelFor
+void JobSystem::ParallelFor(size_t count, size_t grain, const RangeFunction& function) {
+	if (count == 0) {
+		return;
+	}
+	const uint32_t threadCount = GetThreadCount();
+	if (grain == 0) {
+		const size_t chunks = static_cast<size_t>(threadCount) * kAutoChunksPerThread;
+		grain = std::max<size_t>((count + chunks - 1) / chunks, 1);
+	}
+	const size_t chunkCount = (count + grain - 1) / grain;
+	const uint32_t threadIndex = GetCurrentThreadIndex();
+	if (threadCount == 1 || chunkCount == 1) {
+		// 区切りが1つしか無ければ手伝いを積むだけ無駄なのでこのスレッドで済ませる
+		for (size_t begin = 0; begin < count; begin += grain) {
+			function(begin, std::min(begin + grain, count), threadIndex);
+		}
+		return;
+	}
+
+	// 手の空いたスレッドが盗んでいけるよう、手伝いを自分のキューに積んでから自分でも処理する
+	ParallelForState state;
+	ActiveParallelForScope active(&state);
+	state.function = &function;
+	state.count = count;
+	state.grain = grain;
+	const uint32_t helperCount = static_cast<uint32_t>(std::min<size_t>(chunkCount - 1, threadCount - 1));
+	std::unique_ptr<RangeWork[]> helpers(new RangeWork[helperCount]);
+	for (uint32_t i = 0; i < helperCount; ++i) {
+		helpers[i].owner = &state;
+		Push(threadIndex, &helpers[i]);
+	}
+	state.RunChunks(threadIndex);
+
+	// 区切りは全て取られたので、あとは他のスレッドが処理中の区切りを待つ。待つ間も他の仕事を手伝う
+	// 盗まれなかった手伝いは、区切りの中で積まれた仕事の下に埋もれていても、いずれ取り出されて終わったことになる
+	while (state.finished.load(std::memory_order_acquire) < helperCount) {
+		if (!HelpWhileWaiting(threadIndex)) {
+			std::this_thread::yield();
+		}
+	}
+}
+#pragma endregion
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ワークスティーリングのジョブシステム
+// スレッドごとにChase-Lev方式の両端キューを持ち、積んだスレッドは自分のキューの後ろから(最近積んだものから)取り、
+// 手の空いたスレッドは他のスレッドのキューの前から(古いものから)盗む。キューに積む・取るのにロックは使わない
+// ジョブには依存関係をつけられる。前提のジョブが全て終わったら自動で積まれるので、1フレームの更新をタスクグラフとして組める
+// ワーカー以外のスレッドはスレッド番号0として扱うので、ワーカー以外から呼び出すのは1つのスレッド(メインループ)だけにすること
+class JobSystem {
+public:
+	// ジョブの本体。実行しているスレッドの番号(0 ～ GetThreadCount() - 1)を受け取る
+	using JobFunction = std::function<void(uint32_t threadIndex)>;
+	// 範囲[begin, end)と、作業しているスレッドの番号を受け取る
+	using RangeFunction = std::function<void(size_t begin, size_t end, uint32_t threadIndex)>;
+
+	// 依存関係つきのジョブ。CreateJobで作り、Submitした後に終わると自動で破棄される
+	struct Job;
+
+	// 終わっていないジョブの数。CreateJobで渡すと増え、そのジョブが終わると減る
+	class Counter {
+	public:
+		bool IsDone() const { return value_.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+		std::atomic<uint32_t> value_{ 0 };
+	};
+
+	// threadCountは呼び出し側を含めたスレッド数。0なら論理コア数にする
+	explicit JobSystem(uint32_t threadCount = 0);
+	// 積まれたまま終わっていないジョブは実行されない。先にWaitで終わらせておくこと
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// 呼び出し側を含めたスレッド数
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(workers_.size()) + 1; }
+	// 呼び出したスレッドの番号。このジョブシステムのワーカーでなければ0
+	uint32_t GetCurrentThreadIndex() const;
+
+	// ジョブを作る(まだ実行しない)。counterがあれば、ジョブが終わるまでカウントを1増やしておく
+	Job* CreateJob(JobFunction function, Counter* counter = nullptr);
+	// dependentをprerequisiteが終わってから実行する。どちらもSubmitする前に呼ぶこと
+	void AddDependency(Job* prerequisite, Job* dependent);
+	// ジョブを実行できるようにする。前提のジョブが全て終わっていれば、すぐに呼び出したスレッドのキューに積む
+	// Submitした後のジョブはいつ破棄されるか分からないので、ポインタを使わないこと
+	void Submit(Job* job);
+	// counterが0になるまで、他のジョブを手伝いながら待つ
+	void Wait(const Counter& counter);
+
+	// [0, count)をgrain個ずつに区切って並列に処理し、全て終わるまで戻らない。呼び出したスレッドも作業に加わる
+	// grainを指定すると区切り方はスレッド数によらない。0ならスレッド数に合わせて自動で決める
+	// 待っている間は他の仕事を手伝うが、そのスレッドで処理中のParallelForの区切りは実行しないので、区切りの中から入れ子に呼んでもよく、
+	// 同じスレッド番号で同じParallelForの区切りが同時に動くことも無い(スレッドごとの作業領域を使える)
+	void ParallelFor(size_t count, size_t grain, const RangeFunction& function);
+
+	// アプリケーション全体で共有するジョブシステム
+	static JobSystem& GetDefault();
+
+private:
+	// キューに積む仕事(依存関係つきのジョブとParallelForの手伝い)
+	struct Work;
+	struct RangeWork;
+	struct ParallelForState;
+	class WorkQueue;
+
+	// 仕事を呼び出したスレッドのキューに積む。キューが一杯ならその場で実行する
+	void Push(uint32_t threadIndex, Work* work);
+	// 自分のキューから取るか、他のスレッドのキューから盗む
+	Work* FindWork(uint32_t threadIndex);
+	void Execute(Work* work, uint32_t threadIndex);
+	// 待っている間に仕事を1つ手伝う。仕事が無ければfalse
+	bool HelpWhileWaiting(uint32_t threadIndex);
+	// ジョブが終わったときに、依存しているジョブを積んでカウンタを減らす
+	void Finish(Job* job, uint32_t threadIndex);
+	void WorkerMain(uint32_t threadIndex);
+
+	std::vector<std::thread> workers_;
+	// スレッドごとのキュー(0番はワーカー以外のスレッド用)
+	std::vector<std::unique_ptr<WorkQueue>> queues_;
+
+	// 眠っているワーカーを起こす仕組み。キューにある仕事の数が0より大きければ眠らない
+	std::mutex mutex_;
+	std::condition_variable wakeCondition_;
+	std::atomic<int64_t> queuedCount_{ 0 };
+	std::atomic<uint32_t> sleepingCount_{ 0 };
+	std::atomic<bool> quit_{ false };
+};
@@ -0,0 +1,101 @@
+#include "MappedFile.h"
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+#if defined(_WIN32)
+bool MappedFile::Open(const std::string& path) {
+	Close();
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size = {};
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		return false;
+	}
+	file_ = file;
+	open_ = true;
+	size_ = static_cast<size_t>(size.QuadPart);
+	// 大きさ0のファイルはマップできないので、空のまま開いたことにする
+	if (size_ == 0) {
+		return true;
+	}
+	mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping_ != nullptr) {
+		data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (data_ == nullptr) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data_ != nullptr) {
+		UnmapViewOfFile(data_);
+	}
+	if (mapping_ != nullptr) {
+		CloseHandle(mapping_);
+	}
+	if (file_ != nullptr) {
+		CloseHandle(file_);
+	}
+	data_ = nullptr;
+	mapping_ = nullptr;
+	file_ = nullptr;
+	size_ = 0;
+	open_ = false;
+}
+#else
+bool MappedFile::Open(const std::string& path) {
+	Close();
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+	struct stat status = {};
+	if (fstat(file, &status) != 0) {
+		::close(file);
+		return false;
+	}
+	size_ = static_cast<size_t>(status.st_size);
+	if (size_ > 0) {
+		void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data == MAP_FAILED) {
+			::close(file);
+			size_ = 0;
+			return false;
+		}
+		// 先頭から順に読むので先読みさせる
+		madvise(data, size_, MADV_SEQUENTIAL);
+		data_ = static_cast<const char*>(data);
+	}
+	// マップした後はファイルを閉じてもよい
+	::close(file);
+	open_ = true;
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data_ != nullptr) {
+		munmap(const_cast<char*>(data_), size_);
+	}
+	data_ = nullptr;
+	size_ = 0;
+	open_ = false;
+}
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// 読み込み専用でメモリマップしたファイル
+// 読み込みのためのバッファを確保・コピーせず、ファイルの中身をそのままメモリとして読める
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// ファイルを開いてマップする(開いていたファイルは閉じる)。開けなければfalseを返す
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return open_; }
+	const char* GetData() const { return data_; }
+	size_t GetSize() const { return size_; }
+	std::string_view GetView() const { return { data_, size_ }; }
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	bool open_ = false;
+#if defined(_WIN32)
+	void* file_ = nullptr;
+	void* mapping_ = nullptr;
+#endif
+};
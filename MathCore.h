@@ -0,0 +1,300 @@
+#pragma once
+#include <assert.h>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include "Struct.h"
+
+// Vector3・Matrix4x4の基本演算(ヘッダーだけで完結するテンプレート)
+// 呼び出し側のループにインライン展開でき、floatやdoubleなら定数式でも使える
+// 成分の型Tには float, double, Simd::FloatPack を想定している。FloatPackでは1回の呼び出しでSimd::kWidth個分を計算する
+// スカラーを受け取る引数はstd::type_identity_tにして、Multiply(2, v)のように型が違っても推論できるようにしてある
+// 演算の順番は以前のFunction.cppと同じなので、floatの結果は変わらない
+
+#pragma region 数値の補助
+// 定数式用の平方根(ニュートン法)。xより大きい値から単調に減っていくので、減らなくなったら終わる
+constexpr double ConstexprSqrt(double x) {
+	if (!(x >= 0.0)) {
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+	if (x == 0.0 || x == std::numeric_limits<double>::infinity()) {
+		return x;
+	}
+	double guess = x > 1.0 ? x : 1.0;
+	for (;;) {
+		double next = 0.5 * (guess + x / guess);
+		if (next >= guess) {
+			return guess;
+		}
+		guess = next;
+	}
+}
+
+// 平方根。定数式ではConstexprSqrt、実行時はstd::sqrtを使う
+constexpr float Sqrt(float x) {
+	if (std::is_constant_evaluated()) {
+		return static_cast<float>(ConstexprSqrt(x));
+	}
+	return std::sqrt(x);
+}
+
+constexpr double Sqrt(double x) {
+	if (std::is_constant_evaluated()) {
+		return ConstexprSqrt(x);
+	}
+	return std::sqrt(x);
+}
+
+// 逆数(0の場合は0を返す)。Simd::FloatPackにはレーンごとに選ぶ版がある
+template<typename T>
+constexpr T ReciprocalOrZero(T x) {
+	return x == T(0) ? T(0) : T(1) / x;
+}
+#pragma endregion
+
+#pragma region Vector3
+// ベクトルの加算を計算する関数
+template<typename T>
+constexpr TVector3<T> Add(const TVector3<T>& v1, const TVector3<T>& v2) {
+	return { v1.x + v2.x, v1.y + v2.y, v1.z + v2.z };
+}
+
+// ベクトルの引き算を計算する関数
+template<typename T>
+constexpr TVector3<T> Subtract(const TVector3<T>& v1, const TVector3<T>& v2) {
+	return { v1.x - v2.x, v1.y - v2.y, v1.z - v2.z };
+}
+
+// ベクトルをスカラー倍する関数
+template<typename T>
+constexpr TVector3<T> Multiply(std::type_identity_t<T> scalar, const TVector3<T>& v) {
+	return { scalar * v.x, scalar * v.y, scalar * v.z };
+}
+
+// 内積を計算する関数
+template<typename T>
+constexpr T Dot(const TVector3<T>& v1, const TVector3<T>& v2) {
+	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+}
+
+// ベクトルの長さを計算する関数
+template<typename T>
+constexpr T Length(const TVector3<T>& v) {
+	return Sqrt(Dot(v, v));
+}
+
+// ベクトルを正規化する関数(長さ0のベクトルは0ベクトルになる)
+template<typename T>
+constexpr TVector3<T> Normalize(const TVector3<T>& v) {
+	return Multiply(ReciprocalOrZero(Length(v)), v);
+}
+
+// クロス積
+template<typename T>
+constexpr TVector3<T> Cross(const TVector3<T>& v1, const TVector3<T>& v2) {
+	return { v1.y * v2.z - v1.z * v2.y, v1.z * v2.x - v1.x * v2.z, v1.x * v2.y - v1.y * v2.x };
+}
+
+// 座標変換(Matrix4x4からVector3へ)
+template<typename T>
+constexpr TVector3<T> Transform(const TMatrix4x4<T>& matrix, const TVector3<T>& vector) {
+	TVector3<T> result = {};
+	result.x = matrix.m[0][0] * vector.x + matrix.m[1][0] * vector.y + matrix.m[2][0] * vector.z + matrix.m[3][0];
+	result.y = matrix.m[0][1] * vector.x + matrix.m[1][1] * vector.y + matrix.m[2][1] * vector.z + matrix.m[3][1];
+	result.z = matrix.m[0][2] * vector.x + matrix.m[1][2] * vector.y + matrix.m[2][2] * vector.z + matrix.m[3][2];
+	T w = matrix.m[0][3] * vector.x + matrix.m[1][3] * vector.y + matrix.m[2][3] * vector.z + matrix.m[3][3];
+	if constexpr (std::is_arithmetic_v<T>) {
+		assert(w != T(0));
+	}
+	result.x /= w;
+	result.y /= w;
+	result.z /= w;
+	return result;
+}
+
+// 線形補間
+template<typename T>
+constexpr TVector3<T> Lerp(const TVector3<T>& v1, const TVector3<T>& v2, const std::type_identity_t<T>& t) {
+	return Add(Multiply(t, v1), Multiply(T(1) - t, v2));
+}
+
+// ベジエ
+template<typename T>
+constexpr TVector3<T> Bezier(const TVector3<T>& p0, const TVector3<T>& p1, const TVector3<T>& p2, const std::type_identity_t<T>& t) {
+	TVector3<T> p0p1 = Lerp(p0, p1, t);
+	TVector3<T> p1p2 = Lerp(p1, p2, t);
+	return Lerp(p0p1, p1p2, t);
+}
+
+// 反発ベクトルを求める
+template<typename T>
+constexpr TVector3<T> Reflect(const TVector3<T>& input, const TVector3<T>& normal) {
+	return Subtract(input, Multiply(T(2), Multiply(Dot(input, normal), normal)));
+}
+#pragma endregion
+
+#pragma region Matrix4x4
+// 平行移動行列(Matrix4x4)
+template<typename T>
+constexpr TMatrix4x4<T> MakeTranslateMatrix(const TVector3<T>& translate) {
+	TMatrix4x4<T> matrix = {};
+	matrix.m[0][0] = T(1);
+	matrix.m[1][1] = T(1);
+	matrix.m[2][2] = T(1);
+	matrix.m[3][3] = T(1);
+	matrix.m[3][0] = translate.x;
+	matrix.m[3][1] = translate.y;
+	matrix.m[3][2] = translate.z;
+	return matrix;
+}
+
+// 拡大縮小行列(Matrix4x4)
+template<typename T>
+constexpr TMatrix4x4<T> MakeScaleMatrix(const TVector3<T>& scale) {
+	TMatrix4x4<T> matrix = {};
+	matrix.m[0][0] = scale.x;
+	matrix.m[1][1] = scale.y;
+	matrix.m[2][2] = scale.z;
+	matrix.m[3][3] = T(1);
+	return matrix;
+}
+
+// 行列の加算
+template<typename T>
+constexpr TMatrix4x4<T> Add(const TMatrix4x4<T>& m1, const TMatrix4x4<T>& m2) {
+	TMatrix4x4<T> result = {};
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			result.m[i][j] = m1.m[i][j] + m2.m[i][j];
+		}
+	}
+	return result;
+}
+
+// 行列の減算
+template<typename T>
+constexpr TMatrix4x4<T> Subtract(const TMatrix4x4<T>& m1, const TMatrix4x4<T>& m2) {
+	TMatrix4x4<T> result = {};
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			result.m[i][j] = m1.m[i][j] - m2.m[i][j];
+		}
+	}
+	return result;
+}
+
+// 行列の乗算
+// floatではFunction.hのSIMD版(テンプレートでない方)が優先して選ばれる。加算の順番は同じなので結果は一致する
+template<typename T>
+constexpr TMatrix4x4<T> Multiply(const TMatrix4x4<T>& a, const TMatrix4x4<T>& b) {
+	TMatrix4x4<T> result = {};
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			result.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+		}
+	}
+	return result;
+}
+
+// 行列の転置
+template<typename T>
+constexpr TMatrix4x4<T> Transpose(const TMatrix4x4<T>& m) {
+	TMatrix4x4<T> result = {};
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			result.m[i][j] = m.m[j][i];
+		}
+	}
+	return result;
+}
+
+// 単位行列の作成(MakeIdentity<double>()のように型を指定できる)
+template<typename T = float>
+constexpr TMatrix4x4<T> MakeIdentity() {
+	TMatrix4x4<T> identity = {};
+	for (int i = 0; i < 4; ++i) {
+		identity.m[i][i] = T(1);
+	}
+	return identity;
+}
+
+// 行列の4列目が(0,0,0,1)か(w除算が不要か)を判定する
+template<typename T>
+constexpr bool IsAffine(const TMatrix4x4<T>& matrix) {
+	return matrix.m[0][3] == T(0) && matrix.m[1][3] == T(0) && matrix.m[2][3] == T(0) && matrix.m[3][3] == T(1);
+}
+#pragma endregion
+
+#pragma region 演算子オーバーロード
+// 二項演算子
+template<typename T>
+constexpr TVector3<T> operator+(const TVector3<T>& v1, const TVector3<T>& v2) {
+	return Add(v1, v2);
+}
+template<typename T>
+constexpr TVector3<T> operator-(const TVector3<T>& v1, const TVector3<T>& v2) {
+	return Subtract(v1, v2);
+}
+template<typename T>
+constexpr TVector3<T> operator*(std::type_identity_t<T> s, const TVector3<T>& v) {
+	return Multiply(s, v);
+}
+template<typename T>
+constexpr TVector3<T> operator*(const TVector3<T>& v, std::type_identity_t<T> s) {
+	return Multiply(s, v);
+}
+template<typename T>
+constexpr TVector3<T> operator/(const TVector3<T>& v, std::type_identity_t<T> s) {
+	return Multiply(T(1) / s, v);
+}
+template<typename T>
+constexpr TMatrix4x4<T> operator+(const TMatrix4x4<T>& m1, const TMatrix4x4<T>& m2) {
+	return Add(m1, m2);
+}
+template<typename T>
+constexpr TMatrix4x4<T> operator-(const TMatrix4x4<T>& m1, const TMatrix4x4<T>& m2) {
+	return Subtract(m1, m2);
+}
+template<typename T>
+constexpr TMatrix4x4<T> operator*(const TMatrix4x4<T>& m1, const TMatrix4x4<T>& m2) {
+	return Multiply(m1, m2);
+}
+// 単項演算子
+template<typename T>
+constexpr TVector3<T> operator-(const TVector3<T>& v) {
+	return { -v.x, -v.y, -v.z };
+}
+template<typename T>
+constexpr TVector3<T> operator+(const TVector3<T>& v) {
+	return v;
+}
+// 複合代入演算子
+template<typename T>
+constexpr TVector3<T>& operator*=(TVector3<T>& v, std::type_identity_t<T> s) {
+	v.x *= s;
+	v.y *= s;
+	v.z *= s;
+	return v;
+}
+template<typename T>
+constexpr TVector3<T>& operator-=(TVector3<T>& v1, const TVector3<T>& v2) {
+	v1.x -= v2.x;
+	v1.y -= v2.y;
+	v1.z -= v2.z;
+	return v1;
+}
+template<typename T>
+constexpr TVector3<T>& operator+=(TVector3<T>& v1, const TVector3<T>& v2) {
+	v1.x += v2.x;
+	v1.y += v2.y;
+	v1.z += v2.z;
+	return v1;
+}
+template<typename T>
+constexpr TVector3<T>& operator/=(TVector3<T>& v, std::type_identity_t<T> s) {
+	v.x /= s;
+	v.y /= s;
+	v.z /= s;
+	return v;
+}
+#pragma endregion
@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+namespace {
+// 頂点をまとめた後の配列に書き込むときに1スレッドが処理する数
+constexpr size_t kVertexGrain = 65536;
+constexpr uint32_t kNoVertex = 0xFFFFFFFF;
+
+bool IsSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char* SkipSpaces(const char* p, const char* end) {
+	while (p < end && IsSpace(*p)) {
+		++p;
+	}
+	return p;
+}
+
+// 空白の後の実数を読む
+bool ParseFloat(const char*& p, const char* end, float& value) {
+	p = SkipSpaces(p, end);
+	if (p < end && *p == '+') {
+		++p;
+	}
+	std::from_chars_result result = std::from_chars(p, end, value);
+	if (result.ec != std::errc()) {
+		return false;
+	}
+	p = result.ptr;
+	return true;
+}
+
+// 面の頂点の番号を読む。正の番号は0から数えた番号に、負の番号はlocalCount(区切りの中でここまでに読んだ数)から数えた番号にする
+bool ParseIndex(const char*& p, const char* end, size_t localCount, int32_t& index, bool& relative) {
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		++p;
+	}
+	if (p == end || *p < '0' || *p > '9') {
+		return false;
+	}
+	int64_t value = 0;
+	while (p < end && *p >= '0' && *p <= '9') {
+		value = value * 10 + (*p - '0');
+		if (value > std::numeric_limits<int32_t>::max()) {
+			return false;
+		}
+		++p;
+	}
+	if (value == 0) {
+		return false;
+	}
+	relative = negative;
+	index = negative ? static_cast<int32_t>(static_cast<int64_t>(localCount) - value) : static_cast<int32_t>(value - 1);
+	return true;
+}
+
+// 行の先頭の単語がkeywordか
+bool StartsWithKeyword(const char* p, const char* end, std::string_view keyword) {
+	size_t length = keyword.size();
+	return static_cast<size_t>(end - p) > length && std::memcmp(p, keyword.data(), length) == 0 && IsSpace(p[length]);
+}
+}
+
+template<typename Function>
+void ObjLoader::ForEachRange(size_t count, size_t grain, Function&& function) {
+	if (pool_ == nullptr) {
+		function(size_t(0), count);
+		return;
+	}
+	pool_->ParallelFor(count, grain, [&](size_t begin, size_t end, uint32_t) {
+		function(begin, end);
+	});
+}
+
+#pragma region 読み込み
+bool ObjLoader::Load(const std::string& path, ObjMesh& mesh) {
+	MT4_PROFILE_ZONE("ObjLoader::Load");
+	const auto start = std::chrono::steady_clock::now();
+	MappedFile file;
+	if (!file.Open(path)) {
+		statistics_ = {};
+		mesh = {};
+		return false;
+	}
+	bool result = Parse(file.GetView(), mesh);
+	statistics_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+bool ObjLoader::Parse(std::string_view text, ObjMesh& mesh) {
+	MT4_PROFILE_ZONE("ObjLoader::Parse");
+	const auto start = std::chrono::steady_clock::now();
+	statistics_ = {};
+	statistics_.bytes = text.size();
+	mesh.positions.Clear();
+	mesh.normals.Clear();
+	mesh.indices.clear();
+
+	// 区切りの終わりは、目安の位置の次の改行の直後にする
+	size_t chunkCount = 0;
+	const char* p = text.data();
+	const char* end = text.data() + text.size();
+	while (p < end) {
+		const char* chunkEnd = end;
+		if (static_cast<size_t>(end - p) > kChunkSize) {
+			const void* newline = std::memchr(p + kChunkSize, '\n', static_cast<size_t>(end - p) - kChunkSize);
+			chunkEnd = newline != nullptr ? static_cast<const char*>(newline) + 1 : end;
+		}
+		if (chunks_.size() <= chunkCount) {
+			chunks_.resize(chunkCount + 1);
+		}
+		chunks_[chunkCount].begin = p;
+		chunks_[chunkCount].end = chunkEnd;
+		++chunkCount;
+		p = chunkEnd;
+	}
+
+	ForEachRange(chunkCount, 1, [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			ParseChunk(chunks_[i]);
+		}
+	});
+
+	// 各区切りの先頭の番号を求める。解析できない行があればそこで失敗にする
+	for (size_t i = 0; i < chunkCount; ++i) {
+		Chunk& chunk = chunks_[i];
+		if (chunk.errorLine != 0) {
+			statistics_.errorLine = statistics_.lineCount + chunk.errorLine;
+			mesh = {};
+			return false;
+		}
+		chunk.positionBase = statistics_.positionCount;
+		chunk.normalBase = statistics_.normalCount;
+		statistics_.lineCount += chunk.lineCount;
+		statistics_.positionCount += chunk.positions.size() / 3;
+		statistics_.normalCount += chunk.normals.size() / 3;
+		statistics_.triangleCount += chunk.corners.size() / 3;
+	}
+
+	std::vector<uint8_t> valid(chunkCount);
+	ForEachRange(chunkCount, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			valid[i] = ResolveChunk(chunks_[i], statistics_.positionCount, statistics_.normalCount);
+		}
+	});
+	if (std::find(valid.begin(), valid.end(), uint8_t(0)) != valid.end()) {
+		mesh = {};
+		return false;
+	}
+
+	BuildMesh(mesh, chunkCount);
+	statistics_.vertexCount = mesh.positions.Size();
+	statistics_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+void ObjLoader::ParseChunk(Chunk& chunk) {
+	chunk.positions.clear();
+	chunk.normals.clear();
+	chunk.corners.clear();
+	chunk.lineCount = 0;
+	chunk.errorLine = 0;
+	chunk.hasNormal = false;
+
+	const char* p = chunk.begin;
+	while (p < chunk.end) {
+		++chunk.lineCount;
+		const void* newline = std::memchr(p, '\n', static_cast<size_t>(chunk.end - p));
+		const char* lineEnd = newline != nullptr ? static_cast<const char*>(newline) : chunk.end;
+		const char* next = newline != nullptr ? lineEnd + 1 : chunk.end;
+		p = SkipSpaces(p, lineEnd);
+
+		bool ok = true;
+		if (StartsWithKeyword(p, lineEnd, "v") || StartsWithKeyword(p, lineEnd, "vn")) {
+			// 4つ目以降の値(wや頂点カラー)は使わない
+			std::vector<float>& values = p[1] == 'n' ? chunk.normals : chunk.positions;
+			p += p[1] == 'n' ? 2 : 1;
+			float x, y, z;
+			ok = ParseFloat(p, lineEnd, x) && ParseFloat(p, lineEnd, y) && ParseFloat(p, lineEnd, z);
+			if (ok) {
+				values.push_back(x);
+				values.push_back(y);
+				values.push_back(z);
+			}
+		} else if (StartsWithKeyword(p, lineEnd, "f")) {
+			// 頂点は v, v/vt, v//vn, v/vt/vn のどれか。4頂点以上の面は最初の頂点を中心に扇状に分ける
+			++p;
+			Corner first = {};
+			Corner previous = {};
+			int count = 0;
+			for (;;) {
+				p = SkipSpaces(p, lineEnd);
+				if (p == lineEnd) {
+					break;
+				}
+				Corner corner = { 0, -1, false, false };
+				ok = ParseIndex(p, lineEnd, chunk.positions.size() / 3, corner.position, corner.relativePosition);
+				if (ok && p < lineEnd && *p == '/') {
+					++p;
+					if (p < lineEnd && *p != '/' && !IsSpace(*p)) {
+						// テクスチャ座標は使わないので読み飛ばす
+						int32_t texcoord;
+						bool relative;
+						ok = ParseIndex(p, lineEnd, 0, texcoord, relative);
+					}
+					if (ok && p < lineEnd && *p == '/') {
+						++p;
+						ok = ParseIndex(p, lineEnd, chunk.normals.size() / 3, corner.normal, corner.relativeNormal);
+						chunk.hasNormal = true;
+					}
+				}
+				if (!ok || (p < lineEnd && !IsSpace(*p))) {
+					ok = false;
+					break;
+				}
+				if (count == 0) {
+					first = corner;
+				} else if (count >= 2) {
+					chunk.corners.push_back(first);
+					chunk.corners.push_back(previous);
+					chunk.corners.push_back(corner);
+				}
+				previous = corner;
+				++count;
+			}
+			ok = ok && count >= 3;
+		}
+		if (!ok) {
+			chunk.errorLine = chunk.lineCount;
+			return;
+		}
+		p = next;
+	}
+}
+
+bool ObjLoader::ResolveChunk(Chunk& chunk, size_t positionCount, size_t normalCount) {
+	for (Corner& corner : chunk.corners) {
+		int64_t position = corner.position + (corner.relativePosition ? static_cast<int64_t>(chunk.positionBase) : 0);
+		if (position < 0 || position >= static_cast<int64_t>(positionCount)) {
+			return false;
+		}
+		corner.position = static_cast<int32_t>(position);
+		corner.relativePosition = false;
+		if (corner.normal < 0 && !corner.relativeNormal) {
+			continue;
+		}
+		int64_t normal = corner.normal + (corner.relativeNormal ? static_cast<int64_t>(chunk.normalBase) : 0);
+		if (normal < 0 || normal >= static_cast<int64_t>(normalCount)) {
+			return false;
+		}
+		corner.normal = static_cast<int32_t>(normal);
+		corner.relativeNormal = false;
+	}
+	return true;
+}
+
+void ObjLoader::BuildMesh(ObjMesh& mesh, size_t chunkCount) {
+	// 区切りごとの位置と法線を1本の配列につなげる
+	positions_.resize(statistics_.positionCount * 3);
+	normals_.resize(statistics_.normalCount * 3);
+	bool hasNormal = false;
+	for (size_t i = 0; i < chunkCount; ++i) {
+		hasNormal = hasNormal || chunks_[i].hasNormal;
+	}
+	ForEachRange(chunkCount, 1, [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			const Chunk& chunk = chunks_[i];
+			std::copy(chunk.positions.begin(), chunk.positions.end(), positions_.begin() + chunk.positionBase * 3);
+			std::copy(chunk.normals.begin(), chunk.normals.end(), normals_.begin() + chunk.normalBase * 3);
+		}
+	});
+
+	// 頂点をまとめる。番号は最初に使われた順に振るので、スレッド数によらず同じになる
+	vertexSource_.clear();
+	mesh.indices.resize(statistics_.triangleCount * 3);
+	size_t cornerIndex = 0;
+	if (!hasNormal) {
+		vertexOfPosition_.assign(statistics_.positionCount, kNoVertex);
+		for (size_t i = 0; i < chunkCount; ++i) {
+			for (const Corner& corner : chunks_[i].corners) {
+				uint32_t& vertex = vertexOfPosition_[corner.position];
+				if (vertex == kNoVertex) {
+					vertex = static_cast<uint32_t>(vertexSource_.size());
+					vertexSource_.push_back(corner);
+				}
+				mesh.indices[cornerIndex++] = vertex;
+			}
+		}
+	} else {
+		// 開番地法のハッシュ表。埋まった割合が半分を超えたら広げる
+		auto hash = [](const Corner& corner) {
+			uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(corner.position)) << 32) | static_cast<uint32_t>(corner.normal);
+			return key * 0x9E3779B97F4A7C15ull;
+		};
+		size_t tableSize = 1024;
+		while (tableSize < statistics_.positionCount * 2) {
+			tableSize *= 2;
+		}
+		vertexTable_.assign(tableSize, 0);
+		for (size_t i = 0; i < chunkCount; ++i) {
+			for (const Corner& corner : chunks_[i].corners) {
+				size_t mask = vertexTable_.size() - 1;
+				size_t slot = static_cast<size_t>(hash(corner) >> 32) & mask;
+				uint32_t vertex = kNoVertex;
+				while (vertexTable_[slot] != 0) {
+					const Corner& source = vertexSource_[vertexTable_[slot] - 1];
+					if (source.position == corner.position && source.normal == corner.normal) {
+						vertex = vertexTable_[slot] - 1;
+						break;
+					}
+					slot = (slot + 1) & mask;
+				}
+				if (vertex == kNoVertex) {
+					vertex = static_cast<uint32_t>(vertexSource_.size());
+					vertexSource_.push_back(corner);
+					vertexTable_[slot] = vertex + 1;
+					if (vertexSource_.size() * 2 > vertexTable_.size()) {
+						vertexTable_.assign(vertexTable_.size() * 2, 0);
+						mask = vertexTable_.size() - 1;
+						for (uint32_t v = 0; v < vertexSource_.size(); ++v) {
+							size_t s = static_cast<size_t>(hash(vertexSource_[v]) >> 32) & mask;
+							while (vertexTable_[s] != 0) {
+								s = (s + 1) & mask;
+							}
+							vertexTable_[s] = v + 1;
+						}
+					}
+				}
+				mesh.indices[cornerIndex++] = vertex;
+			}
+		}
+	}
+
+	// まとめた頂点の位置と法線をSoAに書き込む
+	const size_t vertexCount = vertexSource_.size();
+	mesh.positions.Resize(vertexCount);
+	mesh.normals.Resize(hasNormal ? vertexCount : 0);
+	ForEachRange(vertexCount, kVertexGrain, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; ++v) {
+			const Corner& source = vertexSource_[v];
+			const float* position = positions_.data() + static_cast<size_t>(source.position) * 3;
+			mesh.positions.X()[v] = position[0];
+			mesh.positions.Y()[v] = position[1];
+			mesh.positions.Z()[v] = position[2];
+			if (hasNormal) {
+				const float* normal = source.normal >= 0 ? normals_.data() + static_cast<size_t>(source.normal) * 3 : nullptr;
+				mesh.normals.X()[v] = normal != nullptr ? normal[0] : 0.0f;
+				mesh.normals.Y()[v] = normal != nullptr ? normal[1] : 0.0f;
+				mesh.normals.Z()[v] = normal != nullptr ? normal[2] : 0.0f;
+			}
+		}
+	});
+}
+#pragma endregion
+
+std::vector<Triangle> MakeTriangles(const ObjMesh& mesh, unsigned int color) {
+	std::vector<Triangle> triangles(mesh.TriangleCount());
+	for (size_t i = 0; i < triangles.size(); ++i) {
+		for (int k = 0; k < 3; ++k) {
+			triangles[i].vertex[k] = mesh.positions.Get(mesh.indices[i * 3 + k]);
+		}
+		triangles[i].color = color;
+	}
+	return triangles;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Struct.h"
+#include "Vector3SoA.h"
+
+class ThreadPool;
+
+// OBJファイルから読み込んだメッシュ
+// 位置と法線の組が同じ頂点は1つにまとめてある
+struct ObjMesh {
+	Vector3SoA positions;          // 頂点の位置
+	Vector3SoA normals;            // 頂点の法線。ファイルに法線が無ければ空、法線の無い面の頂点は0ベクトル
+	std::vector<uint32_t> indices; // 三角形ごとに3つの頂点番号(多角形の面は扇状に分割してある)
+
+	size_t TriangleCount() const { return indices.size() / 3; }
+};
+
+// メッシュをTriangleの配列にする(衝突判定やTriangleBVH、Rasterizerに渡す用)
+std::vector<Triangle> MakeTriangles(const ObjMesh& mesh, unsigned int color = 0xFFFFFFFF);
+
+// OBJファイルの読み込み
+// ファイルはメモリマップして、バッファへのコピーをせずに読む。v(位置)・vn(法線)・f(面)の行だけを使い、他の行は読み飛ばす
+// 文字列は一定の大きさの区切りに分け、区切りごとに(スレッドプールがあれば並列に)解析してから順番につなげるので、
+// 結果はスレッド数によらず同じになる。作業用の配列は使い回すので、同じローダーで続けて読み込むとメモリ確保が減る
+class ObjLoader {
+public:
+	// 1スレッドが解析する文字数の目安(区切りは行の境目に合わせる)
+	static constexpr size_t kChunkSize = 1 << 20;
+
+	// 直近の読み込みの統計
+	struct Statistics {
+		size_t bytes;         // 解析した文字数
+		size_t lineCount;
+		size_t positionCount; // vの行の数
+		size_t normalCount;   // vnの行の数
+		size_t triangleCount;
+		size_t vertexCount;   // まとめた後の頂点の数
+		size_t errorLine;     // 解析できなかった最初の行(1から数える。問題が無い場合と、範囲外の参照で失敗した場合は0)
+		double seconds;       // ファイルのマップから頂点をまとめ終わるまでの時間
+
+		// 1秒あたりに解析できるメガバイト数(10^6バイト)
+		double MegabytesPerSecond() const { return seconds > 0.0 ? static_cast<double>(bytes) / seconds * 1.0e-6 : 0.0; }
+	};
+
+	// nullptrなら呼び出したスレッドだけで処理する
+	void SetThreadPool(ThreadPool* pool) { pool_ = pool; }
+
+	// ファイルを読み込む。開けない・解析できない行がある・範囲外の頂点を参照している場合はfalseを返し、meshは空になる
+	bool Load(const std::string& path, ObjMesh& mesh);
+	// メモリ上のOBJ形式の文字列を読み込む
+	bool Parse(std::string_view text, ObjMesh& mesh);
+
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private:
+	// 面の頂点が参照する位置と法線の番号(0から数える)。法線が無ければ-1
+	// 負の番号(後ろから数える)は区切りの中で数えた番号にしておき、区切りの先頭の番号を足すまでrelativeを立てておく
+	struct Corner {
+		int32_t position;
+		int32_t normal;
+		bool relativePosition;
+		bool relativeNormal;
+	};
+
+	// 区切りごとの解析結果
+	struct Chunk {
+		const char* begin;
+		const char* end;
+		std::vector<float> positions; // x, y, zの順
+		std::vector<float> normals;
+		std::vector<Corner> corners;  // 三角形ごとに3つ
+		size_t lineCount;
+		size_t errorLine;             // 区切りの中での行番号
+		size_t positionBase;          // この区切りより前の位置・法線の数
+		size_t normalBase;
+		bool hasNormal;
+	};
+
+	static void ParseChunk(Chunk& chunk);
+	// 負の番号を解決し、範囲外の参照が無いか調べる
+	static bool ResolveChunk(Chunk& chunk, size_t positionCount, size_t normalCount);
+	// 頂点をまとめてmeshに書き込む
+	void BuildMesh(ObjMesh& mesh, size_t chunkCount);
+
+	// [0, count)をgrain個ずつに区切ってfunction(begin, end)を呼ぶ。スレッドプールがあれば並列に呼ぶ
+	template<typename Function>
+	void ForEachRange(size_t count, size_t grain, Function&& function);
+
+	ThreadPool* pool_ = nullptr;
+	std::vector<Chunk> chunks_;
+	std::vector<float> positions_;
+	std::vector<float> normals_;
+	std::vector<uint32_t> vertexOfPosition_; // 法線が無い場合の、位置の番号から頂点の番号への表
+	std::vector<uint32_t> vertexTable_;      // 法線がある場合の、(位置, 法線)から頂点の番号 + 1へのハッシュ表(0は空き)
+	std::vector<Corner> vertexSource_;       // 頂点ごとの位置と法線の番号
+	Statistics statistics_ = {};
+};
@@ -0,0 +1,234 @@
+#include <assert.h>
+#include <cmath>
+#include "PendulumEnsemble.h"
+#include "Profiler.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+namespace {
+// 並列に処理するときに1つの区切りで扱う要素数(レーン数の倍数)
+constexpr size_t kGrainSize = 1024;
+static_assert(kGrainSize % Simd::kWidth == 0);
+
+constexpr float kPi = 3.14159265358979f;
+
+// レーン数の倍数になるまで余分な要素を足す
+void Pad(std::vector<float>& values, size_t size, float value) {
+	size_t padded = (size + Simd::kWidth - 1) / Simd::kWidth * Simd::kWidth;
+	values.resize(padded, value);
+}
+
+template<typename Function>
+void ForEachRange(size_t count, ThreadPool* pool, Function&& function) {
+	if (pool == nullptr) {
+		function(0, count, 0u);
+	} else {
+		pool->ParallelFor(count, kGrainSize, function);
+	}
+}
+
+// x,y,zをbobs[index]から書き込む。レーンが配列の終わりをはみ出す場合は一時領域を経由する
+void StoreBobs(std::span<Vector3> bobs, size_t index, Simd::Float x, Simd::Float y, Simd::Float z) {
+	if (index + Simd::kWidth <= bobs.size()) {
+		Simd::StoreVector3(&bobs[index].x, x, y, z);
+		return;
+	}
+	Vector3 temp[Simd::kWidth];
+	Simd::StoreVector3(&temp[0].x, x, y, z);
+	for (size_t i = 0; index + i < bobs.size(); ++i) {
+		bobs[index + i] = temp[i];
+	}
+}
+}
+
+#pragma region PendulumEnsemble
+void PendulumEnsemble::Clear() {
+	size_ = 0;
+	for (std::vector<float>* values : { &anchorX_, &anchorY_, &anchorZ_, &length_, &angle_, &angularVelocity_, &angularAcceleration_ }) {
+		values->clear();
+	}
+}
+
+size_t PendulumEnsemble::Add(const Pendulum& pendulum) {
+	size_t index = size_++;
+	// 余った要素は長さ1の止まった振り子にしておく(0除算を避けるため)
+	Pad(anchorX_, size_, 0.0f);
+	Pad(anchorY_, size_, 0.0f);
+	Pad(anchorZ_, size_, 0.0f);
+	Pad(length_, size_, 1.0f);
+	Pad(angle_, size_, 0.0f);
+	Pad(angularVelocity_, size_, 0.0f);
+	Pad(angularAcceleration_, size_, 0.0f);
+	Set(index, pendulum);
+	return index;
+}
+
+Pendulum PendulumEnsemble::Get(size_t index) const {
+	assert(index < size_);
+	return {
+		{ anchorX_[index], anchorY_[index], anchorZ_[index] },
+		length_[index],
+		angle_[index],
+		angularVelocity_[index],
+		angularAcceleration_[index],
+	};
+}
+
+void PendulumEnsemble::Set(size_t index, const Pendulum& pendulum) {
+	assert(index < size_);
+	assert(pendulum.length > 0.0f);
+	anchorX_[index] = pendulum.anchor.x;
+	anchorY_[index] = pendulum.anchor.y;
+	anchorZ_[index] = pendulum.anchor.z;
+	length_[index] = pendulum.length;
+	angle_[index] = pendulum.angle;
+	angularVelocity_[index] = pendulum.angularVelocity;
+	angularAcceleration_[index] = pendulum.angularAcceleration;
+}
+
+void PendulumEnsemble::Update(float deltaTime, uint32_t subSteps, ThreadPool* pool) {
+	MT4_PROFILE_ZONE("PendulumEnsemble::Update");
+	assert(subSteps > 0);
+	ForEachRange(length_.size(), pool, [&](size_t begin, size_t end, uint32_t) {
+		Update(begin, end, deltaTime, subSteps);
+	});
+}
+
+void PendulumEnsemble::Update(size_t begin, size_t end, float deltaTime, uint32_t subSteps) {
+	const Simd::Float h = Simd::Set1(deltaTime / static_cast<float>(subSteps));
+	const Simd::Float minusGravity = Simd::Set1(-gravity_);
+	for (size_t i = begin; i < end; i += Simd::kWidth) {
+		// -g / length はサブステップの間変わらないので先に求めておく
+		Simd::Float coefficient = Simd::Div(minusGravity, Simd::LoadUnaligned(&length_[i]));
+		Simd::Float angle = Simd::LoadUnaligned(&angle_[i]);
+		Simd::Float angularVelocity = Simd::LoadUnaligned(&angularVelocity_[i]);
+		Simd::Float angularAcceleration = Simd::Zero();
+		for (uint32_t step = 0; step < subSteps; ++step) {
+			Simd::Float sin, cos;
+			Simd::SinCos(angle, sin, cos);
+			angularAcceleration = Simd::Mul(coefficient, sin);
+			angularVelocity = Simd::Add(angularVelocity, Simd::Mul(angularAcceleration, h));
+			angle = Simd::Add(angle, Simd::Mul(angularVelocity, h));
+		}
+		Simd::StoreUnaligned(&angle_[i], angle);
+		Simd::StoreUnaligned(&angularVelocity_[i], angularVelocity);
+		Simd::StoreUnaligned(&angularAcceleration_[i], angularAcceleration);
+	}
+}
+
+void PendulumEnsemble::ComputeBobPositions(std::span<Vector3> bobs, ThreadPool* pool) const {
+	assert(bobs.size() == size_);
+	ForEachRange(length_.size(), pool, [&](size_t begin, size_t end, uint32_t) {
+		ComputeBobPositions(begin, end, bobs);
+	});
+}
+
+void PendulumEnsemble::ComputeBobPositions(size_t begin, size_t end, std::span<Vector3> bobs) const {
+	for (size_t i = begin; i < end && i < size_; i += Simd::kWidth) {
+		Simd::Float sin, cos;
+		Simd::SinCos(Simd::LoadUnaligned(&angle_[i]), sin, cos);
+		Simd::Float length = Simd::LoadUnaligned(&length_[i]);
+		// (sin * length, -cos * length, 0) + anchor
+		Simd::Float x = Simd::Add(Simd::LoadUnaligned(&anchorX_[i]), Simd::Mul(sin, length));
+		Simd::Float y = Simd::Sub(Simd::LoadUnaligned(&anchorY_[i]), Simd::Mul(cos, length));
+		Simd::Float z = Simd::LoadUnaligned(&anchorZ_[i]);
+		StoreBobs(bobs, i, x, y, z);
+	}
+}
+#pragma endregion
+
+#pragma region ConicalPendulumEnsemble
+void ConicalPendulumEnsemble::Clear() {
+	size_ = 0;
+	for (std::vector<float>* values : { &anchorX_, &anchorY_, &anchorZ_, &length_, &halfApexAngle_, &angle_, &angularVelocity_ }) {
+		values->clear();
+	}
+}
+
+size_t ConicalPendulumEnsemble::Add(const ConicalPendulum& pendulum) {
+	size_t index = size_++;
+	Pad(anchorX_, size_, 0.0f);
+	Pad(anchorY_, size_, 0.0f);
+	Pad(anchorZ_, size_, 0.0f);
+	Pad(length_, size_, 1.0f);
+	Pad(halfApexAngle_, size_, 0.0f);
+	Pad(angle_, size_, 0.0f);
+	Pad(angularVelocity_, size_, 0.0f);
+	Set(index, pendulum);
+	return index;
+}
+
+ConicalPendulum ConicalPendulumEnsemble::Get(size_t index) const {
+	assert(index < size_);
+	return {
+		{ anchorX_[index], anchorY_[index], anchorZ_[index] },
+		length_[index],
+		halfApexAngle_[index],
+		angle_[index],
+		angularVelocity_[index],
+	};
+}
+
+void ConicalPendulumEnsemble::Set(size_t index, const ConicalPendulum& pendulum) {
+	assert(index < size_);
+	assert(pendulum.length > 0.0f);
+	anchorX_[index] = pendulum.anchor.x;
+	anchorY_[index] = pendulum.anchor.y;
+	anchorZ_[index] = pendulum.anchor.z;
+	length_[index] = pendulum.length;
+	halfApexAngle_[index] = pendulum.halfApexAngle;
+	angle_[index] = pendulum.angle;
+	angularVelocity_[index] = pendulum.angularVelocity;
+}
+
+void ConicalPendulumEnsemble::Update(float deltaTime, uint32_t subSteps, ThreadPool* pool) {
+	MT4_PROFILE_ZONE("ConicalPendulumEnsemble::Update");
+	assert(subSteps > 0);
+	(void)subSteps;
+	ForEachRange(length_.size(), pool, [&](size_t begin, size_t end, uint32_t) {
+		Update(begin, end, deltaTime);
+	});
+}
+
+void ConicalPendulumEnsemble::Update(size_t begin, size_t end, float deltaTime) {
+	const Simd::Float dt = Simd::Set1(deltaTime);
+	const Simd::Float gravity = Simd::Set1(gravity_);
+	const Simd::Float twoPi = Simd::Set1(2.0f * kPi);
+	const Simd::Float inverseTwoPi = Simd::Set1(1.0f / (2.0f * kPi));
+	for (size_t i = begin; i < end; i += Simd::kWidth) {
+		// ω = sqrt(g / (length * cos(halfApexAngle)))
+		Simd::Float sin, cos;
+		Simd::SinCos(Simd::LoadUnaligned(&halfApexAngle_[i]), sin, cos);
+		Simd::Float angularVelocity = Simd::Sqrt(Simd::Div(gravity, Simd::Mul(Simd::LoadUnaligned(&length_[i]), cos)));
+		Simd::Float angle = Simd::Add(Simd::LoadUnaligned(&angle_[i]), Simd::Mul(angularVelocity, dt));
+		// 2πの倍数を引いて[-π, π]に折り返す
+		angle = Simd::Sub(angle, Simd::Mul(Simd::Round(Simd::Mul(angle, inverseTwoPi)), twoPi));
+		Simd::StoreUnaligned(&angle_[i], angle);
+		Simd::StoreUnaligned(&angularVelocity_[i], angularVelocity);
+	}
+}
+
+void ConicalPendulumEnsemble::ComputeBobPositions(std::span<Vector3> bobs, ThreadPool* pool) const {
+	assert(bobs.size() == size_);
+	ForEachRange(length_.size(), pool, [&](size_t begin, size_t end, uint32_t) {
+		ComputeBobPositions(begin, end, bobs);
+	});
+}
+
+void ConicalPendulumEnsemble::ComputeBobPositions(size_t begin, size_t end, std::span<Vector3> bobs) const {
+	for (size_t i = begin; i < end && i < size_; i += Simd::kWidth) {
+		Simd::Float length = Simd::LoadUnaligned(&length_[i]);
+		Simd::Float apexSin, apexCos;
+		Simd::SinCos(Simd::LoadUnaligned(&halfApexAngle_[i]), apexSin, apexCos);
+		Simd::Float radius = Simd::Mul(apexSin, length);
+		Simd::Float height = Simd::Mul(apexCos, length);
+		Simd::Float sin, cos;
+		Simd::SinCos(Simd::LoadUnaligned(&angle_[i]), sin, cos);
+		// anchor + (cos(angle) * radius, -height, -sin(angle) * radius)
+		Simd::Float x = Simd::Add(Simd::LoadUnaligned(&anchorX_[i]), Simd::Mul(cos, radius));
+		Simd::Float y = Simd::Sub(Simd::LoadUnaligned(&anchorY_[i]), height);
+		Simd::Float z = Simd::Sub(Simd::LoadUnaligned(&anchorZ_[i]), Simd::Mul(sin, radius));
+		StoreBobs(bobs, i, x, y, z);
+	}
+}
+#pragma endregion
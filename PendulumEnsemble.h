@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Struct.h"
+
+class ThreadPool;
+
+// 大量の振り子をまとめて進める
+// 成分ごとの配列(SoA)で保持し、SIMDのレーン数ずつ処理する。sin/cosはSimd::SinCosの多項式近似を使う
+// 配列はレーン数の倍数まで余分に確保してあるので、端数の処理は要らない
+
+// 単振り子(Pendulum)の集まり
+// 角加速度 = -(g / length) * sin(angle) を半陰的Euler法で積分する
+class PendulumEnsemble {
+public:
+	size_t Size() const { return size_; }
+	void Clear();
+	// 追加して番号を返す
+	size_t Add(const Pendulum& pendulum);
+	Pendulum Get(size_t index) const;
+	void Set(size_t index, const Pendulum& pendulum);
+
+	void SetGravity(float gravity) { gravity_ = gravity; }
+
+	// deltaTimeをsubSteps回に分けて進める。poolを渡すとレーンのまとまりごとに並列に処理する
+	void Update(float deltaTime, uint32_t subSteps = 1, ThreadPool* pool = nullptr);
+	// おもりの位置を求める(bobs.size() == Size())
+	void ComputeBobPositions(std::span<Vector3> bobs, ThreadPool* pool = nullptr) const;
+
+private:
+	void Update(size_t begin, size_t end, float deltaTime, uint32_t subSteps);
+	void ComputeBobPositions(size_t begin, size_t end, std::span<Vector3> bobs) const;
+
+	size_t size_ = 0;
+	float gravity_ = 9.8f;
+	std::vector<float> anchorX_, anchorY_, anchorZ_;
+	std::vector<float> length_;
+	std::vector<float> angle_;
+	std::vector<float> angularVelocity_;
+	std::vector<float> angularAcceleration_;
+};
+
+// 円錐振り子(ConicalPendulum)の集まり
+// 角速度 = sqrt(g / (length * cos(halfApexAngle))) で一定なので、角度はそのまま進める
+// 角度は単調に増えて近似の誤差が大きくなるので、[-π, π]に折り返して保持する
+class ConicalPendulumEnsemble {
+public:
+	size_t Size() const { return size_; }
+	void Clear();
+	size_t Add(const ConicalPendulum& pendulum);
+	ConicalPendulum Get(size_t index) const;
+	void Set(size_t index, const ConicalPendulum& pendulum);
+
+	void SetGravity(float gravity) { gravity_ = gravity; }
+
+	// 角速度は一定なので、subStepsで分けても結果は変わらない(PendulumEnsembleと呼び方を揃えるためにある)
+	void Update(float deltaTime, uint32_t subSteps = 1, ThreadPool* pool = nullptr);
+	void ComputeBobPositions(std::span<Vector3> bobs, ThreadPool* pool = nullptr) const;
+
+private:
+	void Update(size_t begin, size_t end, float deltaTime);
+	void ComputeBobPositions(size_t begin, size_t end, std::span<Vector3> bobs) const;
+
+	size_t size_ = 0;
+	float gravity_ = 9.8f;
+	std::vector<float> anchorX_, anchorY_, anchorZ_;
+	std::vector<float> length_;
+	std::vector<float> halfApexAngle_;
+	std::vector<float> angle_;
+	std::vector<float> angularVelocity_;
+};
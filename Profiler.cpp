@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Profiler.h"
+
+namespace Profiler {
+
+namespace {
+// 記録した区間
+struct Event {
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+};
+
+#ifdef _MSC_VER
+// キャッシュラインを分けるための詰め物はわざとなので、C4324(alignasで詰め物が入った)は出さない
+#pragma warning(push)
+#pragma warning(disable: 4324)
+#endif
+// スレッドごとのリングバッファ。書くのは持ち主のスレッド、読むのはEndFrameを呼ぶスレッドだけ
+// head(書いた数)とtail(読んだ数)は別々のスレッドが書くので、キャッシュラインを分けておく
+struct ThreadBuffer {
+	alignas(64) std::atomic<size_t> head{ 0 };
+	alignas(64) std::atomic<size_t> tail{ 0 };
+	std::atomic<size_t> dropped{ 0 };
+	uint32_t threadIndex = 0;
+	std::string name;
+	Event events[kRingCapacity];
+};
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+// キャプチャした区間
+struct CapturedEvent {
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+	uint32_t threadIndex;
+};
+
+// ゾーンごとの集計
+struct Zone {
+	ZoneStatistics statistics;
+	uint64_t ticks;                 // 今のフレームの合計
+	uint32_t callCount;
+	float history[kHistoryFrames];  // フレームごとの合計(ミリ秒)
+};
+
+static_assert((kRingCapacity & (kRingCapacity - 1)) == 0, "kRingCapacityは2のべき乗にすること");
+
+// EndFrameで作るフレーム全体の区間の名前
+constexpr const char* kFrameName = "Frame";
+
+// 較正の基準にする時刻。プロファイラを最初に使ったときに取る
+struct Origin {
+	uint64_t ticks = Now();
+	std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+};
+
+struct State {
+	Origin origin;
+
+	// スレッドの登録はまれなのでロックで守る。バッファは解放せず、終わったスレッドの分は次に登録するスレッドが使う
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	std::vector<ThreadBuffer*> freeBuffers;
+
+	// ここから下はメインループのスレッドだけが触る
+	std::vector<Zone> zones;
+	std::vector<ZoneStatistics> zoneStatistics;
+	FrameStatistics frameStatistics = {};
+	float frameHistory[kHistoryFrames] = {};
+	uint64_t frameStart = 0;
+	bool capturing = false;
+	uint64_t captureStart = 0;
+	std::vector<CapturedEvent> captured;
+};
+
+// スレッドの終了時(静的なオブジェクトを破棄した後のこともある)にも使うので、破棄しない
+State& GetState() {
+	static State* state = new State;
+	return *state;
+}
+
+// スレッドが終わるときに、そのスレッドのバッファを次に登録するスレッドのために返す
+// 回収していない区間はそのまま残り、次のEndFrameで回収される
+class ThreadBufferReleaser {
+public:
+	explicit ThreadBufferReleaser(ThreadBuffer*& buffer) : buffer_(buffer) {}
+	~ThreadBufferReleaser() {
+		State& state = GetState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.freeBuffers.push_back(buffer_);
+		buffer_ = nullptr;
+	}
+
+	ThreadBufferReleaser(const ThreadBufferReleaser&) = delete;
+	ThreadBufferReleaser& operator=(const ThreadBufferReleaser&) = delete;
+
+private:
+	ThreadBuffer*& buffer_;
+};
+
+// 呼び出したスレッドのバッファ。最初に呼ばれたときに、終わったスレッドのものがあればそれを、無ければ新しく登録する
+ThreadBuffer& GetThreadBuffer() {
+	thread_local ThreadBuffer* buffer = nullptr;
+	if (buffer == nullptr) {
+		State& state = GetState();
+		{
+			std::lock_guard<std::mutex> lock(state.mutex);
+			if (state.freeBuffers.empty()) {
+				state.buffers.push_back(std::make_unique<ThreadBuffer>());
+				buffer = state.buffers.back().get();
+				buffer->threadIndex = static_cast<uint32_t>(state.buffers.size() - 1);
+			} else {
+				buffer = state.freeBuffers.back();
+				state.freeBuffers.pop_back();
+			}
+			buffer->name = "Thread " + std::to_string(buffer->threadIndex);
+		}
+		thread_local ThreadBufferReleaser releaser(buffer);
+	}
+	return *buffer;
+}
+
+Zone& FindZone(State& state, const char* name) {
+	// 同じ場所のゾーンはポインタが同じなので先に比べる。違う場所でも同じ名前なら同じゾーンにまとめる
+	for (Zone& zone : state.zones) {
+		if (zone.statistics.name == name) {
+			return zone;
+		}
+	}
+	for (Zone& zone : state.zones) {
+		if (std::strcmp(zone.statistics.name, name) == 0) {
+			return zone;
+		}
+	}
+	Zone zone = {};
+	zone.statistics.name = name;
+	state.zones.push_back(zone);
+	return state.zones.back();
+}
+
+void Capture(State& state, const char* name, uint64_t start, uint64_t end, uint32_t threadIndex) {
+	if (state.captured.size() < kMaxCaptureEvents) {
+		state.captured.push_back({ name, start, end, threadIndex });
+	}
+}
+
+// 直近kHistoryFramesフレームの平均と最大
+void Summarize(const float (&history)[kHistoryFrames], uint64_t frameCount, double& average, double& max) {
+	const uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(frameCount, kHistoryFrames));
+	double sum = 0.0;
+	max = 0.0;
+	for (uint32_t i = 0; i < count; ++i) {
+		sum += history[i];
+		max = std::max<double>(max, history[i]);
+	}
+	average = count > 0 ? sum / count : 0.0;
+}
+
+// JSONの文字列として書けるようにエスケープする
+std::string Escape(const char* text) {
+	std::string result;
+	for (; *text != '\0'; ++text) {
+		char c = *text;
+		if (c == '"' || c == '\\') {
+			result += '\\';
+			result += c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			result += ' ';
+		} else {
+			result += c;
+		}
+	}
+	return result;
+}
+}
+
+double TicksPerSecond() {
+#if MT4_PROFILER_USE_RDTSC
+	const Origin& origin = GetState().origin;
+	// 経過時間が短いと誤差が大きいので、開始直後は少し待ってから測る
+	const auto minimum = std::chrono::milliseconds(10);
+	auto time = std::chrono::steady_clock::now();
+	while (time - origin.time < minimum) {
+		time = std::chrono::steady_clock::now();
+	}
+	const double seconds = std::chrono::duration<double>(time - origin.time).count();
+	return static_cast<double>(Now() - origin.ticks) / seconds;
+#else
+	return static_cast<double>(std::chrono::steady_clock::period::den) / static_cast<double>(std::chrono::steady_clock::period::num);
+#endif
+}
+
+void Record(const char* name, uint64_t start, uint64_t end) {
+	ThreadBuffer& buffer = GetThreadBuffer();
+	const size_t head = buffer.head.load(std::memory_order_relaxed);
+	if (head - buffer.tail.load(std::memory_order_acquire) >= kRingCapacity) {
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	buffer.events[head & (kRingCapacity - 1)] = { name, start, end };
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void SetThreadName(const std::string& name) {
+	ThreadBuffer& buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(GetState().mutex);
+	buffer.name = name;
+}
+
+void BeginFrame() {
+	GetState().frameStart = Now();
+}
+
+void EndFrame() {
+	State& state = GetState();
+	const uint64_t frameEnd = Now();
+	if (state.frameStart == 0) {
+		// BeginFrameを呼んでいない場合は前のEndFrameから数える
+		state.frameStart = frameEnd;
+	}
+	const double millisecondsPerTick = 1000.0 / TicksPerSecond();
+
+	// 全スレッドのバッファから回収して、ゾーンごとに足し合わせる
+	for (Zone& zone : state.zones) {
+		zone.ticks = 0;
+		zone.callCount = 0;
+	}
+	size_t eventCount = 0;
+	size_t droppedCount = 0;
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		for (const std::unique_ptr<ThreadBuffer>& buffer : state.buffers) {
+			const size_t tail = buffer->tail.load(std::memory_order_relaxed);
+			const size_t head = buffer->head.load(std::memory_order_acquire);
+			for (size_t i = tail; i < head; ++i) {
+				const Event& event = buffer->events[i & (kRingCapacity - 1)];
+				Zone& zone = FindZone(state, event.name);
+				zone.ticks += event.end - event.start;
+				++zone.callCount;
+				if (state.capturing && event.end >= state.captureStart) {
+					Capture(state, event.name, event.start, event.end, buffer->threadIndex);
+				}
+			}
+			buffer->tail.store(head, std::memory_order_release);
+			eventCount += head - tail;
+			droppedCount += buffer->dropped.load(std::memory_order_relaxed);
+		}
+	}
+	if (state.capturing && frameEnd >= state.captureStart) {
+		Capture(state, kFrameName, state.frameStart, frameEnd, GetThreadBuffer().threadIndex);
+	}
+
+	// フレームごとの履歴を更新する
+	FrameStatistics& frame = state.frameStatistics;
+	const uint32_t slot = static_cast<uint32_t>(frame.frameCount % kHistoryFrames);
+	++frame.frameCount;
+	frame.milliseconds = static_cast<double>(frameEnd - state.frameStart) * millisecondsPerTick;
+	frame.eventCount = eventCount;
+	frame.droppedCount = droppedCount;
+	state.frameHistory[slot] = static_cast<float>(frame.milliseconds);
+	Summarize(state.frameHistory, frame.frameCount, frame.averageMilliseconds, frame.maxMilliseconds);
+
+	state.zoneStatistics.resize(state.zones.size());
+	for (size_t i = 0; i < state.zones.size(); ++i) {
+		Zone& zone = state.zones[i];
+		ZoneStatistics& statistics = zone.statistics;
+		statistics.callCount = zone.callCount;
+		statistics.milliseconds = static_cast<double>(zone.ticks) * millisecondsPerTick;
+		zone.history[slot] = static_cast<float>(statistics.milliseconds);
+		Summarize(zone.history, frame.frameCount, statistics.averageMilliseconds, statistics.maxMilliseconds);
+		state.zoneStatistics[i] = statistics;
+	}
+	state.frameStart = frameEnd;
+}
+
+const FrameStatistics& GetFrameStatistics() {
+	return GetState().frameStatistics;
+}
+
+std::span<const ZoneStatistics> GetZoneStatistics() {
+	return GetState().zoneStatistics;
+}
+
+void BeginCapture() {
+	State& state = GetState();
+	state.captured.clear();
+	state.capturing = true;
+	state.captureStart = Now();
+}
+
+void EndCapture() {
+	GetState().capturing = false;
+}
+
+bool IsCapturing() {
+	return GetState().capturing;
+}
+
+bool WriteChromeTrace(const std::string& path) {
+	State& state = GetState();
+	std::ofstream file(path);
+	if (!file) {
+		return false;
+	}
+	const double microsecondsPerTick = 1.0e6 / TicksPerSecond();
+	// キャプチャの前に始まってキャプチャ中に終わった区間もあるので、一番早い時刻を0にする
+	uint64_t base = state.captureStart;
+	for (const CapturedEvent& event : state.captured) {
+		base = std::min(base, event.start);
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		for (const std::unique_ptr<ThreadBuffer>& buffer : state.buffers) {
+			file << (first ? "" : ",\n");
+			file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->threadIndex
+				<< ",\"args\":{\"name\":\"" << Escape(buffer->name.c_str()) << "\"}}";
+			first = false;
+		}
+	}
+	for (const CapturedEvent& event : state.captured) {
+		char numbers[96];
+		std::snprintf(numbers, sizeof(numbers), "\"ts\":%.3f,\"dur\":%.3f",
+			static_cast<double>(event.start - base) * microsecondsPerTick, static_cast<double>(event.end - event.start) * microsecondsPerTick);
+		file << (first ? "" : ",\n");
+		file << "{\"name\":\"" << Escape(event.name) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.threadIndex << "," << numbers << "}";
+		first = false;
+	}
+	file << "\n]}\n";
+	return static_cast<bool>(file);
+}
+
+} // namespace Profiler
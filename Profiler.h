@@ -0,0 +1,116 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define MT4_PROFILER_USE_RDTSC 1
+#else
+#include <chrono>
+#define MT4_PROFILER_USE_RDTSC 0
+#endif
+
+// 0にするとMT4_PROFILE_*のマクロが空になり、計測のコードごと消える(CMakeではMT4_ENABLE_PROFILER=OFF)
+#ifndef MT4_ENABLE_PROFILER
+#define MT4_ENABLE_PROFILER 1
+#endif
+
+// フレーム単位の簡単なプロファイラ
+// 計測区間(ゾーン)はスコープの開始と終了の時刻を、スレッドごとのリングバッファ(書くのはそのスレッドだけ)に積む
+// EndFrameで全スレッドのバッファを回収して、ゾーンごとのフレーム内の合計時間と直近kHistoryFramesフレームの平均・最大を求める
+// キャプチャ中の区間はためておき、Chromeのトレース形式(chrome://tracing, Perfetto)のJSONに書き出せる
+// BeginFrame・EndFrame・キャプチャの操作・統計の取得は同じ1つのスレッド(メインループ)から呼ぶこと
+namespace Profiler {
+
+// 統計を取るフレーム数
+constexpr uint32_t kHistoryFrames = 120;
+// スレッドごとのリングバッファに入る区間の数。EndFrameまでに溢れた分は捨てて数える
+constexpr size_t kRingCapacity = size_t(1) << 14;
+// キャプチャしておく区間の最大数
+constexpr size_t kMaxCaptureEvents = size_t(1) << 20;
+
+// ゾーンごとの統計(時間は入れ子の内側のゾーンも含む。複数のスレッドで同時に動いた分は足し合わせる)
+struct ZoneStatistics {
+	const char* name;
+	uint32_t callCount;         // 直近のフレームで終わった回数
+	double milliseconds;        // 直近のフレームでの合計
+	double averageMilliseconds; // 直近kHistoryFramesフレームの平均
+	double maxMilliseconds;     // 直近kHistoryFramesフレームの最大
+};
+
+// フレーム全体の統計
+struct FrameStatistics {
+	uint64_t frameCount;        // EndFrameを呼んだ回数
+	double milliseconds;        // 直近のフレームのBeginFrameからEndFrameまで
+	double averageMilliseconds;
+	double maxMilliseconds;
+	size_t eventCount;          // 直近のフレームで回収した区間の数
+	size_t droppedCount;        // リングバッファが溢れて捨てた区間の数(累計)
+};
+
+// 時刻(x86ではタイムスタンプカウンタ、それ以外ではsteady_clockのナノ秒)
+inline uint64_t Now() {
+#if MT4_PROFILER_USE_RDTSC
+	return __rdtsc();
+#else
+	return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Nowの値が1秒あたりに進む量(プロファイラを最初に使ってからの経過時間で較正する)
+double TicksPerSecond();
+
+// 呼び出したスレッドのリングバッファに区間を積む。nameは文字列リテラルなどプログラムの終わりまで残る文字列
+void Record(const char* name, uint64_t start, uint64_t end);
+// 呼び出したスレッドの名前(トレースに表示する)。指定しなければ"Thread 番号"
+// 番号とバッファは終わったスレッドのものを次に記録を始めたスレッドが引き継ぐので、短命なスレッドが多くてもメモリは増えない
+void SetThreadName(const std::string& name);
+
+void BeginFrame();
+// 全スレッドの区間を回収して統計を更新する
+void EndFrame();
+const FrameStatistics& GetFrameStatistics();
+// 一度でも記録されたゾーンの統計(最初に記録された順)
+std::span<const ZoneStatistics> GetZoneStatistics();
+
+// これより後に終わった区間をEndFrameで回収するたびにためる(前にためていた区間は捨てる)
+void BeginCapture();
+void EndCapture();
+bool IsCapturing();
+// ためた区間をChromeのトレース形式で書き出す。失敗したらfalseを返す
+bool WriteChromeTrace(const std::string& path);
+
+// スコープの開始から終了までを1つの区間として記録する
+class ScopedZone {
+public:
+	explicit ScopedZone(const char* name) : name_(name), start_(Now()) {}
+	~ScopedZone() { Record(name_, start_, Now()); }
+
+	ScopedZone(const ScopedZone&) = delete;
+	ScopedZone& operator=(const ScopedZone&) = delete;
+
+private:
+	const char* name_;
+	uint64_t start_;
+};
+
+} // namespace Profiler
+
+#if MT4_ENABLE_PROFILER
+#define MT4_PROFILE_CONCAT_INNER(a, b) a##b
+#define MT4_PROFILE_CONCAT(a, b) MT4_PROFILE_CONCAT_INNER(a, b)
+// このスコープの終わりまでをnameのゾーンとして計測する
+#define MT4_PROFILE_ZONE(name) ::Profiler::ScopedZone MT4_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define MT4_PROFILE_BEGIN_FRAME() ::Profiler::BeginFrame()
+#define MT4_PROFILE_END_FRAME() ::Profiler::EndFrame()
+#define MT4_PROFILE_THREAD_NAME(name) ::Profiler::SetThreadName(name)
+#else
+#define MT4_PROFILE_ZONE(name) ((void)0)
+#define MT4_PROFILE_BEGIN_FRAME() ((void)0)
+#define MT4_PROFILE_END_FRAME() ((void)0)
+#define MT4_PROFILE_THREAD_NAME(name) ((void)0)
+#endif
@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include "Rasterizer.h"
+#include "Function.h"
+#include "Profiler.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+namespace {
+// 固定小数点の小数部のビット数(1ピクセルを256に分ける)
+constexpr int32_t kSubPixelBits = 8;
+constexpr int32_t kSubPixelOne = 1 << kSubPixelBits;
+constexpr int32_t kSubPixelHalf = kSubPixelOne / 2;
+// クリップ空間の6枚の平面で切り取ると、三角形は最大9角形になる
+constexpr int kMaxPolygonVertices = 9;
+
+// クリップ座標(x, y, z, w)から各平面までの距離。0以上が見える側。並びはFrustumと同じ(左, 右, 下, 上, 近, 遠)
+float ClipDistance(const float* v, int plane) {
+	switch (plane) {
+	case 0: return v[3] + v[0];
+	case 1: return v[3] - v[0];
+	case 2: return v[3] + v[1];
+	case 3: return v[3] - v[1];
+	case 4: return v[2];
+	default: return v[3] - v[2];
+	}
+}
+
+// 見える側にない平面のビットを立てる
+uint32_t ComputeOutCode(const float* v) {
+	uint32_t code = 0;
+	for (int plane = 0; plane < 6; ++plane) {
+		if (ClipDistance(v, plane) < 0.0f) {
+			code |= 1u << plane;
+		}
+	}
+	return code;
+}
+
+// マスクに含まれる平面で凸多角形を順に切り取る(Sutherland-Hodgman)。切り取った後の頂点数を返す
+int ClipPolygon(float (*polygon)[4], int count, uint32_t planeMask) {
+	float buffer[kMaxPolygonVertices][4];
+	for (int plane = 0; plane < 6 && count > 0; ++plane) {
+		if ((planeMask & (1u << plane)) == 0) {
+			continue;
+		}
+		int outCount = 0;
+		for (int i = 0; i < count; ++i) {
+			const float* current = polygon[i];
+			const float* next = polygon[(i + 1) % count];
+			float currentDistance = ClipDistance(current, plane);
+			float nextDistance = ClipDistance(next, plane);
+			if (currentDistance >= 0.0f) {
+				std::copy(current, current + 4, buffer[outCount++]);
+			}
+			if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+				float t = currentDistance / (currentDistance - nextDistance);
+				for (int k = 0; k < 4; ++k) {
+					buffer[outCount][k] = current[k] + t * (next[k] - current[k]);
+				}
+				++outCount;
+			}
+		}
+		count = outCount;
+		std::copy(&buffer[0][0], &buffer[0][0] + count * 4, &polygon[0][0]);
+	}
+	return count;
+}
+
+// 範囲の端の画素(中心が[minFixed, maxFixed]に入るもの)。固定小数点の座標はクリッピング済みなので0付近より小さくはならない
+int32_t FirstPixel(int32_t minFixed) {
+	return (minFixed - kSubPixelHalf + kSubPixelOne - 1) >> kSubPixelBits;
+}
+int32_t LastPixel(int32_t maxFixed) {
+	return (maxFixed - kSubPixelHalf) >> kSubPixelBits;
+}
+}
+
+Rasterizer::Rasterizer(int32_t width, int32_t height)
+	: width_(width), height_(height) {
+	assert(width > 0 && height > 0);
+	tilesX_ = (width + kTileSize - 1) / kTileSize;
+	tilesY_ = (height + kTileSize - 1) / kTileSize;
+	viewport_ = MakeViewportMatrix(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f);
+	color_.resize(static_cast<size_t>(width) * height);
+	depth_.resize(static_cast<size_t>(width) * height);
+	Clear();
+}
+
+void Rasterizer::Clear(uint32_t color) {
+	std::fill(color_.begin(), color_.end(), color);
+	std::fill(depth_.begin(), depth_.end(), 1.0f);
+	statistics_ = {};
+}
+
+#pragma region 描画
+void Rasterizer::Draw(std::span<const Triangle> triangles, const Matrix4x4& worldViewProjection) {
+	MT4_PROFILE_ZONE("Rasterizer::Draw");
+	const auto start = std::chrono::steady_clock::now();
+	const size_t chunkCount = (triangles.size() + kChunkSize - 1) / kChunkSize;
+	if (chunks_.size() < chunkCount) {
+		chunks_.resize(chunkCount);
+	}
+
+	// 座標変換・クリッピング・振り分け。区切りの番号がそのままchunkの番号になる
+	auto processRange = [&](size_t begin, size_t end, uint32_t) {
+		ProcessChunk(triangles, worldViewProjection, begin, end, chunks_[begin / kChunkSize]);
+	};
+	if (pool_ != nullptr) {
+		pool_->ParallelFor(triangles.size(), kChunkSize, processRange);
+	} else {
+		for (size_t begin = 0; begin < triangles.size(); begin += kChunkSize) {
+			processRange(begin, std::min(begin + kChunkSize, triangles.size()), 0u);
+		}
+	}
+
+	// 塗りつぶし。タイルは重ならないので、別々のスレッドが書き込んでも競合しない
+	const size_t tileCount = static_cast<size_t>(tilesX_) * tilesY_;
+	auto rasterizeRange = [&](size_t begin, size_t end, uint32_t) {
+		for (size_t tile = begin; tile < end; ++tile) {
+			RasterizeTile(static_cast<int32_t>(tile), chunkCount);
+		}
+	};
+	if (pool_ != nullptr) {
+		pool_->ParallelFor(tileCount, 1, rasterizeRange);
+	} else {
+		rasterizeRange(0, tileCount, 0u);
+	}
+
+	statistics_.inputTriangles += triangles.size();
+	for (size_t i = 0; i < chunkCount; ++i) {
+		statistics_.culledTriangles += chunks_[i].culled;
+		statistics_.clippedTriangles += chunks_[i].clipped;
+		statistics_.rasterizedTriangles += chunks_[i].triangles.size();
+		statistics_.tileEntries += chunks_[i].entries.size();
+	}
+	statistics_.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Rasterizer::ProcessChunk(std::span<const Triangle> triangles, const Matrix4x4& worldViewProjection, size_t begin, size_t end, Chunk& chunk) const {
+	chunk.triangles.clear();
+	chunk.culled = 0;
+	chunk.clipped = 0;
+
+	// 行ベクトルなので クリップ座標 = x * 0行目 + y * 1行目 + z * 2行目 + 3行目
+	const __m128 row0 = _mm_loadu_ps(worldViewProjection.m[0]);
+	const __m128 row1 = _mm_loadu_ps(worldViewProjection.m[1]);
+	const __m128 row2 = _mm_loadu_ps(worldViewProjection.m[2]);
+	const __m128 row3 = _mm_loadu_ps(worldViewProjection.m[3]);
+	for (size_t i = begin; i < end; ++i) {
+		const Triangle& triangle = triangles[i];
+		float polygon[kMaxPolygonVertices][4];
+		uint32_t codeAnd = 0x3F;
+		uint32_t codeOr = 0;
+		for (int k = 0; k < 3; ++k) {
+			const Vector3& v = triangle.vertex[k];
+			__m128 clip = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.x), row0), _mm_mul_ps(_mm_set1_ps(v.y), row1)),
+				_mm_mul_ps(_mm_set1_ps(v.z), row2)), row3);
+			_mm_storeu_ps(polygon[k], clip);
+			uint32_t code = ComputeOutCode(polygon[k]);
+			codeAnd &= code;
+			codeOr |= code;
+		}
+		// 全ての頂点が同じ平面の外にあれば見えない
+		if (codeAnd != 0) {
+			++chunk.culled;
+			continue;
+		}
+		int count = 3;
+		if (codeOr != 0) {
+			++chunk.clipped;
+			count = ClipPolygon(polygon, count, codeOr);
+		}
+		if (count < 3 || SetupPolygon(polygon, count, triangle.color, chunk) == 0) {
+			++chunk.culled;
+		}
+	}
+
+	// タイルごとの三角形の一覧(CSR)。三角形の外接矩形が重なるタイルに入れる
+	const size_t tileCount = static_cast<size_t>(tilesX_) * tilesY_;
+	chunk.tileStart.assign(tileCount + 1, 0);
+	for (const SetupTriangle& triangle : chunk.triangles) {
+		for (int32_t ty = triangle.minY / kTileSize; ty <= triangle.maxY / kTileSize; ++ty) {
+			for (int32_t tx = triangle.minX / kTileSize; tx <= triangle.maxX / kTileSize; ++tx) {
+				++chunk.tileStart[static_cast<size_t>(ty) * tilesX_ + tx + 1];
+			}
+		}
+	}
+	for (size_t tile = 0; tile < tileCount; ++tile) {
+		chunk.tileStart[tile + 1] += chunk.tileStart[tile];
+	}
+	chunk.entries.resize(chunk.tileStart[tileCount]);
+	// 埋めた位置を進めるため一時的に開始位置をずらし、最後に戻す
+	for (uint32_t index = 0; index < chunk.triangles.size(); ++index) {
+		const SetupTriangle& triangle = chunk.triangles[index];
+		for (int32_t ty = triangle.minY / kTileSize; ty <= triangle.maxY / kTileSize; ++ty) {
+			for (int32_t tx = triangle.minX / kTileSize; tx <= triangle.maxX / kTileSize; ++tx) {
+				chunk.entries[chunk.tileStart[static_cast<size_t>(ty) * tilesX_ + tx]++] = index;
+			}
+		}
+	}
+	for (size_t tile = tileCount; tile > 0; --tile) {
+		chunk.tileStart[tile] = chunk.tileStart[tile - 1];
+	}
+	chunk.tileStart[0] = 0;
+}
+
+size_t Rasterizer::SetupPolygon(const float (*vertices)[4], int count, uint32_t color, Chunk& chunk) const {
+	// w除算とビューポート変換をして、座標を固定小数点にする
+	int32_t x[kMaxPolygonVertices];
+	int32_t y[kMaxPolygonVertices];
+	float z[kMaxPolygonVertices];
+	for (int i = 0; i < count; ++i) {
+		float w = vertices[i][3];
+		if (!(w > 0.0f)) {
+			return 0;
+		}
+		float inverseW = 1.0f / w;
+		float screenX = vertices[i][0] * inverseW * viewport_.m[0][0] + viewport_.m[3][0];
+		float screenY = vertices[i][1] * inverseW * viewport_.m[1][1] + viewport_.m[3][1];
+		x[i] = static_cast<int32_t>(std::floor(screenX * kSubPixelOne + 0.5f));
+		y[i] = static_cast<int32_t>(std::floor(screenY * kSubPixelOne + 0.5f));
+		z[i] = vertices[i][2] * inverseW * viewport_.m[2][2] + viewport_.m[3][2];
+	}
+
+	size_t added = 0;
+	for (int i = 1; i + 1 < count; ++i) {
+		SetupTriangle triangle = {};
+		const int index[3] = { 0, i, i + 1 };
+		for (int k = 0; k < 3; ++k) {
+			triangle.x[k] = x[index[k]];
+			triangle.y[k] = y[index[k]];
+			triangle.z[k] = z[index[k]];
+		}
+		// 画面はy軸が下向きなので、面積が正なら時計回り(表)
+		int64_t area = static_cast<int64_t>(triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) -
+			static_cast<int64_t>(triangle.y[1] - triangle.y[0]) * (triangle.x[2] - triangle.x[0]);
+		if (area == 0 || (area < 0 && cullMode_ == CullMode::Back)) {
+			continue;
+		}
+		// 裏面は頂点を入れ替えて、塗りつぶしでは常に時計回りとして扱う
+		if (area < 0) {
+			std::swap(triangle.x[1], triangle.x[2]);
+			std::swap(triangle.y[1], triangle.y[2]);
+			std::swap(triangle.z[1], triangle.z[2]);
+		}
+		triangle.minX = std::max(FirstPixel(std::min({ triangle.x[0], triangle.x[1], triangle.x[2] })), 0);
+		triangle.minY = std::max(FirstPixel(std::min({ triangle.y[0], triangle.y[1], triangle.y[2] })), 0);
+		triangle.maxX = std::min(LastPixel(std::max({ triangle.x[0], triangle.x[1], triangle.x[2] })), width_ - 1);
+		triangle.maxY = std::min(LastPixel(std::max({ triangle.y[0], triangle.y[1], triangle.y[2] })), height_ - 1);
+		// 画素の中心を1つも含まない小さな三角形
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+			continue;
+		}
+		triangle.color = color;
+		chunk.triangles.push_back(triangle);
+		++added;
+	}
+	return added;
+}
+
+void Rasterizer::RasterizeTile(int32_t tile, size_t chunkCount) {
+	const int32_t tileMinX = (tile % tilesX_) * kTileSize;
+	const int32_t tileMinY = (tile / tilesX_) * kTileSize;
+	const int32_t tileMaxX = std::min(tileMinX + kTileSize, width_) - 1;
+	const int32_t tileMaxY = std::min(tileMinY + kTileSize, height_) - 1;
+	for (size_t i = 0; i < chunkCount; ++i) {
+		const Chunk& chunk = chunks_[i];
+		for (uint32_t k = chunk.tileStart[tile]; k < chunk.tileStart[tile + 1]; ++k) {
+			RasterizeTriangle(chunk.triangles[chunk.entries[k]], tileMinX, tileMinY, tileMaxX, tileMaxY);
+		}
+	}
+}
+
+// 辺の式 E(p) = (b - a) × (p - a) が3辺とも0以上の画素を塗る(頂点は時計回りに並べてある)
+// 辺の上に中心がある画素は、左の辺(dy < 0)か上の辺(dy == 0 && dx > 0)のものだけ塗る(トップレフトルール)
+// 隣り合う三角形の境界の画素を二重に塗ったり塗り残したりしない
+void Rasterizer::RasterizeTriangle(const SetupTriangle& triangle, int32_t tileMinX, int32_t tileMinY, int32_t tileMaxX, int32_t tileMaxY) {
+	const int32_t minX = std::max(triangle.minX, tileMinX);
+	const int32_t minY = std::max(triangle.minY, tileMinY);
+	const int32_t maxX = std::min(triangle.maxX, tileMaxX);
+	const int32_t maxY = std::min(triangle.maxY, tileMaxY);
+	if (minX > maxX || minY > maxY) {
+		return;
+	}
+
+	// 左上の画素の中心での辺の式と、1画素進んだときの増分
+	const int64_t startX = static_cast<int64_t>(minX) * kSubPixelOne + kSubPixelHalf;
+	const int64_t startY = static_cast<int64_t>(minY) * kSubPixelOne + kSubPixelHalf;
+	int64_t rowEdge[3];
+	int64_t stepX[3];
+	int64_t stepY[3];
+	for (int k = 0; k < 3; ++k) {
+		const int a = k;
+		const int b = (k + 1) % 3;
+		const int64_t dx = triangle.x[b] - triangle.x[a];
+		const int64_t dy = triangle.y[b] - triangle.y[a];
+		const bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+		rowEdge[k] = dx * (startY - triangle.y[a]) - dy * (startX - triangle.x[a]) + (topLeft ? 0 : -1);
+		stepX[k] = -dy * kSubPixelOne;
+		stepY[k] = dx * kSubPixelOne;
+	}
+
+	// 深度は画面上の平面 z = z0 + dzdx * (x - x0) + dzdy * (y - y0) で補間する(座標はピクセル単位)
+	const float x0 = static_cast<float>(triangle.x[0]) / kSubPixelOne;
+	const float y0 = static_cast<float>(triangle.y[0]) / kSubPixelOne;
+	const float x10 = static_cast<float>(triangle.x[1] - triangle.x[0]) / kSubPixelOne;
+	const float y10 = static_cast<float>(triangle.y[1] - triangle.y[0]) / kSubPixelOne;
+	const float x20 = static_cast<float>(triangle.x[2] - triangle.x[0]) / kSubPixelOne;
+	const float y20 = static_cast<float>(triangle.y[2] - triangle.y[0]) / kSubPixelOne;
+	const float z10 = triangle.z[1] - triangle.z[0];
+	const float z20 = triangle.z[2] - triangle.z[0];
+	const float inverseArea = 1.0f / (x10 * y20 - y10 * x20);
+	const float dzdx = (z10 * y20 - z20 * y10) * inverseArea;
+	const float dzdy = (z20 * x10 - z10 * x20) * inverseArea;
+	const float rowDepthStart = triangle.z[0] + dzdx * (static_cast<float>(minX) + 0.5f - x0) + dzdy * (static_cast<float>(minY) + 0.5f - y0);
+
+	for (int32_t py = minY; py <= maxY; ++py) {
+		int64_t e0 = rowEdge[0];
+		int64_t e1 = rowEdge[1];
+		int64_t e2 = rowEdge[2];
+		const float rowDepth = rowDepthStart + dzdy * static_cast<float>(py - minY);
+		uint32_t* colorRow = color_.data() + static_cast<size_t>(py) * width_;
+		float* depthRow = depth_.data() + static_cast<size_t>(py) * width_;
+		for (int32_t px = minX; px <= maxX; ++px) {
+			if ((e0 | e1 | e2) >= 0) {
+				float depth = rowDepth + dzdx * static_cast<float>(px - minX);
+				if (depth < depthRow[px]) {
+					depthRow[px] = depth;
+					colorRow[px] = triangle.color;
+				}
+			}
+			e0 += stepX[0];
+			e1 += stepX[1];
+			e2 += stepX[2];
+		}
+		rowEdge[0] += stepY[0];
+		rowEdge[1] += stepY[1];
+		rowEdge[2] += stepY[2];
+	}
+}
+#pragma endregion
+
+#pragma region 出力
+bool Rasterizer::WritePPM(const std::string& path) const {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	file << "P6\n" << width_ << ' ' << height_ << "\n255\n";
+	std::vector<char> row(static_cast<size_t>(width_) * 3);
+	for (int32_t y = 0; y < height_; ++y) {
+		for (int32_t x = 0; x < width_; ++x) {
+			uint32_t color = GetPixel(x, y);
+			row[x * 3 + 0] = static_cast<char>((color >> 24) & 0xFF);
+			row[x * 3 + 1] = static_cast<char>((color >> 16) & 0xFF);
+			row[x * 3 + 2] = static_cast<char>((color >> 8) & 0xFF);
+		}
+		file.write(row.data(), static_cast<std::streamsize>(row.size()));
+	}
+	return static_cast<bool>(file);
+}
+#pragma endregion
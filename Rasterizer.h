@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "Struct.h"
+
+class ThreadPool;
+
+// CPUで三角形を塗るソフトウェアラスタライザ(Noviceの無い環境でも描画結果を確認できるようにする)
+// 頂点の座標変換 → クリッピング → 画面のタイルへの振り分け → タイルごとの塗りつぶし(深度テスト付き) の順に処理する
+// 座標変換と振り分けは三角形を一定数ずつ、塗りつぶしはタイルごとに並列に処理する
+// 各タイルは三角形を渡された順に塗るので、スレッド数によらず結果は一致する
+// 色はNoviceと同じ0xRRGGBBAA。アルファは無視して上書きする
+class Rasterizer {
+public:
+	// タイルの一辺のピクセル数
+	static constexpr int32_t kTileSize = 64;
+	// 座標変換と振り分けを1スレッドがまとめて処理する三角形の数
+	static constexpr size_t kChunkSize = 1024;
+
+	enum class CullMode {
+		None, // 両面を描く
+		Back, // 画面上で反時計回りの三角形(裏面)を描かない。DirectXと同じく時計回りが表
+	};
+
+	// 直近のClearからの統計
+	struct Statistics {
+		size_t inputTriangles;      // Drawに渡された三角形の数
+		size_t culledTriangles;     // 視錐台の外・裏面・面積0で捨てた三角形の数
+		size_t clippedTriangles;    // 視錐台の面をまたいでいて切り取った三角形の数
+		size_t rasterizedTriangles; // 塗りつぶした三角形の数(切り取りで分かれた分も数える)
+		size_t tileEntries;         // タイルに振り分けた延べ数
+		double seconds;             // Drawにかかった時間の合計
+
+		// 1秒あたりに処理できる三角形の数
+		double TrianglesPerSecond() const { return seconds > 0.0 ? static_cast<double>(inputTriangles) / seconds : 0.0; }
+	};
+
+	explicit Rasterizer(int32_t width = kWindowWidth, int32_t height = kWindowHeight);
+
+	int32_t GetWidth() const { return width_; }
+	int32_t GetHeight() const { return height_; }
+
+	// nullptrなら呼び出したスレッドだけで処理する
+	void SetThreadPool(ThreadPool* pool) { pool_ = pool; }
+	void SetCullMode(CullMode cullMode) { cullMode_ = cullMode; }
+
+	// 色を塗りつぶし、深度を1(一番奥)に戻し、統計をリセットする
+	void Clear(uint32_t color = 0x000000FF);
+	// 三角形をまとめて描く。worldViewProjectionは行ベクトルでクリップ空間(zは0～1)へ変換する行列
+	void Draw(std::span<const Triangle> triangles, const Matrix4x4& worldViewProjection);
+
+	// 色(0xRRGGBBAA)と深度。左上から行ごとに並んでいる
+	const std::vector<uint32_t>& GetColorBuffer() const { return color_; }
+	const std::vector<float>& GetDepthBuffer() const { return depth_; }
+	uint32_t GetPixel(int32_t x, int32_t y) const { return color_[static_cast<size_t>(y) * width_ + x]; }
+	// バイナリのPPM(P6)で書き出す。書き込めなければfalseを返す
+	bool WritePPM(const std::string& path) const;
+
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private:
+	// 画面座標に変換して、辺の式を作るまで済ませた三角形
+	// 座標は小数部8bitの固定小数点。深度は画面上で線形に補間する
+	struct SetupTriangle {
+		int32_t x[3];
+		int32_t y[3];
+		float z[3];
+		int32_t minX, minY, maxX, maxY; // 塗る範囲(ピクセル、両端を含む)
+		uint32_t color;
+	};
+
+	// kChunkSize個の三角形の処理結果。タイルごとの三角形の一覧はCSR形式で持つ
+	struct Chunk {
+		std::vector<SetupTriangle> triangles;
+		std::vector<uint32_t> tileStart; // タイル数 + 1
+		std::vector<uint32_t> entries;   // trianglesの添字
+		size_t culled;  // 描く三角形が1つも残らなかった入力の三角形の数
+		size_t clipped; // 切り取った入力の三角形の数
+	};
+
+	// [begin, end)番目の三角形を変換・クリッピングしてchunkにまとめ、タイルに振り分ける
+	void ProcessChunk(std::span<const Triangle> triangles, const Matrix4x4& worldViewProjection, size_t begin, size_t end, Chunk& chunk) const;
+	// クリップ空間の凸多角形を扇状に三角形に分け、画面座標にしてchunkに追加する。追加した数を返す
+	size_t SetupPolygon(const float (*vertices)[4], int count, uint32_t color, Chunk& chunk) const;
+	// tile番目のタイルに振り分けた三角形を全てのchunkから順に塗る
+	void RasterizeTile(int32_t tile, size_t chunkCount);
+	void RasterizeTriangle(const SetupTriangle& triangle, int32_t tileMinX, int32_t tileMinY, int32_t tileMaxX, int32_t tileMaxY);
+
+	int32_t width_;
+	int32_t height_;
+	int32_t tilesX_;
+	int32_t tilesY_;
+	Matrix4x4 viewport_;
+	std::vector<uint32_t> color_;
+	std::vector<float> depth_;
+	std::vector<Chunk> chunks_;
+	ThreadPool* pool_ = nullptr;
+	CullMode cullMode_ = CullMode::None;
+	Statistics statistics_ = {};
+};
@@ -0,0 +1,1237 @@
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include "RigidBodyWorld.h"
+#include "Collision.h"
+#include "Function.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+namespace {
+// この距離まで離れている所も接触点にしておき、近づく速さをその距離で止まる分に抑える(すり抜けと接触の出入りによる振動を防ぐ)
+constexpr float kContactMargin = 0.02f;
+// 接触を押し戻すばねの固有振動数(Hz)と減衰比。振動数は1秒あたりのサブステップ数の4分の1までに抑える
+constexpr float kContactHertz = 60.0f;
+constexpr float kContactDampingRatio = 10.0f;
+// めり込みを押し戻す最大の速さ
+constexpr float kMaxPushVelocity = 3.0f;
+// これより遅くぶつかったときは跳ね返らない
+constexpr float kRestitutionThreshold = 1.0f;
+// 剛体の表面の速さ(重心の速さと、回転による一番外側の点の速さの大きい方)がこれより遅い状態がkTimeToSleep秒続いたら止まっているとみなす
+constexpr float kSleepSpeed = 0.05f;
+constexpr float kTimeToSleep = 0.5f;
+// 前のステップの接触点と同じとみなす距離(剛体のローカル座標で比べる)
+constexpr float kMatchDistance = 0.05f;
+// 箱同士で、辺の組より面を、Bの面よりAの面を優先する(分離量の差がこれ以下なら前者を使い、フレームごとに切り替わらないようにする)
+constexpr float kRelativeTolerance = 0.98f;
+constexpr float kAbsoluteTolerance = 0.001f;
+// 並列に処理するときに1つの区切りで扱う数
+constexpr size_t kBodyGrainSize = 128;
+constexpr size_t kPairGrainSize = 64;
+constexpr size_t kManifoldGrainSize = 256;
+
+// 柔らかい拘束の係数(ばねとダンパーを陰的に解いたときの、押し戻しの速さの割合と質量・力積の倍率)
+struct Softness {
+	float biasRate;
+	float massScale;
+	float impulseScale;
+};
+
+Softness MakeSoftness(float hertz, float dampingRatio, float h) {
+	const float omega = 2.0f * 3.14159265f * hertz;
+	const float a1 = 2.0f * dampingRatio + h * omega;
+	const float a2 = h * omega * a1;
+	const float a3 = 1.0f / (1.0f + a2);
+	return { omega / a1, a2 * a3, a3 };
+}
+
+// 形状どうしの接触点(法線は1つ目の形状から2つ目の形状へ向かう向き、depthは離れていれば負)
+constexpr uint32_t kMaxPoints = 4;
+struct Contacts {
+	Vector3 normal;
+	uint32_t count;
+	Vector3 points[kMaxPoints];
+	float depths[kMaxPoints];
+};
+
+float Component(const Vector3& v, int i) {
+	return i == 0 ? v.x : (i == 1 ? v.y : v.z);
+}
+
+float LengthSquared(const Vector3& v) {
+	return Dot(v, v);
+}
+
+// 対称な3x3行列とベクトルの積
+Vector3 Multiply(const float (&m)[3][3], const Vector3& v) {
+	return {
+		m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+		m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+		m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z,
+	};
+}
+
+// 行を回転後の座標軸とする回転行列(OBBのorientations)からクォータニオンを求める
+Quaternion MakeQuaternion(const Vector3 (&axes)[3]) {
+	const float m00 = axes[0].x, m01 = axes[0].y, m02 = axes[0].z;
+	const float m10 = axes[1].x, m11 = axes[1].y, m12 = axes[1].z;
+	const float m20 = axes[2].x, m21 = axes[2].y, m22 = axes[2].z;
+	const float trace = m00 + m11 + m22;
+	Quaternion q;
+	if (trace > 0.0f) {
+		float s = 2.0f * std::sqrt(1.0f + trace);
+		q = { (m12 - m21) / s, (m20 - m02) / s, (m01 - m10) / s, 0.25f * s };
+	} else if (m00 > m11 && m00 > m22) {
+		float s = 2.0f * std::sqrt(1.0f + m00 - m11 - m22);
+		q = { 0.25f * s, (m01 + m10) / s, (m02 + m20) / s, (m12 - m21) / s };
+	} else if (m11 > m22) {
+		float s = 2.0f * std::sqrt(1.0f + m11 - m00 - m22);
+		q = { (m01 + m10) / s, 0.25f * s, (m12 + m21) / s, (m20 - m02) / s };
+	} else {
+		float s = 2.0f * std::sqrt(1.0f + m22 - m00 - m11);
+		q = { (m02 + m20) / s, (m12 + m21) / s, 0.25f * s, (m01 - m10) / s };
+	}
+	return Normalize(q);
+}
+
+// Y軸をdirection(正規化済み)に向ける回転
+Quaternion MakeQuaternionFromY(const Vector3& direction) {
+	const Vector3 y = { 0.0f, 1.0f, 0.0f };
+	float w = 1.0f + Dot(y, direction);
+	if (w < 1.0e-6f) {
+		// 真下を向くときはX軸まわりに180度回す
+		return { 1.0f, 0.0f, 0.0f, 0.0f };
+	}
+	Vector3 axis = Cross(y, direction);
+	return Normalize(Quaternion{ axis.x, axis.y, axis.z, w });
+}
+
+void AddPoint(Contacts& contacts, const Vector3& point, float depth) {
+	if (contacts.count < kMaxPoints) {
+		contacts.points[contacts.count] = point;
+		contacts.depths[contacts.count] = depth;
+		++contacts.count;
+	}
+}
+
+// 近い点が既にあれば深い方を残す
+void AddUniquePoint(Contacts& contacts, const Vector3& point, float depth) {
+	for (uint32_t i = 0; i < contacts.count; ++i) {
+		if (LengthSquared(contacts.points[i] - point) < kMatchDistance * kMatchDistance) {
+			if (depth > contacts.depths[i]) {
+				contacts.points[i] = point;
+				contacts.depths[i] = depth;
+			}
+			return;
+		}
+	}
+	AddPoint(contacts, point, depth);
+}
+
+// 多数の接触点から、一番深い点と、それを含んで面積がなるべく大きくなる4点を選ぶ
+void ReducePoints(const Vector3* points, const float* depths, uint32_t count, const Vector3& normal, Contacts& contacts) {
+	contacts.count = 0;
+	if (count <= kMaxPoints) {
+		for (uint32_t i = 0; i < count; ++i) {
+			AddPoint(contacts, points[i], depths[i]);
+		}
+		return;
+	}
+	uint32_t chosen[kMaxPoints];
+	chosen[0] = 0;
+	for (uint32_t i = 1; i < count; ++i) {
+		if (depths[i] > depths[chosen[0]]) {
+			chosen[0] = i;
+		}
+	}
+	const Vector3& p0 = points[chosen[0]];
+	chosen[1] = chosen[0];
+	float farthest = -1.0f;
+	for (uint32_t i = 0; i < count; ++i) {
+		float d = LengthSquared(points[i] - p0);
+		if (d > farthest) {
+			farthest = d;
+			chosen[1] = i;
+		}
+	}
+	const Vector3 edge = points[chosen[1]] - p0;
+	chosen[2] = chosen[0];
+	chosen[3] = chosen[0];
+	float maxArea = 0.0f;
+	float minArea = 0.0f;
+	for (uint32_t i = 0; i < count; ++i) {
+		float area = Dot(Cross(edge, points[i] - p0), normal);
+		if (area > maxArea) {
+			maxArea = area;
+			chosen[2] = i;
+		}
+		if (area < minArea) {
+			minArea = area;
+			chosen[3] = i;
+		}
+	}
+	for (uint32_t i = 0; i < kMaxPoints; ++i) {
+		bool duplicate = false;
+		for (uint32_t j = 0; j < i; ++j) {
+			duplicate = duplicate || chosen[j] == chosen[i];
+		}
+		if (!duplicate) {
+			AddPoint(contacts, points[chosen[i]], depths[chosen[i]]);
+		}
+	}
+}
+
+Sphere Inflate(Sphere sphere) {
+	sphere.radius += kContactMargin;
+	return sphere;
+}
+
+Capsule Inflate(Capsule capsule) {
+	capsule.radius += kContactMargin;
+	return capsule;
+}
+
+// 1点だけの接触。形状を接触の余裕の分だけ太らせて判定し、めり込み量から戻す
+template<typename Shape1, typename Shape2>
+bool CollideSingle(const Shape1& shape1, const Shape2& shape2, Contacts& contacts) {
+	Contact contact;
+	if (!IsCollision(Inflate(shape1), shape2, contact)) {
+		return false;
+	}
+	contacts.normal = contact.normal;
+	contacts.count = 0;
+	AddPoint(contacts, contact.point, contact.depth - kContactMargin);
+	return true;
+}
+
+Sphere EndSphere(const Capsule& capsule, float t) {
+	return { capsule.segment.origin + capsule.segment.diff * t, capsule.radius, 0 };
+}
+
+// カプセル同士。線分が平行に近いときに転がらないよう、端の球の接触も(法線が大きく違わなければ)加える
+bool CollideCapsules(const Capsule& capsule1, const Capsule& capsule2, Contacts& contacts) {
+	if (!CollideSingle(capsule1, capsule2, contacts)) {
+		return false;
+	}
+	Contact contact;
+	for (float t : { 0.0f, 1.0f }) {
+		if (IsCollision(Inflate(EndSphere(capsule1, t)), capsule2, contact) && Dot(contact.normal, contacts.normal) > 0.9f) {
+			AddUniquePoint(contacts, contact.point, contact.depth - kContactMargin);
+		}
+		if (IsCollision(Inflate(EndSphere(capsule2, t)), capsule1, contact) && Dot(contact.normal, contacts.normal) < -0.9f) {
+			AddUniquePoint(contacts, contact.point, contact.depth - kContactMargin);
+		}
+	}
+	return true;
+}
+
+// カプセルと箱。寝かせたカプセルが箱の面に乗るように端の球の接触も加える
+bool CollideCapsuleBox(const Capsule& capsule, const OBB& obb, Contacts& contacts) {
+	Contact contact;
+	if (!IsCollision(obb, Inflate(capsule), contact)) {
+		return false;
+	}
+	contacts.normal = -contact.normal;
+	contacts.count = 0;
+	AddPoint(contacts, contact.point, contact.depth - kContactMargin);
+	for (float t : { 0.0f, 1.0f }) {
+		if (IsCollision(Inflate(EndSphere(capsule, t)), obb, contact) && Dot(contact.normal, contacts.normal) > 0.9f) {
+			AddUniquePoint(contacts, contact.point, contact.depth - kContactMargin);
+		}
+	}
+	return true;
+}
+
+// 箱の中心から見たnormal方向の厚みの半分
+float ProjectedRadius(const OBB& obb, const Vector3& normal) {
+	return std::abs(Dot(obb.orientations[0], normal)) * obb.size.x +
+		std::abs(Dot(obb.orientations[1], normal)) * obb.size.y +
+		std::abs(Dot(obb.orientations[2], normal)) * obb.size.z;
+}
+
+// 切り取った多角形の最大の頂点数(四角形を4辺で切ると最大8点。誤差で増えた分は捨てる)
+constexpr uint32_t kMaxPolygonPoints = 16;
+
+// 多角形を dot(axis, p) <= limit の側で切り取る(Sutherland-Hodgman)
+uint32_t ClipPolygon(const Vector3* input, uint32_t count, const Vector3& axis, float limit, Vector3* output) {
+	uint32_t result = 0;
+	for (uint32_t i = 0; i < count && result + 2 <= kMaxPolygonPoints; ++i) {
+		const Vector3& p = input[i];
+		const Vector3& q = input[(i + 1) % count];
+		float dp = Dot(axis, p) - limit;
+		float dq = Dot(axis, q) - limit;
+		if (dp <= 0.0f) {
+			output[result++] = p;
+		}
+		if ((dp <= 0.0f) != (dq <= 0.0f)) {
+			output[result++] = p + (q - p) * (dp / (dp - dq));
+		}
+	}
+	return result;
+}
+
+// 箱同士(分離軸定理で一番浅い軸を探し、面なら相手の面を切り取って最大4点、辺の組なら最近接点の1点)
+bool CollideBoxes(const OBB& obb1, const OBB& obb2, Contacts& contacts) {
+	const Vector3 d = obb2.center - obb1.center;
+	// 面の軸(0～2は1つ目の箱、3～5は2つ目の箱)
+	float faceSeparation[2] = { -FLT_MAX, -FLT_MAX };
+	int faceAxis[2] = { 0, 0 };
+	for (int box = 0; box < 2; ++box) {
+		const OBB& reference = box == 0 ? obb1 : obb2;
+		const OBB& other = box == 0 ? obb2 : obb1;
+		for (int i = 0; i < 3; ++i) {
+			const Vector3& axis = reference.orientations[i];
+			float separation = std::abs(Dot(d, axis)) - Component(reference.size, i) - ProjectedRadius(other, axis);
+			if (separation > kContactMargin) {
+				return false;
+			}
+			if (separation > faceSeparation[box]) {
+				faceSeparation[box] = separation;
+				faceAxis[box] = i;
+			}
+		}
+	}
+	float edgeSeparation = -FLT_MAX;
+	Vector3 edgeNormal = {};
+	int edgeAxis[2] = { 0, 0 };
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			Vector3 axis = Cross(obb1.orientations[i], obb2.orientations[j]);
+			float length = Length(axis);
+			if (length < 1.0e-4f) {
+				continue;
+			}
+			axis = axis * (1.0f / length);
+			float distance = Dot(d, axis);
+			float separation = std::abs(distance) - ProjectedRadius(obb1, axis) - ProjectedRadius(obb2, axis);
+			if (separation > kContactMargin) {
+				return false;
+			}
+			if (separation > edgeSeparation) {
+				edgeSeparation = separation;
+				edgeNormal = distance < 0.0f ? -axis : axis;
+				edgeAxis[0] = i;
+				edgeAxis[1] = j;
+			}
+		}
+	}
+
+	const int reference = faceSeparation[1] > kRelativeTolerance * faceSeparation[0] + kAbsoluteTolerance ? 1 : 0;
+	const float faceBest = faceSeparation[reference];
+	contacts.count = 0;
+	if (edgeSeparation > kRelativeTolerance * faceBest + kAbsoluteTolerance) {
+		// 辺と辺。法線の向きにそれぞれの箱で一番出ている辺を選ぶ
+		Vector3 center1 = obb1.center;
+		Vector3 center2 = obb2.center;
+		for (int k = 0; k < 3; ++k) {
+			if (k != edgeAxis[0]) {
+				center1 += obb1.orientations[k] * (Component(obb1.size, k) * (Dot(obb1.orientations[k], edgeNormal) > 0.0f ? 1.0f : -1.0f));
+			}
+			if (k != edgeAxis[1]) {
+				center2 += obb2.orientations[k] * (Component(obb2.size, k) * (Dot(obb2.orientations[k], edgeNormal) > 0.0f ? -1.0f : 1.0f));
+			}
+		}
+		const Vector3 half1 = obb1.orientations[edgeAxis[0]] * Component(obb1.size, edgeAxis[0]);
+		const Vector3 half2 = obb2.orientations[edgeAxis[1]] * Component(obb2.size, edgeAxis[1]);
+		Segment edge1 = { center1 - half1, half1 * 2.0f, 0 };
+		Segment edge2 = { center2 - half2, half2 * 2.0f, 0 };
+		Vector3 point1, point2;
+		ClosestPoints(edge1, edge2, point1, point2);
+		contacts.normal = edgeNormal;
+		AddPoint(contacts, (point1 + point2) * 0.5f, -edgeSeparation);
+		return true;
+	}
+
+	// 面。基準の面に一番向かい合う相手の面を、基準の面の4辺で切り取る
+	const OBB& referenceBox = reference == 0 ? obb1 : obb2;
+	const OBB& incidentBox = reference == 0 ? obb2 : obb1;
+	const int axis = faceAxis[reference];
+	Vector3 normal = referenceBox.orientations[axis];
+	if (Dot(normal, incidentBox.center - referenceBox.center) < 0.0f) {
+		normal = -normal;
+	}
+	int incidentAxis = 0;
+	float best = -1.0f;
+	for (int k = 0; k < 3; ++k) {
+		float alignment = std::abs(Dot(incidentBox.orientations[k], normal));
+		if (alignment > best) {
+			best = alignment;
+			incidentAxis = k;
+		}
+	}
+	const float sign = Dot(incidentBox.orientations[incidentAxis], normal) > 0.0f ? -1.0f : 1.0f;
+	const Vector3 faceCenter = incidentBox.center + incidentBox.orientations[incidentAxis] * (Component(incidentBox.size, incidentAxis) * sign);
+	const int u = (incidentAxis + 1) % 3;
+	const int v = (incidentAxis + 2) % 3;
+	const Vector3 du = incidentBox.orientations[u] * Component(incidentBox.size, u);
+	const Vector3 dv = incidentBox.orientations[v] * Component(incidentBox.size, v);
+	Vector3 polygon[2][kMaxPolygonPoints] = { { faceCenter + du + dv, faceCenter - du + dv, faceCenter - du - dv, faceCenter + du - dv } };
+	uint32_t count = 4;
+	int current = 0;
+	for (int k = 0; k < 3 && count > 0; ++k) {
+		if (k == axis) {
+			continue;
+		}
+		const Vector3& side = referenceBox.orientations[k];
+		const float extent = Component(referenceBox.size, k);
+		const float offset = Dot(side, referenceBox.center);
+		count = ClipPolygon(polygon[current], count, side, offset + extent, polygon[1 - current]);
+		current = 1 - current;
+		count = ClipPolygon(polygon[current], count, -side, extent - offset, polygon[1 - current]);
+		current = 1 - current;
+	}
+	const float facePlane = Dot(normal, referenceBox.center) + Component(referenceBox.size, axis);
+	Vector3 points[kMaxPolygonPoints];
+	float depths[kMaxPolygonPoints];
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		float separation = Dot(normal, polygon[current][i]) - facePlane;
+		if (separation <= kContactMargin) {
+			points[kept] = polygon[current][i] - normal * (separation * 0.5f);
+			depths[kept] = -separation;
+			++kept;
+		}
+	}
+	if (kept == 0) {
+		return false;
+	}
+	contacts.normal = reference == 0 ? normal : -normal;
+	ReducePoints(points, depths, kept, normal, contacts);
+	return true;
+}
+}
+
+#pragma region 追加と取得
+uint32_t RigidBodyWorld::AddBody(Shape shape, const Vector3& position, const Quaternion& orientation, const Vector3& halfExtent, float mass, const Vector3& inertia, unsigned int color) {
+	assert(bodies_.size() < kPlaneFlag);
+	const uint32_t index = static_cast<uint32_t>(bodies_.size());
+	Body body = {};
+	body.shape = shape;
+	body.position = position;
+	body.orientation = orientation;
+	body.halfExtent = halfExtent;
+	body.color = color;
+	body.friction = 0.5f;
+	body.restitution = 0.0f;
+	body.sleepIsland = kAwake;
+	if (mass > 0.0f) {
+		body.inverseMass = 1.0f / mass;
+		body.inverseInertiaLocal = { 1.0f / inertia.x, 1.0f / inertia.y, 1.0f / inertia.z };
+	}
+	UpdateInverseInertia(body);
+	body.proxy = tree_.CreateProxy(ComputeAABB(body), index);
+	bodies_.push_back(body);
+	if (mass > 0.0f) {
+		awakeBodies_.push_back(index);
+	}
+	return index;
+}
+
+uint32_t RigidBodyWorld::AddSphere(const Sphere& sphere, float mass) {
+	const float r = sphere.radius;
+	const float i = 0.4f * mass * r * r;
+	return AddBody(Shape::Sphere, sphere.center, IdentityQuaternion(), { r, 0.0f, 0.0f }, mass, { i, i, i }, sphere.color);
+}
+
+uint32_t RigidBodyWorld::AddCapsule(const Capsule& capsule, float mass) {
+	const Segment& segment = capsule.segment;
+	const float length = Length(segment.diff);
+	const float r = capsule.radius;
+	const float h = length * 0.5f;
+	const Quaternion orientation = length > 0.0f ? MakeQuaternionFromY(segment.diff * (1.0f / length)) : IdentityQuaternion();
+	// 円柱と両端の半球に体積で質量を分け、半球は重心からずらした分(平行軸の定理)を足す
+	const float cylinderVolume = 2.0f * h * r * r;
+	const float sphereVolume = 4.0f / 3.0f * r * r * r;
+	const float cylinderMass = mass * cylinderVolume / (cylinderVolume + sphereVolume);
+	const float sphereMass = mass - cylinderMass;
+	const float axial = cylinderMass * r * r * 0.5f + sphereMass * 0.4f * r * r;
+	const float perpendicular = cylinderMass * (h * h / 3.0f + r * r * 0.25f) + sphereMass * (0.4f * r * r + h * h + 0.75f * h * r);
+	return AddBody(Shape::Capsule, segment.origin + segment.diff * 0.5f, orientation, { r, h, 0.0f }, mass, { perpendicular, axial, perpendicular }, segment.color);
+}
+
+uint32_t RigidBodyWorld::AddBox(const OBB& obb, float mass) {
+	const Vector3& e = obb.size;
+	const float k = mass / 3.0f;
+	const Vector3 inertia = { k * (e.y * e.y + e.z * e.z), k * (e.x * e.x + e.z * e.z), k * (e.x * e.x + e.y * e.y) };
+	return AddBody(Shape::Box, obb.center, MakeQuaternion(obb.orientations), obb.size, mass, inertia, obb.color);
+}
+
+void RigidBodyWorld::AddPlane(const Plane& plane) {
+	assert(planes_.size() < kPlaneFlag);
+	planes_.push_back(plane);
+}
+
+void RigidBodyWorld::Clear() {
+	bodies_.clear();
+	planes_.clear();
+	tree_ = DynamicAABBTree();
+	awakeBodies_.clear();
+	pairs_.clear();
+	manifolds_.clear();
+	previousManifolds_.clear();
+	sleepIslands_.clear();
+	freeSleepIslands_.clear();
+	accumulator_ = 0.0f;
+	statistics_ = {};
+}
+
+Sphere RigidBodyWorld::GetSphere(uint32_t body) const {
+	const Body& b = bodies_[body];
+	return { b.position, b.halfExtent.x, b.color };
+}
+
+Capsule RigidBodyWorld::GetCapsule(uint32_t body) const {
+	const Body& b = bodies_[body];
+	const Vector3 half = RotateVector({ 0.0f, b.halfExtent.y, 0.0f }, b.orientation);
+	return { { b.position - half, half * 2.0f, b.color }, b.halfExtent.x };
+}
+
+OBB RigidBodyWorld::GetOBB(uint32_t body) const {
+	const Body& b = bodies_[body];
+	OBB obb;
+	obb.center = b.position;
+	obb.orientations[0] = RotateVector({ 1.0f, 0.0f, 0.0f }, b.orientation);
+	obb.orientations[1] = RotateVector({ 0.0f, 1.0f, 0.0f }, b.orientation);
+	obb.orientations[2] = RotateVector({ 0.0f, 0.0f, 1.0f }, b.orientation);
+	obb.size = b.halfExtent;
+	obb.color = b.color;
+	return obb;
+}
+
+void RigidBodyWorld::SetLinearVelocity(uint32_t body, const Vector3& velocity) {
+	WakeUp(body);
+	bodies_[body].linearVelocity = velocity;
+}
+
+void RigidBodyWorld::SetAngularVelocity(uint32_t body, const Vector3& velocity) {
+	WakeUp(body);
+	bodies_[body].angularVelocity = velocity;
+}
+
+void RigidBodyWorld::SetMaterial(uint32_t body, float friction, float restitution) {
+	bodies_[body].friction = friction;
+	bodies_[body].restitution = restitution;
+}
+
+void RigidBodyWorld::WakeUp(uint32_t body) {
+	if (IsSleeping(body)) {
+		WakeIsland(bodies_[body].sleepIsland, nullptr);
+		std::sort(awakeBodies_.begin(), awakeBodies_.end());
+	}
+}
+
+void RigidBodyWorld::SetSleepEnabled(bool enabled) {
+	sleepEnabled_ = enabled;
+	if (!enabled) {
+		for (uint32_t island = 0; island < sleepIslands_.size(); ++island) {
+			if (!sleepIslands_[island].empty()) {
+				WakeIsland(island, nullptr);
+			}
+		}
+		std::sort(awakeBodies_.begin(), awakeBodies_.end());
+	}
+}
+
+void RigidBodyWorld::WakeIsland(uint32_t sleepIsland, std::vector<uint32_t>* woken) {
+	std::vector<uint32_t>& bodies = sleepIslands_[sleepIsland];
+	for (uint32_t index : bodies) {
+		Body& body = bodies_[index];
+		body.sleepIsland = kAwake;
+		body.sleepTime = 0.0f;
+		awakeBodies_.push_back(index);
+		if (woken != nullptr) {
+			woken->push_back(index);
+		}
+	}
+	bodies.clear();
+	freeSleepIslands_.push_back(sleepIsland);
+}
+#pragma endregion
+
+#pragma region 内部の計算
+template<typename Function>
+void RigidBodyWorld::ForEachRange(size_t count, size_t grain, Function&& function) {
+	if (pool_ == nullptr) {
+		function(0, count, 0u);
+		return;
+	}
+	pool_->ParallelFor(count, grain, function);
+}
+
+AABB RigidBodyWorld::ComputeAABB(const Body& body) const {
+	Vector3 center = body.position;
+	Vector3 extent;
+	switch (body.shape) {
+	case Shape::Sphere:
+		extent = { body.halfExtent.x, body.halfExtent.x, body.halfExtent.x };
+		break;
+	case Shape::Capsule: {
+		const Vector3 half = RotateVector({ 0.0f, body.halfExtent.y, 0.0f }, body.orientation);
+		const float r = body.halfExtent.x;
+		extent = { std::abs(half.x) + r, std::abs(half.y) + r, std::abs(half.z) + r };
+		break;
+	}
+	case Shape::Box:
+	default: {
+		const Vector3 axes[3] = {
+			RotateVector({ 1.0f, 0.0f, 0.0f }, body.orientation),
+			RotateVector({ 0.0f, 1.0f, 0.0f }, body.orientation),
+			RotateVector({ 0.0f, 0.0f, 1.0f }, body.orientation),
+		};
+		const Vector3& e = body.halfExtent;
+		extent = {
+			std::abs(axes[0].x) * e.x + std::abs(axes[1].x) * e.y + std::abs(axes[2].x) * e.z,
+			std::abs(axes[0].y) * e.x + std::abs(axes[1].y) * e.y + std::abs(axes[2].y) * e.z,
+			std::abs(axes[0].z) * e.x + std::abs(axes[1].z) * e.y + std::abs(axes[2].z) * e.z,
+		};
+		break;
+	}
+	}
+	return { center - extent, center + extent, 0 };
+}
+
+void RigidBodyWorld::UpdateInverseInertia(Body& body) const {
+	// R * diag(I^-1) * R^T。a_kは回転後のk番目の座標軸
+	const Vector3 axes[3] = {
+		RotateVector({ 1.0f, 0.0f, 0.0f }, body.orientation),
+		RotateVector({ 0.0f, 1.0f, 0.0f }, body.orientation),
+		RotateVector({ 0.0f, 0.0f, 1.0f }, body.orientation),
+	};
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			body.inverseInertiaWorld[i][j] =
+				body.inverseInertiaLocal.x * Component(axes[0], i) * Component(axes[0], j) +
+				body.inverseInertiaLocal.y * Component(axes[1], i) * Component(axes[1], j) +
+				body.inverseInertiaLocal.z * Component(axes[2], i) * Component(axes[2], j);
+		}
+	}
+}
+
+uint32_t RigidBodyWorld::Collide(uint32_t a, uint32_t b, Manifold& manifold) const {
+	// 形の種類の順(球 < カプセル < 箱)に並べて判定し、入れ替えたときは法線を反転する
+	const bool swapped = bodies_[a].shape > bodies_[b].shape;
+	const Body& first = bodies_[swapped ? b : a];
+	const Body& second = bodies_[swapped ? a : b];
+	const uint32_t firstIndex = swapped ? b : a;
+	const uint32_t secondIndex = swapped ? a : b;
+	Contacts contacts = {};
+	bool hit = false;
+	switch (first.shape) {
+	case Shape::Sphere:
+		switch (second.shape) {
+		case Shape::Sphere:
+			hit = CollideSingle(GetSphere(firstIndex), GetSphere(secondIndex), contacts);
+			break;
+		case Shape::Capsule:
+			hit = CollideSingle(GetSphere(firstIndex), GetCapsule(secondIndex), contacts);
+			break;
+		case Shape::Box:
+			hit = CollideSingle(GetSphere(firstIndex), GetOBB(secondIndex), contacts);
+			break;
+		}
+		break;
+	case Shape::Capsule:
+		if (second.shape == Shape::Capsule) {
+			hit = CollideCapsules(GetCapsule(firstIndex), GetCapsule(secondIndex), contacts);
+		} else {
+			hit = CollideCapsuleBox(GetCapsule(firstIndex), GetOBB(secondIndex), contacts);
+		}
+		break;
+	case Shape::Box:
+		hit = CollideBoxes(GetOBB(firstIndex), GetOBB(secondIndex), contacts);
+		break;
+	}
+	if (!hit) {
+		return 0;
+	}
+	manifold.normal = swapped ? -contacts.normal : contacts.normal;
+	for (uint32_t i = 0; i < contacts.count; ++i) {
+		manifold.points[i].point = contacts.points[i];
+		manifold.points[i].depth = contacts.depths[i];
+	}
+	return contacts.count;
+}
+
+uint32_t RigidBodyWorld::CollidePlane(uint32_t body, const Plane& plane, Manifold& manifold) const {
+	// 剛体から平面へ向かう法線は、平面の法線の逆向き
+	const Body& b = bodies_[body];
+	const Vector3& n = plane.normal;
+	Vector3 points[8];
+	float depths[8];
+	uint32_t count = 0;
+	auto addSphere = [&](const Vector3& center, float radius) {
+		float separation = Dot(n, center) - plane.distance - radius;
+		if (separation <= kContactMargin) {
+			points[count] = center - n * (radius + separation * 0.5f);
+			depths[count] = -separation;
+			++count;
+		}
+	};
+	switch (b.shape) {
+	case Shape::Sphere:
+		addSphere(b.position, b.halfExtent.x);
+		break;
+	case Shape::Capsule: {
+		const Capsule capsule = GetCapsule(body);
+		addSphere(capsule.segment.origin, capsule.radius);
+		addSphere(capsule.segment.origin + capsule.segment.diff, capsule.radius);
+		break;
+	}
+	case Shape::Box: {
+		const OBB obb = GetOBB(body);
+		for (int corner = 0; corner < 8; ++corner) {
+			Vector3 vertex = obb.center;
+			vertex += obb.orientations[0] * ((corner & 1) ? obb.size.x : -obb.size.x);
+			vertex += obb.orientations[1] * ((corner & 2) ? obb.size.y : -obb.size.y);
+			vertex += obb.orientations[2] * ((corner & 4) ? obb.size.z : -obb.size.z);
+			addSphere(vertex, 0.0f);
+		}
+		break;
+	}
+	}
+	Contacts contacts = {};
+	ReducePoints(points, depths, count, n, contacts);
+	manifold.normal = -n;
+	for (uint32_t i = 0; i < contacts.count; ++i) {
+		manifold.points[i].point = contacts.points[i];
+		manifold.points[i].depth = contacts.depths[i];
+	}
+	return contacts.count;
+}
+
+void RigidBodyWorld::WarmStart(Manifold& manifold) const {
+	auto it = std::lower_bound(previousManifolds_.begin(), previousManifolds_.end(), manifold.key,
+		[](const Manifold& m, uint64_t key) { return m.key < key; });
+	if (it == previousManifolds_.end() || it->key != manifold.key) {
+		return;
+	}
+	for (uint32_t i = 0; i < manifold.pointCount; ++i) {
+		ContactPoint& point = manifold.points[i];
+		float best = kMatchDistance * kMatchDistance;
+		for (uint32_t j = 0; j < it->pointCount; ++j) {
+			const ContactPoint& old = it->points[j];
+			float distance = LengthSquared(old.localA - point.localA);
+			if (distance < best) {
+				best = distance;
+				point.normalImpulse = old.normalImpulse;
+				point.tangentImpulse[0] = old.tangentImpulse[0];
+				point.tangentImpulse[1] = old.tangentImpulse[1];
+			}
+		}
+	}
+}
+
+uint32_t RigidBodyWorld::Find(uint32_t body) const {
+	uint32_t parent = parents_[body].load(std::memory_order_relaxed);
+	while (parent != body) {
+		body = parent;
+		parent = parents_[body].load(std::memory_order_relaxed);
+	}
+	return body;
+}
+
+void RigidBodyWorld::Union(uint32_t a, uint32_t b) {
+	while (true) {
+		a = Find(a);
+		b = Find(b);
+		if (a == b) {
+			return;
+		}
+		// 大きい方の根を小さい方の下につなぐ。他のスレッドが先につないでいたらやり直す
+		if (a < b) {
+			std::swap(a, b);
+		}
+		uint32_t expected = a;
+		if (parents_[a].compare_exchange_weak(expected, b, std::memory_order_relaxed)) {
+			return;
+		}
+	}
+}
+#pragma endregion
+
+#pragma region ステップ
+uint32_t RigidBodyWorld::Update(float deltaTime) {
+	accumulator_ += deltaTime;
+	uint32_t steps = 0;
+	while (accumulator_ >= timeStep_ && steps < maxStepsPerUpdate_) {
+		Step();
+		accumulator_ -= timeStep_;
+		++steps;
+	}
+	if (steps == maxStepsPerUpdate_) {
+		// 追いつけなかった分は捨てる
+		accumulator_ = std::min(accumulator_, timeStep_);
+	}
+	return steps;
+}
+
+void RigidBodyWorld::Step() {
+	MT4_PROFILE_ZONE("RigidBodyWorld::Step");
+	using Clock = std::chrono::steady_clock;
+	const auto start = Clock::now();
+	const uint32_t threadCount = pool_ != nullptr ? pool_->GetThreadCount() : 1;
+	threadPairs_.resize(threadCount);
+	threadWakeRequests_.resize(threadCount);
+	threadConstraints_.resize(threadCount);
+
+	{
+		MT4_PROFILE_ZONE("RigidBodyWorld::BroadPhase");
+		BroadPhase();
+	}
+	const auto broadPhaseEnd = Clock::now();
+	{
+		MT4_PROFILE_ZONE("RigidBodyWorld::NarrowPhase");
+		NarrowPhase();
+	}
+	const auto narrowPhaseEnd = Clock::now();
+	{
+		MT4_PROFILE_ZONE("RigidBodyWorld::BuildIslands");
+		BuildIslands();
+	}
+	const auto islandEnd = Clock::now();
+	const size_t islandCount = islandBodyStart_.empty() ? 0 : islandBodyStart_.size() - 1;
+	{
+		MT4_PROFILE_ZONE("RigidBodyWorld::Solve");
+		ForEachRange(islandCount, 1, [this](size_t begin, size_t end, uint32_t threadIndex) {
+			for (size_t island = begin; island < end; ++island) {
+				SolveIsland(static_cast<uint32_t>(island), threadIndex);
+			}
+		});
+		SleepIslands();
+	}
+	const auto end = Clock::now();
+
+	Statistics& s = statistics_;
+	s.bodyCount = bodies_.size();
+	s.activeCount = awakeBodies_.size();
+	s.sleepingCount = 0;
+	for (const std::vector<uint32_t>& island : sleepIslands_) {
+		s.sleepingCount += island.size();
+	}
+	s.staticCount = s.bodyCount - s.activeCount - s.sleepingCount;
+	s.islandCount = islandCount;
+	s.pairCount = 0;
+	for (uint64_t pair : pairs_) {
+		s.pairCount += (pair & kPlaneFlag) == 0 ? 1 : 0;
+	}
+	s.manifoldCount = manifolds_.size();
+	s.contactCount = 0;
+	for (const Manifold& manifold : manifolds_) {
+		s.contactCount += manifold.pointCount;
+	}
+	s.broadPhaseSeconds = std::chrono::duration<double>(broadPhaseEnd - start).count();
+	s.narrowPhaseSeconds = std::chrono::duration<double>(narrowPhaseEnd - broadPhaseEnd).count();
+	s.islandSeconds = std::chrono::duration<double>(islandEnd - narrowPhaseEnd).count();
+	s.solverSeconds = std::chrono::duration<double>(end - islandEnd).count();
+	s.stepSeconds = std::chrono::duration<double>(end - start).count();
+}
+
+void RigidBodyWorld::BroadPhase() {
+	const float dt = timeStep_;
+	for (uint32_t index : awakeBodies_) {
+		Body& body = bodies_[index];
+		tree_.MoveProxy(body.proxy, ComputeAABB(body), body.linearVelocity * dt);
+	}
+
+	// 起きている剛体から探し、触れた眠っている島を起こして、起こした剛体からまた探す
+	pairs_.clear();
+	std::vector<uint32_t> queries = awakeBodies_;
+	std::vector<uint32_t> woken;
+	while (!queries.empty()) {
+		for (uint32_t thread = 0; thread < threadPairs_.size(); ++thread) {
+			threadPairs_[thread].clear();
+			threadWakeRequests_[thread].clear();
+		}
+		ForEachRange(queries.size(), kPairGrainSize, [this, &queries](size_t begin, size_t end, uint32_t threadIndex) {
+			std::vector<uint64_t>& pairs = threadPairs_[threadIndex];
+			std::vector<uint32_t>& wakeRequests = threadWakeRequests_[threadIndex];
+			for (size_t k = begin; k < end; ++k) {
+				const uint32_t i = queries[k];
+				const Vector3 margin = { kContactMargin, kContactMargin, kContactMargin };
+				AABB tight = ComputeAABB(bodies_[i]);
+				tight.min -= margin;
+				tight.max += margin;
+				tree_.Query(tree_.GetFatAABB(bodies_[i].proxy), [&](int32_t proxy) {
+					const uint32_t j = tree_.GetUserData(proxy);
+					const Body& other = bodies_[j];
+					if (j == i) {
+						return true;
+					}
+					if (other.inverseMass > 0.0f) {
+						if (other.sleepIsland == kAwake) {
+							// 起きている剛体同士は番号の大きい方だけが組を作る
+							if (j < i) {
+								return true;
+							}
+						} else {
+							// 眠っている剛体は、実際の形が触れそうなときだけ起こす
+							if (!IsCollision(tight, ComputeAABB(other))) {
+								return true;
+							}
+							wakeRequests.push_back(other.sleepIsland);
+						}
+					}
+					const uint32_t a = std::min(i, j);
+					const uint32_t b = std::max(i, j);
+					pairs.push_back((static_cast<uint64_t>(a) << 32) | b);
+					return true;
+				});
+			}
+		});
+		std::vector<uint32_t> wakeRequests;
+		for (uint32_t thread = 0; thread < threadPairs_.size(); ++thread) {
+			pairs_.insert(pairs_.end(), threadPairs_[thread].begin(), threadPairs_[thread].end());
+			wakeRequests.insert(wakeRequests.end(), threadWakeRequests_[thread].begin(), threadWakeRequests_[thread].end());
+		}
+		std::sort(wakeRequests.begin(), wakeRequests.end());
+		wakeRequests.erase(std::unique(wakeRequests.begin(), wakeRequests.end()), wakeRequests.end());
+		woken.clear();
+		for (uint32_t island : wakeRequests) {
+			WakeIsland(island, &woken);
+		}
+		std::sort(woken.begin(), woken.end());
+		queries.swap(woken);
+	}
+	std::sort(awakeBodies_.begin(), awakeBodies_.end());
+
+	// 平面は数が少ないので、起きている剛体ごとに全て調べる
+	for (uint32_t index : awakeBodies_) {
+		const AABB aabb = ComputeAABB(bodies_[index]);
+		const Vector3 center = (aabb.min + aabb.max) * 0.5f;
+		const Vector3 extent = (aabb.max - aabb.min) * 0.5f;
+		for (uint32_t p = 0; p < planes_.size(); ++p) {
+			const Vector3& n = planes_[p].normal;
+			float nearest = Dot(n, center) - std::abs(n.x) * extent.x - std::abs(n.y) * extent.y - std::abs(n.z) * extent.z;
+			if (nearest - planes_[p].distance <= kContactMargin) {
+				pairs_.push_back((static_cast<uint64_t>(index) << 32) | (kPlaneFlag | p));
+			}
+		}
+	}
+	std::sort(pairs_.begin(), pairs_.end());
+	pairs_.erase(std::unique(pairs_.begin(), pairs_.end()), pairs_.end());
+}
+
+void RigidBodyWorld::NarrowPhase() {
+	static_assert(kMaxManifoldPoints == kMaxPoints, "接触点の最大数を合わせること");
+	manifolds_.swap(previousManifolds_);
+	manifolds_.resize(pairs_.size());
+	ForEachRange(pairs_.size(), kPairGrainSize, [this](size_t begin, size_t end, uint32_t) {
+		for (size_t k = begin; k < end; ++k) {
+			Manifold& manifold = manifolds_[k];
+			manifold = {};
+			manifold.key = pairs_[k];
+			manifold.bodyA = static_cast<uint32_t>(pairs_[k] >> 32);
+			manifold.bodyB = static_cast<uint32_t>(pairs_[k]);
+			if (manifold.bodyB & kPlaneFlag) {
+				manifold.pointCount = CollidePlane(manifold.bodyA, planes_[manifold.bodyB & ~kPlaneFlag], manifold);
+			} else {
+				manifold.pointCount = Collide(manifold.bodyA, manifold.bodyB, manifold);
+			}
+			if (manifold.pointCount == 0) {
+				continue;
+			}
+			const Body& a = bodies_[manifold.bodyA];
+			const Quaternion inverseA = Conjugate(a.orientation);
+			for (uint32_t i = 0; i < manifold.pointCount; ++i) {
+				ContactPoint& point = manifold.points[i];
+				point.localA = RotateVector(point.point - a.position, inverseA);
+				if (manifold.bodyB & kPlaneFlag) {
+					point.localB = point.point;
+				} else {
+					const Body& b = bodies_[manifold.bodyB];
+					point.localB = RotateVector(point.point - b.position, Conjugate(b.orientation));
+				}
+			}
+			WarmStart(manifold);
+		}
+	});
+	manifolds_.erase(std::remove_if(manifolds_.begin(), manifolds_.end(), [](const Manifold& m) { return m.pointCount == 0; }), manifolds_.end());
+}
+
+void RigidBodyWorld::BuildIslands() {
+	if (parentCapacity_ < bodies_.size()) {
+		parentCapacity_ = std::max(bodies_.size(), parentCapacity_ * 2);
+		parents_ = std::make_unique<std::atomic<uint32_t>[]>(parentCapacity_);
+	}
+	ForEachRange(awakeBodies_.size(), kBodyGrainSize, [this](size_t begin, size_t end, uint32_t) {
+		for (size_t k = begin; k < end; ++k) {
+			parents_[awakeBodies_[k]].store(awakeBodies_[k], std::memory_order_relaxed);
+		}
+	});
+	ForEachRange(manifolds_.size(), kManifoldGrainSize, [this](size_t begin, size_t end, uint32_t) {
+		for (size_t k = begin; k < end; ++k) {
+			const Manifold& manifold = manifolds_[k];
+			if ((manifold.bodyB & kPlaneFlag) == 0 && bodies_[manifold.bodyA].inverseMass > 0.0f && bodies_[manifold.bodyB].inverseMass > 0.0f) {
+				Union(manifold.bodyA, manifold.bodyB);
+			}
+		}
+	});
+
+	// 根は集合の一番小さい番号なので、番号順に見ると根が先に島の番号を持つ
+	islandOfBody_.resize(bodies_.size());
+	islandBodyStart_.clear();
+	uint32_t islandCount = 0;
+	for (uint32_t index : awakeBodies_) {
+		const uint32_t root = Find(index);
+		islandOfBody_[index] = root == index ? islandCount++ : islandOfBody_[root];
+	}
+	islandBodyStart_.assign(islandCount + 1, 0);
+	islandManifoldStart_.assign(islandCount + 1, 0);
+	for (uint32_t index : awakeBodies_) {
+		++islandBodyStart_[islandOfBody_[index] + 1];
+	}
+	auto manifoldIsland = [this](const Manifold& manifold) {
+		return islandOfBody_[bodies_[manifold.bodyA].inverseMass > 0.0f ? manifold.bodyA : manifold.bodyB];
+	};
+	for (const Manifold& manifold : manifolds_) {
+		++islandManifoldStart_[manifoldIsland(manifold) + 1];
+	}
+	for (uint32_t island = 0; island < islandCount; ++island) {
+		islandBodyStart_[island + 1] += islandBodyStart_[island];
+		islandManifoldStart_[island + 1] += islandManifoldStart_[island];
+	}
+	islandBodies_.resize(awakeBodies_.size());
+	islandManifolds_.resize(manifolds_.size());
+	std::vector<uint32_t> cursor(islandBodyStart_.begin(), islandBodyStart_.end() - 1);
+	for (uint32_t index : awakeBodies_) {
+		islandBodies_[cursor[islandOfBody_[index]]++] = index;
+	}
+	cursor.assign(islandManifoldStart_.begin(), islandManifoldStart_.end() - 1);
+	for (uint32_t k = 0; k < manifolds_.size(); ++k) {
+		islandManifolds_[cursor[manifoldIsland(manifolds_[k])]++] = k;
+	}
+	islandCanSleep_.assign(islandCount, 0);
+}
+
+void RigidBodyWorld::SolveIsland(uint32_t island, uint32_t threadIndex) {
+	const uint32_t subSteps = std::max(subSteps_, 1u);
+	const float dt = timeStep_;
+	const float h = dt / static_cast<float>(subSteps);
+	const float inverseH = 1.0f / h;
+	const uint32_t* bodies = islandBodies_.data() + islandBodyStart_[island];
+	const uint32_t bodyCount = islandBodyStart_[island + 1] - islandBodyStart_[island];
+	const uint32_t* manifolds = islandManifolds_.data() + islandManifoldStart_[island];
+	const uint32_t manifoldCount = islandManifoldStart_[island + 1] - islandManifoldStart_[island];
+
+	for (uint32_t k = 0; k < bodyCount; ++k) {
+		Body& body = bodies_[bodies[k]];
+		body.deltaPosition = {};
+		body.deltaOrientation = IdentityQuaternion();
+		UpdateInverseInertia(body);
+	}
+
+	// 拘束の準備
+	const float hertz = std::min(kContactHertz, 0.25f * inverseH);
+	const Softness softness = MakeSoftness(hertz, kContactDampingRatio, h);
+	const Softness staticSoftness = MakeSoftness(2.0f * hertz, kContactDampingRatio, h);
+	Body staticBody = {};
+	staticBody.deltaOrientation = IdentityQuaternion();
+	std::vector<ConstraintManifold>& constraints = threadConstraints_[threadIndex];
+	constraints.resize(manifoldCount);
+	for (uint32_t k = 0; k < manifoldCount; ++k) {
+		const Manifold& manifold = manifolds_[manifolds[k]];
+		ConstraintManifold& c = constraints[k];
+		const bool plane = (manifold.bodyB & kPlaneFlag) != 0;
+		Body& a = bodies_[manifold.bodyA];
+		Body* b = plane ? nullptr : &bodies_[manifold.bodyB];
+		c.bodyA = a.inverseMass > 0.0f ? &a : &staticBody;
+		c.bodyB = b != nullptr && b->inverseMass > 0.0f ? b : &staticBody;
+		c.normal = manifold.normal;
+		c.tangent[0] = Normalize(Perpendicular(c.normal));
+		c.tangent[1] = Cross(c.normal, c.tangent[0]);
+		c.friction = b != nullptr ? std::sqrt(a.friction * b->friction) : a.friction;
+		c.restitution = b != nullptr ? std::max(a.restitution, b->restitution) : a.restitution;
+		const Softness& soft = c.bodyA == &staticBody || c.bodyB == &staticBody ? staticSoftness : softness;
+		c.biasRate = soft.biasRate;
+		c.massScale = soft.massScale;
+		c.impulseScale = soft.impulseScale;
+		c.pointCount = manifold.pointCount;
+		const Body& bodyA = *c.bodyA;
+		const Body& bodyB = *c.bodyB;
+		auto effectiveMass = [&](const Vector3& rA, const Vector3& rB, const Vector3& direction) {
+			const Vector3 rnA = Cross(rA, direction);
+			const Vector3 rnB = Cross(rB, direction);
+			float k = bodyA.inverseMass + bodyB.inverseMass + Dot(rnA, Multiply(bodyA.inverseInertiaWorld, rnA)) + Dot(rnB, Multiply(bodyB.inverseInertiaWorld, rnB));
+			return k > 0.0f ? 1.0f / k : 0.0f;
+		};
+		for (uint32_t i = 0; i < c.pointCount; ++i) {
+			const ContactPoint& point = manifold.points[i];
+			ContactConstraint& cp = c.points[i];
+			cp.rA = point.point - bodyA.position;
+			cp.rB = point.point - bodyB.position;
+			cp.baseSeparation = -point.depth - Dot(cp.rB - cp.rA, c.normal);
+			cp.normalMass = effectiveMass(cp.rA, cp.rB, c.normal);
+			cp.tangentMass[0] = effectiveMass(cp.rA, cp.rB, c.tangent[0]);
+			cp.tangentMass[1] = effectiveMass(cp.rA, cp.rB, c.tangent[1]);
+			cp.normalImpulse = point.normalImpulse;
+			cp.tangentImpulse[0] = point.tangentImpulse[0];
+			cp.tangentImpulse[1] = point.tangentImpulse[1];
+			cp.maxNormalImpulse = 0.0f;
+			const Vector3 dv = bodyB.linearVelocity + Cross(bodyB.angularVelocity, cp.rB) - bodyA.linearVelocity - Cross(bodyA.angularVelocity, cp.rA);
+			cp.relativeVelocity = Dot(dv, c.normal);
+		}
+	}
+
+	auto applyImpulse = [](ConstraintManifold& c, const ContactConstraint& cp, const Vector3& impulse) {
+		Body& a = *c.bodyA;
+		Body& b = *c.bodyB;
+		a.linearVelocity -= impulse * a.inverseMass;
+		a.angularVelocity -= Multiply(a.inverseInertiaWorld, Cross(cp.rA, impulse));
+		b.linearVelocity += impulse * b.inverseMass;
+		b.angularVelocity += Multiply(b.inverseInertiaWorld, Cross(cp.rB, impulse));
+	};
+	auto relativeVelocity = [](const ConstraintManifold& c, const ContactConstraint& cp) {
+		const Body& a = *c.bodyA;
+		const Body& b = *c.bodyB;
+		return b.linearVelocity + Cross(b.angularVelocity, cp.rB) - a.linearVelocity - Cross(a.angularVelocity, cp.rA);
+	};
+	// useBiasがtrueならめり込みを柔らかく押し戻し、falseなら押し戻しで付いた速度を取り除く(リラックス)
+	auto solve = [&](bool useBias) {
+		for (ConstraintManifold& c : constraints) {
+			const Body& a = *c.bodyA;
+			const Body& b = *c.bodyB;
+			for (uint32_t i = 0; i < c.pointCount; ++i) {
+				ContactConstraint& cp = c.points[i];
+				// 接触点を作り直さず、剛体が動いた量から今の距離を求める
+				const Vector3 d = b.deltaPosition - a.deltaPosition + RotateVector(cp.rB, b.deltaOrientation) - RotateVector(cp.rA, a.deltaOrientation);
+				const float separation = Dot(d, c.normal) + cp.baseSeparation;
+				float bias = 0.0f;
+				float massScale = 1.0f;
+				float impulseScale = 0.0f;
+				if (separation > 0.0f) {
+					// 離れている間は、このサブステップでちょうど触れる速さまで近づいてよい
+					bias = separation * inverseH;
+				} else if (useBias) {
+					bias = std::max(c.biasRate * separation, -kMaxPushVelocity);
+					massScale = c.massScale;
+					impulseScale = c.impulseScale;
+				}
+				const float vn = Dot(relativeVelocity(c, cp), c.normal);
+				const float impulse = -cp.normalMass * massScale * (vn + bias) - impulseScale * cp.normalImpulse;
+				const float total = std::max(cp.normalImpulse + impulse, 0.0f);
+				const float delta = total - cp.normalImpulse;
+				cp.normalImpulse = total;
+				cp.maxNormalImpulse = std::max(cp.maxNormalImpulse, delta);
+				applyImpulse(c, cp, c.normal * delta);
+			}
+			for (uint32_t i = 0; i < c.pointCount; ++i) {
+				ContactConstraint& cp = c.points[i];
+				const float limit = c.friction * cp.normalImpulse;
+				for (int t = 0; t < 2; ++t) {
+					const float vt = Dot(relativeVelocity(c, cp), c.tangent[t]);
+					const float total = std::clamp(cp.tangentImpulse[t] - cp.tangentMass[t] * vt, -limit, limit);
+					const float delta = total - cp.tangentImpulse[t];
+					cp.tangentImpulse[t] = total;
+					applyImpulse(c, cp, c.tangent[t] * delta);
+				}
+			}
+		}
+	};
+	auto integrate = [](Quaternion& q, const Vector3& w, float step) {
+		const Quaternion spin = Multiply(Quaternion{ w.x, w.y, w.z, 0.0f }, q);
+		const float half = 0.5f * step;
+		q = Normalize(Quaternion{ q.x + spin.x * half, q.y + spin.y * half, q.z + spin.z * half, q.w + spin.w * half });
+	};
+
+	for (uint32_t subStep = 0; subStep < subSteps; ++subStep) {
+		for (uint32_t k = 0; k < bodyCount; ++k) {
+			bodies_[bodies[k]].linearVelocity += gravity_ * h;
+		}
+		// ウォームスタート(溜めた力積をまとめて加える)
+		for (ConstraintManifold& c : constraints) {
+			for (uint32_t i = 0; i < c.pointCount; ++i) {
+				const ContactConstraint& cp = c.points[i];
+				applyImpulse(c, cp, c.normal * cp.normalImpulse + c.tangent[0] * cp.tangentImpulse[0] + c.tangent[1] * cp.tangentImpulse[1]);
+			}
+		}
+		solve(true);
+		for (uint32_t k = 0; k < bodyCount; ++k) {
+			Body& body = bodies_[bodies[k]];
+			const Vector3 move = body.linearVelocity * h;
+			body.position += move;
+			body.deltaPosition += move;
+			integrate(body.orientation, body.angularVelocity, h);
+			integrate(body.deltaOrientation, body.angularVelocity, h);
+		}
+		solve(false);
+	}
+
+	// 反発(速くぶつかって、実際に押し返した接触点だけ)
+	for (ConstraintManifold& c : constraints) {
+		if (c.restitution == 0.0f) {
+			continue;
+		}
+		for (uint32_t i = 0; i < c.pointCount; ++i) {
+			ContactConstraint& cp = c.points[i];
+			if (cp.relativeVelocity > -kRestitutionThreshold || cp.maxNormalImpulse == 0.0f) {
+				continue;
+			}
+			const float vn = Dot(relativeVelocity(c, cp), c.normal);
+			const float total = std::max(cp.normalImpulse - cp.normalMass * (vn + c.restitution * cp.relativeVelocity), 0.0f);
+			const float delta = total - cp.normalImpulse;
+			cp.normalImpulse = total;
+			applyImpulse(c, cp, c.normal * delta);
+		}
+	}
+
+	// 次のステップのウォームスタートのために力積を戻す
+	for (uint32_t k = 0; k < manifoldCount; ++k) {
+		Manifold& manifold = manifolds_[manifolds[k]];
+		const ConstraintManifold& c = constraints[k];
+		for (uint32_t i = 0; i < c.pointCount; ++i) {
+			manifold.points[i].normalImpulse = c.points[i].normalImpulse;
+			manifold.points[i].tangentImpulse[0] = c.points[i].tangentImpulse[0];
+			manifold.points[i].tangentImpulse[1] = c.points[i].tangentImpulse[1];
+		}
+	}
+
+	// 止まっている時間を数える
+	float minSleepTime = FLT_MAX;
+	for (uint32_t k = 0; k < bodyCount; ++k) {
+		Body& body = bodies_[bodies[k]];
+		const float extent = body.shape == Shape::Box ? Length(body.halfExtent) : body.halfExtent.x + body.halfExtent.y;
+		const float speed = std::max(Length(body.linearVelocity), Length(body.angularVelocity) * extent);
+		if (speed < kSleepSpeed) {
+			body.sleepTime += dt;
+		} else {
+			body.sleepTime = 0.0f;
+		}
+		minSleepTime = std::min(minSleepTime, body.sleepTime);
+	}
+	islandCanSleep_[island] = minSleepTime >= kTimeToSleep ? 1 : 0;
+}
+
+void RigidBodyWorld::SleepIslands() {
+	if (!sleepEnabled_) {
+		return;
+	}
+	bool slept = false;
+	for (uint32_t island = 0; island < islandCanSleep_.size(); ++island) {
+		if (!islandCanSleep_[island]) {
+			continue;
+		}
+		uint32_t slot;
+		if (!freeSleepIslands_.empty()) {
+			slot = freeSleepIslands_.back();
+			freeSleepIslands_.pop_back();
+		} else {
+			slot = static_cast<uint32_t>(sleepIslands_.size());
+			sleepIslands_.emplace_back();
+		}
+		std::vector<uint32_t>& sleeping = sleepIslands_[slot];
+		for (uint32_t k = islandBodyStart_[island]; k < islandBodyStart_[island + 1]; ++k) {
+			Body& body = bodies_[islandBodies_[k]];
+			body.sleepIsland = slot;
+			body.linearVelocity = {};
+			body.angularVelocity = {};
+			sleeping.push_back(islandBodies_[k]);
+		}
+		slept = true;
+	}
+	if (slept) {
+		awakeBodies_.erase(std::remove_if(awakeBodies_.begin(), awakeBodies_.end(), [this](uint32_t index) { return bodies_[index].sleepIsland != kAwake; }), awakeBodies_.end());
+	}
+}
+#pragma endregion
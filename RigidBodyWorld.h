@@ -0,0 +1,237 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "DynamicAABBTree.h"
+#include "Struct.h"
+
+class ThreadPool;
+
+// 球・カプセル・箱(OBB)の剛体シミュレーション
+// 1ステップの流れ
+//   ブロードフェーズ: 起きている剛体の太らせたAABBでDynamicAABBTreeを探し、眠っている剛体に触れたらその島ごと起こす
+//   ナローフェーズ: 組ごとに接触点(箱同士は最大4点)をまとめた接触多様体を作り、前のステップの同じ接触点の力積を引き継ぐ(ウォームスタート)
+//   島分け: 接触でつながった剛体を並列のUnion-Findでまとめる
+//   ソルバー: 島ごとに(スレッドプールがあれば並列に)速度を逐次インパルス法で解き、摩擦はクーロン摩擦の円錐を四角錐で近似する
+//     1ステップをサブステップに分け、接触はばねとダンパーのように柔らかく押し戻す(積み上げた箱が押し戻しの勢いで揺れ続けないように)
+//     サブステップの中では接触点を作り直さず、剛体が動いた量から接触点の距離を求め直す
+//   眠り: 島の全剛体がしばらく止まっていたら島ごと眠らせ、起こされるまで計算しない
+// 島は互いに独立していて島の中の順番は剛体と組の番号で決まるので、結果はスレッド数によらず同じになる
+// 質量が0以下の剛体と平面は動かない(地面や壁)
+class RigidBodyWorld {
+public:
+	// 剛体の形
+	enum class Shape : uint8_t {
+		Sphere,
+		Capsule,
+		Box,
+	};
+
+	// 直近のステップの統計
+	struct Statistics {
+		size_t bodyCount;
+		size_t staticCount;     // 動かない剛体の数
+		size_t activeCount;     // 起きている剛体の数
+		size_t sleepingCount;   // 眠っている剛体の数
+		size_t islandCount;     // 解いた島の数
+		size_t pairCount;       // ブロードフェーズで見つかった組の数(平面との組は含まない)
+		size_t manifoldCount;   // 接触している組の数
+		size_t contactCount;    // 接触点の数
+		double broadPhaseSeconds;
+		double narrowPhaseSeconds;
+		double islandSeconds;
+		double solverSeconds;   // 速度と位置の更新と眠りの判定を含む
+		double stepSeconds;     // ステップ全体
+	};
+
+	// 平面を除く形は、作ったときの姿勢をローカル座標の基準にする
+	// 箱はorientationsを回転に、sizeを半分の大きさにする。カプセルは線分の中点を中心に、線分の向きをローカルのY軸にする
+	uint32_t AddSphere(const Sphere& sphere, float mass);
+	uint32_t AddCapsule(const Capsule& capsule, float mass);
+	uint32_t AddBox(const OBB& obb, float mass);
+	// 動かない平面(裏側は中身の詰まった空間として扱う)
+	void AddPlane(const Plane& plane);
+	void Clear();
+
+	size_t GetBodyCount() const { return bodies_.size(); }
+	Shape GetShape(uint32_t body) const { return bodies_[body].shape; }
+	// 現在の姿勢での形(描画や当たり判定用)
+	Sphere GetSphere(uint32_t body) const;
+	Capsule GetCapsule(uint32_t body) const;
+	OBB GetOBB(uint32_t body) const;
+
+	const Vector3& GetPosition(uint32_t body) const { return bodies_[body].position; }
+	const Quaternion& GetOrientation(uint32_t body) const { return bodies_[body].orientation; }
+	const Vector3& GetLinearVelocity(uint32_t body) const { return bodies_[body].linearVelocity; }
+	const Vector3& GetAngularVelocity(uint32_t body) const { return bodies_[body].angularVelocity; }
+	// 速度を変えると、眠っていた場合は島ごと起こす
+	void SetLinearVelocity(uint32_t body, const Vector3& velocity);
+	void SetAngularVelocity(uint32_t body, const Vector3& velocity);
+	// 摩擦係数(接触する2つの剛体の相乗平均を使う)と反発係数(大きい方を使う)
+	void SetMaterial(uint32_t body, float friction, float restitution);
+	bool IsSleeping(uint32_t body) const { return bodies_[body].sleepIsland != kAwake; }
+	bool IsStatic(uint32_t body) const { return bodies_[body].inverseMass == 0.0f; }
+	// 眠っている剛体を島ごと起こす
+	void WakeUp(uint32_t body);
+
+	void SetGravity(const Vector3& gravity) { gravity_ = gravity; }
+	void SetTimeStep(float timeStep) { timeStep_ = timeStep; }
+	// 1ステップを分けるサブステップの数
+	void SetSubSteps(uint32_t subSteps) { subSteps_ = subSteps; }
+	void SetSleepEnabled(bool enabled);
+	// nullptrなら呼び出したスレッドだけで処理する
+	void SetThreadPool(ThreadPool* pool) { pool_ = pool; }
+	// 1回のUpdateで進める最大ステップ数
+	void SetMaxStepsPerUpdate(uint32_t maxSteps) { maxStepsPerUpdate_ = maxSteps; }
+
+	// 経過時間を溜めて、固定の刻み幅で進められるだけ進める。進めたステップ数を返す
+	uint32_t Update(float deltaTime);
+	// 固定の刻み幅で1ステップ進める
+	void Step();
+
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private:
+	// 起きている剛体のsleepIsland
+	static constexpr uint32_t kAwake = UINT32_MAX;
+	// 接触多様体の相手が平面であることを表す番号(bodyBに平面の番号 | kPlaneFlagを入れる)
+	static constexpr uint32_t kPlaneFlag = 0x80000000u;
+	// 接触多様体の最大点数
+	static constexpr uint32_t kMaxManifoldPoints = 4;
+
+	struct Body {
+		Vector3 position;
+		Quaternion orientation;
+		Vector3 linearVelocity;
+		Vector3 angularVelocity;
+		Vector3 deltaPosition;       // ステップの始めからの移動量(サブステップで接触点の距離を求め直す用)
+		Quaternion deltaOrientation; // ステップの始めからの回転
+		Vector3 halfExtent;          // 箱は半分の大きさ、カプセルは(半径, 線分の長さの半分, 0)、球は(半径, 0, 0)
+		Vector3 inverseInertiaLocal; // ローカル座標での慣性テンソル(対角)の逆数
+		float inverseInertiaWorld[3][3];
+		float inverseMass;
+		float friction;
+		float restitution;
+		float sleepTime;             // 止まっている時間
+		uint32_t sleepIsland;        // 眠っている島の番号。起きていればkAwake
+		int32_t proxy;               // DynamicAABBTreeのプロキシ
+		unsigned int color;
+		Shape shape;
+	};
+
+	// 接触点。ウォームスタート用に剛体のローカル座標での位置を持つ
+	struct ContactPoint {
+		Vector3 point;        // ワールド座標(2つの形状の最近接点の中点)
+		Vector3 localA;       // bodyAのローカル座標
+		Vector3 localB;       // bodyBのローカル座標(平面ならワールド座標)
+		float depth;
+		float normalImpulse;  // 蓄積した力積
+		float tangentImpulse[2];
+	};
+
+	// 2つの剛体(または剛体と平面)の接触。法線はbodyAからbodyBへ向かう向き
+	struct Manifold {
+		uint64_t key;         // 組の番号((bodyA << 32) | bodyB)。この順に並べておく
+		uint32_t bodyA;
+		uint32_t bodyB;
+		Vector3 normal;
+		uint32_t pointCount;
+		ContactPoint points[kMaxManifoldPoints];
+	};
+
+	// ソルバーの作業用の接触点
+	struct ContactConstraint {
+		Vector3 rA;                // ステップの始めの重心から接触点まで
+		Vector3 rB;
+		float baseSeparation;      // 距離(離れていれば正)から、rB - rAの法線方向の成分を引いたもの
+		float normalMass;
+		float tangentMass[2];
+		float relativeVelocity;    // ステップの始めの法線方向の相対速度(反発用)
+		float maxNormalImpulse;    // サブステップ中の法線方向の力積の最大(反発用)
+		float normalImpulse;
+		float tangentImpulse[2];
+	};
+
+	// 動かない剛体と平面は、速度が0で質量が無限大の作業用の剛体を指す(スレッドごとに持ち、他の島と書き込みが重ならないように)
+	struct ConstraintManifold {
+		Body* bodyA;
+		Body* bodyB;
+		Vector3 normal;
+		Vector3 tangent[2];
+		float friction;
+		float restitution;
+		// 柔らかい拘束の係数(動かない物との接触は硬めにする)
+		float biasRate;
+		float massScale;
+		float impulseScale;
+		uint32_t pointCount;
+		ContactConstraint points[kMaxManifoldPoints];
+	};
+
+	uint32_t AddBody(Shape shape, const Vector3& position, const Quaternion& orientation, const Vector3& halfExtent, float mass, const Vector3& inertia, unsigned int color);
+	AABB ComputeAABB(const Body& body) const;
+	void UpdateInverseInertia(Body& body) const;
+
+	void BroadPhase();
+	void NarrowPhase();
+	void BuildIslands();
+	void SolveIsland(uint32_t island, uint32_t threadIndex);
+	void SleepIslands();
+	// 眠っている島の剛体を全て起こし、wokenがあれば起こした剛体を足す
+	void WakeIsland(uint32_t sleepIsland, std::vector<uint32_t>* woken);
+
+	// 2つの剛体の接触点を求める。法線はaからbへ向かう向き。点の数を返す
+	uint32_t Collide(uint32_t a, uint32_t b, Manifold& manifold) const;
+	uint32_t CollidePlane(uint32_t body, const Plane& plane, Manifold& manifold) const;
+	// 前のステップの同じ組の接触点から力積を引き継ぐ
+	void WarmStart(Manifold& manifold) const;
+
+	// 並列のUnion-Find。根は常にその集合の一番小さい番号になる
+	uint32_t Find(uint32_t body) const;
+	void Union(uint32_t a, uint32_t b);
+
+	// [0, count)をgrain個ずつ区切って処理する(pool_が無ければまとめて呼ぶ)
+	template<typename Function>
+	void ForEachRange(size_t count, size_t grain, Function&& function);
+
+	std::vector<Body> bodies_;
+	std::vector<Plane> planes_;
+	DynamicAABBTree tree_;
+
+	// 起きている動く剛体の番号
+	std::vector<uint32_t> awakeBodies_;
+	// ブロードフェーズの結果(スレッドごとに集めてから並べ替える)
+	std::vector<std::vector<uint64_t>> threadPairs_;
+	std::vector<std::vector<uint32_t>> threadWakeRequests_;
+	std::vector<uint64_t> pairs_;
+
+	// 接触多様体。previousManifolds_は前のステップの分(ウォームスタート用)
+	std::vector<Manifold> manifolds_;
+	std::vector<Manifold> previousManifolds_;
+
+	// Union-Findの親
+	std::unique_ptr<std::atomic<uint32_t>[]> parents_;
+	size_t parentCapacity_ = 0;
+	// 島ごとの剛体と接触多様体(CSR形式)
+	std::vector<uint32_t> islandOfBody_;
+	std::vector<uint32_t> islandBodyStart_;
+	std::vector<uint32_t> islandBodies_;
+	std::vector<uint32_t> islandManifoldStart_;
+	std::vector<uint32_t> islandManifolds_;
+	std::vector<uint8_t> islandCanSleep_;
+	// 眠っている島ごとの剛体。空いた番号はfreeSleepIslands_で使い回す
+	std::vector<std::vector<uint32_t>> sleepIslands_;
+	std::vector<uint32_t> freeSleepIslands_;
+	// スレッドごとのソルバーの作業領域
+	std::vector<std::vector<ConstraintManifold>> threadConstraints_;
+
+	Vector3 gravity_ = { 0.0f, -9.8f, 0.0f };
+	float timeStep_ = 1.0f / 60.0f;
+	float accumulator_ = 0.0f;
+	uint32_t subSteps_ = 4;
+	uint32_t maxStepsPerUpdate_ = 8;
+	bool sleepEnabled_ = true;
+	ThreadPool* pool_ = nullptr;
+	Statistics statistics_ = {};
+};
@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <cmath>
+#include "SignedDistanceField.h"
+#include "Function.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+namespace {
+// 粗い格子を求めるときに1スレッドがまとめて処理する行の数
+constexpr size_t kRowGrain = 4;
+// ブリックを1スレッドがまとめて処理する数
+constexpr size_t kBrickGrain = 1;
+// まとめて処理する点を1スレッドが処理する数
+constexpr size_t kSampleGrain = 4096;
+
+// 焼き込む形状の種類と配列での番号
+struct Primitive {
+	enum class Kind : uint32_t {
+		Sphere,
+		Plane,
+		AABB,
+		OBB,
+		Capsule,
+	};
+	Kind kind;
+	uint32_t index;
+};
+
+// poolがあれば[0, count)をgrain個ずつ並列に処理する
+template<typename Function>
+void ForEachRange(ThreadPool* pool, size_t count, size_t grain, Function&& function) {
+	if (pool != nullptr) {
+		pool->ParallelFor(count, grain, [&](size_t begin, size_t end, uint32_t) {
+			function(begin, end);
+		});
+		return;
+	}
+	function(size_t(0), count);
+}
+
+float Distance(const DistanceFieldShapes& shapes, const Primitive& primitive, const Vector3& point) {
+	switch (primitive.kind) {
+	case Primitive::Kind::Sphere:
+		return SignedDistance(shapes.spheres[primitive.index], point);
+	case Primitive::Kind::Plane:
+		return SignedDistance(shapes.planes[primitive.index], point);
+	case Primitive::Kind::AABB:
+		return SignedDistance(shapes.aabbs[primitive.index], point);
+	case Primitive::Kind::OBB:
+		return SignedDistance(shapes.obbs[primitive.index], point);
+	case Primitive::Kind::Capsule:
+		return SignedDistance(shapes.capsules[primitive.index], point);
+	}
+	return 0.0f;
+}
+
+// 形状の集まり(和集合)までの距離。形状が無ければfarを返す
+float Distance(const DistanceFieldShapes& shapes, std::span<const Primitive> primitives, const Vector3& point, float far) {
+	float distance = far;
+	for (const Primitive& primitive : primitives) {
+		distance = std::min(distance, Distance(shapes, primitive, point));
+	}
+	return distance;
+}
+}
+
+#pragma region 作成
+void SignedDistanceField::Build(const DistanceFieldShapes& shapes, const AABB& bounds, float voxelSize, float narrowBand) {
+	MT4_PROFILE_ZONE("SignedDistanceField::Build");
+	const auto start = std::chrono::steady_clock::now();
+	assert(voxelSize > 0.0f);
+
+	std::vector<Primitive> primitives;
+	auto add = [&primitives](Primitive::Kind kind, size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			primitives.push_back({ kind, static_cast<uint32_t>(i) });
+		}
+	};
+	add(Primitive::Kind::Sphere, shapes.spheres.size());
+	add(Primitive::Kind::Plane, shapes.planes.size());
+	add(Primitive::Kind::AABB, shapes.aabbs.size());
+	add(Primitive::Kind::OBB, shapes.obbs.size());
+	add(Primitive::Kind::Capsule, shapes.capsules.size());
+
+	// 範囲は上側にブリック単位で広げる
+	voxelSize_ = voxelSize;
+	inverseVoxelSize_ = 1.0f / voxelSize;
+	bounds_ = bounds;
+	const float extent[3] = { bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z };
+	for (int axis = 0; axis < 3; ++axis) {
+		const uint32_t voxels = std::max(static_cast<uint32_t>(std::ceil(extent[axis] * inverseVoxelSize_)), 1u);
+		brickCount_[axis] = (voxels + kBrickSize - 1) / kBrickSize;
+		voxelCount_[axis] = brickCount_[axis] * kBrickSize;
+	}
+	bounds_.max = bounds_.min + Vector3{ static_cast<float>(voxelCount_[0]), static_cast<float>(voxelCount_[1]), static_cast<float>(voxelCount_[2]) } * voxelSize;
+	const float brickSize = voxelSize * static_cast<float>(kBrickSize);
+	// 形状が無いところの距離(範囲の対角線の長さ)
+	const float far = Length(bounds_.max - bounds_.min);
+
+	// ブリックの角の距離
+	const uint32_t cornerX = brickCount_[0] + 1;
+	const uint32_t cornerY = brickCount_[1] + 1;
+	const uint32_t cornerZ = brickCount_[2] + 1;
+	coarse_.resize(static_cast<size_t>(cornerX) * cornerY * cornerZ);
+	ForEachRange(pool_, static_cast<size_t>(cornerY) * cornerZ, kRowGrain, [&](size_t begin, size_t end) {
+		for (size_t row = begin; row < end; ++row) {
+			const float y = bounds_.min.y + static_cast<float>(row % cornerY) * brickSize;
+			const float z = bounds_.min.z + static_cast<float>(row / cornerY) * brickSize;
+			for (uint32_t x = 0; x < cornerX; ++x) {
+				coarse_[row * cornerX + x] = Distance(shapes, primitives, { bounds_.min.x + static_cast<float>(x) * brickSize, y, z }, far);
+			}
+		}
+	});
+
+	// 中心から表面までの距離がブリックの外接球の半径 + narrowBand以内なら、ブリックの中にnarrowBand以内の点があり得る
+	const size_t brickTotal = static_cast<size_t>(brickCount_[0]) * brickCount_[1] * brickCount_[2];
+	const float halfDiagonal = brickSize * 0.5f * std::sqrt(3.0f);
+	auto brickCenter = [&](size_t brick) {
+		const uint32_t x = static_cast<uint32_t>(brick % brickCount_[0]);
+		const uint32_t y = static_cast<uint32_t>((brick / brickCount_[0]) % brickCount_[1]);
+		const uint32_t z = static_cast<uint32_t>(brick / (static_cast<size_t>(brickCount_[0]) * brickCount_[1]));
+		return bounds_.min + Vector3{ static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f, static_cast<float>(z) + 0.5f } * brickSize;
+	};
+	brickIndex_.resize(brickTotal);
+	ForEachRange(pool_, brickTotal, kRowGrain * brickCount_[0], [&](size_t begin, size_t end) {
+		for (size_t brick = begin; brick < end; ++brick) {
+			const float distance = Distance(shapes, primitives, brickCenter(brick), far);
+			brickIndex_[brick] = std::abs(distance) <= halfDiagonal + narrowBand ? 0 : kCoarseBrick;
+		}
+	});
+	// 細かい格子の番号はブリックの順に振る(スレッド数によらず同じ並びになる)
+	uint32_t fineCount = 0;
+	for (uint32_t& index : brickIndex_) {
+		if (index != kCoarseBrick) {
+			index = fineCount++;
+		}
+	}
+
+	// 細かい格子。ブリックの中で一番近くなり得る形状だけで求める
+	// ブリックの中の点では各形状の距離は中心との差がhalfDiagonal以内なので、中心での距離が(一番近い形状の距離 + 2 * halfDiagonal)より遠い形状は一番近くならない
+	fine_.resize(static_cast<size_t>(fineCount) * kBrickSampleCount);
+	ForEachRange(pool_, brickTotal, kBrickGrain, [&](size_t begin, size_t end) {
+		std::vector<float> centerDistances(primitives.size());
+		std::vector<Primitive> candidates;
+		for (size_t brick = begin; brick < end; ++brick) {
+			if (brickIndex_[brick] == kCoarseBrick) {
+				continue;
+			}
+			const Vector3 center = brickCenter(brick);
+			float nearest = far;
+			for (size_t i = 0; i < primitives.size(); ++i) {
+				centerDistances[i] = Distance(shapes, primitives[i], center);
+				nearest = std::min(nearest, centerDistances[i]);
+			}
+			candidates.clear();
+			for (size_t i = 0; i < primitives.size(); ++i) {
+				if (centerDistances[i] <= nearest + 2.0f * halfDiagonal) {
+					candidates.push_back(primitives[i]);
+				}
+			}
+			const Vector3 corner = center - Vector3{ 0.5f, 0.5f, 0.5f } * brickSize;
+			float* samples = fine_.data() + static_cast<size_t>(brickIndex_[brick]) * kBrickSampleCount;
+			for (uint32_t z = 0; z < kBrickSamples; ++z) {
+				for (uint32_t y = 0; y < kBrickSamples; ++y) {
+					for (uint32_t x = 0; x < kBrickSamples; ++x) {
+						const Vector3 point = corner + Vector3{ static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) } * voxelSize;
+						*samples++ = Distance(shapes, candidates, point, far);
+					}
+				}
+			}
+		}
+	});
+
+	statistics_ = {};
+	for (int axis = 0; axis < 3; ++axis) {
+		statistics_.voxelCount[axis] = voxelCount_[axis];
+		statistics_.brickCount[axis] = brickCount_[axis];
+	}
+	statistics_.fineBrickCount = fineCount;
+	statistics_.shapeCount = primitives.size();
+	statistics_.memoryBytes = (coarse_.size() + fine_.size()) * sizeof(float) + brickIndex_.size() * sizeof(uint32_t);
+	statistics_.buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+#pragma endregion
+
+#pragma region 問い合わせ
+float SignedDistanceField::Interpolate(const Vector3& point, Vector3* gradient) const {
+	if (brickIndex_.empty()) {
+		if (gradient != nullptr) {
+			*gradient = {};
+		}
+		return 0.0f;
+	}
+	// 格子座標(ボクセルの大きさを1とした座標)。範囲の外は端に寄せて、はみ出した距離を後で足す
+	const Vector3 clamped = {
+		std::clamp(point.x, bounds_.min.x, bounds_.max.x),
+		std::clamp(point.y, bounds_.min.y, bounds_.max.y),
+		std::clamp(point.z, bounds_.min.z, bounds_.max.z),
+	};
+	const float grid[3] = {
+		(clamped.x - bounds_.min.x) * inverseVoxelSize_,
+		(clamped.y - bounds_.min.y) * inverseVoxelSize_,
+		(clamped.z - bounds_.min.z) * inverseVoxelSize_,
+	};
+	uint32_t brick[3];
+	float local[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		brick[axis] = std::min(static_cast<uint32_t>(grid[axis]) / kBrickSize, brickCount_[axis] - 1);
+		local[axis] = grid[axis] - static_cast<float>(brick[axis] * kBrickSize);
+	}
+	const uint32_t index = brickIndex_[(static_cast<size_t>(brick[2]) * brickCount_[1] + brick[1]) * brickCount_[0] + brick[0]];
+
+	// 補間する8つの角と、角の間隔の逆数
+	const float* base;
+	size_t strideY;
+	size_t strideZ;
+	float fraction[3];
+	float inverseSpacing;
+	if (index != kCoarseBrick) {
+		uint32_t cell[3];
+		for (int axis = 0; axis < 3; ++axis) {
+			cell[axis] = std::min(static_cast<uint32_t>(local[axis]), kBrickSize - 1);
+			fraction[axis] = local[axis] - static_cast<float>(cell[axis]);
+		}
+		strideY = kBrickSamples;
+		strideZ = kBrickSamples * kBrickSamples;
+		base = fine_.data() + static_cast<size_t>(index) * kBrickSampleCount + cell[2] * strideZ + cell[1] * strideY + cell[0];
+		inverseSpacing = inverseVoxelSize_;
+	} else {
+		for (int axis = 0; axis < 3; ++axis) {
+			fraction[axis] = local[axis] * (1.0f / static_cast<float>(kBrickSize));
+		}
+		strideY = brickCount_[0] + 1;
+		strideZ = strideY * (brickCount_[1] + 1);
+		base = coarse_.data() + brick[2] * strideZ + brick[1] * strideY + brick[0];
+		inverseSpacing = inverseVoxelSize_ * (1.0f / static_cast<float>(kBrickSize));
+	}
+	const float c000 = base[0];
+	const float c100 = base[1];
+	const float c010 = base[strideY];
+	const float c110 = base[strideY + 1];
+	const float c001 = base[strideZ];
+	const float c101 = base[strideZ + 1];
+	const float c011 = base[strideZ + strideY];
+	const float c111 = base[strideZ + strideY + 1];
+	const float fx = fraction[0];
+	const float fy = fraction[1];
+	const float fz = fraction[2];
+	// x方向、y方向、z方向の順に線形補間する
+	const float c00 = c000 + (c100 - c000) * fx;
+	const float c10 = c010 + (c110 - c010) * fx;
+	const float c01 = c001 + (c101 - c001) * fx;
+	const float c11 = c011 + (c111 - c011) * fx;
+	const float c0 = c00 + (c10 - c00) * fy;
+	const float c1 = c01 + (c11 - c01) * fy;
+	float distance = c0 + (c1 - c0) * fz;
+	if (gradient != nullptr) {
+		const float dx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * fy;
+		const float dx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * fy;
+		*gradient = Vector3{
+			dx0 + (dx1 - dx0) * fz,
+			(c10 - c00) + ((c11 - c01) - (c10 - c00)) * fz,
+			c1 - c0,
+		} * inverseSpacing;
+	}
+	if (clamped.x != point.x || clamped.y != point.y || clamped.z != point.z) {
+		distance += Length(point - clamped);
+	}
+	return distance;
+}
+
+float SignedDistanceField::GetDistance(const Vector3& point) const {
+	return Interpolate(point, nullptr);
+}
+
+float SignedDistanceField::Sample(const Vector3& point, Vector3& gradient) const {
+	return Interpolate(point, &gradient);
+}
+
+void SignedDistanceField::Sample(std::span<const Vector3> points, std::span<float> distances, std::span<Vector3> gradients) const {
+	MT4_PROFILE_ZONE("SignedDistanceField::Sample");
+	assert(distances.size() >= points.size());
+	assert(gradients.empty() || gradients.size() >= points.size());
+	const bool withGradients = !gradients.empty();
+	ForEachRange(pool_, points.size(), kSampleGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			distances[i] = Interpolate(points[i], withGradients ? &gradients[i] : nullptr);
+		}
+	});
+}
+
+bool SignedDistanceField::IsCollision(const Sphere& sphere, Contact& contact) const {
+	Vector3 gradient;
+	const float distance = Sample(sphere.center, gradient);
+	if (distance >= sphere.radius) {
+		return false;
+	}
+	// 勾配が0(距離が極小になる点)では向きが決まらないので上向きとみなす
+	const float length = Length(gradient);
+	const Vector3 outward = length > 1.0e-6f ? gradient * (1.0f / length) : Vector3{ 0.0f, 1.0f, 0.0f };
+	contact.normal = -outward;
+	contact.depth = sphere.radius - distance;
+	contact.point = sphere.center - outward * ((distance + sphere.radius) * 0.5f);
+	return true;
+}
+#pragma endregion
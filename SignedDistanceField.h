@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Collision.h"
+#include "Struct.h"
+
+class ThreadPool;
+
+// 距離場に焼き込む動かない形状の一覧(配列は呼び出し側が持つ)
+struct DistanceFieldShapes {
+	std::span<const Sphere> spheres;
+	std::span<const Plane> planes;
+	std::span<const AABB> aabbs;
+	std::span<const OBB> obbs;
+	std::span<const Capsule> capsules;
+};
+
+// 動かない形状の集まりまでの符号付き距離(外側が正、内側が負)を格子に焼き込んだもの
+// 範囲をkBrickSize^3個のボクセルのブリックに分け、
+//   ブリックの角では常に距離を持つ(粗い格子)
+//   表面からnarrowBand以内に掛かるブリックだけ、全ボクセルの角の距離を持つ(細かい格子)
+// 問い合わせは点のあるブリックの格子を三線形補間するだけなので、形状の数によらず一定の手間で済む
+// 細かい格子の無いブリック(表面から遠い所)は粗い格子の補間なので、距離はボクセルの大きさより粗い近似になる
+// 作るときはブリックの中心との距離で、ブリックの中で一番近くなり得る形状だけに絞り込んでから各点を求める
+class SignedDistanceField {
+public:
+	// ブリックの1辺のボクセル数
+	static constexpr uint32_t kBrickSize = 8;
+	// 細かい格子を持たないブリックのbrickIndex_
+	static constexpr uint32_t kCoarseBrick = 0xFFFFFFFF;
+
+	// 直近のBuildの統計
+	struct Statistics {
+		uint32_t voxelCount[3];  // 各軸のボクセル数
+		uint32_t brickCount[3];  // 各軸のブリック数
+		size_t fineBrickCount;   // 細かい格子を持つブリックの数
+		size_t shapeCount;
+		size_t memoryBytes;      // 距離の格子と索引の大きさ
+		double buildSeconds;
+	};
+
+	// nullptrなら呼び出したスレッドだけで処理する
+	void SetThreadPool(ThreadPool* pool) { pool_ = pool; }
+
+	// boundsの範囲をvoxelSizeの大きさのボクセルに分けて焼き込む
+	// 表面(距離0)からnarrowBand以内の点は細かい格子で補間する。0でも表面を含むブリックは細かい格子を持つ
+	void Build(const DistanceFieldShapes& shapes, const AABB& bounds, float voxelSize, float narrowBand);
+
+	const AABB& GetBounds() const { return bounds_; }
+	float GetVoxelSize() const { return voxelSize_; }
+
+	// 点での距離。範囲の外は一番近い範囲内の点の距離に、その点までの距離を足す
+	float GetDistance(const Vector3& point) const;
+	// 点での距離と勾配(補間した距離の微分。表面の外向きの法線に近い)
+	float Sample(const Vector3& point, Vector3& gradient) const;
+	// まとめて求める。gradientsが空なら距離だけ求める
+	void Sample(std::span<const Vector3> points, std::span<float> distances, std::span<Vector3> gradients) const;
+
+	// 球と形状の集まりの接触。法線は球から形状へ向かう向き(勾配の逆向き)
+	bool IsCollision(const Sphere& sphere, Contact& contact) const;
+
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private:
+	// 細かい格子の1辺の点の数(ブリックの両端の角を含む)
+	static constexpr uint32_t kBrickSamples = kBrickSize + 1;
+	static constexpr uint32_t kBrickSampleCount = kBrickSamples * kBrickSamples * kBrickSamples;
+
+	// 点の距離と(gradientがあれば)勾配を補間する
+	float Interpolate(const Vector3& point, Vector3* gradient) const;
+
+	std::vector<float> coarse_;         // ブリックの角の距離((brickCount + 1)^3個、x方向が先に並ぶ)
+	std::vector<uint32_t> brickIndex_;  // ブリックごとの細かい格子の番号。無ければkCoarseBrick
+	std::vector<float> fine_;           // 細かい格子(1つのブリックにkBrickSampleCount個)
+	AABB bounds_ = {};
+	float voxelSize_ = 1.0f;
+	float inverseVoxelSize_ = 1.0f;
+	uint32_t voxelCount_[3] = {};
+	uint32_t brickCount_[3] = {};
+	ThreadPool* pool_ = nullptr;
+	Statistics statistics_ = {};
+};
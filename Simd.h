@@ -0,0 +1,221 @@
+#pragma once
+#include <cstddef>
+#include <immintrin.h>
+
+// SSE/AVXの共通ヘルパー
+// x64ではSSE2までは常に使えるので、AVXは__AVX__が定義されている場合(/arch:AVX等)だけ使う
+namespace Simd {
+
+#pragma region レーン幅に依存しない演算
+// 使用できる一番広いfloatレジスタ(AVX:8レーン、SSE:4レーン)
+#if defined(__AVX__)
+using Float = __m256;
+constexpr size_t kWidth = 8;
+inline Float Load(const float* p) { return _mm256_load_ps(p); }
+inline Float LoadUnaligned(const float* p) { return _mm256_loadu_ps(p); }
+inline void Store(float* p, Float v) { _mm256_store_ps(p, v); }
+inline void StoreUnaligned(float* p, Float v) { _mm256_storeu_ps(p, v); }
+inline Float Set1(float s) { return _mm256_set1_ps(s); }
+inline Float Zero() { return _mm256_setzero_ps(); }
+inline Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+inline Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+inline Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+inline Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+inline Float Sqrt(Float a) { return _mm256_sqrt_ps(a); }
+inline Float CmpEq(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+inline Float CmpLt(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline Float CmpLe(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+// どちらかがNaNのレーンはbになる
+inline Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+inline Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+// maskが立っているレーンはa、それ以外はbを選ぶ
+inline Float Select(Float mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+inline Float Or(Float a, Float b) { return _mm256_or_ps(a, b); }
+inline Float And(Float a, Float b) { return _mm256_and_ps(a, b); }
+// 各レーンの符号ビット(比較結果のマスク)をまとめた整数
+inline int MoveMask(Float a) { return _mm256_movemask_ps(a); }
+// 最も近い整数に丸める(0.5ちょうどは偶数側)
+inline Float Round(Float a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+#else
+using Float = __m128;
+constexpr size_t kWidth = 4;
+inline Float Load(const float* p) { return _mm_load_ps(p); }
+inline Float LoadUnaligned(const float* p) { return _mm_loadu_ps(p); }
+inline void Store(float* p, Float v) { _mm_store_ps(p, v); }
+inline void StoreUnaligned(float* p, Float v) { _mm_storeu_ps(p, v); }
+inline Float Set1(float s) { return _mm_set1_ps(s); }
+inline Float Zero() { return _mm_setzero_ps(); }
+inline Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+inline Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+inline Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+inline Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+inline Float Sqrt(Float a) { return _mm_sqrt_ps(a); }
+inline Float CmpEq(Float a, Float b) { return _mm_cmpeq_ps(a, b); }
+inline Float CmpLt(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+inline Float CmpLe(Float a, Float b) { return _mm_cmple_ps(a, b); }
+// どちらかがNaNのレーンはbになる
+inline Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+inline Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+// maskが立っているレーンはa、それ以外はbを選ぶ
+inline Float Select(Float mask, Float a, Float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+inline Float Or(Float a, Float b) { return _mm_or_ps(a, b); }
+inline Float And(Float a, Float b) { return _mm_and_ps(a, b); }
+// 各レーンの符号ビット(比較結果のマスク)をまとめた整数
+inline int MoveMask(Float a) { return _mm_movemask_ps(a); }
+// 最も近い整数に丸める(0.5ちょうどは偶数側)。SSE2には丸め命令が無いので整数を経由する(|a| < 2^31)
+inline Float Round(Float a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+#endif
+#pragma endregion
+
+#pragma region 並べ替え
+// 要素を並べ替える(結果のi番目 = vの(x,y,z,w)[i]番目)
+template<int x, int y, int z, int w>
+inline __m128 Swizzle(__m128 v) {
+	return _mm_shuffle_ps(v, v, _MM_SHUFFLE(w, z, y, x));
+}
+#pragma endregion
+
+#pragma region AoS <-> SoA
+// Vector3 4個分(float 12個)を読み込み、x,y,zそれぞれ4要素ずつに並べ替える
+inline void LoadVector3x4(const float* src, __m128& x, __m128& y, __m128& z) {
+	__m128 a = _mm_loadu_ps(src + 0); // x0 y0 z0 x1
+	__m128 b = _mm_loadu_ps(src + 4); // y1 z1 x2 y2
+	__m128 c = _mm_loadu_ps(src + 8); // z2 x3 y3 z3
+	__m128 xy = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2)); // x2 y2 x3 y3
+	__m128 yz = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1)); // y0 z0 y1 z1
+	x = _mm_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+	y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+	z = _mm_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+// x,y,zそれぞれ4要素をVector3 4個分(float 12個)に並べ直して書き込む
+inline void StoreVector3x4(float* dst, __m128 x, __m128 y, __m128 z) {
+	__m128 t0 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0)); // x0 x2 y0 y2
+	__m128 t1 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0)); // z0 z2 x1 x3
+	__m128 t2 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1)); // y1 y3 z1 z3
+	_mm_storeu_ps(dst + 0, _mm_shuffle_ps(t0, t1, _MM_SHUFFLE(2, 0, 2, 0)));
+	_mm_storeu_ps(dst + 4, _mm_shuffle_ps(t2, t0, _MM_SHUFFLE(3, 1, 2, 0)));
+	_mm_storeu_ps(dst + 8, _mm_shuffle_ps(t1, t2, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+// 4要素の構造体(Quaternionなど)4個分を読み込み、要素ごとに4つずつ並べ替える
+inline void LoadVector4x4(const float* src, __m128& x, __m128& y, __m128& z, __m128& w) {
+	x = _mm_loadu_ps(src + 0);
+	y = _mm_loadu_ps(src + 4);
+	z = _mm_loadu_ps(src + 8);
+	w = _mm_loadu_ps(src + 12);
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+}
+
+// LoadVector4x4の逆変換
+inline void StoreVector4x4(float* dst, __m128 x, __m128 y, __m128 z, __m128 w) {
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+	_mm_storeu_ps(dst + 0, x);
+	_mm_storeu_ps(dst + 4, y);
+	_mm_storeu_ps(dst + 8, z);
+	_mm_storeu_ps(dst + 12, w);
+}
+
+#if defined(__AVX__)
+// Vector3 8個分を読み込む。下位128bitに0～3個目、上位128bitに4～7個目が入る
+inline void LoadVector3x8(const float* src, __m256& x, __m256& y, __m256& z) {
+	__m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 0)), _mm_loadu_ps(src + 12), 1);
+	__m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 4)), _mm_loadu_ps(src + 16), 1);
+	__m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 8)), _mm_loadu_ps(src + 20), 1);
+	__m256 xy = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+	__m256 yz = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+	x = _mm256_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+	y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+	z = _mm256_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+// LoadVector3x8の逆変換
+inline void StoreVector3x8(float* dst, __m256 x, __m256 y, __m256 z) {
+	__m256 t0 = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+	__m256 t1 = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+	__m256 t2 = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+	__m256 a = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(2, 0, 2, 0));
+	__m256 b = _mm256_shuffle_ps(t2, t0, _MM_SHUFFLE(3, 1, 2, 0));
+	__m256 c = _mm256_shuffle_ps(t1, t2, _MM_SHUFFLE(3, 1, 3, 1));
+	_mm_storeu_ps(dst + 0, _mm256_castps256_ps128(a));
+	_mm_storeu_ps(dst + 4, _mm256_castps256_ps128(b));
+	_mm_storeu_ps(dst + 8, _mm256_castps256_ps128(c));
+	_mm_storeu_ps(dst + 12, _mm256_extractf128_ps(a, 1));
+	_mm_storeu_ps(dst + 16, _mm256_extractf128_ps(b, 1));
+	_mm_storeu_ps(dst + 20, _mm256_extractf128_ps(c, 1));
+}
+#endif
+
+// Float 1本分のVector3を書き込む
+inline void StoreVector3(float* dst, Float x, Float y, Float z) {
+#if defined(__AVX__)
+	StoreVector3x8(dst, x, y, z);
+#else
+	StoreVector3x4(dst, x, y, z);
+#endif
+}
+#pragma endregion
+
+#pragma region 三角関数
+// sinとcosを多項式近似で同時に求める
+// π/2の倍数を引いて[-π/4, π/4]に縮めてから(Cody-Waite法)、区間ごとの最小最大近似多項式(Cephesのsinf/cosfと同じ係数)を使う
+// 誤差は|x| <= 8192で真の値との絶対誤差1e-7未満(倍精度との比較で実測7.8e-8)。それより大きいと縮める際の誤差が増えていく
+inline void SinCos(Float x, Float& sin, Float& cos) {
+	// x = k * π/2 + r
+	Float k = Round(Mul(x, Set1(0.63661977236758134f)));
+	Float r = Sub(x, Mul(k, Set1(1.5703125f)));
+	r = Sub(r, Mul(k, Set1(4.837512969970703125e-4f)));
+	r = Sub(r, Mul(k, Set1(7.549789954891882e-8f)));
+
+	Float r2 = Mul(r, r);
+	Float s = Add(Mul(r2, Set1(-1.9515295891e-4f)), Set1(8.3321608736e-3f));
+	s = Add(Mul(s, r2), Set1(-1.6666654611e-1f));
+	s = Add(Mul(Mul(s, r2), r), r);
+	Float c = Add(Mul(r2, Set1(2.443315711809948e-5f)), Set1(-1.388731625493765e-3f));
+	c = Add(Mul(c, r2), Set1(4.166664568298827e-2f));
+	c = Add(Sub(Mul(Mul(c, r2), r2), Mul(r2, Set1(0.5f))), Set1(1.0f));
+
+	// kを4で割った余り(-2～2)で、sinとcosの入れ替えと符号を決める
+	Float quadrant = Sub(k, Mul(Round(Mul(k, Set1(0.25f))), Set1(4.0f)));
+	Float q1 = CmpEq(quadrant, Set1(1.0f));
+	Float q2 = Or(CmpEq(quadrant, Set1(2.0f)), CmpEq(quadrant, Set1(-2.0f)));
+	Float q3 = CmpEq(quadrant, Set1(-1.0f));
+	Float swap = Or(q1, q3);
+	Float sinValue = Select(swap, c, s);
+	Float cosValue = Select(swap, s, c);
+	Float one = Set1(1.0f);
+	Float minusOne = Set1(-1.0f);
+	sin = Mul(sinValue, Select(Or(q2, q3), minusOne, one));
+	cos = Mul(cosValue, Select(Or(q1, q2), minusOne, one));
+}
+#pragma endregion
+
+#pragma region FloatPack
+// Floatを普通の数値と同じように+ - * /で扱えるようにした型
+// MathCore.hのテンプレートに成分の型として渡すと、kWidth個分のベクトルを1回で計算できる(TVector3<FloatPack>など)
+// floatからは全レーンに同じ値を入れる形で暗黙に変換する
+struct FloatPack {
+	Float value;
+
+	FloatPack() = default;
+	FloatPack(Float v) : value(v) {}
+	FloatPack(float s) : value(Set1(s)) {}
+};
+
+inline FloatPack operator+(FloatPack a, FloatPack b) { return Add(a.value, b.value); }
+inline FloatPack operator-(FloatPack a, FloatPack b) { return Sub(a.value, b.value); }
+inline FloatPack operator*(FloatPack a, FloatPack b) { return Mul(a.value, b.value); }
+inline FloatPack operator/(FloatPack a, FloatPack b) { return Div(a.value, b.value); }
+inline FloatPack operator-(FloatPack a) { return Mul(a.value, Set1(-1.0f)); }
+inline FloatPack& operator+=(FloatPack& a, FloatPack b) { return a = a + b; }
+inline FloatPack& operator-=(FloatPack& a, FloatPack b) { return a = a - b; }
+inline FloatPack& operator*=(FloatPack& a, FloatPack b) { return a = a * b; }
+inline FloatPack& operator/=(FloatPack& a, FloatPack b) { return a = a / b; }
+inline FloatPack Sqrt(FloatPack a) { return Sqrt(a.value); }
+// 逆数(0のレーンは0)
+inline FloatPack ReciprocalOrZero(FloatPack a) {
+	return Select(CmpEq(a.value, Zero()), Zero(), Div(Set1(1.0f), a.value));
+}
+#pragma endregion
+
+} // namespace Simd
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include "SpatialHashGrid.h"
+#include "ThreadPool.h"
+
+namespace {
+// 基数ソートの1回あたりのビット数
+constexpr uint32_t kRadixBits = 8;
+constexpr uint32_t kRadixSize = 1u << kRadixBits;
+// 並列に探すときに1つの区切りで扱う物体の数
+constexpr size_t kChunkSize = 1024;
+}
+
+SpatialHashGrid::SpatialHashGrid(float cellSize)
+	: cellSize_(cellSize) {}
+
+void SpatialHashGrid::Build(std::span<const Sphere> spheres) {
+	centers_.resize(spheres.size());
+	radii_.resize(spheres.size());
+	for (size_t i = 0; i < spheres.size(); ++i) {
+		centers_[i] = spheres[i].center;
+		radii_[i] = spheres[i].radius;
+	}
+	BuildBuckets();
+}
+
+void SpatialHashGrid::Build(std::span<const Ball> balls) {
+	centers_.resize(balls.size());
+	radii_.resize(balls.size());
+	for (size_t i = 0; i < balls.size(); ++i) {
+		centers_[i] = balls[i].position;
+		radii_[i] = balls[i].radius;
+	}
+	BuildBuckets();
+}
+
+uint32_t SpatialHashGrid::Hash(int32_t x, int32_t y, int32_t z) const {
+	// 大きな素数を掛けて混ぜる(Teschner et al. 2003)
+	uint32_t hash = (static_cast<uint32_t>(x) * 73856093u) ^ (static_cast<uint32_t>(y) * 19349663u) ^ (static_cast<uint32_t>(z) * 83492791u);
+	return hash & bucketMask_;
+}
+
+void SpatialHashGrid::CellOf(const Vector3& position, int32_t& x, int32_t& y, int32_t& z) const {
+	x = static_cast<int32_t>(std::floor(position.x * inverseCellSize_));
+	y = static_cast<int32_t>(std::floor(position.y * inverseCellSize_));
+	z = static_cast<int32_t>(std::floor(position.z * inverseCellSize_));
+}
+
+void SpatialHashGrid::BuildBuckets() {
+	const uint32_t count = static_cast<uint32_t>(centers_.size());
+	assert(centers_.size() < UINT32_MAX);
+
+	maxRadius_ = 0.0f;
+	for (float radius : radii_) {
+		maxRadius_ = std::max(maxRadius_, radius);
+	}
+	usedCellSize_ = cellSize_ > 0.0f ? cellSize_ : std::max(maxRadius_ * 2.0f, 1e-4f);
+	inverseCellSize_ = 1.0f / usedCellSize_;
+	// 重なる2つの中心は各軸で最大2 * maxRadius_離れているので、その分のセルを調べればよい
+	searchRange_ = std::max(1, static_cast<int32_t>(std::ceil(maxRadius_ * 2.0f * inverseCellSize_)));
+
+	// ハッシュ表の大きさは物体数の4倍以上の2の累乗にして、別のセルとの衝突を減らす
+	uint32_t bucketBits = 6;
+	while ((1u << bucketBits) < count * 4u && bucketBits < 30) {
+		++bucketBits;
+	}
+	const uint32_t bucketCount = 1u << bucketBits;
+	bucketMask_ = bucketCount - 1;
+
+	// 各物体の中心が入るセルのバケット番号
+	tempKeys_.resize(count);
+	tempIndices_.resize(count);
+	sortedKeys_.resize(count);
+	sortedIndices_.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		int32_t x, y, z;
+		CellOf(centers_[i], x, y, z);
+		sortedKeys_[i] = Hash(x, y, z);
+		sortedIndices_[i] = i;
+	}
+
+	// バケット番号の下位から8ビットずつ安定な計数ソートを繰り返す(LSD基数ソート)
+	for (uint32_t shift = 0; shift < bucketBits; shift += kRadixBits) {
+		uint32_t histogram[kRadixSize] = {};
+		for (uint32_t i = 0; i < count; ++i) {
+			++histogram[(sortedKeys_[i] >> shift) & (kRadixSize - 1)];
+		}
+		uint32_t offset = 0;
+		for (uint32_t digit = 0; digit < kRadixSize; ++digit) {
+			uint32_t size = histogram[digit];
+			histogram[digit] = offset;
+			offset += size;
+		}
+		for (uint32_t i = 0; i < count; ++i) {
+			uint32_t destination = histogram[(sortedKeys_[i] >> shift) & (kRadixSize - 1)]++;
+			tempKeys_[destination] = sortedKeys_[i];
+			tempIndices_[destination] = sortedIndices_[i];
+		}
+		sortedKeys_.swap(tempKeys_);
+		sortedIndices_.swap(tempIndices_);
+	}
+
+	// バケットごとの範囲を求める
+	bucketStart_.assign(bucketCount + 1, 0);
+	for (uint32_t i = 0; i < count; ++i) {
+		++bucketStart_[sortedKeys_[i] + 1];
+	}
+	uint32_t maxBucketSize = 0;
+	uint32_t occupiedBuckets = 0;
+	for (uint32_t bucket = 0; bucket < bucketCount; ++bucket) {
+		uint32_t size = bucketStart_[bucket + 1];
+		maxBucketSize = std::max(maxBucketSize, size);
+		occupiedBuckets += size != 0;
+		bucketStart_[bucket + 1] = bucketStart_[bucket] + size;
+	}
+
+	// 近くの物体がメモリ上でも近くなるよう、中心と半径もソート順に並べておく
+	entries_.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		uint32_t index = sortedIndices_[i];
+		entries_[i] = { centers_[index], radii_[index], index };
+	}
+
+	statistics_ = {};
+	statistics_.objectCount = count;
+	statistics_.bucketCount = bucketCount;
+	statistics_.occupiedBuckets = occupiedBuckets;
+	statistics_.maxBucketSize = maxBucketSize;
+	statistics_.searchRange = searchRange_;
+}
+
+uint64_t SpatialHashGrid::FindPairs(uint32_t begin, uint32_t end, std::vector<Pair>& pairs) const {
+	uint64_t candidates = 0;
+	// 調べるバケットの一覧。違うセルが同じバケットになることがあるので、重複を除いておく
+	std::vector<uint32_t> buckets;
+	const int32_t range = searchRange_;
+	buckets.reserve(static_cast<size_t>(2 * range + 1) * (2 * range + 1) * (2 * range + 1));
+	int32_t previousX = 0, previousY = 0, previousZ = 0;
+	bool hasPrevious = false;
+
+	for (uint32_t i = begin; i < end; ++i) {
+		const Vector3& center = entries_[i].center;
+		const float radius = entries_[i].radius;
+		const uint32_t index = entries_[i].index;
+		int32_t x, y, z;
+		CellOf(center, x, y, z);
+
+		// ソート済みなので同じセルの物体は並んでいることが多く、その間は一覧を使い回せる
+		if (!hasPrevious || x != previousX || y != previousY || z != previousZ) {
+			buckets.clear();
+			for (int32_t dz = -range; dz <= range; ++dz) {
+				for (int32_t dy = -range; dy <= range; ++dy) {
+					for (int32_t dx = -range; dx <= range; ++dx) {
+						// 空のバケットは除いておく。残りは少ないので重複は線形に探せば十分
+						uint32_t bucket = Hash(x + dx, y + dy, z + dz);
+						if (bucketStart_[bucket] != bucketStart_[bucket + 1] &&
+							std::find(buckets.begin(), buckets.end(), bucket) == buckets.end()) {
+							buckets.push_back(bucket);
+						}
+					}
+				}
+			}
+			previousX = x;
+			previousY = y;
+			previousZ = z;
+			hasPrevious = true;
+		}
+
+		for (uint32_t bucket : buckets) {
+			for (uint32_t j = bucketStart_[bucket]; j < bucketStart_[bucket + 1]; ++j) {
+				// 同じ組を2回数えないよう、元の添字が大きい相手とだけ組にする
+				const Entry& other = entries_[j];
+				if (other.index <= index) {
+					continue;
+				}
+				++candidates;
+				float dx = other.center.x - center.x;
+				float dy = other.center.y - center.y;
+				float dz = other.center.z - center.z;
+				float sum = radius + other.radius;
+				if (dx * dx + dy * dy + dz * dz <= sum * sum) {
+					pairs.push_back({ index, other.index });
+				}
+			}
+		}
+	}
+	return candidates;
+}
+
+void SpatialHashGrid::FindPairs(std::vector<Pair>& pairs, ThreadPool* pool) {
+	pairs.clear();
+	const uint32_t count = statistics_.objectCount;
+	const size_t chunkCount = (count + kChunkSize - 1) / kChunkSize;
+	if (pool == nullptr || chunkCount <= 1) {
+		statistics_.candidateCount = FindPairs(0, count, pairs);
+		statistics_.pairCount = pairs.size();
+		return;
+	}
+
+	// 区切りごとに専用の配列へ書き込むので、スレッド間でロックは要らない
+	if (chunkPairs_.size() < chunkCount) {
+		chunkPairs_.resize(chunkCount);
+	}
+	chunkCandidates_.assign(chunkCount, 0);
+	pool->ParallelFor(count, kChunkSize, [&](size_t begin, size_t end, uint32_t) {
+		size_t chunk = begin / kChunkSize;
+		chunkPairs_[chunk].clear();
+		chunkCandidates_[chunk] = FindPairs(static_cast<uint32_t>(begin), static_cast<uint32_t>(end), chunkPairs_[chunk]);
+	});
+
+	size_t total = 0;
+	uint64_t candidates = 0;
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+		total += chunkPairs_[chunk].size();
+		candidates += chunkCandidates_[chunk];
+	}
+	pairs.reserve(total);
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+		pairs.insert(pairs.end(), chunkPairs_[chunk].begin(), chunkPairs_[chunk].end());
+	}
+	statistics_.candidateCount = candidates;
+	statistics_.pairCount = pairs.size();
+}
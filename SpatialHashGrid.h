@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Struct.h"
+
+class ThreadPool;
+
+// 一様格子による空間ハッシュのブロードフェーズ
+// 同じくらいの大きさの球(Ball, Sphere)が密集している場合に向いている
+// 毎フレームBuildで作り直す。各物体の中心が入るセルのハッシュ値を基数ソートして連続した配列に並べるので、
+// 木のような組み替えもポインタの追跡も無い
+class SpatialHashGrid {
+public:
+	// 重なっている組(Buildに渡した配列の添字。index1 < index2)
+	struct Pair {
+		uint32_t index1;
+		uint32_t index2;
+	};
+
+	// 直近のBuildとFindPairsの統計
+	struct Statistics {
+		uint32_t objectCount;       // 物体の数
+		uint32_t bucketCount;       // ハッシュ表の大きさ
+		uint32_t occupiedBuckets;   // 物体が1つ以上入っているバケットの数
+		uint32_t maxBucketSize;     // 1つのバケットに入っている物体の最大数
+		int32_t searchRange;        // 周囲何セルまで調べたか
+		uint64_t candidateCount;    // 距離を調べた組の数
+		size_t pairCount;           // 見つかった組の数
+	};
+
+	// cellSizeが0以下なら、Buildのたびに一番大きい物体の直径にする
+	explicit SpatialHashGrid(float cellSize = 0.0f);
+
+	// セルの大きさを変える。次のBuildから反映される
+	// 直径くらいにすると隣接セルだけ調べればよく、小さくするとセルあたりの物体は減るが調べるセルが増える
+	void SetCellSize(float cellSize) { cellSize_ = cellSize; }
+	float GetCellSize() const { return cellSize_; }
+
+	// 物体を登録し直す
+	void Build(std::span<const Sphere> spheres);
+	void Build(std::span<const Ball> balls);
+
+	// 重なっている組を全て求める。poolを渡すと物体を区切って並列に探す
+	// 区切りごとに別の配列へ書き込んでから順番につなぐので、結果の並びはスレッド数によらない
+	void FindPairs(std::vector<Pair>& pairs, ThreadPool* pool = nullptr);
+
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private:
+	// centers_とradii_を詰めた後の共通の処理
+	void BuildBuckets();
+	uint32_t Hash(int32_t x, int32_t y, int32_t z) const;
+	void CellOf(const Vector3& position, int32_t& x, int32_t& y, int32_t& z) const;
+	// ソート済みの[begin, end)番目の物体について、自分より添字が大きい相手との組を探す
+	uint64_t FindPairs(uint32_t begin, uint32_t end, std::vector<Pair>& pairs) const;
+
+	float cellSize_;
+	// 今回のBuildで使ったセルの大きさ
+	float usedCellSize_ = 1.0f;
+	float inverseCellSize_ = 1.0f;
+	float maxRadius_ = 0.0f;
+	int32_t searchRange_ = 1;
+	uint32_t bucketMask_ = 0;
+
+	// Buildに渡された順の中心と半径
+	std::vector<Vector3> centers_;
+	std::vector<float> radii_;
+	// バケット番号でソートした物体。sortedIndices_は元の添字
+	std::vector<uint32_t> sortedKeys_;
+	std::vector<uint32_t> sortedIndices_;
+	// ペア検出で相手を調べるときに読む値。1回のキャッシュミスで済むようまとめておく
+	struct Entry {
+		Vector3 center;
+		float radius;
+		uint32_t index;
+	};
+	std::vector<Entry> entries_;
+	// 基数ソートの作業領域
+	std::vector<uint32_t> tempKeys_;
+	std::vector<uint32_t> tempIndices_;
+	// バケットごとのソート済み配列での範囲[bucketStart_[b], bucketStart_[b + 1])
+	std::vector<uint32_t> bucketStart_;
+	// 並列に探すときの区切りごとの結果
+	std::vector<std::vector<Pair>> chunkPairs_;
+	std::vector<uint64_t> chunkCandidates_;
+
+	Statistics statistics_ = {};
+};
@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include "SpringSystem.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+namespace {
+// 並列に処理するときに1つの区切りで扱う要素数
+constexpr size_t kGrainSize = 4096;
+}
+
+template<typename Function>
+void SpringSystem::ForEachRange(size_t count, Function&& function) {
+	if (pool_ == nullptr) {
+		function(0, count, 0u);
+		return;
+	}
+	pool_->ParallelFor(count, kGrainSize, function);
+}
+
+#pragma region 追加と取得
+uint32_t SpringSystem::AddBall(const Ball& ball) {
+	uint32_t index = static_cast<uint32_t>(inverseMass_.size());
+	positionX_.push_back(ball.position.x);
+	positionY_.push_back(ball.position.y);
+	positionZ_.push_back(ball.position.z);
+	velocityX_.push_back(ball.velocity.x);
+	velocityY_.push_back(ball.velocity.y);
+	velocityZ_.push_back(ball.velocity.z);
+	previousX_.push_back(ball.position.x - ball.velocity.x * timeStep_);
+	previousY_.push_back(ball.position.y - ball.velocity.y * timeStep_);
+	previousZ_.push_back(ball.position.z - ball.velocity.z * timeStep_);
+	forceX_.push_back(0.0f);
+	forceY_.push_back(0.0f);
+	forceZ_.push_back(0.0f);
+	mass_.push_back(ball.mass);
+	inverseMass_.push_back(ball.mass > 0.0f ? 1.0f / ball.mass : 0.0f);
+	radius_.push_back(ball.radius);
+	color_.push_back(ball.color);
+	adjacencyDirty_ = true;
+	return index;
+}
+
+uint32_t SpringSystem::AddSpring(uint32_t ball1, uint32_t ball2, float naturalLength, float stiffness, float dampingCoefficient) {
+	assert(ball1 < GetBallCount());
+	assert(ball2 < GetBallCount() || ball2 == kAnchor);
+	assert(ball1 != ball2);
+	uint32_t index = static_cast<uint32_t>(ball1_.size());
+	ball1_.push_back(ball1);
+	ball2_.push_back(ball2);
+	naturalLength_.push_back(naturalLength);
+	stiffness_.push_back(stiffness);
+	damping_.push_back(dampingCoefficient);
+	anchorX_.push_back(0.0f);
+	anchorY_.push_back(0.0f);
+	anchorZ_.push_back(0.0f);
+	springForceX_.push_back(0.0f);
+	springForceY_.push_back(0.0f);
+	springForceZ_.push_back(0.0f);
+	adjacencyDirty_ = true;
+	return index;
+}
+
+uint32_t SpringSystem::AddSpring(const Spring& spring, uint32_t ball) {
+	uint32_t index = AddSpring(ball, kAnchor, spring.naturalLength, spring.stiffness, spring.dampingCoefficient);
+	anchorX_[index] = spring.ancher.x;
+	anchorY_[index] = spring.ancher.y;
+	anchorZ_[index] = spring.ancher.z;
+	return index;
+}
+
+void SpringSystem::Clear() {
+	for (std::vector<float>* values : { &positionX_, &positionY_, &positionZ_, &velocityX_, &velocityY_, &velocityZ_,
+		&previousX_, &previousY_, &previousZ_, &forceX_, &forceY_, &forceZ_, &mass_, &inverseMass_, &radius_,
+		&naturalLength_, &stiffness_, &damping_, &anchorX_, &anchorY_, &anchorZ_,
+		&springForceX_, &springForceY_, &springForceZ_, &threadForces_ }) {
+		values->clear();
+	}
+	color_.clear();
+	ball1_.clear();
+	ball2_.clear();
+	accumulator_ = 0.0f;
+	adjacencyDirty_ = true;
+}
+
+void SpringSystem::SetPosition(uint32_t ball, const Vector3& position) {
+	previousX_[ball] += position.x - positionX_[ball];
+	previousY_[ball] += position.y - positionY_[ball];
+	previousZ_[ball] += position.z - positionZ_[ball];
+	positionX_[ball] = position.x;
+	positionY_[ball] = position.y;
+	positionZ_[ball] = position.z;
+}
+
+void SpringSystem::SetVelocity(uint32_t ball, const Vector3& velocity) {
+	velocityX_[ball] = velocity.x;
+	velocityY_[ball] = velocity.y;
+	velocityZ_[ball] = velocity.z;
+	previousX_[ball] = positionX_[ball] - velocity.x * timeStep_;
+	previousY_[ball] = positionY_[ball] - velocity.y * timeStep_;
+	previousZ_[ball] = positionZ_[ball] - velocity.z * timeStep_;
+}
+
+Ball SpringSystem::GetBall(uint32_t ball) const {
+	Ball result = {};
+	result.position = GetPosition(ball);
+	result.velocity = GetVelocity(ball);
+	if (inverseMass_[ball] > 0.0f) {
+		result.acceleration = {
+			forceX_[ball] * inverseMass_[ball] + gravity_.x,
+			forceY_[ball] * inverseMass_[ball] + gravity_.y,
+			forceZ_[ball] * inverseMass_[ball] + gravity_.z,
+		};
+	}
+	result.mass = mass_[ball];
+	result.radius = radius_[ball];
+	result.color = color_[ball];
+	return result;
+}
+
+void SpringSystem::CopyTo(std::span<Ball> balls) const {
+	assert(balls.size() == GetBallCount());
+	for (size_t i = 0; i < balls.size(); ++i) {
+		balls[i] = GetBall(static_cast<uint32_t>(i));
+	}
+}
+#pragma endregion
+
+#pragma region ステップ
+uint32_t SpringSystem::Update(float deltaTime) {
+	accumulator_ += deltaTime;
+	uint32_t steps = 0;
+	while (accumulator_ >= timeStep_ && steps < maxStepsPerUpdate_) {
+		Step();
+		accumulator_ -= timeStep_;
+		++steps;
+	}
+	if (steps == maxStepsPerUpdate_) {
+		// 追いつけなかった分は捨てる
+		accumulator_ = std::min(accumulator_, timeStep_);
+	}
+	return steps;
+}
+
+void SpringSystem::Step() {
+	MT4_PROFILE_ZONE("SpringSystem::Step");
+	const size_t ballCount = GetBallCount();
+	const size_t springCount = GetSpringCount();
+
+	if (mode_ == Mode::Deterministic) {
+		if (adjacencyDirty_) {
+			BuildAdjacency();
+		}
+		// ばねごとの力を求めてから、ボールごとにばねの番号順に集める
+		ForEachRange(springCount, [this](size_t begin, size_t end, uint32_t) {
+			ComputeSpringForces(begin, end);
+		});
+		ForEachRange(ballCount, [this](size_t begin, size_t end, uint32_t) {
+			for (size_t ball = begin; ball < end; ++ball) {
+				float x = 0.0f, y = 0.0f, z = 0.0f;
+				for (uint32_t k = adjacencyStart_[ball]; k < adjacencyStart_[ball + 1]; ++k) {
+					uint32_t spring = adjacency_[k] >> 1;
+					float sign = (adjacency_[k] & 1) ? -1.0f : 1.0f;
+					x += sign * springForceX_[spring];
+					y += sign * springForceY_[spring];
+					z += sign * springForceZ_[spring];
+				}
+				forceX_[ball] = x;
+				forceY_[ball] = y;
+				forceZ_[ball] = z;
+			}
+		});
+	} else {
+		// スレッドごとの作業領域に足し込んでから、ボールごとに合計する
+		const uint32_t threadCount = pool_ != nullptr ? pool_->GetThreadCount() : 1;
+		const size_t stride = ballCount * 3;
+		if (threadForces_.size() != stride * threadCount) {
+			threadForces_.assign(stride * threadCount, 0.0f);
+		}
+		ForEachRange(springCount, [this, stride](size_t begin, size_t end, uint32_t threadIndex) {
+			AccumulateSpringForces(begin, end, threadForces_.data() + stride * threadIndex);
+		});
+		ForEachRange(ballCount, [this, stride, threadCount](size_t begin, size_t end, uint32_t) {
+			for (size_t ball = begin; ball < end; ++ball) {
+				float x = 0.0f, y = 0.0f, z = 0.0f;
+				for (uint32_t thread = 0; thread < threadCount; ++thread) {
+					float* forces = threadForces_.data() + stride * thread + ball * 3;
+					x += forces[0];
+					y += forces[1];
+					z += forces[2];
+					// 次のステップのために空にしておく
+					forces[0] = forces[1] = forces[2] = 0.0f;
+				}
+				forceX_[ball] = x;
+				forceY_[ball] = y;
+				forceZ_[ball] = z;
+			}
+		});
+	}
+
+	ForEachRange(ballCount, [this](size_t begin, size_t end, uint32_t) {
+		Integrate(begin, end);
+	});
+}
+
+void SpringSystem::BuildAdjacency() {
+	const size_t ballCount = GetBallCount();
+	const size_t springCount = GetSpringCount();
+	adjacencyStart_.assign(ballCount + 1, 0);
+	for (size_t spring = 0; spring < springCount; ++spring) {
+		++adjacencyStart_[ball1_[spring] + 1];
+		if (ball2_[spring] != kAnchor) {
+			++adjacencyStart_[ball2_[spring] + 1];
+		}
+	}
+	for (size_t ball = 0; ball < ballCount; ++ball) {
+		adjacencyStart_[ball + 1] += adjacencyStart_[ball];
+	}
+	adjacency_.resize(adjacencyStart_[ballCount]);
+	// ばねの番号順に詰めるので、各ボールの一覧もばねの番号順になる
+	std::vector<uint32_t> cursor(adjacencyStart_.begin(), adjacencyStart_.end() - 1);
+	for (uint32_t spring = 0; spring < springCount; ++spring) {
+		adjacency_[cursor[ball1_[spring]]++] = spring * 2;
+		if (ball2_[spring] != kAnchor) {
+			adjacency_[cursor[ball2_[spring]]++] = spring * 2 + 1;
+		}
+	}
+	adjacencyDirty_ = false;
+}
+
+namespace {
+// ball1側にかかるばねの力。相手の位置と速度を受け取る
+void SpringForce(float x, float y, float z, float vx, float vy, float vz,
+	float otherX, float otherY, float otherZ, float otherVx, float otherVy, float otherVz,
+	float naturalLength, float stiffness, float damping, float& fx, float& fy, float& fz) {
+	float dx = x - otherX;
+	float dy = y - otherY;
+	float dz = z - otherZ;
+	float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+	fx = fy = fz = 0.0f;
+	if (length != 0.0f) {
+		// 復元力 -k * (長さ - 自然長) * 向き
+		float scale = -stiffness * (length - naturalLength) / length;
+		fx = dx * scale;
+		fy = dy * scale;
+		fz = dz * scale;
+	}
+	// 減衰力 -c * 相対速度
+	fx -= damping * (vx - otherVx);
+	fy -= damping * (vy - otherVy);
+	fz -= damping * (vz - otherVz);
+}
+}
+
+void SpringSystem::ComputeSpringForces(size_t begin, size_t end) {
+	for (size_t spring = begin; spring < end; ++spring) {
+		uint32_t a = ball1_[spring];
+		uint32_t b = ball2_[spring];
+		if (b == kAnchor) {
+			SpringForce(positionX_[a], positionY_[a], positionZ_[a], velocityX_[a], velocityY_[a], velocityZ_[a],
+				anchorX_[spring], anchorY_[spring], anchorZ_[spring], 0.0f, 0.0f, 0.0f,
+				naturalLength_[spring], stiffness_[spring], damping_[spring],
+				springForceX_[spring], springForceY_[spring], springForceZ_[spring]);
+		} else {
+			SpringForce(positionX_[a], positionY_[a], positionZ_[a], velocityX_[a], velocityY_[a], velocityZ_[a],
+				positionX_[b], positionY_[b], positionZ_[b], velocityX_[b], velocityY_[b], velocityZ_[b],
+				naturalLength_[spring], stiffness_[spring], damping_[spring],
+				springForceX_[spring], springForceY_[spring], springForceZ_[spring]);
+		}
+	}
+}
+
+void SpringSystem::AccumulateSpringForces(size_t begin, size_t end, float* forces) {
+	for (size_t spring = begin; spring < end; ++spring) {
+		uint32_t a = ball1_[spring];
+		uint32_t b = ball2_[spring];
+		float fx, fy, fz;
+		if (b == kAnchor) {
+			SpringForce(positionX_[a], positionY_[a], positionZ_[a], velocityX_[a], velocityY_[a], velocityZ_[a],
+				anchorX_[spring], anchorY_[spring], anchorZ_[spring], 0.0f, 0.0f, 0.0f,
+				naturalLength_[spring], stiffness_[spring], damping_[spring], fx, fy, fz);
+		} else {
+			SpringForce(positionX_[a], positionY_[a], positionZ_[a], velocityX_[a], velocityY_[a], velocityZ_[a],
+				positionX_[b], positionY_[b], positionZ_[b], velocityX_[b], velocityY_[b], velocityZ_[b],
+				naturalLength_[spring], stiffness_[spring], damping_[spring], fx, fy, fz);
+			forces[b * 3 + 0] -= fx;
+			forces[b * 3 + 1] -= fy;
+			forces[b * 3 + 2] -= fz;
+		}
+		forces[a * 3 + 0] += fx;
+		forces[a * 3 + 1] += fy;
+		forces[a * 3 + 2] += fz;
+	}
+}
+
+void SpringSystem::Integrate(size_t begin, size_t end) {
+	const float dt = timeStep_;
+	for (size_t ball = begin; ball < end; ++ball) {
+		const float inverseMass = inverseMass_[ball];
+		if (inverseMass == 0.0f) {
+			// 動かないボール
+			velocityX_[ball] = velocityY_[ball] = velocityZ_[ball] = 0.0f;
+			previousX_[ball] = positionX_[ball];
+			previousY_[ball] = positionY_[ball];
+			previousZ_[ball] = positionZ_[ball];
+			continue;
+		}
+		float ax = forceX_[ball] * inverseMass + gravity_.x;
+		float ay = forceY_[ball] * inverseMass + gravity_.y;
+		float az = forceZ_[ball] * inverseMass + gravity_.z;
+		float x = positionX_[ball];
+		float y = positionY_[ball];
+		float z = positionZ_[ball];
+
+		if (integrator_ == Integrator::SemiImplicitEuler) {
+			velocityX_[ball] += ax * dt;
+			velocityY_[ball] += ay * dt;
+			velocityZ_[ball] += az * dt;
+			positionX_[ball] = x + velocityX_[ball] * dt;
+			positionY_[ball] = y + velocityY_[ball] * dt;
+			positionZ_[ball] = z + velocityZ_[ball] * dt;
+		} else {
+			// x(t + dt) = 2x(t) - x(t - dt) + a * dt^2
+			positionX_[ball] = x + (x - previousX_[ball]) + ax * dt * dt;
+			positionY_[ball] = y + (y - previousY_[ball]) + ay * dt * dt;
+			positionZ_[ball] = z + (z - previousZ_[ball]) + az * dt * dt;
+			// 減衰力に使う速度は今回動いた量から求める
+			velocityX_[ball] = (positionX_[ball] - x) / dt;
+			velocityY_[ball] = (positionY_[ball] - y) / dt;
+			velocityZ_[ball] = (positionZ_[ball] - z) / dt;
+		}
+		// どちらの方法でも前回の位置を残しておき、途中で切り替えられるようにする
+		previousX_[ball] = x;
+		previousY_[ball] = y;
+		previousZ_[ball] = z;
+	}
+}
+#pragma endregion
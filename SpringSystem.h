@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Struct.h"
+
+class ThreadPool;
+
+// ボールとばねをまとめて固定の刻み幅で進めるシミュレーション
+// ボール・ばねともに成分ごとの配列(SoA)で保持し、ThreadPoolを渡せばばねとボールを区切って並列に処理する
+// ばねの力は -stiffness * (長さ - 自然長) * 向き - dampingCoefficient * 相対速度(Springと同じ式)
+class SpringSystem {
+public:
+	// ばねの端がボールではなくアンカー(固定点)であることを表す番号
+	static constexpr uint32_t kAnchor = UINT32_MAX;
+
+	enum class Integrator {
+		SemiImplicitEuler, // 速度を先に更新し、新しい速度で位置を進める
+		Verlet,            // 前回の位置との差から次の位置を求める(位置Verlet)
+	};
+
+	enum class Mode {
+		// ばねの力をボールごとに決まった順番で足し合わせるので、スレッド数によらず結果が一致する
+		Deterministic,
+		// スレッドごとの作業領域に直接足し込んでから合計する。速いが足す順番がスレッド数で変わる
+		Fast,
+	};
+
+	// ボールを追加して番号を返す。massが0以下のボールは動かない
+	uint32_t AddBall(const Ball& ball);
+	// 2つのボールをつなぐばねを追加して番号を返す
+	uint32_t AddSpring(uint32_t ball1, uint32_t ball2, float naturalLength, float stiffness, float dampingCoefficient);
+	// spring.ancherとボールをつなぐばねを追加して番号を返す
+	uint32_t AddSpring(const Spring& spring, uint32_t ball);
+	void Clear();
+
+	size_t GetBallCount() const { return inverseMass_.size(); }
+	size_t GetSpringCount() const { return ball1_.size(); }
+
+	Vector3 GetPosition(uint32_t ball) const { return { positionX_[ball], positionY_[ball], positionZ_[ball] }; }
+	Vector3 GetVelocity(uint32_t ball) const { return { velocityX_[ball], velocityY_[ball], velocityZ_[ball] }; }
+	// 位置を直接動かす(ドラッグなど)。Verletでは速度も保つよう前回の位置も一緒にずらす
+	void SetPosition(uint32_t ball, const Vector3& position);
+	void SetVelocity(uint32_t ball, const Vector3& velocity);
+	// 直近のステップでの値を入れたBallを返す
+	Ball GetBall(uint32_t ball) const;
+	// 全ボールを書き出す(balls.size() == GetBallCount())
+	void CopyTo(std::span<Ball> balls) const;
+
+	void SetGravity(const Vector3& gravity) { gravity_ = gravity; }
+	void SetTimeStep(float timeStep) { timeStep_ = timeStep; }
+	void SetIntegrator(Integrator integrator) { integrator_ = integrator; }
+	void SetMode(Mode mode) { mode_ = mode; }
+	// nullptrなら呼び出したスレッドだけで処理する
+	void SetThreadPool(ThreadPool* pool) { pool_ = pool; }
+	// 1回のUpdateで進める最大ステップ数。処理落ちしたときに遅れが雪だるま式に増えるのを防ぐ
+	void SetMaxStepsPerUpdate(uint32_t maxSteps) { maxStepsPerUpdate_ = maxSteps; }
+
+	// 経過時間を溜めて、固定の刻み幅で進められるだけ進める。進めたステップ数を返す
+	uint32_t Update(float deltaTime);
+	// 固定の刻み幅で1ステップ進める
+	void Step();
+
+private:
+	// ボールごとに、つながっているばねの一覧(CSR形式)を作り直す
+	void BuildAdjacency();
+	// [begin, end)番目のばねの力を求めてspringForce*_に書く
+	void ComputeSpringForces(size_t begin, size_t end);
+	// [begin, end)番目のばねの力を求めてforces(3 * ボール数)に足し込む
+	void AccumulateSpringForces(size_t begin, size_t end, float* forces);
+	// [begin, end)番目のボールを進める
+	void Integrate(size_t begin, size_t end);
+	// [0, count)を一定数ずつ区切って処理する(pool_が無ければまとめて呼ぶ)
+	template<typename Function>
+	void ForEachRange(size_t count, Function&& function);
+
+	// ボール
+	std::vector<float> positionX_, positionY_, positionZ_;
+	std::vector<float> velocityX_, velocityY_, velocityZ_;
+	// Verlet用の前回の位置
+	std::vector<float> previousX_, previousY_, previousZ_;
+	// 直近のステップでかかった力の合計(重力を除く)
+	std::vector<float> forceX_, forceY_, forceZ_;
+	std::vector<float> mass_;
+	std::vector<float> inverseMass_;
+	std::vector<float> radius_;
+	std::vector<unsigned int> color_;
+
+	// ばね。ball1_側にかかる力を求め、ball2_側には逆向きにかける
+	std::vector<uint32_t> ball1_, ball2_;
+	std::vector<float> naturalLength_, stiffness_, damping_;
+	// ball2_がkAnchorのときの固定点
+	std::vector<float> anchorX_, anchorY_, anchorZ_;
+	// 決定的モード用のばねごとの力
+	std::vector<float> springForceX_, springForceY_, springForceZ_;
+
+	// ボールごとのばねの一覧。adjacency_[adjacencyStart_[b] ～ adjacencyStart_[b + 1]]に、
+	// ばねの番号 * 2 + (ball2側なら1)をばねの番号順に入れる
+	std::vector<uint32_t> adjacencyStart_;
+	std::vector<uint32_t> adjacency_;
+	bool adjacencyDirty_ = true;
+
+	// 高速モード用のスレッドごとの力(スレッド数 * 3 * ボール数)
+	std::vector<float> threadForces_;
+
+	Vector3 gravity_ = { 0.0f, -9.8f, 0.0f };
+	float timeStep_ = 1.0f / 60.0f;
+	float accumulator_ = 0.0f;
+	uint32_t maxStepsPerUpdate_ = 8;
+	Integrator integrator_ = Integrator::SemiImplicitEuler;
+	Mode mode_ = Mode::Deterministic;
+	ThreadPool* pool_ = nullptr;
+};
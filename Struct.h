@@ -4,16 +4,36 @@
 const int kWindowWidth = 1280;
 const int kWindowHeight = 720;
 
-struct Vector3 {
-	float x;
-	float y;
-	float z;
+// 成分の型を変えられるベクトルと行列。演算はMathCore.hのテンプレートにまとめてある
+// floatの他に、doubleやSimd::FloatPack(SIMDのレーンをまとめた型)でも同じ演算が使える
+template<typename T>
+struct TVector3 {
+	T x;
+	T y;
+	T z;
 };
 
-struct Matrix4x4 {
+template<typename T>
+struct TMatrix4x4 {
+	T m[4][4];
+};
+
+using Vector3 = TVector3<float>;
+using Matrix4x4 = TMatrix4x4<float>;
+
+// 16バイト境界に揃えたMatrix4x4。SIMDで行をまとめて読み書きする用
+struct alignas(16) AlignedMatrix4x4 {
 	float m[4][4];
 };
 
+// クォータニオン(x,y,zが虚部、wが実部)
+struct Quaternion {
+	float x;
+	float y;
+	float z;
+	float w;
+};
+
 struct Segment {
 	Vector3 origin; //!< 始点
 	Vector3 diff; //!< 終点への差分ベクトル
@@ -85,4 +105,10 @@ struct ConicalPendulum {
 struct Capsule {
 	Segment segment;
 	float radius;
+};
+
+// 視錐台。各平面の法線は内側を向いていて、dot(normal, p) >= distance を満たす側が見える範囲
+// 平面の順番は 左, 右, 下, 上, 近, 遠
+struct Frustum {
+	Plane planes[6];
 };
\ No newline at end of file
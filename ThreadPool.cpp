@@ -0,0 +1,16 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+	: ownedJobSystem_(std::make_unique<JobSystem>(threadCount)), jobSystem_(ownedJobSystem_.get()) {
+}
+
+ThreadPool::ThreadPool(JobSystem& jobSystem)
+	: jobSystem_(&jobSystem) {
+}
+
+ThreadPool::~ThreadPool() = default;
+
+ThreadPool& ThreadPool::GetDefault() {
+	static ThreadPool pool(JobSystem::GetDefault());
+	return pool;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include "JobSystem.h"
+
+// ワーカースレッドを起動したまま使い回すスレッドプール
+// 実際の作業はJobSystemのワークスティーリングで行う。各処理のSetThreadPoolはこの窓口を受け取る
+// ParallelForは呼び出したスレッドも作業に加わり、全て終わるまで戻らない
+class ThreadPool {
+public:
+	// 範囲[begin, end)と、作業しているスレッドの番号(0 ～ GetThreadCount() - 1)を受け取る
+	using RangeFunction = JobSystem::RangeFunction;
+
+	// threadCountは呼び出し側を含めたスレッド数。0なら論理コア数にする(専用のJobSystemを持つ)
+	explicit ThreadPool(uint32_t threadCount = 0);
+	// 既にあるJobSystemのワーカーを使う
+	explicit ThreadPool(JobSystem& jobSystem);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// 呼び出し側を含めたスレッド数。スレッドごとの作業領域はこの数だけ用意すればよい
+	uint32_t GetThreadCount() const { return jobSystem_->GetThreadCount(); }
+	JobSystem& GetJobSystem() const { return *jobSystem_; }
+
+	// [0, count)をgrain個ずつに区切って並列に処理する
+	// 同じ区切りが2回呼ばれることはなく、grainを指定すれば区切り方はスレッド数によらない。0ならスレッド数に合わせて自動で決める
+	void ParallelFor(size_t count, size_t grain, const RangeFunction& function) { jobSystem_->ParallelFor(count, grain, function); }
+
+	// アプリケーション全体で共有するプール(JobSystem::GetDefaultのワーカーを使う)
+	static ThreadPool& GetDefault();
+
+private:
+	std::unique_ptr<JobSystem> ownedJobSystem_;
+	JobSystem* jobSystem_;
+};
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <assert.h>
+#include "TransformHierarchy.h"
+#include "Function.h"
+#include "Profiler.h"
+
+uint32_t TransformHierarchy::Create(uint32_t parent, const Vector3& scale, const Vector3& rotate, const Vector3& translate) {
+	assert(parent == kNoParent || parent < parents_.size());
+	uint32_t node = static_cast<uint32_t>(parents_.size());
+	parents_.push_back(parent);
+	scales_.push_back(scale);
+	rotates_.push_back(rotate);
+	translates_.push_back(translate);
+	localMatrices_.push_back(MakeIdentity());
+	worldMatrices_.push_back(MakeIdentity());
+	localDirty_.push_back(1);
+	worldChanged_.push_back(0);
+	MarkDirty(node);
+	return node;
+}
+
+void TransformHierarchy::Clear() {
+	parents_.clear();
+	scales_.clear();
+	rotates_.clear();
+	translates_.clear();
+	localMatrices_.clear();
+	worldMatrices_.clear();
+	localDirty_.clear();
+	worldChanged_.clear();
+	firstDirty_ = UINT32_MAX;
+	statistics_ = {};
+}
+
+void TransformHierarchy::SetParent(uint32_t node, uint32_t parent) {
+	assert(parent == kNoParent || parent < node);
+	parents_[node] = parent;
+	// ローカル行列は変わらないが、ワールド行列は計算し直す必要がある
+	MarkDirty(node);
+}
+
+void TransformHierarchy::SetScale(uint32_t node, const Vector3& scale) {
+	scales_[node] = scale;
+	localDirty_[node] = 1;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::SetRotate(uint32_t node, const Vector3& rotate) {
+	rotates_[node] = rotate;
+	localDirty_[node] = 1;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::SetTranslate(uint32_t node, const Vector3& translate) {
+	translates_[node] = translate;
+	localDirty_[node] = 1;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::MarkDirty(uint32_t node) {
+	// 子孫は必ずnodeより後ろにあるので、Updateではここから後ろだけ見ればよい
+	worldChanged_[node] = 1;
+	firstDirty_ = std::min(firstDirty_, node);
+}
+
+void TransformHierarchy::Update() {
+	MT4_PROFILE_ZONE("TransformHierarchy::Update");
+	const uint32_t count = static_cast<uint32_t>(parents_.size());
+	statistics_ = { count, 0, 0 };
+	if (firstDirty_ >= count) {
+		// 何も変更されていなければ何もしない
+		return;
+	}
+
+	for (uint32_t node = firstDirty_; node < count; ++node) {
+		if (localDirty_[node]) {
+			localMatrices_[node] = MakeAffineMatrix(scales_[node], rotates_[node], translates_[node]);
+			localDirty_[node] = 0;
+			++statistics_.localMatrixRecomputed;
+		}
+		// 親のワールド行列が変わっていれば子も計算し直す。親は必ず先に処理済み
+		uint32_t parent = parents_[node];
+		if (parent != kNoParent && worldChanged_[parent]) {
+			worldChanged_[node] = 1;
+		}
+		if (worldChanged_[node]) {
+			if (parent == kNoParent) {
+				worldMatrices_[node] = localMatrices_[node];
+			} else {
+				worldMatrices_[node] = Multiply(localMatrices_[node], worldMatrices_[parent]);
+			}
+			++statistics_.worldMatrixRecomputed;
+		}
+	}
+
+	// 次のUpdateのためにフラグを戻す
+	std::fill(worldChanged_.begin() + firstDirty_, worldChanged_.end(), static_cast<uint8_t>(0));
+	firstDirty_ = UINT32_MAX;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Struct.h"
+
+// 親子関係を持つトランスフォームの集まり
+// ノードは親が必ず子より前に来るように(トポロジカル順に)平坦な配列で保持し、
+// Updateでは変更されたノードとその子孫だけローカル行列・ワールド行列を計算し直す
+class TransformHierarchy {
+public:
+	// 親を持たないことを表すノード番号
+	static constexpr uint32_t kNoParent = UINT32_MAX;
+
+	// 直近のUpdateで計算し直した数
+	struct Statistics {
+		uint32_t nodeCount;             // ノードの総数
+		uint32_t localMatrixRecomputed; // ローカル行列を計算し直した数
+		uint32_t worldMatrixRecomputed; // ワールド行列を計算し直した数
+	};
+
+	// ノードを追加してその番号を返す。親は追加済みのノードであること
+	uint32_t Create(uint32_t parent = kNoParent, const Vector3& scale = { 1.0f, 1.0f, 1.0f }, const Vector3& rotate = {}, const Vector3& translate = {});
+	// 全ノードを削除する
+	void Clear();
+
+	// 親を付け替える。トポロジカル順を保つため、新しい親はnodeより前に追加されたノードであること
+	void SetParent(uint32_t node, uint32_t parent);
+	void SetScale(uint32_t node, const Vector3& scale);
+	void SetRotate(uint32_t node, const Vector3& rotate);
+	void SetTranslate(uint32_t node, const Vector3& translate);
+
+	uint32_t GetParent(uint32_t node) const { return parents_[node]; }
+	const Vector3& GetScale(uint32_t node) const { return scales_[node]; }
+	const Vector3& GetRotate(uint32_t node) const { return rotates_[node]; }
+	const Vector3& GetTranslate(uint32_t node) const { return translates_[node]; }
+	// キャッシュ済みの行列。最新の値にするには先にUpdateを呼ぶ
+	const Matrix4x4& GetLocalMatrix(uint32_t node) const { return localMatrices_[node]; }
+	const Matrix4x4& GetWorldMatrix(uint32_t node) const { return worldMatrices_[node]; }
+
+	size_t Size() const { return parents_.size(); }
+
+	// 変更のあったノードとその子孫の行列を計算し直す
+	void Update();
+
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private:
+	// nodeを変更済みにする
+	void MarkDirty(uint32_t node);
+
+	std::vector<uint32_t> parents_;
+	std::vector<Vector3> scales_;
+	std::vector<Vector3> rotates_;
+	std::vector<Vector3> translates_;
+	std::vector<Matrix4x4> localMatrices_;
+	std::vector<Matrix4x4> worldMatrices_;
+	// ローカルの値が変更されたか
+	std::vector<uint8_t> localDirty_;
+	// Update中に使う、ワールド行列が変わったか
+	std::vector<uint8_t> worldChanged_;
+	// 変更されたノードのうち一番前の番号。これより前のノードは見なくてよい
+	uint32_t firstDirty_ = UINT32_MAX;
+
+	Statistics statistics_ = {};
+};
@@ -0,0 +1,563 @@
+#include <algorithm>
+#include <assert.h>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "TriangleBVH.h"
+#include "Function.h"
+#include "Profiler.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+namespace {
+// SAHでノード1つを調べる手間(三角形1つとの判定を1とする)
+constexpr float kTraversalCost = 1.0f;
+// 三角形ごとの前処理を1スレッドがまとめて処理する数
+constexpr size_t kPrimitiveGrain = 4096;
+// 大きなノードの振り分けを1スレッドがまとめて処理する数
+constexpr size_t kBinGrain = 16384;
+// まとめて判定する線分を1スレッドが処理する数(Simd::kWidthの倍数)
+constexpr size_t kRayGrain = 256;
+// 木の深さの上限(根が0)。探索用スタックにはこの深さ + 1個までしか積まれない
+constexpr uint32_t kMaxDepth = TriangleBVH::kStackSize - 1;
+// 線分の向きの成分がこれより小さい軸は、この大きさとして逆数を求める(0除算によるinf * 0 = NaNを避ける)
+constexpr float kMinDirection = 1.0e-20f;
+
+float Component(const Vector3& v, int axis) {
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+float SafeInverse(float value) {
+	if (std::fabs(value) < kMinDirection) {
+		return value < 0.0f ? -1.0f / kMinDirection : 1.0f / kMinDirection;
+	}
+	return 1.0f / value;
+}
+
+// 作成中に使う範囲(空のときはmin > max)
+struct Bounds {
+	Vector3 min = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+	Vector3 max = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+
+	void Grow(const Vector3& point) {
+		min = { std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z) };
+		max = { std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z) };
+	}
+	void Grow(const Bounds& bounds) {
+		min = { std::min(min.x, bounds.min.x), std::min(min.y, bounds.min.y), std::min(min.z, bounds.min.z) };
+		max = { std::max(max.x, bounds.max.x), std::max(max.y, bounds.max.y), std::max(max.z, bounds.max.z) };
+	}
+	// 表面積の半分(SAHでは比しか使わないので半分でよい)
+	float HalfArea() const {
+		if (min.x > max.x) {
+			return 0.0f;
+		}
+		Vector3 size = max - min;
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+};
+
+struct Bin {
+	Bounds bounds;   // 三角形を囲む範囲
+	Bounds centroid; // 重心を囲む範囲
+	uint32_t count = 0;
+};
+// 3軸分の区間。axis軸のb番目の区間は [axis * kBinCount + b]
+constexpr size_t kBinsPerNode = 3 * TriangleBVH::kBinCount;
+
+// これから分割するノード。三角形はindices[begin, end)
+struct BuildTask {
+	uint32_t node;
+	uint32_t begin;
+	uint32_t end;
+	uint32_t depth;
+	Bounds bounds;
+	Bounds centroid;
+};
+
+struct Split {
+	int axis;
+	uint32_t bin; // 区間[0, bin)が左、[bin, kBinCount)が右
+	float cost;   // 左右の(表面積 * 三角形の数)の和
+	uint32_t leftCount;
+	Bounds leftBounds, leftCentroid, rightBounds, rightCentroid;
+};
+
+// 作成中に共有するデータ。indicesは部分木ごとに別の範囲を並べ替えるので、並列に作っても競合しない
+struct BuildContext {
+	std::vector<Bounds> primitiveBounds;
+	std::vector<Vector3> centroids;
+	std::vector<uint32_t> indices;
+	ThreadPool* pool;
+};
+
+// [0, count)をgrain個ずつに区切ってfunction(区切りの番号, begin, end)を呼ぶ。poolがあれば並列に呼ぶ
+template<typename Function>
+void ForEachChunk(ThreadPool* pool, size_t count, size_t grain, Function&& function) {
+	if (pool != nullptr) {
+		pool->ParallelFor(count, grain, [&](size_t begin, size_t end, uint32_t) {
+			function(begin / grain, begin, end);
+		});
+		return;
+	}
+	for (size_t begin = 0; begin < count; begin += grain) {
+		function(begin / grain, begin, std::min(begin + grain, count));
+	}
+}
+
+// 重心の範囲[min, min + 区間の幅 * kBinCount)を区間に分けたときの番号
+uint32_t BinIndex(float centroid, float min, float scale) {
+	int32_t bin = static_cast<int32_t>((centroid - min) * scale);
+	return static_cast<uint32_t>(std::clamp(bin, 0, static_cast<int32_t>(TriangleBVH::kBinCount) - 1));
+}
+
+float BinScale(const Bounds& centroid, int axis) {
+	float extent = Component(centroid.max, axis) - Component(centroid.min, axis);
+	return extent > 0.0f ? static_cast<float>(TriangleBVH::kBinCount) / extent : 0.0f;
+}
+
+void AddToBins(const BuildContext& context, const BuildTask& task, size_t begin, size_t end, Bin* bins) {
+	float scale[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		scale[axis] = BinScale(task.centroid, axis);
+	}
+	for (size_t i = begin; i < end; ++i) {
+		uint32_t index = context.indices[i];
+		const Vector3& centroid = context.centroids[index];
+		for (int axis = 0; axis < 3; ++axis) {
+			if (scale[axis] == 0.0f) {
+				continue;
+			}
+			Bin& bin = bins[axis * TriangleBVH::kBinCount + BinIndex(Component(centroid, axis), Component(task.centroid.min, axis), scale[axis])];
+			bin.bounds.Grow(context.primitiveBounds[index]);
+			bin.centroid.Grow(centroid);
+			++bin.count;
+		}
+	}
+}
+
+// 3軸の区間の境目から、SAHのコストが一番小さい分割を探す。重心が全て同じ位置なら分割できないのでfalseを返す
+bool FindSplit(const BuildContext& context, const BuildTask& task, bool parallel, Split& split) {
+	Bin bins[kBinsPerNode];
+	const size_t count = task.end - task.begin;
+	if (parallel && context.pool != nullptr && count > kBinGrain) {
+		// 区切りごとに振り分けてから合わせる。範囲の合成と個数の和は順番によらないので、結果はスレッド数によらない
+		std::vector<Bin> chunkBins(((count + kBinGrain - 1) / kBinGrain) * kBinsPerNode);
+		ForEachChunk(context.pool, count, kBinGrain, [&](size_t chunk, size_t begin, size_t end) {
+			AddToBins(context, task, task.begin + begin, task.begin + end, chunkBins.data() + chunk * kBinsPerNode);
+		});
+		for (size_t i = 0; i < chunkBins.size(); ++i) {
+			Bin& bin = bins[i % kBinsPerNode];
+			bin.bounds.Grow(chunkBins[i].bounds);
+			bin.centroid.Grow(chunkBins[i].centroid);
+			bin.count += chunkBins[i].count;
+		}
+	} else {
+		AddToBins(context, task, task.begin, task.end, bins);
+	}
+
+	bool found = false;
+	for (int axis = 0; axis < 3; ++axis) {
+		if (BinScale(task.centroid, axis) == 0.0f) {
+			continue;
+		}
+		const Bin* axisBins = bins + axis * TriangleBVH::kBinCount;
+		// 右から順に合わせた範囲と個数
+		float rightArea[TriangleBVH::kBinCount];
+		uint32_t rightCount[TriangleBVH::kBinCount];
+		Bounds right;
+		uint32_t accumulated = 0;
+		for (uint32_t b = TriangleBVH::kBinCount; b-- > 1;) {
+			right.Grow(axisBins[b].bounds);
+			accumulated += axisBins[b].count;
+			rightArea[b] = right.HalfArea();
+			rightCount[b] = accumulated;
+		}
+		Bounds left;
+		uint32_t leftCount = 0;
+		for (uint32_t b = 1; b < TriangleBVH::kBinCount; ++b) {
+			left.Grow(axisBins[b - 1].bounds);
+			leftCount += axisBins[b - 1].count;
+			if (leftCount == 0 || rightCount[b] == 0) {
+				continue;
+			}
+			float cost = left.HalfArea() * static_cast<float>(leftCount) + rightArea[b] * static_cast<float>(rightCount[b]);
+			if (!found || cost < split.cost) {
+				found = true;
+				split.axis = axis;
+				split.bin = b;
+				split.cost = cost;
+				split.leftCount = leftCount;
+			}
+		}
+	}
+	if (!found) {
+		return false;
+	}
+
+	// 選んだ分割の左右の範囲
+	split.leftBounds = split.leftCentroid = split.rightBounds = split.rightCentroid = Bounds{};
+	for (uint32_t b = 0; b < TriangleBVH::kBinCount; ++b) {
+		const Bin& bin = bins[split.axis * TriangleBVH::kBinCount + b];
+		(b < split.bin ? split.leftBounds : split.rightBounds).Grow(bin.bounds);
+		(b < split.bin ? split.leftCentroid : split.rightCentroid).Grow(bin.centroid);
+	}
+	return true;
+}
+
+// count個の三角形を半分ずつに分けていったとき、葉(kMaxLeafSize個以下)になるまでに必要な深さ
+uint32_t BalancedDepth(uint32_t count) {
+	return static_cast<uint32_t>(std::bit_width((count - 1) / TriangleBVH::kMaxLeafSize));
+}
+
+// rootから始めてnodesに木を作る。deferredを渡すと、kSubtreeSize以下の部分木は作らずにそこへ追加する
+// 戻り値は作ったノードの一番深い深さ
+uint32_t BuildNodes(BuildContext& context, std::vector<TriangleBVH::Node>& nodes, const BuildTask& root, std::vector<BuildTask>* deferred) {
+	const bool parallel = deferred != nullptr;
+	uint32_t maxDepth = 0;
+	std::vector<BuildTask> stack;
+	stack.push_back(root);
+	while (!stack.empty()) {
+		BuildTask task = stack.back();
+		stack.pop_back();
+		const uint32_t count = task.end - task.begin;
+		if (deferred != nullptr && count <= TriangleBVH::kSubtreeSize) {
+			deferred->push_back(task);
+			continue;
+		}
+		maxDepth = std::max(maxDepth, task.depth);
+		nodes[task.node].min = task.bounds.min;
+		nodes[task.node].max = task.bounds.max;
+
+		// SAHの分割が偏り続けると木が深くなり、探索用スタックが溢れる
+		// 残りを半分ずつに分けてもkMaxDepthに収まらなくなる手前からは、中央値で半分に分ける
+		const bool balanced = task.depth + BalancedDepth(count) >= kMaxDepth;
+		Split split = {};
+		const bool found = !balanced && count > 1 && FindSplit(context, task, parallel, split);
+		const float area = task.bounds.HalfArea();
+		if (count <= TriangleBVH::kMaxLeafSize && (balanced || !found || static_cast<float>(count) * area <= kTraversalCost * area + split.cost)) {
+			nodes[task.node].leftOrFirst = task.begin;
+			nodes[task.node].count = static_cast<uint16_t>(count);
+			nodes[task.node].axis = 0;
+			continue;
+		}
+
+		BuildTask left = {};
+		BuildTask right = {};
+		uint32_t middle;
+		int axis = found ? split.axis : 0;
+		if (found) {
+			const float min = Component(task.centroid.min, split.axis);
+			const float scale = BinScale(task.centroid, split.axis);
+			auto first = context.indices.begin() + task.begin;
+			std::partition(first, context.indices.begin() + task.end, [&](uint32_t index) {
+				return BinIndex(Component(context.centroids[index], split.axis), min, scale) < split.bin;
+			});
+			middle = task.begin + split.leftCount;
+			left.bounds = split.leftBounds;
+			left.centroid = split.leftCentroid;
+			right.bounds = split.rightBounds;
+			right.centroid = split.rightCentroid;
+		} else {
+			// 重心が全て同じ位置にある(または深さの上限が近い)ので、重心が一番広がっている軸の中央値で半分に分ける
+			middle = task.begin + count / 2;
+			if (balanced) {
+				const Vector3 extent = task.centroid.max - task.centroid.min;
+				axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+				std::nth_element(context.indices.begin() + task.begin, context.indices.begin() + middle, context.indices.begin() + task.end,
+					[&](uint32_t a, uint32_t b) { return Component(context.centroids[a], axis) < Component(context.centroids[b], axis); });
+			}
+			for (uint32_t i = task.begin; i < task.end; ++i) {
+				uint32_t index = context.indices[i];
+				(i < middle ? left.bounds : right.bounds).Grow(context.primitiveBounds[index]);
+				(i < middle ? left.centroid : right.centroid).Grow(context.centroids[index]);
+			}
+		}
+
+		const uint32_t child = static_cast<uint32_t>(nodes.size());
+		nodes.resize(nodes.size() + 2);
+		nodes[task.node].leftOrFirst = child;
+		nodes[task.node].count = 0;
+		nodes[task.node].axis = static_cast<uint16_t>(axis);
+		left.node = child;
+		left.begin = task.begin;
+		left.end = middle;
+		left.depth = task.depth + 1;
+		right.node = child + 1;
+		right.begin = middle;
+		right.end = task.end;
+		right.depth = task.depth + 1;
+		// 左の子から先に作る
+		stack.push_back(right);
+		stack.push_back(left);
+	}
+	return maxDepth;
+}
+
+// 三角形との交差判定(Möller-Trumbore)。floatとSimd::FloatPackで同じ順番で計算する
+// det == 0(線分が面と平行)のときは逆数がinfになり、uかvがinfかNaNになって範囲の判定で外れる
+template<typename T>
+void IntersectTriangle(const TVector3<T>& origin, const TVector3<T>& diff, const TVector3<T>& vertex0, const TVector3<T>& edge1, const TVector3<T>& edge2,
+	T& t, T& u, T& v) {
+	TVector3<T> p = Cross(diff, edge2);
+	T inverseDet = T(1.0f) / Dot(edge1, p);
+	TVector3<T> toOrigin = origin - vertex0;
+	u = Dot(toOrigin, p) * inverseDet;
+	TVector3<T> q = Cross(toOrigin, edge1);
+	v = Dot(diff, q) * inverseDet;
+	t = Dot(edge2, q) * inverseDet;
+}
+}
+
+#pragma region 作成
+void TriangleBVH::Build(std::span<const Triangle> triangles) {
+	MT4_PROFILE_ZONE("TriangleBVH::Build");
+	const auto start = std::chrono::steady_clock::now();
+	const size_t count = triangles.size();
+	nodes_.clear();
+	triangles_.clear();
+	triangleIndex_.clear();
+	statistics_ = {};
+	statistics_.triangleCount = count;
+	if (count == 0) {
+		return;
+	}
+	assert(count < kNoHit);
+
+	BuildContext context;
+	context.pool = pool_;
+	context.primitiveBounds.resize(count);
+	context.centroids.resize(count);
+	context.indices.resize(count);
+	const size_t chunkCount = (count + kPrimitiveGrain - 1) / kPrimitiveGrain;
+	std::vector<Bounds> chunkBounds(chunkCount);
+	std::vector<Bounds> chunkCentroids(chunkCount);
+	ForEachChunk(pool_, count, kPrimitiveGrain, [&](size_t chunk, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			const Triangle& triangle = triangles[i];
+			Bounds bounds;
+			bounds.Grow(triangle.vertex[0]);
+			bounds.Grow(triangle.vertex[1]);
+			bounds.Grow(triangle.vertex[2]);
+			Vector3 centroid = (bounds.min + bounds.max) * 0.5f;
+			context.primitiveBounds[i] = bounds;
+			context.centroids[i] = centroid;
+			context.indices[i] = static_cast<uint32_t>(i);
+			chunkBounds[chunk].Grow(bounds);
+			chunkCentroids[chunk].Grow(centroid);
+		}
+	});
+	BuildTask root = {};
+	root.end = static_cast<uint32_t>(count);
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+		root.bounds.Grow(chunkBounds[chunk]);
+		root.centroid.Grow(chunkCentroids[chunk]);
+	}
+
+	// 上の方のノードを作り、残りの部分木はそれぞれ別のスレッドで作ってから後ろにつなげる
+	nodes_.reserve(2 * count / kMaxLeafSize + 1);
+	nodes_.resize(1);
+	std::vector<BuildTask> deferred;
+	uint32_t maxDepth = BuildNodes(context, nodes_, root, &deferred);
+	std::vector<std::vector<Node>> subtrees(deferred.size());
+	std::vector<uint32_t> subtreeDepth(deferred.size());
+	ForEachChunk(pool_, deferred.size(), 1, [&](size_t, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			BuildTask task = deferred[i];
+			task.node = 0;
+			subtrees[i].resize(1);
+			subtreeDepth[i] = BuildNodes(context, subtrees[i], task, nullptr);
+		}
+	});
+	for (size_t i = 0; i < deferred.size(); ++i) {
+		// 部分木のk番目(k >= 1)のノードは、つなげた先では base + k - 1 番目になる
+		const uint32_t base = static_cast<uint32_t>(nodes_.size());
+		for (Node& node : subtrees[i]) {
+			if (!node.IsLeaf()) {
+				node.leftOrFirst += base - 1;
+			}
+		}
+		nodes_[deferred[i].node] = subtrees[i][0];
+		nodes_.insert(nodes_.end(), subtrees[i].begin() + 1, subtrees[i].end());
+		maxDepth = std::max(maxDepth, subtreeDepth[i]);
+	}
+
+	triangleIndex_ = std::move(context.indices);
+	triangles_.resize(count);
+	ForEachChunk(pool_, count, kPrimitiveGrain, [&](size_t, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			const Triangle& triangle = triangles[triangleIndex_[i]];
+			triangles_[i] = { triangle.vertex[0], triangle.vertex[1] - triangle.vertex[0], triangle.vertex[2] - triangle.vertex[0] };
+		}
+	});
+
+	statistics_.nodeCount = nodes_.size();
+	statistics_.maxDepth = maxDepth;
+	float cost = 0.0f;
+	for (const Node& node : nodes_) {
+		Bounds bounds = { node.min, node.max };
+		if (node.IsLeaf()) {
+			++statistics_.leafCount;
+			cost += static_cast<float>(node.count) * bounds.HalfArea();
+		} else {
+			cost += kTraversalCost * bounds.HalfArea();
+		}
+	}
+	const float rootArea = Bounds{ nodes_[0].min, nodes_[0].max }.HalfArea();
+	statistics_.sahCost = rootArea > 0.0f ? cost / rootArea : 0.0f;
+	statistics_.buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+#pragma endregion
+
+#pragma region レイキャスト
+bool TriangleBVH::RayCast(const Segment& segment, RayHit& hit) const {
+	hit = { 1.0f, 0.0f, 0.0f, kNoHit };
+	if (nodes_.empty()) {
+		return false;
+	}
+	const float origin[3] = { segment.origin.x, segment.origin.y, segment.origin.z };
+	const float inverse[3] = { SafeInverse(segment.diff.x), SafeInverse(segment.diff.y), SafeInverse(segment.diff.z) };
+	const bool negative[3] = { segment.diff.x < 0.0f, segment.diff.y < 0.0f, segment.diff.z < 0.0f };
+
+	uint32_t stack[kStackSize];
+	int32_t count = 0;
+	stack[count++] = 0;
+	while (count > 0) {
+		const Node& node = nodes_[stack[--count]];
+		// スラブ法で[0, これまでに見つけた一番近いt]の範囲で交わるか調べる
+		const float min[3] = { node.min.x, node.min.y, node.min.z };
+		const float max[3] = { node.max.x, node.max.y, node.max.z };
+		float tNear = 0.0f;
+		float tFar = hit.t;
+		for (int axis = 0; axis < 3; ++axis) {
+			float t1 = (min[axis] - origin[axis]) * inverse[axis];
+			float t2 = (max[axis] - origin[axis]) * inverse[axis];
+			tNear = std::max(tNear, std::min(t1, t2));
+			tFar = std::min(tFar, std::max(t1, t2));
+		}
+		if (!(tNear <= tFar)) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+				const PrimitiveTriangle& triangle = triangles_[i];
+				float t, u, v;
+				IntersectTriangle(segment.origin, segment.diff, triangle.vertex0, triangle.edge1, triangle.edge2, t, u, v);
+				if (u >= 0.0f && u <= 1.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t < hit.t) {
+					hit = { t, u, v, triangleIndex_[i] };
+				}
+			}
+		} else {
+			// 遠い方の子を先に積み、近い方から調べる
+			assert(count + 2 <= kStackSize);
+			const bool rightFirst = negative[node.axis];
+			stack[count++] = node.leftOrFirst + (rightFirst ? 0 : 1);
+			stack[count++] = node.leftOrFirst + (rightFirst ? 1 : 0);
+		}
+	}
+	return hit.triangle != kNoHit;
+}
+
+void TriangleBVH::RayCast(std::span<const Segment> segments, std::span<RayHit> hits) const {
+	assert(segments.size() == hits.size());
+	ForEachChunk(pool_, segments.size(), kRayGrain, [&](size_t, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i += Simd::kWidth) {
+			RayCastPacket(segments.data() + i, std::min(Simd::kWidth, end - i), hits.data() + i);
+		}
+	});
+}
+
+void TriangleBVH::RayCastPacket(const Segment* segments, size_t count, RayHit* hits) const {
+	using Pack = Simd::FloatPack;
+	alignas(32) float lanes[9][Simd::kWidth];
+	for (size_t lane = 0; lane < Simd::kWidth; ++lane) {
+		// 余ったレーンは最初の線分で埋める(結果は捨てる)
+		const Segment& segment = segments[lane < count ? lane : 0];
+		lanes[0][lane] = segment.origin.x;
+		lanes[1][lane] = segment.origin.y;
+		lanes[2][lane] = segment.origin.z;
+		lanes[3][lane] = segment.diff.x;
+		lanes[4][lane] = segment.diff.y;
+		lanes[5][lane] = segment.diff.z;
+		lanes[6][lane] = SafeInverse(segment.diff.x);
+		lanes[7][lane] = SafeInverse(segment.diff.y);
+		lanes[8][lane] = SafeInverse(segment.diff.z);
+	}
+	const TVector3<Pack> origin = { Simd::Load(lanes[0]), Simd::Load(lanes[1]), Simd::Load(lanes[2]) };
+	const TVector3<Pack> diff = { Simd::Load(lanes[3]), Simd::Load(lanes[4]), Simd::Load(lanes[5]) };
+	const Simd::Float inverse[3] = { Simd::Load(lanes[6]), Simd::Load(lanes[7]), Simd::Load(lanes[8]) };
+	const Simd::Float originAxis[3] = { origin.x.value, origin.y.value, origin.z.value };
+	const bool negative[3] = { segments[0].diff.x < 0.0f, segments[0].diff.y < 0.0f, segments[0].diff.z < 0.0f };
+
+	alignas(32) float bestT[Simd::kWidth];
+	float bestU[Simd::kWidth] = {};
+	float bestV[Simd::kWidth] = {};
+	uint32_t bestTriangle[Simd::kWidth];
+	std::fill(bestTriangle, bestTriangle + Simd::kWidth, kNoHit);
+	Simd::Float best = Simd::Set1(1.0f);
+	const Simd::Float zero = Simd::Zero();
+	const Simd::Float one = Simd::Set1(1.0f);
+
+	uint32_t stack[kStackSize];
+	int32_t stackCount = nodes_.empty() ? 0 : 1;
+	stack[0] = 0;
+	while (stackCount > 0) {
+		const Node& node = nodes_[stack[--stackCount]];
+		// どれか1本でも交われば子や三角形を調べる
+		const float min[3] = { node.min.x, node.min.y, node.min.z };
+		const float max[3] = { node.max.x, node.max.y, node.max.z };
+		Simd::Float tNear = zero;
+		Simd::Float tFar = best;
+		for (int axis = 0; axis < 3; ++axis) {
+			Simd::Float t1 = Simd::Mul(Simd::Sub(Simd::Set1(min[axis]), originAxis[axis]), inverse[axis]);
+			Simd::Float t2 = Simd::Mul(Simd::Sub(Simd::Set1(max[axis]), originAxis[axis]), inverse[axis]);
+			tNear = Simd::Max(tNear, Simd::Min(t1, t2));
+			tFar = Simd::Min(tFar, Simd::Max(t1, t2));
+		}
+		if (Simd::MoveMask(Simd::CmpLe(tNear, tFar)) == 0) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+				const PrimitiveTriangle& triangle = triangles_[i];
+				const TVector3<Pack> vertex0 = { triangle.vertex0.x, triangle.vertex0.y, triangle.vertex0.z };
+				const TVector3<Pack> edge1 = { triangle.edge1.x, triangle.edge1.y, triangle.edge1.z };
+				const TVector3<Pack> edge2 = { triangle.edge2.x, triangle.edge2.y, triangle.edge2.z };
+				Pack t, u, v;
+				IntersectTriangle(origin, diff, vertex0, edge1, edge2, t, u, v);
+				Simd::Float mask = Simd::And(Simd::CmpLe(zero, u.value), Simd::CmpLe(u.value, one));
+				mask = Simd::And(mask, Simd::And(Simd::CmpLe(zero, v.value), Simd::CmpLe((u + v).value, one)));
+				mask = Simd::And(mask, Simd::And(Simd::CmpLe(zero, t.value), Simd::CmpLt(t.value, best)));
+				int hitMask = Simd::MoveMask(mask);
+				if (hitMask == 0) {
+					continue;
+				}
+				best = Simd::Select(mask, t.value, best);
+				alignas(32) float laneU[Simd::kWidth];
+				alignas(32) float laneV[Simd::kWidth];
+				Simd::Store(laneU, u.value);
+				Simd::Store(laneV, v.value);
+				for (size_t lane = 0; lane < Simd::kWidth; ++lane) {
+					if (hitMask & (1 << lane)) {
+						bestU[lane] = laneU[lane];
+						bestV[lane] = laneV[lane];
+						bestTriangle[lane] = triangleIndex_[i];
+					}
+				}
+			}
+		} else {
+			// 近い方の子の判定には最初の線分の向きを使う(まとめて飛ばす線分はだいたい同じ向きを向いている)
+			assert(stackCount + 2 <= kStackSize);
+			const bool rightFirst = negative[node.axis];
+			stack[stackCount++] = node.leftOrFirst + (rightFirst ? 0 : 1);
+			stack[stackCount++] = node.leftOrFirst + (rightFirst ? 1 : 0);
+		}
+	}
+
+	Simd::Store(bestT, best);
+	for (size_t lane = 0; lane < count; ++lane) {
+		hits[lane] = { bestT[lane], bestU[lane], bestV[lane], bestTriangle[lane] };
+	}
+}
+#pragma endregion
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Struct.h"
+
+class ThreadPool;
+
+// 線分と三角形の一番近い交点
+struct RayHit {
+	float t;           // 線分上の割合(0～1)。交点 = origin + diff * t
+	float u;           // 重心座標。交点 = vertex[0] + u * (vertex[1] - vertex[0]) + v * (vertex[2] - vertex[0])
+	float v;
+	uint32_t triangle; // Buildに渡した配列での添字。交わらなければTriangleBVH::kNoHit
+};
+
+// 静的な三角形の集まり(地形やステージのメッシュ)に対するレイキャスト用のBVH
+// 表面積ヒューリスティック(SAH)で分割位置を選ぶ。重心を軸ごとにkBinCount個の区間に振り分け、区間の境目だけを候補にする
+// 上の方の大きなノードは振り分けを並列に行い、kSubtreeSize個以下になった部分木はそれぞれ1スレッドで作る
+// 木の形はスレッド数によらず同じになる
+// ピック・視線判定・接地判定のように線分を多く飛ばす場合は、Simd::kWidth本(SSE:4本、AVX:8本)をまとめて判定する版を使う
+class TriangleBVH {
+public:
+	static constexpr uint32_t kNoHit = 0xFFFFFFFF;
+	// 分割位置の候補を探すときの区間の数
+	static constexpr uint32_t kBinCount = 16;
+	// 葉に入れる三角形の最大数
+	static constexpr uint32_t kMaxLeafSize = 4;
+	// 三角形がこの数以下の部分木は1スレッドで作る
+	static constexpr uint32_t kSubtreeSize = 8192;
+	// 探索用スタックの大きさ。木の深さはkStackSize - 1までに抑えるので溢れない
+	static constexpr int32_t kStackSize = 64;
+
+	// 木のノード(32バイト)
+	struct Node {
+		Vector3 min;
+		uint32_t leftOrFirst; // 内部ノードは左の子の番号(右の子はその次)、葉は最初の三角形の位置
+		Vector3 max;
+		uint16_t count;       // 葉は三角形の数(1以上)、内部ノードは0
+		uint16_t axis;        // 内部ノードを分割した軸(0:x 1:y 2:z)。近い方の子から調べるのに使う
+
+		bool IsLeaf() const { return count != 0; }
+	};
+
+	// 直近のBuildの統計
+	struct Statistics {
+		size_t triangleCount;
+		size_t nodeCount;
+		size_t leafCount;
+		uint32_t maxDepth;
+		float sahCost;       // 根に当たった線分が調べるノードと三角形の数の期待値(小さいほど良い木)
+		double buildSeconds; // 作るのにかかった時間
+	};
+
+	// nullptrなら呼び出したスレッドだけで処理する
+	void SetThreadPool(ThreadPool* pool) { pool_ = pool; }
+
+	// 三角形の配列から木を作り直す(三角形はコピーして持つ)
+	void Build(std::span<const Triangle> triangles);
+
+	// 線分と一番近くで交わる三角形を求める。交わらなければfalseを返し、hit.triangleはkNoHitになる
+	// 線分の終点ちょうど(t == 1)で交わる場合は交わらない扱いになる
+	bool RayCast(const Segment& segment, RayHit& hit) const;
+	// 線分をSimd::kWidth本ずつまとめて判定する。結果は1本ずつ呼んだ場合と同じ
+	// (同じtで交わる三角形が複数あるときだけ、どの三角形を返すかが変わることがある)
+	void RayCast(std::span<const Segment> segments, std::span<RayHit> hits) const;
+
+	std::span<const Node> GetNodes() const { return nodes_; }
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private:
+	// 交差判定用に 頂点0, 辺(頂点1 - 頂点0), 辺(頂点2 - 頂点0) にした三角形。葉の順に並べてある
+	struct PrimitiveTriangle {
+		Vector3 vertex0;
+		Vector3 edge1;
+		Vector3 edge2;
+	};
+
+	// count本(Simd::kWidth以下)の線分をまとめて判定する
+	void RayCastPacket(const Segment* segments, size_t count, RayHit* hits) const;
+
+	std::vector<Node> nodes_;
+	std::vector<PrimitiveTriangle> triangles_;
+	std::vector<uint32_t> triangleIndex_; // 葉の順の三角形が元の配列の何番目か
+	ThreadPool* pool_ = nullptr;
+	Statistics statistics_ = {};
+};
@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include "MathCore.h"
+#include "Vector3SoA.h"
+#include "Simd.h"
+
+// キャッシュライン境界
+static constexpr size_t kAlignment = 64;
+
+// kBlockの倍数に切り上げる
+static size_t RoundUpToBlock(size_t count) {
+	return (count + Vector3SoA::kBlock - 1) / Vector3SoA::kBlock * Vector3SoA::kBlock;
+}
+
+// index番目からSimd::kWidth個分を、MathCore.hのテンプレートに渡せる形で読み書きする
+static TVector3<Simd::FloatPack> LoadPack(const Vector3SoA& v, size_t index) {
+	return { Simd::Load(v.X() + index), Simd::Load(v.Y() + index), Simd::Load(v.Z() + index) };
+}
+
+static void StorePack(Vector3SoA& v, size_t index, const TVector3<Simd::FloatPack>& pack) {
+	Simd::Store(v.X() + index, pack.x.value);
+	Simd::Store(v.Y() + index, pack.y.value);
+	Simd::Store(v.Z() + index, pack.z.value);
+}
+
+#pragma region Vector3SoA
+Vector3SoA::Vector3SoA(size_t size) {
+	Resize(size);
+}
+
+Vector3SoA::Vector3SoA(std::span<const Vector3> vectors) {
+	Assign(vectors);
+}
+
+Vector3SoA::Vector3SoA(const Vector3SoA& other) {
+	*this = other;
+}
+
+Vector3SoA::Vector3SoA(Vector3SoA&& other) noexcept {
+	*this = std::move(other);
+}
+
+Vector3SoA& Vector3SoA::operator=(const Vector3SoA& other) {
+	if (this == &other) {
+		return *this;
+	}
+	if (capacity_ < other.size_) {
+		Reallocate(RoundUpToBlock(other.size_));
+	}
+	// 短くなった分は端数レーンになるので0にする
+	Zero(other.size_, size_);
+	size_ = other.size_;
+	if (size_ > 0) {
+		std::memcpy(x_, other.x_, sizeof(float) * size_);
+		std::memcpy(y_, other.y_, sizeof(float) * size_);
+		std::memcpy(z_, other.z_, sizeof(float) * size_);
+	}
+	return *this;
+}
+
+Vector3SoA& Vector3SoA::operator=(Vector3SoA&& other) noexcept {
+	if (this == &other) {
+		return *this;
+	}
+	_mm_free(x_);
+	x_ = std::exchange(other.x_, nullptr);
+	y_ = std::exchange(other.y_, nullptr);
+	z_ = std::exchange(other.z_, nullptr);
+	size_ = std::exchange(other.size_, 0);
+	capacity_ = std::exchange(other.capacity_, 0);
+	return *this;
+}
+
+Vector3SoA::~Vector3SoA() {
+	_mm_free(x_);
+}
+
+void Vector3SoA::Resize(size_t size) {
+	if (capacity_ < size) {
+		Reallocate(RoundUpToBlock(size));
+	}
+	// 増えた分は新しい要素として、減った分は端数レーンとして0にする
+	Zero(std::min(size_, size), std::max(size_, size));
+	size_ = size;
+}
+
+void Vector3SoA::Zero(size_t begin, size_t end) {
+	if (begin < end) {
+		std::memset(x_ + begin, 0, sizeof(float) * (end - begin));
+		std::memset(y_ + begin, 0, sizeof(float) * (end - begin));
+		std::memset(z_ + begin, 0, sizeof(float) * (end - begin));
+	}
+}
+
+void Vector3SoA::Reserve(size_t capacity) {
+	if (capacity_ < capacity) {
+		Reallocate(RoundUpToBlock(capacity));
+	}
+}
+
+void Vector3SoA::PushBack(const Vector3& v) {
+	if (size_ == capacity_) {
+		// 償却O(1)にするため倍々で伸ばす
+		Reallocate(std::max(kBlock, capacity_ * 2));
+	}
+	Set(size_++, v);
+}
+
+void Vector3SoA::Assign(std::span<const Vector3> vectors) {
+	Resize(vectors.size());
+	const float* src = reinterpret_cast<const float*>(vectors.data());
+	size_t i = 0;
+	for (; i + 4 <= size_; i += 4) {
+		__m128 x, y, z;
+		Simd::LoadVector3x4(src + i * 3, x, y, z);
+		_mm_store_ps(x_ + i, x);
+		_mm_store_ps(y_ + i, y);
+		_mm_store_ps(z_ + i, z);
+	}
+	for (; i < size_; ++i) {
+		Set(i, vectors[i]);
+	}
+}
+
+void Vector3SoA::CopyTo(std::span<Vector3> output) const {
+	assert(output.size() >= size_);
+	float* dst = reinterpret_cast<float*>(output.data());
+	size_t i = 0;
+	for (; i + 4 <= size_; i += 4) {
+		Simd::StoreVector3x4(dst + i * 3, _mm_load_ps(x_ + i), _mm_load_ps(y_ + i), _mm_load_ps(z_ + i));
+	}
+	for (; i < size_; ++i) {
+		output[i] = Get(i);
+	}
+}
+
+std::vector<Vector3> Vector3SoA::ToVector() const {
+	std::vector<Vector3> result(size_);
+	CopyTo(result);
+	return result;
+}
+
+void Vector3SoA::Reallocate(size_t capacity) {
+	assert(capacity % kBlock == 0);
+	float* block = static_cast<float*>(_mm_malloc(sizeof(float) * capacity * 3, kAlignment));
+	assert(block != nullptr);
+	// 端数レーンも一括演算で読まれるので、非正規化数などが入らないよう0で埋めておく
+	std::memset(block, 0, sizeof(float) * capacity * 3);
+	size_t keep = std::min(size_, capacity);
+	if (x_ != nullptr) {
+		std::memcpy(block, x_, sizeof(float) * keep);
+		std::memcpy(block + capacity, y_, sizeof(float) * keep);
+		std::memcpy(block + capacity * 2, z_, sizeof(float) * keep);
+		_mm_free(x_);
+	}
+	x_ = block;
+	y_ = block + capacity;
+	z_ = block + capacity * 2;
+	size_ = keep;
+	capacity_ = capacity;
+}
+#pragma endregion
+
+#pragma region 一括演算
+// 各関数はkBlock(16)レーンずつ処理する。容量がkBlockの倍数なので端数の処理は不要
+// 演算の順番はMathCore.hの1個ずつの関数と同じにしてあるので結果は一致する
+
+// ベクトルの加算
+void Add(const Vector3SoA& v1, const Vector3SoA& v2, Vector3SoA& result) {
+	assert(v1.Size() == v2.Size());
+	result.Resize(v1.Size());
+	const size_t count = RoundUpToBlock(v1.Size());
+	for (size_t i = 0; i < count; i += Vector3SoA::kBlock) {
+		for (size_t j = i; j < i + Vector3SoA::kBlock; j += Simd::kWidth) {
+			Simd::Store(result.X() + j, Simd::Add(Simd::Load(v1.X() + j), Simd::Load(v2.X() + j)));
+			Simd::Store(result.Y() + j, Simd::Add(Simd::Load(v1.Y() + j), Simd::Load(v2.Y() + j)));
+			Simd::Store(result.Z() + j, Simd::Add(Simd::Load(v1.Z() + j), Simd::Load(v2.Z() + j)));
+		}
+	}
+}
+
+// ベクトルの引き算
+void Subtract(const Vector3SoA& v1, const Vector3SoA& v2, Vector3SoA& result) {
+	assert(v1.Size() == v2.Size());
+	result.Resize(v1.Size());
+	const size_t count = RoundUpToBlock(v1.Size());
+	for (size_t i = 0; i < count; i += Vector3SoA::kBlock) {
+		for (size_t j = i; j < i + Vector3SoA::kBlock; j += Simd::kWidth) {
+			Simd::Store(result.X() + j, Simd::Sub(Simd::Load(v1.X() + j), Simd::Load(v2.X() + j)));
+			Simd::Store(result.Y() + j, Simd::Sub(Simd::Load(v1.Y() + j), Simd::Load(v2.Y() + j)));
+			Simd::Store(result.Z() + j, Simd::Sub(Simd::Load(v1.Z() + j), Simd::Load(v2.Z() + j)));
+		}
+	}
+}
+
+// ベクトルのスカラー倍
+void Multiply(float scalar, const Vector3SoA& v, Vector3SoA& result) {
+	result.Resize(v.Size());
+	const Simd::Float s = Simd::Set1(scalar);
+	const size_t count = RoundUpToBlock(v.Size());
+	for (size_t i = 0; i < count; i += Vector3SoA::kBlock) {
+		for (size_t j = i; j < i + Vector3SoA::kBlock; j += Simd::kWidth) {
+			Simd::Store(result.X() + j, Simd::Mul(s, Simd::Load(v.X() + j)));
+			Simd::Store(result.Y() + j, Simd::Mul(s, Simd::Load(v.Y() + j)));
+			Simd::Store(result.Z() + j, Simd::Mul(s, Simd::Load(v.Z() + j)));
+		}
+	}
+	// scalarが無限大やNaNだと0のレーンもNaNになるので、要素数より後ろを0に戻す
+	const size_t size = v.Size();
+	std::memset(result.X() + size, 0, sizeof(float) * (count - size));
+	std::memset(result.Y() + size, 0, sizeof(float) * (count - size));
+	std::memset(result.Z() + size, 0, sizeof(float) * (count - size));
+}
+
+// 内積
+void Dot(const Vector3SoA& v1, const Vector3SoA& v2, std::span<float> result) {
+	assert(v1.Size() == v2.Size());
+	assert(result.size() >= v1.Size());
+	const size_t count = v1.Size();
+	size_t i = 0;
+	for (; i + Simd::kWidth <= count; i += Simd::kWidth) {
+		Simd::Float xx = Simd::Mul(Simd::Load(v1.X() + i), Simd::Load(v2.X() + i));
+		Simd::Float yy = Simd::Mul(Simd::Load(v1.Y() + i), Simd::Load(v2.Y() + i));
+		Simd::Float zz = Simd::Mul(Simd::Load(v1.Z() + i), Simd::Load(v2.Z() + i));
+		Simd::StoreUnaligned(result.data() + i, Simd::Add(Simd::Add(xx, yy), zz));
+	}
+	for (; i < count; ++i) {
+		result[i] = v1.X()[i] * v2.X()[i] + v1.Y()[i] * v2.Y()[i] + v1.Z()[i] * v2.Z()[i];
+	}
+}
+
+// ベクトルの長さ
+void Length(const Vector3SoA& v, std::span<float> result) {
+	assert(result.size() >= v.Size());
+	const size_t count = v.Size();
+	size_t i = 0;
+	for (; i + Simd::kWidth <= count; i += Simd::kWidth) {
+		Simd::Float x = Simd::Load(v.X() + i);
+		Simd::Float y = Simd::Load(v.Y() + i);
+		Simd::Float z = Simd::Load(v.Z() + i);
+		Simd::Float dot = Simd::Add(Simd::Add(Simd::Mul(x, x), Simd::Mul(y, y)), Simd::Mul(z, z));
+		Simd::StoreUnaligned(result.data() + i, Simd::Sqrt(dot));
+	}
+	for (; i < count; ++i) {
+		result[i] = sqrtf(v.X()[i] * v.X()[i] + v.Y()[i] * v.Y()[i] + v.Z()[i] * v.Z()[i]);
+	}
+}
+
+// 正規化(長さ0のベクトルは0ベクトルになる)
+// 1個ずつのNormalizeと同じテンプレートを、成分の型をSimd::FloatPackにして使う
+void Normalize(const Vector3SoA& v, Vector3SoA& result) {
+	result.Resize(v.Size());
+	const size_t count = RoundUpToBlock(v.Size());
+	for (size_t i = 0; i < count; i += Vector3SoA::kBlock) {
+		for (size_t j = i; j < i + Vector3SoA::kBlock; j += Simd::kWidth) {
+			StorePack(result, j, Normalize(LoadPack(v, j)));
+		}
+	}
+}
+
+// クロス積
+// 結果を書く前に全成分を読み終えているので、resultがv1/v2と同じでもよい
+void Cross(const Vector3SoA& v1, const Vector3SoA& v2, Vector3SoA& result) {
+	assert(v1.Size() == v2.Size());
+	result.Resize(v1.Size());
+	const size_t count = RoundUpToBlock(v1.Size());
+	for (size_t i = 0; i < count; i += Vector3SoA::kBlock) {
+		for (size_t j = i; j < i + Vector3SoA::kBlock; j += Simd::kWidth) {
+			StorePack(result, j, Cross(LoadPack(v1, j), LoadPack(v2, j)));
+		}
+	}
+}
+#pragma endregion
@@ -0,0 +1,85 @@
+#pragma once
+#include <span>
+#include <vector>
+#include "Struct.h"
+
+// Vector3をx,y,zの3本のfloat配列に分けて保持するコンテナ(Structure of Arrays)
+// 各配列は64バイト境界に揃え、容量はkBlockの倍数に切り上げるので
+// 一括演算はレーンの端数を気にせずブロック単位で処理できる
+// 要素数より後ろ(容量まで)のレーンは常に0にしておく(一括演算が読んでも非正規化数やNaNにならない)
+class Vector3SoA {
+public:
+	// 一括演算が1ループで処理するレーン数
+	static constexpr size_t kBlock = 16;
+
+	Vector3SoA() = default;
+	explicit Vector3SoA(size_t size);
+	explicit Vector3SoA(std::span<const Vector3> vectors);
+	Vector3SoA(const Vector3SoA& other);
+	Vector3SoA(Vector3SoA&& other) noexcept;
+	Vector3SoA& operator=(const Vector3SoA& other);
+	Vector3SoA& operator=(Vector3SoA&& other) noexcept;
+	~Vector3SoA();
+
+	size_t Size() const { return size_; }
+	size_t Capacity() const { return capacity_; }
+	bool Empty() const { return size_ == 0; }
+
+	// 要素数を変更する。増えた分は0で初期化され、減った分は0で埋め直す
+	void Resize(size_t size);
+	// 容量を確保する(要素数は変わらない)
+	void Reserve(size_t capacity);
+	void Clear() { Resize(0); }
+	void PushBack(const Vector3& v);
+
+	Vector3 Get(size_t index) const { return { x_[index], y_[index], z_[index] }; }
+	void Set(size_t index, const Vector3& v) {
+		x_[index] = v.x;
+		y_[index] = v.y;
+		z_[index] = v.z;
+	}
+
+	// 各成分の配列(64バイト境界)
+	float* X() { return x_; }
+	float* Y() { return y_; }
+	float* Z() { return z_; }
+	const float* X() const { return x_; }
+	const float* Y() const { return y_; }
+	const float* Z() const { return z_; }
+
+	// AoSの配列からまとめて読み込む
+	void Assign(std::span<const Vector3> vectors);
+	// AoSの配列へまとめて書き出す(output.size() >= Size())
+	void CopyTo(std::span<Vector3> output) const;
+	std::vector<Vector3> ToVector() const;
+
+private:
+	// 容量を変更する。既存の要素はコピーし、新しい領域は0で埋める
+	void Reallocate(size_t capacity);
+	// 要素[begin, end)を0にする
+	void Zero(size_t begin, size_t end);
+
+	float* x_ = nullptr;
+	float* y_ = nullptr;
+	float* z_ = nullptr;
+	size_t size_ = 0;
+	size_t capacity_ = 0;
+};
+
+#pragma region 一括演算
+// 結果の格納先は入力と同じでもよい。格納先の要素数は入力に合わせて変更される
+// ベクトルの加算
+void Add(const Vector3SoA& v1, const Vector3SoA& v2, Vector3SoA& result);
+// ベクトルの引き算
+void Subtract(const Vector3SoA& v1, const Vector3SoA& v2, Vector3SoA& result);
+// ベクトルのスカラー倍
+void Multiply(float scalar, const Vector3SoA& v, Vector3SoA& result);
+// 内積(result.size() >= v1.Size())
+void Dot(const Vector3SoA& v1, const Vector3SoA& v2, std::span<float> result);
+// ベクトルの長さ(result.size() >= v.Size())
+void Length(const Vector3SoA& v, std::span<float> result);
+// 正規化(長さ0のベクトルは0ベクトルになる)
+void Normalize(const Vector3SoA& v, Vector3SoA& result);
+// クロス積
+void Cross(const Vector3SoA& v1, const Vector3SoA& v2, Vector3SoA& result);
+#pragma endregion
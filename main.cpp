@@ -1,6 +1,7 @@
 #include <Novice.h>
 #include "Struct.h"
 #include "Function.h"
+#include "Profiler.h"
 
 const char kWindowTitle[] = "LE2B_02_イトウカズイ_タイトル";
 
@@ -12,13 +13,26 @@ void MatrixScreenPrintf(int x, int y, const Matrix4x4& matrix, const char* label
 	}
 }
 
+// プロファイラの直近のフレームの統計を画面に表示
+void ProfilerScreenPrintf(int x, int y) {
+	const Profiler::FrameStatistics& frame = Profiler::GetFrameStatistics();
+	Novice::ScreenPrintf(x, y, "frame %6.2fms (avg %6.2f max %6.2f)%s", frame.milliseconds, frame.averageMilliseconds,
+		frame.maxMilliseconds, Profiler::IsCapturing() ? " capturing" : "");
+	int line = 1;
+	for (const Profiler::ZoneStatistics& zone : Profiler::GetZoneStatistics()) {
+		Novice::ScreenPrintf(x, y + line * 20, "%-24s %6.2fms (avg %6.2f max %6.2f) x%u", zone.name, zone.milliseconds,
+			zone.averageMilliseconds, zone.maxMilliseconds, zone.callCount);
+		++line;
+	}
+}
+
 // Windowsアプリでのエントリーポイント(main関数)
 int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 
 	// ライブラリの初期化
 	Novice::Initialize(kWindowTitle, 1280, 720);
 
-	Vector3 axis = Normalize({ 1.0f, 1.0f, 1.0f });
+	Vector3 axis = Normalize(Vector3{ 1.0f, 1.0f, 1.0f });
 	float angle = 0.44f;
 	Matrix4x4 rotateMatrix = MakeRotateAxisAngle(axis, angle);
 
@@ -26,8 +40,12 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	char keys[256] = {0};
 	char preKeys[256] = {0};
 
+	MT4_PROFILE_THREAD_NAME("Main");
+
 	// ウィンドウの×ボタンが押されるまでループ
 	while (Novice::ProcessMessage() == 0) {
+		MT4_PROFILE_BEGIN_FRAME();
+
 		// フレームの開始
 		Novice::BeginFrame();
 
@@ -38,7 +56,19 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		///
 		/// ↓更新処理ここから
 		///
-
+		{
+			MT4_PROFILE_ZONE("Update");
+
+			// Pキーでキャプチャを始め、もう一度押したらChromeのトレース形式で書き出す
+			if (preKeys[DIK_P] == 0 && keys[DIK_P] != 0) {
+				if (Profiler::IsCapturing()) {
+					Profiler::EndCapture();
+					Profiler::WriteChromeTrace("profile.json");
+				} else {
+					Profiler::BeginCapture();
+				}
+			}
+		}
 		///
 		/// ↑更新処理ここまで
 		///
@@ -46,15 +76,22 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		///
 		/// ↓描画処理ここから
 		///
+		{
+			MT4_PROFILE_ZONE("Draw");
 
-		MatrixScreenPrintf(0, 0, rotateMatrix, "matrix");
-
+			MatrixScreenPrintf(0, 0, rotateMatrix, "matrix");
+			ProfilerScreenPrintf(0, 120);
+		}
 		///
 		/// ↑描画処理ここまで
 		///
 
 		// フレームの終了
-		Novice::EndFrame();
+		{
+			MT4_PROFILE_ZONE("Novice::EndFrame");
+			Novice::EndFrame();
+		}
+		MT4_PROFILE_END_FRAME();
 
 		// ESCキーが押されたらループを抜ける
 		if (preKeys[DIK_ESCAPE] == 0 && keys[DIK_ESCAPE] != 0) {